@@ -0,0 +1,479 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpack.cpp
+// ============
+// read assets out of a single memory-mapped pack file
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetPack.h"
+#include "Lz4Codec.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+// declaration of the pack file layout and helper functions
+namespace
+{
+	// identifies an asset pack file
+	const char g_PackMagic[4] = { 'A', 'P', 'A', 'K' };
+	// bump whenever the layout changes
+	const uint32_t g_PackVersion = 1;
+	// alignment of the data of each entry in the file, which keeps
+	// the aligned mip levels of packed texture cache files aligned
+	const size_t g_EntryAlignment = 16;
+	// compression methods of the entries
+	const uint32_t g_CompressionNone = 0;
+	const uint32_t g_CompressionLz4 = 1;
+
+	struct PACK_FILE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t reserved;
+		uint64_t indexOffset;
+		uint64_t namesOffset;
+		uint64_t namesSize;
+	};
+
+	// round a file offset up to the entry alignment
+	size_t AlignOffset(size_t offset)
+	{
+		return((offset + g_EntryAlignment - 1) & ~(g_EntryAlignment - 1));
+	}
+
+	// skip any leading "./" of a relative path
+	const char* SkipCurrentDirectory(const char* name)
+	{
+		while ((name[0] == '.') && ((name[1] == '/') || (name[1] == '\\')))
+		{
+			name += 2;
+		}
+		return(name);
+	}
+
+	// entry names always use forward slashes
+	char NormalizeCharacter(char character)
+	{
+		return((character == '\\') ? '/' : character);
+	}
+
+	// add the passed in file, or every file below the passed in directory
+	void ListFiles(const std::string& path, std::vector<std::string>& filenames)
+	{
+#ifdef _WIN32
+		DWORD attributes = GetFileAttributesA(path.c_str());
+		if ((attributes == INVALID_FILE_ATTRIBUTES) || ((attributes & FILE_ATTRIBUTE_DIRECTORY) == 0))
+		{
+			filenames.push_back(path);
+			return;
+		}
+
+		std::vector<std::string> children;
+		WIN32_FIND_DATAA findData;
+		HANDLE findHandle = FindFirstFileA((path + "\\*").c_str(), &findData);
+		if (findHandle != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				if ((strcmp(findData.cFileName, ".") != 0) && (strcmp(findData.cFileName, "..") != 0))
+				{
+					children.push_back(path + "/" + findData.cFileName);
+				}
+			} while (FindNextFileA(findHandle, &findData) != FALSE);
+			FindClose(findHandle);
+		}
+#else
+		struct stat fileInfo;
+		if ((stat(path.c_str(), &fileInfo) != 0) || (S_ISDIR(fileInfo.st_mode) == false))
+		{
+			filenames.push_back(path);
+			return;
+		}
+
+		std::vector<std::string> children;
+		DIR* pDirectory = opendir(path.c_str());
+		if (pDirectory != NULL)
+		{
+			struct dirent* pEntry;
+			while ((pEntry = readdir(pDirectory)) != NULL)
+			{
+				if ((strcmp(pEntry->d_name, ".") != 0) && (strcmp(pEntry->d_name, "..") != 0))
+				{
+					children.push_back(path + "/" + pEntry->d_name);
+				}
+			}
+			closedir(pDirectory);
+		}
+#endif
+
+		// sort the directory contents so the pack layout is reproducible
+		std::sort(children.begin(), children.end());
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			ListFiles(children[i], filenames);
+		}
+	}
+}
+
+/***********************************************************
+ *  AssetPack()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AssetPack::AssetPack()
+{
+	m_pEntries = NULL;
+	m_entryCount = 0;
+	m_pNames = NULL;
+	m_namesSize = 0;
+}
+
+/***********************************************************
+ *  HashName()
+ *
+ *  This method is used for calculating the 64-bit FNV-1a
+ *  hash of an entry name, with backslashes treated as
+ *  forward slashes and any leading "./" skipped.
+ ***********************************************************/
+uint64_t AssetPack::HashName(const char* name)
+{
+	name = SkipCurrentDirectory(name);
+
+	uint64_t hash = 14695981039346656037ULL;
+	while (*name != '\0')
+	{
+		hash ^= (unsigned char)NormalizeCharacter(*name);
+		hash *= 1099511628211ULL;
+		name++;
+	}
+	return(hash);
+}
+
+/***********************************************************
+ *  NameEquals()
+ *
+ *  This method is used for comparing an entry name with a
+ *  name stored in the pack index, the same way HashName()
+ *  treats the passed in name.
+ ***********************************************************/
+bool AssetPack::NameEquals(const char* name, const char* indexName, size_t indexNameLength)
+{
+	name = SkipCurrentDirectory(name);
+
+	for (size_t i = 0; i < indexNameLength; i++)
+	{
+		if ((name[i] == '\0') || (NormalizeCharacter(name[i]) != indexName[i]))
+		{
+			return(false);
+		}
+	}
+	return(name[indexNameLength] == '\0');
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping the passed in pack file
+ *  and validating its index.  Returns false if the file
+ *  does not exist or is not a valid pack file.
+ ***********************************************************/
+bool AssetPack::Open(const char* filename)
+{
+	Close();
+
+	if (m_file.Open(filename) == false)
+	{
+		return(false);
+	}
+
+	const unsigned char* pData = m_file.GetData();
+	size_t fileSize = m_file.GetSize();
+
+	// validate the header before trusting any of the sizes in it
+	PACK_FILE_HEADER header;
+	if (fileSize < sizeof(header))
+	{
+		m_file.Close();
+		return(false);
+	}
+	memcpy(&header, pData, sizeof(header));
+
+	if ((memcmp(header.magic, g_PackMagic, sizeof(g_PackMagic)) != 0) ||
+		(header.version != g_PackVersion) ||
+		(header.entryCount == 0) ||
+		((header.indexOffset % g_EntryAlignment) != 0) ||
+		(header.indexOffset > fileSize) ||
+		((uint64_t)header.entryCount * sizeof(PACK_ENTRY) > fileSize - header.indexOffset) ||
+		(header.namesOffset > fileSize) ||
+		(header.namesSize > fileSize - header.namesOffset))
+	{
+		std::cout << "Ignoring invalid asset pack: " << filename << std::endl;
+		m_file.Close();
+		return(false);
+	}
+
+	const PACK_ENTRY* pEntries = (const PACK_ENTRY*)(pData + header.indexOffset);
+	for (uint32_t i = 0; i < header.entryCount; i++)
+	{
+		const PACK_ENTRY& entry = pEntries[i];
+		if ((entry.dataOffset > fileSize) || (entry.storedSize > fileSize - entry.dataOffset) ||
+			(entry.nameOffset > header.namesSize) || (entry.nameLength > header.namesSize - entry.nameOffset) ||
+			((entry.compression != g_CompressionNone) && (entry.compression != g_CompressionLz4)) ||
+			((entry.compression == g_CompressionNone) && (entry.storedSize != entry.size)) ||
+			((i > 0) && (pEntries[i - 1].nameHash > entry.nameHash)))
+		{
+			std::cout << "Ignoring corrupt asset pack: " << filename << std::endl;
+			m_file.Close();
+			return(false);
+		}
+	}
+
+	m_pEntries = pEntries;
+	m_entryCount = header.entryCount;
+	m_pNames = (const char*)(pData + header.namesOffset);
+	m_namesSize = (size_t)header.namesSize;
+
+	std::cout << "Mounted asset pack " << filename << " with " << m_entryCount << " entries" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the pack file and
+ *  freeing the decompressed entries.  Pointers returned by
+ *  Find() are no longer valid afterwards.
+ ***********************************************************/
+void AssetPack::Close()
+{
+	std::lock_guard<std::mutex> lock(m_decompressMutex);
+	m_decompressed.clear();
+	m_pEntries = NULL;
+	m_entryCount = 0;
+	m_pNames = NULL;
+	m_namesSize = 0;
+	m_file.Close();
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for finding the entry with the
+ *  passed in relative path and getting its contents.  A
+ *  stored entry points straight into the mapped file and a
+ *  compressed entry is decompressed on its first lookup.
+ *  The contents stay valid until the pack is closed.  Safe
+ *  to call from several threads at the same time.
+ ***********************************************************/
+bool AssetPack::Find(const char* name, const unsigned char*& pData, size_t& size)
+{
+	if (m_entryCount == 0)
+	{
+		return(false);
+	}
+
+	// binary search for the first entry with the name hash
+	uint64_t nameHash = HashName(name);
+	uint32_t first = 0;
+	uint32_t last = m_entryCount;
+	while (first < last)
+	{
+		uint32_t middle = first + (last - first) / 2;
+		if (m_pEntries[middle].nameHash < nameHash)
+		{
+			first = middle + 1;
+		}
+		else
+		{
+			last = middle;
+		}
+	}
+
+	for (uint32_t i = first; (i < m_entryCount) && (m_pEntries[i].nameHash == nameHash); i++)
+	{
+		const PACK_ENTRY& entry = m_pEntries[i];
+		if (NameEquals(name, m_pNames + entry.nameOffset, entry.nameLength) == false)
+		{
+			continue;
+		}
+
+		const unsigned char* pStored = m_file.GetData() + entry.dataOffset;
+		if (entry.compression == g_CompressionNone)
+		{
+			pData = pStored;
+			size = (size_t)entry.size;
+			return(true);
+		}
+
+		std::lock_guard<std::mutex> lock(m_decompressMutex);
+		std::unique_ptr<std::vector<unsigned char>>& pContents = m_decompressed[i];
+		if (pContents == NULL)
+		{
+			std::unique_ptr<std::vector<unsigned char>> pDecompressed(
+				new std::vector<unsigned char>((size_t)entry.size));
+			if (Lz4Codec::Decompress(pStored, (size_t)entry.storedSize,
+				pDecompressed->data(), pDecompressed->size()) == false)
+			{
+				std::cerr << "Failed to decompress asset pack entry: " << name << std::endl;
+				m_decompressed.erase(i);
+				return(false);
+			}
+			pContents = std::move(pDecompressed);
+		}
+
+		pData = pContents->data();
+		size = pContents->size();
+		return(true);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for writing a pack file holding the
+ *  passed in files, and every file below the passed in
+ *  directories, under their relative paths.  Each entry is
+ *  LZ4 compressed when that makes it noticeably smaller,
+ *  otherwise it is stored so it can be read in place.
+ ***********************************************************/
+bool AssetPack::Build(const char* packFilename, const std::vector<std::string>& paths)
+{
+	std::vector<std::string> filenames;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		ListFiles(paths[i], filenames);
+	}
+
+	std::string tempFilename = std::string(packFilename) + ".tmp";
+	FILE* pFile = fopen(tempFilename.c_str(), "wb");
+	if (pFile == NULL)
+	{
+		std::cerr << "Unable to create asset pack: " << packFilename << std::endl;
+		return(false);
+	}
+
+	// the header is written again once the index location is known
+	PACK_FILE_HEADER header;
+	memset(&header, 0, sizeof(header));
+	bool bSuccess = (fwrite(&header, sizeof(header), 1, pFile) == 1);
+
+	const unsigned char padding[g_EntryAlignment] = { 0 };
+	size_t written = sizeof(header);
+	size_t totalSize = 0;
+	size_t totalStoredSize = 0;
+
+	std::vector<PACK_ENTRY> entries;
+	std::string names;
+	std::vector<unsigned char> compressed;
+
+	for (size_t i = 0; (i < filenames.size()) && bSuccess; i++)
+	{
+		// normalize the name the same way the lookups do
+		std::string name = SkipCurrentDirectory(filenames[i].c_str());
+		std::replace(name.begin(), name.end(), '\\', '/');
+
+		bool bDuplicate = false;
+		for (size_t j = 0; j < entries.size(); j++)
+		{
+			bDuplicate = bDuplicate || NameEquals(name.c_str(), names.c_str() + entries[j].nameOffset, entries[j].nameLength);
+		}
+		if (bDuplicate == true)
+		{
+			continue;
+		}
+
+		MappedFile sourceFile;
+		if (sourceFile.Open(filenames[i].c_str()) == false)
+		{
+			std::cout << "Skipping unreadable or empty file: " << filenames[i] << std::endl;
+			continue;
+		}
+
+		// keep the compressed data only when it saves more than an eighth
+		Lz4Codec::Compress(sourceFile.GetData(), sourceFile.GetSize(), compressed);
+		bool bCompress = (compressed.size() < sourceFile.GetSize() - sourceFile.GetSize() / 8);
+		const unsigned char* pStored = bCompress ? compressed.data() : sourceFile.GetData();
+		size_t storedSize = bCompress ? compressed.size() : sourceFile.GetSize();
+
+		size_t dataOffset = AlignOffset(written);
+		bSuccess = (fwrite(padding, 1, dataOffset - written, pFile) == dataOffset - written);
+		bSuccess = bSuccess && (fwrite(pStored, 1, storedSize, pFile) == storedSize);
+		written = dataOffset + storedSize;
+
+		PACK_ENTRY entry;
+		entry.nameHash = HashName(name.c_str());
+		entry.nameOffset = (uint32_t)names.size();
+		entry.nameLength = (uint32_t)name.size();
+		entry.dataOffset = dataOffset;
+		entry.storedSize = storedSize;
+		entry.size = sourceFile.GetSize();
+		entry.compression = bCompress ? g_CompressionLz4 : g_CompressionNone;
+		entry.reserved = 0;
+		entries.push_back(entry);
+		names += name;
+
+		totalSize += sourceFile.GetSize();
+		totalStoredSize += storedSize;
+
+		std::cout << "  " << name << ": " << sourceFile.GetSize() << " bytes"
+			<< (bCompress ? ", lz4 " : ", stored ") << storedSize << " bytes" << std::endl;
+	}
+
+	if (entries.empty() == true)
+	{
+		std::cerr << "No files to pack" << std::endl;
+		bSuccess = false;
+	}
+
+	// the index is sorted by name hash for the binary search in Find()
+	std::stable_sort(entries.begin(), entries.end(),
+		[](const PACK_ENTRY& a, const PACK_ENTRY& b) { return a.nameHash < b.nameHash; });
+
+	size_t indexOffset = AlignOffset(written);
+	bSuccess = bSuccess && (fwrite(padding, 1, indexOffset - written, pFile) == indexOffset - written);
+	bSuccess = bSuccess && (fwrite(entries.data(), sizeof(PACK_ENTRY), entries.size(), pFile) == entries.size());
+	size_t namesOffset = indexOffset + entries.size() * sizeof(PACK_ENTRY);
+	bSuccess = bSuccess && (fwrite(names.data(), 1, names.size(), pFile) == names.size());
+
+	memcpy(header.magic, g_PackMagic, sizeof(g_PackMagic));
+	header.version = g_PackVersion;
+	header.entryCount = (uint32_t)entries.size();
+	header.indexOffset = indexOffset;
+	header.namesOffset = namesOffset;
+	header.namesSize = names.size();
+	bSuccess = bSuccess && (fseek(pFile, 0, SEEK_SET) == 0);
+	bSuccess = bSuccess && (fwrite(&header, sizeof(header), 1, pFile) == 1);
+
+	bSuccess = (fclose(pFile) == 0) && bSuccess;
+
+	// replace any previous pack file with the completed one
+	remove(packFilename);
+	if ((bSuccess == false) || (rename(tempFilename.c_str(), packFilename) != 0))
+	{
+		remove(tempFilename.c_str());
+		std::cerr << "Failed to write asset pack: " << packFilename << std::endl;
+		return(false);
+	}
+
+	std::cout << "Packed " << entries.size() << " files into " << packFilename << ": "
+		<< totalSize << " bytes, " << totalStoredSize << " bytes stored" << std::endl;
+
+	return(true);
+}
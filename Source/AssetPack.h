@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetpack.h
+// ============
+// read assets out of a single memory-mapped pack file
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  AssetPack
+ *
+ *  This class maps a pack file holding any number of asset
+ *  files, such as shader sources, texture images and cached
+ *  texture mip chains, with a single open.  Entries are
+ *  found by their relative path through a sorted hash
+ *  index.  Stored entries are read in place with no copy,
+ *  and LZ4 compressed entries are decompressed once on
+ *  first use.
+ ***********************************************************/
+class AssetPack
+{
+public:
+	// constructor
+	AssetPack();
+
+	// map the passed in pack file and validate its index
+	bool Open(const char* filename);
+	// unmap the pack file and free any decompressed entries
+	void Close();
+	// check whether a pack file is open
+	bool IsOpen() const { return m_entryCount > 0; }
+
+	// find an entry by its relative path and get its contents
+	bool Find(const char* name, const unsigned char*& pData, size_t& size);
+
+	// write a pack file holding the passed in files and directories
+	static bool Build(const char* packFilename, const std::vector<std::string>& paths);
+
+private:
+	struct PACK_ENTRY
+	{
+		uint64_t nameHash;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		uint64_t dataOffset;
+		uint64_t storedSize;
+		uint64_t size;
+		uint32_t compression;
+		uint32_t reserved;
+	};
+
+	// hash an entry name the same way it is stored in the index
+	static uint64_t HashName(const char* name);
+	// compare an entry name with a name from the index
+	static bool NameEquals(const char* name, const char* indexName, size_t indexNameLength);
+
+	// the mapped pack file
+	MappedFile m_file;
+	// index of entries sorted by name hash, pointing into the mapped file
+	const PACK_ENTRY* m_pEntries;
+	uint32_t m_entryCount;
+	// entry names, pointing into the mapped file
+	const char* m_pNames;
+	size_t m_namesSize;
+	// decompressed contents of compressed entries, guarded by m_decompressMutex
+	std::unordered_map<uint32_t, std::unique_ptr<std::vector<unsigned char>>> m_decompressed;
+	std::mutex m_decompressMutex;
+
+	// asset packs cannot be copied
+	AssetPack(const AssetPack&);
+	AssetPack& operator=(const AssetPack&);
+};
@@ -0,0 +1,507 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompressor.cpp
+// ============
+// encode texture images into the BC1 and BC3 block compressed formats
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// the nearest color search uses SSE2 on every x64 build
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define BLOCK_COMPRESSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+// declaration of the helper functions
+namespace
+{
+	// quantize an 8-bit color to RGB 5:6:5
+	unsigned short PackColor565(const float color[3])
+	{
+		int r = std::min(31, std::max(0, (int)(color[0] * 31.0f / 255.0f + 0.5f)));
+		int g = std::min(63, std::max(0, (int)(color[1] * 63.0f / 255.0f + 0.5f)));
+		int b = std::min(31, std::max(0, (int)(color[2] * 31.0f / 255.0f + 0.5f)));
+		return((unsigned short)((r << 11) | (g << 5) | b));
+	}
+
+	// expand an RGB 5:6:5 color back to 8 bits per channel
+	void UnpackColor565(unsigned short packed, float color[3])
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (float)((r << 3) | (r >> 2));
+		color[1] = (float)((g << 2) | (g >> 4));
+		color[2] = (float)((b << 3) | (b >> 2));
+	}
+
+	// build the four color palette of a BC1 block in four color mode
+	void BuildPalette(unsigned short color0, unsigned short color1, float palette[4][3])
+	{
+		UnpackColor565(color0, palette[0]);
+		UnpackColor565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+	}
+
+	// pick the nearest palette entry for each texel and return the total error
+	float FindColorIndices(
+		const float red[16], const float green[16], const float blue[16],
+		const float palette[4][3], unsigned char indices[16])
+	{
+		float totalError = 0.0f;
+
+#ifdef BLOCK_COMPRESSOR_SSE2
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128 r = _mm_loadu_ps(red + i);
+			__m128 g = _mm_loadu_ps(green + i);
+			__m128 b = _mm_loadu_ps(blue + i);
+			__m128 bestError = _mm_set1_ps(1.0e30f);
+			__m128i bestIndex = _mm_setzero_si128();
+
+			for (int entry = 0; entry < 4; entry++)
+			{
+				__m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[entry][0]));
+				__m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[entry][1]));
+				__m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[entry][2]));
+				__m128 error = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+				__m128 closer = _mm_cmplt_ps(error, bestError);
+				bestError = _mm_min_ps(error, bestError);
+				__m128i closerMask = _mm_castps_si128(closer);
+				bestIndex = _mm_or_si128(
+					_mm_and_si128(closerMask, _mm_set1_epi32(entry)),
+					_mm_andnot_si128(closerMask, bestIndex));
+			}
+
+			float errors[4];
+			int bestIndices[4];
+			_mm_storeu_ps(errors, bestError);
+			_mm_storeu_si128((__m128i*)bestIndices, bestIndex);
+			for (int j = 0; j < 4; j++)
+			{
+				indices[i + j] = (unsigned char)bestIndices[j];
+				totalError += errors[j];
+			}
+		}
+#else
+		for (int i = 0; i < 16; i++)
+		{
+			float bestError = 1.0e30f;
+			for (int entry = 0; entry < 4; entry++)
+			{
+				float dr = red[i] - palette[entry][0];
+				float dg = green[i] - palette[entry][1];
+				float db = blue[i] - palette[entry][2];
+				float error = dr * dr + dg * dg + db * db;
+				if (error < bestError)
+				{
+					bestError = error;
+					indices[i] = (unsigned char)entry;
+				}
+			}
+			totalError += bestError;
+		}
+#endif
+
+		return(totalError);
+	}
+
+	// fit the two endpoint colors to the texels along their principal axis
+	void FitEndpoints(
+		const float red[16], const float green[16], const float blue[16],
+		float endpoint0[3], float endpoint1[3])
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			mean[0] += red[i];
+			mean[1] += green[i];
+			mean[2] += blue[i];
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			mean[c] /= 16.0f;
+		}
+
+		// covariance of the texel colors
+		float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float r = red[i] - mean[0];
+			float g = green[i] - mean[1];
+			float b = blue[i] - mean[2];
+			covariance[0] += r * r;
+			covariance[1] += r * g;
+			covariance[2] += r * b;
+			covariance[3] += g * g;
+			covariance[4] += g * b;
+			covariance[5] += b * b;
+		}
+
+		// a few power iterations converge on the principal axis
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 4; iteration++)
+		{
+			float x = axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2];
+			float y = axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4];
+			float z = axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5];
+			float length = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+			if (length < 1.0e-6f)
+			{
+				break;
+			}
+			axis[0] = x / length;
+			axis[1] = y / length;
+			axis[2] = z / length;
+		}
+
+		// the endpoints are the texels furthest along the axis
+		float minimum = 1.0e30f;
+		float maximum = -1.0e30f;
+		int minimumTexel = 0;
+		int maximumTexel = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			float projection = red[i] * axis[0] + green[i] * axis[1] + blue[i] * axis[2];
+			if (projection < minimum)
+			{
+				minimum = projection;
+				minimumTexel = i;
+			}
+			if (projection > maximum)
+			{
+				maximum = projection;
+				maximumTexel = i;
+			}
+		}
+
+		endpoint0[0] = red[maximumTexel];
+		endpoint0[1] = green[maximumTexel];
+		endpoint0[2] = blue[maximumTexel];
+		endpoint1[0] = red[minimumTexel];
+		endpoint1[1] = green[minimumTexel];
+		endpoint1[2] = blue[minimumTexel];
+	}
+
+	// solve for the endpoints that best reproduce the texels with
+	// the passed in indices, returns false if they are undetermined
+	bool RefineEndpoints(
+		const float red[16], const float green[16], const float blue[16],
+		const unsigned char indices[16], float endpoint0[3], float endpoint1[3])
+	{
+		// weight of the first endpoint for each palette entry
+		const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+		float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+		float ax[3] = { 0.0f, 0.0f, 0.0f };
+		float bx[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float a = weights[indices[i]];
+			float b = 1.0f - a;
+			float texel[3] = { red[i], green[i], blue[i] };
+			aa += a * a;
+			bb += b * b;
+			ab += a * b;
+			for (int c = 0; c < 3; c++)
+			{
+				ax[c] += a * texel[c];
+				bx[c] += b * texel[c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1.0e-6f)
+		{
+			return(false);
+		}
+
+		for (int c = 0; c < 3; c++)
+		{
+			endpoint0[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) / determinant));
+			endpoint1[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) / determinant));
+		}
+		return(true);
+	}
+
+	// quantize the endpoints and pick the texel indices, returns the error
+	float EncodeColors(
+		const float red[16], const float green[16], const float blue[16],
+		const float endpoint0[3], const float endpoint1[3],
+		unsigned short& color0, unsigned short& color1, unsigned char indices[16])
+	{
+		color0 = PackColor565(endpoint0);
+		color1 = PackColor565(endpoint1);
+
+		// four color mode needs the first color to be the larger one
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+		}
+
+		if (color0 == color1)
+		{
+			// a single color block - every texel uses the first color
+			float palette[4][3];
+			BuildPalette(color0, color1, palette);
+			float error = 0.0f;
+			for (int i = 0; i < 16; i++)
+			{
+				float dr = red[i] - palette[0][0];
+				float dg = green[i] - palette[0][1];
+				float db = blue[i] - palette[0][2];
+				error += dr * dr + dg * dg + db * db;
+				indices[i] = 0;
+			}
+			return(error);
+		}
+
+		float palette[4][3];
+		BuildPalette(color0, color1, palette);
+		return(FindColorIndices(red, green, blue, palette, indices));
+	}
+
+	// write the color part of a BC1 or BC3 block
+	void WriteColorBlock(unsigned short color0, unsigned short color1, const unsigned char indices[16], unsigned char block[8])
+	{
+		unsigned int packedIndices = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			packedIndices |= (unsigned int)indices[i] << (i * 2);
+		}
+
+		block[0] = (unsigned char)(color0 & 0xFF);
+		block[1] = (unsigned char)(color0 >> 8);
+		block[2] = (unsigned char)(color1 & 0xFF);
+		block[3] = (unsigned char)(color1 >> 8);
+		block[4] = (unsigned char)(packedIndices & 0xFF);
+		block[5] = (unsigned char)((packedIndices >> 8) & 0xFF);
+		block[6] = (unsigned char)((packedIndices >> 16) & 0xFF);
+		block[7] = (unsigned char)(packedIndices >> 24);
+	}
+
+	// write the alpha part of a BC3 block
+	void WriteAlphaBlock(const unsigned char texels[64], unsigned char block[8])
+	{
+		int maximum = 0;
+		int minimum = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			maximum = std::max(maximum, (int)texels[i * 4 + 3]);
+			minimum = std::min(minimum, (int)texels[i * 4 + 3]);
+		}
+
+		block[0] = (unsigned char)maximum;
+		block[1] = (unsigned char)minimum;
+
+		// eight alpha values are interpolated between the two endpoints,
+		// index 0 is the maximum, 1 the minimum and 2 to 7 lie between
+		unsigned long long packedIndices = 0;
+		if (maximum > minimum)
+		{
+			int range = maximum - minimum;
+			for (int i = 0; i < 16; i++)
+			{
+				int step = ((maximum - texels[i * 4 + 3]) * 7 + range / 2) / range;
+				unsigned long long index = (step == 0) ? 0 : ((step == 7) ? 1 : step + 1);
+				packedIndices |= index << (i * 3);
+			}
+		}
+
+		for (int i = 0; i < 6; i++)
+		{
+			block[2 + i] = (unsigned char)((packedIndices >> (i * 8)) & 0xFF);
+		}
+	}
+}
+
+/***********************************************************
+ *  IsCompressedFormat()
+ *
+ *  This method is used for checking whether the passed in
+ *  OpenGL internal format is one of the block compressed
+ *  formats written by this class.
+ ***********************************************************/
+bool BlockCompressor::IsCompressedFormat(GLenum internalFormat)
+{
+	return((internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ||
+		(internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT));
+}
+
+/***********************************************************
+ *  GetCompressedFormat()
+ *
+ *  This method is used for getting the block compressed
+ *  format for an image - BC1 for opaque images and BC3 for
+ *  images with an alpha channel.
+ ***********************************************************/
+GLenum BlockCompressor::GetCompressedFormat(int colorChannels)
+{
+	return((colorChannels == 4) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+}
+
+/***********************************************************
+ *  GetLevelSize()
+ *
+ *  This method is used for getting the number of bytes in a
+ *  mip level of the passed in size and format.  Compressed
+ *  levels are rounded up to whole 4x4 blocks.
+ ***********************************************************/
+size_t BlockCompressor::GetLevelSize(GLenum internalFormat, int width, int height, int colorChannels)
+{
+	if (IsCompressedFormat(internalFormat) == false)
+	{
+		return((size_t)width * height * colorChannels);
+	}
+
+	size_t blockBytes = (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ? 8 : 16;
+	return((size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes);
+}
+
+/***********************************************************
+ *  EncodeBlockBC1()
+ *
+ *  This method is used for encoding a block of 4x4 RGBA
+ *  texels into an opaque BC1 block.  The endpoints are fit
+ *  along the principal axis of the texel colors and then
+ *  refined with a least squares fit to the chosen indices.
+ ***********************************************************/
+void BlockCompressor::EncodeBlockBC1(const unsigned char texels[64], unsigned char block[8])
+{
+	float red[16], green[16], blue[16];
+	for (int i = 0; i < 16; i++)
+	{
+		red[i] = texels[i * 4 + 0];
+		green[i] = texels[i * 4 + 1];
+		blue[i] = texels[i * 4 + 2];
+	}
+
+	float endpoint0[3], endpoint1[3];
+	FitEndpoints(red, green, blue, endpoint0, endpoint1);
+
+	unsigned short color0, color1;
+	unsigned char indices[16];
+	float error = EncodeColors(red, green, blue, endpoint0, endpoint1, color0, color1, indices);
+
+	// keep the refined endpoints only if they lower the error
+	if ((error > 0.0f) && (RefineEndpoints(red, green, blue, indices, endpoint0, endpoint1) == true))
+	{
+		unsigned short refinedColor0, refinedColor1;
+		unsigned char refinedIndices[16];
+		float refinedError = EncodeColors(red, green, blue, endpoint0, endpoint1,
+			refinedColor0, refinedColor1, refinedIndices);
+		if (refinedError < error)
+		{
+			color0 = refinedColor0;
+			color1 = refinedColor1;
+			memcpy(indices, refinedIndices, sizeof(indices));
+		}
+	}
+
+	WriteColorBlock(color0, color1, indices, block);
+}
+
+/***********************************************************
+ *  EncodeBlockBC3()
+ *
+ *  This method is used for encoding a block of 4x4 RGBA
+ *  texels into a BC3 block, an interpolated alpha block
+ *  followed by a BC1 color block.
+ ***********************************************************/
+void BlockCompressor::EncodeBlockBC3(const unsigned char texels[64], unsigned char block[16])
+{
+	WriteAlphaBlock(texels, block);
+	EncodeBlockBC1(texels, block + 8);
+}
+
+/***********************************************************
+ *  CompressImage()
+ *
+ *  This method is used for encoding every mip level of an
+ *  uncompressed image into the block compressed format for
+ *  its channels.  Blocks that reach past the edge of a mip
+ *  level repeat the edge texels.
+ ***********************************************************/
+void BlockCompressor::CompressImage(TEXTURE_IMAGE& image)
+{
+	if (IsCompressedFormat(image.internalFormat) == true)
+	{
+		return;
+	}
+
+	GLenum format = GetCompressedFormat(image.colorChannels);
+	size_t blockBytes = (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ? 8 : 16;
+
+	std::vector<TEXTURE_MIP_LEVEL> mips(image.mips.size());
+	size_t totalSize = 0;
+	for (size_t level = 0; level < image.mips.size(); level++)
+	{
+		mips[level].width = image.mips[level].width;
+		mips[level].height = image.mips[level].height;
+		mips[level].offset = totalSize;
+		mips[level].size = GetLevelSize(format, mips[level].width, mips[level].height, image.colorChannels);
+		totalSize += mips[level].size;
+	}
+
+	std::vector<unsigned char> compressed(totalSize);
+	unsigned char texels[64];
+
+	for (size_t level = 0; level < image.mips.size(); level++)
+	{
+		const TEXTURE_MIP_LEVEL& source = image.mips[level];
+		const unsigned char* pSource = image.pData + source.offset;
+		unsigned char* pBlock = compressed.data() + mips[level].offset;
+
+		for (int blockY = 0; blockY < source.height; blockY += 4)
+		{
+			for (int blockX = 0; blockX < source.width; blockX += 4)
+			{
+				// gather the block texels as RGBA
+				for (int y = 0; y < 4; y++)
+				{
+					int sourceY = std::min(blockY + y, source.height - 1);
+					for (int x = 0; x < 4; x++)
+					{
+						int sourceX = std::min(blockX + x, source.width - 1);
+						const unsigned char* pTexel = pSource +
+							((size_t)sourceY * source.width + sourceX) * image.colorChannels;
+						unsigned char* pDestination = texels + (y * 4 + x) * 4;
+						pDestination[0] = pTexel[0];
+						pDestination[1] = pTexel[1];
+						pDestination[2] = pTexel[2];
+						pDestination[3] = (image.colorChannels == 4) ? pTexel[3] : 255;
+					}
+				}
+
+				if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+				{
+					EncodeBlockBC1(texels, pBlock);
+				}
+				else
+				{
+					EncodeBlockBC3(texels, pBlock);
+				}
+				pBlock += blockBytes;
+			}
+		}
+	}
+
+	image.internalFormat = format;
+	image.mips.swap(mips);
+	image.pixels.swap(compressed);
+	image.pMappedFile.reset();
+	image.pData = image.pixels.data();
+	image.bFromCache = false;
+}
@@ -0,0 +1,39 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompressor.h
+// ============
+// encode texture images into the BC1 and BC3 block compressed formats
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCache.h"
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  BlockCompressor
+ *
+ *  This class encodes the mip chain of a texture image into
+ *  4x4 texel blocks, BC1 (DXT1) for opaque images and BC3
+ *  (DXT5) for images with alpha, which OpenGL samples
+ *  directly in their compressed form.
+ ***********************************************************/
+class BlockCompressor
+{
+public:
+	// check whether an internal format is one of the block compressed formats
+	static bool IsCompressedFormat(GLenum internalFormat);
+	// get the block compressed format used for an image with the passed in channels
+	static GLenum GetCompressedFormat(int colorChannels);
+	// get the size in bytes of a mip level in the passed in format
+	static size_t GetLevelSize(GLenum internalFormat, int width, int height, int colorChannels);
+	// encode every mip level of an uncompressed image
+	static void CompressImage(TEXTURE_IMAGE& image);
+
+	// encode a single block of 4x4 RGBA texels
+	static void EncodeBlockBC1(const unsigned char texels[64], unsigned char block[8]);
+	static void EncodeBlockBC3(const unsigned char texels[64], unsigned char block[16]);
+};
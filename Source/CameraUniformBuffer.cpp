@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerauniformbuffer.cpp
+// ============
+// share the camera matrices with every shader through one uniform buffer
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraUniformBuffer.h"
+#include "GLResources.h"
+
+#include <cstring>
+#include <iostream>
+
+const char* const CameraUniformBuffer::BLOCK_NAME = "Camera";
+
+/***********************************************************
+ *  CameraUniformBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraUniformBuffer::CameraUniformBuffer()
+{
+	m_buffer = 0;
+	m_slotSize = 0;
+	m_currentSlot = -1;
+	m_pMapped = NULL;
+	for (int i = 0; i < SLOT_COUNT; i++)
+	{
+		m_fences[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~CameraUniformBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CameraUniformBuffer::~CameraUniformBuffer()
+{
+	for (int i = 0; i < SLOT_COUNT; i++)
+	{
+		if (NULL != m_fences[i])
+		{
+			glDeleteSync(m_fences[i]);
+			m_fences[i] = NULL;
+		}
+	}
+	if (m_buffer != 0)
+	{
+		if (NULL != m_pMapped)
+		{
+			GLResources::UnmapBuffer(m_buffer, GL_UNIFORM_BUFFER);
+			m_pMapped = NULL;
+		}
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the buffer ring.  Each
+ *  slot starts on the offset alignment the context needs
+ *  for binding a range of a uniform buffer.
+ ***********************************************************/
+bool CameraUniformBuffer::Initialize()
+{
+	if (m_buffer != 0)
+	{
+		return(true);
+	}
+
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment <= 0)
+	{
+		alignment = 256;
+	}
+	m_slotSize = ((GLsizeiptr)sizeof(CAMERA_UNIFORMS) + alignment - 1) / alignment * alignment;
+	GLsizeiptr bufferSize = m_slotSize * SLOT_COUNT;
+
+	m_buffer = GLResources::CreateBuffer();
+	if (m_buffer == 0)
+	{
+		std::cerr << "Failed to create the camera uniform buffer" << std::endl;
+		return(false);
+	}
+
+	if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLResources::BufferStorage(m_buffer, GL_UNIFORM_BUFFER, bufferSize, NULL, flags);
+		m_pMapped = (unsigned char*)GLResources::MapBufferRange(m_buffer, GL_UNIFORM_BUFFER, 0, bufferSize, flags);
+	}
+	else
+	{
+		GLResources::BufferData(m_buffer, GL_UNIFORM_BUFFER, bufferSize, NULL, GL_DYNAMIC_DRAW);
+	}
+
+	std::cout << "INFO: Camera uniform buffer of " << SLOT_COUNT << " slots of " << m_slotSize << " bytes, "
+		<< ((NULL != m_pMapped) ? "persistently mapped" : "updated by copy") << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for writing the camera of the frame
+ *  about to be drawn into the next slot of the ring, and
+ *  binding that slot for every program to read.  The frame
+ *  that read the previous slot is fenced first, and before
+ *  a slot is written again the fence of the last frame that
+ *  read it is waited on, which only blocks when the GPU is
+ *  more than a whole ring of frames behind.
+ ***********************************************************/
+void CameraUniformBuffer::Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position)
+{
+	if ((m_buffer == 0) && (Initialize() == false))
+	{
+		return;
+	}
+
+	CAMERA_UNIFORMS camera;
+	camera.view = view;
+	camera.projection = projection;
+	camera.viewProjection = projection * view;
+	camera.inverseView = glm::inverse(view);
+	camera.inverseProjection = glm::inverse(projection);
+	camera.position = glm::vec4(position, 1.0f);
+
+	if (NULL != m_pMapped)
+	{
+		// the draws of the last frame were all submitted after its slot was bound
+		if (m_currentSlot >= 0)
+		{
+			m_fences[m_currentSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		m_currentSlot = (m_currentSlot + 1) % SLOT_COUNT;
+
+		if (NULL != m_fences[m_currentSlot])
+		{
+			GLenum result = glClientWaitSync(m_fences[m_currentSlot], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			while ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED) && (result != GL_WAIT_FAILED))
+			{
+				result = glClientWaitSync(m_fences[m_currentSlot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			}
+			glDeleteSync(m_fences[m_currentSlot]);
+			m_fences[m_currentSlot] = NULL;
+		}
+
+		memcpy(m_pMapped + m_slotSize * m_currentSlot, &camera, sizeof(CAMERA_UNIFORMS));
+	}
+	else
+	{
+		m_currentSlot = (m_currentSlot + 1) % SLOT_COUNT;
+		GLResources::BufferSubData(m_buffer, GL_UNIFORM_BUFFER, m_slotSize * m_currentSlot,
+			sizeof(CAMERA_UNIFORMS), &camera);
+	}
+
+	GLResources::BindBufferRange(GL_UNIFORM_BUFFER, BINDING_POINT, m_buffer,
+		m_slotSize * m_currentSlot, sizeof(CAMERA_UNIFORMS));
+}
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerauniformbuffer.h
+// ============
+// share the camera matrices with every shader through one uniform buffer
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  CAMERA_UNIFORMS
+ *
+ *  The contents of the Camera uniform block, laid out by
+ *  the std140 rules - every member is 16 byte aligned.
+ ***********************************************************/
+struct CAMERA_UNIFORMS
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::mat4 inverseView;
+	glm::mat4 inverseProjection;
+	// camera position in world space, w is unused
+	glm::vec4 position;
+};
+
+/***********************************************************
+ *  CameraUniformBuffer
+ *
+ *  This class writes the camera matrices once per frame
+ *  into a uniform buffer that every shader program reads
+ *  through its Camera block.  The buffer is a ring with a
+ *  slot for each frame in flight.  With OpenGL 4.4 or
+ *  ARB_buffer_storage it stays persistently mapped and a
+ *  fence keeps a slot from being written while the GPU may
+ *  still read it, otherwise each slot is updated with a
+ *  buffer copy.
+ ***********************************************************/
+class CameraUniformBuffer
+{
+public:
+	// uniform buffer binding point the Camera block is read from
+	static const GLuint BINDING_POINT = 0;
+	// name of the uniform block in the shader code
+	static const char* const BLOCK_NAME;
+
+	// constructor
+	CameraUniformBuffer();
+	// destructor
+	~CameraUniformBuffer();
+
+	// create the buffer ring, returns false if it could not be created
+	bool Initialize();
+	// write the camera of this frame into the next slot of the ring
+	// and bind that slot to the binding point
+	void Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position);
+	// check whether the ring is persistently mapped
+	bool IsPersistent() const { return(m_pMapped != nullptr); }
+
+private:
+	// number of slots, one for each frame the GPU may still be reading
+	static const int SLOT_COUNT = 3;
+
+	// the buffer holding every slot of the ring
+	GLuint m_buffer;
+	// bytes between slots, rounded up to the binding offset alignment
+	GLsizeiptr m_slotSize;
+	// slot written last, or -1 before the first frame
+	int m_currentSlot;
+	// persistently mapped buffer memory, NULL on the fallback path
+	unsigned char* m_pMapped;
+	// fence of the frame that last read each slot
+	GLsync m_fences[SLOT_COUNT];
+};
@@ -0,0 +1,507 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusteredlightculling.cpp
+// ============
+// assign the point lights to the clusters of the view frustum every frame
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ClusteredLightCulling.h"
+#include "GLResources.h"
+#include "RenderState.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// number of clusters across the screen, down it and in depth
+	const int g_ClusterCountX = 16;
+	const int g_ClusterCountY = 12;
+	const int g_ClusterCountZ = 24;
+	// lights whose cluster bounds one task finds
+	const int g_LightsPerTask = 256;
+	// fewer lights than this are assigned on the calling thread alone,
+	// since waking the workers would cost more than the work
+	const int g_ParallelLightCount = 512;
+	// most worker threads, the calling thread also takes tasks
+	const int g_MaxWorkers = 3;
+
+	/***********************************************************
+	 *  GetTimeMs()
+	 *
+	 *  This function is used for getting a steady time stamp
+	 *  in milliseconds.
+	 ***********************************************************/
+	double GetTimeMs()
+	{
+		return(std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+}
+
+/***********************************************************
+ *  ClusteredLightCulling()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ClusteredLightCulling::ClusteredLightCulling()
+{
+	m_clusterBuffer = 0;
+	m_clusterTexture = 0;
+	m_lightIndexBuffer = 0;
+	m_lightIndexTexture = 0;
+	m_pLights = NULL;
+	m_nearPlane = 0.1f;
+	m_farPlane = 100.0f;
+	m_grid.countX = g_ClusterCountX;
+	m_grid.countY = g_ClusterCountY;
+	m_grid.countZ = g_ClusterCountZ;
+	m_grid.bEnabled = 1;
+	m_grid.depthScale = 0.0f;
+	m_grid.depthBias = 0.0f;
+	m_grid.tileWidth = 1.0f;
+	m_grid.tileHeight = 1.0f;
+	m_clusterRanges.assign(g_ClusterCountX * g_ClusterCountY * g_ClusterCountZ * 2, 0);
+	m_taskCount = 0;
+	m_nextTask = 0;
+	m_taskGeneration = 0;
+	m_busyWorkers = 0;
+	m_bCancel = false;
+	m_stats.visibleLights = 0;
+	m_stats.lightIndices = 0;
+	m_stats.maxClusterLights = 0;
+	m_stats.assignTimeMs = 0.0;
+}
+
+/***********************************************************
+ *  ~ClusteredLightCulling()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ClusteredLightCulling::~ClusteredLightCulling()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bCancel = true;
+	}
+	m_taskCondition.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	if (m_clusterTexture != 0)
+	{
+		RenderState::DeleteTextures(1, &m_clusterTexture);
+		m_clusterTexture = 0;
+	}
+	if (m_lightIndexTexture != 0)
+	{
+		RenderState::DeleteTextures(1, &m_lightIndexTexture);
+		m_lightIndexTexture = 0;
+	}
+	if (m_clusterBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_clusterBuffer);
+		m_clusterBuffer = 0;
+	}
+	if (m_lightIndexBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_lightIndexBuffer);
+		m_lightIndexBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the buffer textures
+ *  the clusters are uploaded into and starting the worker
+ *  threads.
+ ***********************************************************/
+void ClusteredLightCulling::Initialize()
+{
+	if (m_clusterBuffer != 0)
+	{
+		return;
+	}
+
+	m_clusterBuffer = GLResources::CreateBuffer();
+	GLResources::BufferData(m_clusterBuffer, GL_TEXTURE_BUFFER,
+		m_clusterRanges.size() * sizeof(uint32_t), &m_clusterRanges[0], GL_STREAM_DRAW);
+	m_clusterTexture = GLResources::CreateTexture(GL_TEXTURE_BUFFER);
+	GLResources::TextureBuffer(m_clusterTexture, GL_RG32UI, m_clusterBuffer);
+
+	uint32_t noLight = 0;
+	m_lightIndexBuffer = GLResources::CreateBuffer();
+	GLResources::BufferData(m_lightIndexBuffer, GL_TEXTURE_BUFFER, sizeof(uint32_t), &noLight, GL_STREAM_DRAW);
+	m_lightIndexTexture = GLResources::CreateTexture(GL_TEXTURE_BUFFER);
+	GLResources::TextureBuffer(m_lightIndexTexture, GL_R32UI, m_lightIndexBuffer);
+
+	int workerCount = std::min((int)std::thread::hardware_concurrency() - 1, g_MaxWorkers);
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&ClusteredLightCulling::WorkerLoop, this));
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for assigning the point lights to
+ *  the clusters of the passed in view and uploading the
+ *  result.  The depth range of the clusters is taken from
+ *  the projection, which can be perspective or
+ *  orthographic.
+ ***********************************************************/
+void ClusteredLightCulling::Update(LightUniformBuffer* pLights, const glm::mat4& view, const glm::mat4& projection,
+	int viewportWidth, int viewportHeight)
+{
+	Initialize();
+
+	double startTime = GetTimeMs();
+
+	m_pLights = pLights;
+	m_view = view;
+	m_projection = projection;
+	if (projection[3][3] < 0.5f)
+	{
+		m_nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+		m_farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+	}
+	else
+	{
+		m_nearPlane = (projection[3][2] + 1.0f) / projection[2][2];
+		m_farPlane = (projection[3][2] - 1.0f) / projection[2][2];
+	}
+	// without a depth range in front of the camera, such as before the
+	// first view is set, every fragment loops over every light
+	if ((m_nearPlane <= 0.0f) || (m_farPlane <= m_nearPlane))
+	{
+		LIGHT_CLUSTER_GRID grid = LIGHT_CLUSTER_GRID();
+		pLights->SetClusterGrid(grid);
+		return;
+	}
+
+	// the depth slices are spaced evenly in the log of the view distance
+	m_grid.depthScale = (float)g_ClusterCountZ / std::log(m_farPlane / m_nearPlane);
+	m_grid.depthBias = -std::log(m_nearPlane) * m_grid.depthScale;
+	// the tiles split the viewport evenly, so the shader finds the same
+	// tile from the pixel position as the lights are assigned by
+	m_grid.tileWidth = (float)std::max(viewportWidth, 1) / g_ClusterCountX;
+	m_grid.tileHeight = (float)std::max(viewportHeight, 1) / g_ClusterCountY;
+	m_grid.bEnabled = 1;
+	pLights->SetClusterGrid(m_grid);
+
+	int lightCount = pLights->GetPointLightCount();
+	m_lightBounds.resize(lightCount);
+	bool bParallel = (lightCount >= g_ParallelLightCount);
+
+	// find the clusters each light reaches
+	int blockCount = (lightCount + g_LightsPerTask - 1) / g_LightsPerTask;
+	if (bParallel == true)
+	{
+		RunParallel(blockCount, [this](int block) { FindLightBounds(block); });
+	}
+	else
+	{
+		for (int block = 0; block < blockCount; block++)
+		{
+			FindLightBounds(block);
+		}
+	}
+
+	// count the lights of every cluster, one depth slice per task
+	if (bParallel == true)
+	{
+		RunParallel(g_ClusterCountZ, [this](int slice) { CountSliceLights(slice); });
+	}
+	else
+	{
+		for (int slice = 0; slice < g_ClusterCountZ; slice++)
+		{
+			CountSliceLights(slice);
+		}
+	}
+
+	// place the lights of each cluster after the ones before it
+	uint32_t offset = 0;
+	int maxClusterLights = 0;
+	for (size_t cluster = 0; cluster < m_clusterRanges.size(); cluster += 2)
+	{
+		m_clusterRanges[cluster] = offset;
+		offset += m_clusterRanges[cluster + 1];
+		maxClusterLights = std::max(maxClusterLights, (int)m_clusterRanges[cluster + 1]);
+	}
+	m_lightIndices.resize(std::max(offset, (uint32_t)1));
+
+	// write the light indices, each slice writing only its own clusters
+	if (bParallel == true)
+	{
+		RunParallel(g_ClusterCountZ, [this](int slice) { WriteSliceLights(slice); });
+	}
+	else
+	{
+		for (int slice = 0; slice < g_ClusterCountZ; slice++)
+		{
+			WriteSliceLights(slice);
+		}
+	}
+
+	// the buffers are replaced whole every frame, so the driver can give
+	// them new memory instead of waiting for the frame still reading them
+	GLResources::BufferData(m_clusterBuffer, GL_TEXTURE_BUFFER,
+		m_clusterRanges.size() * sizeof(uint32_t), &m_clusterRanges[0], GL_STREAM_DRAW);
+	GLResources::BufferData(m_lightIndexBuffer, GL_TEXTURE_BUFFER,
+		m_lightIndices.size() * sizeof(uint32_t), &m_lightIndices[0], GL_STREAM_DRAW);
+
+	int visibleLights = 0;
+	for (int i = 0; i < lightCount; i++)
+	{
+		if (m_lightBounds[i].minZ <= m_lightBounds[i].maxZ)
+		{
+			visibleLights++;
+		}
+	}
+	m_stats.visibleLights = visibleLights;
+	m_stats.lightIndices = (int)offset;
+	m_stats.maxClusterLights = maxClusterLights;
+	m_stats.assignTimeMs = GetTimeMs() - startTime;
+}
+
+/***********************************************************
+ *  FindLightBounds()
+ *
+ *  This method is used for finding the range of clusters
+ *  each light of a block of lights reaches.  The depth
+ *  slices come from the nearest and farthest view distance
+ *  of the light's sphere, and the tiles from the screen
+ *  rectangle of the box around the sphere.  A box that
+ *  reaches behind the camera covers the whole screen.
+ ***********************************************************/
+void ClusteredLightCulling::FindLightBounds(int block)
+{
+	int firstLight = block * g_LightsPerTask;
+	int lastLight = std::min(firstLight + g_LightsPerTask, (int)m_lightBounds.size());
+
+	for (int i = firstLight; i < lastLight; i++)
+	{
+		LIGHT_BOUNDS& bounds = m_lightBounds[i];
+		// an empty range, unless the light reaches into the frustum
+		bounds.minX = 0;
+		bounds.maxX = -1;
+		bounds.minY = 0;
+		bounds.maxY = -1;
+		bounds.minZ = 0;
+		bounds.maxZ = -1;
+
+		glm::vec4 sphere = m_pLights->GetPointLightSphere(i);
+		float range = sphere.w;
+		glm::vec4 center = m_view * glm::vec4(glm::vec3(sphere), 1.0f);
+		float nearDistance = -center.z - range;
+		float farDistance = -center.z + range;
+		if ((range <= 0.0f) || (farDistance < m_nearPlane) || (nearDistance > m_farPlane))
+		{
+			continue;
+		}
+
+		float minNdcX = 1.0f;
+		float maxNdcX = -1.0f;
+		float minNdcY = 1.0f;
+		float maxNdcY = -1.0f;
+		bool bBehind = false;
+		for (int corner = 0; (corner < 8) && (bBehind == false); corner++)
+		{
+			glm::vec4 point(
+				center.x + (((corner & 1) != 0) ? range : -range),
+				center.y + (((corner & 2) != 0) ? range : -range),
+				center.z + (((corner & 4) != 0) ? range : -range),
+				1.0f);
+			glm::vec4 clip = m_projection * point;
+			if (clip.w <= 1e-5f)
+			{
+				bBehind = true;
+				break;
+			}
+			float ndcX = clip.x / clip.w;
+			float ndcY = clip.y / clip.w;
+			minNdcX = std::min(minNdcX, ndcX);
+			maxNdcX = std::max(maxNdcX, ndcX);
+			minNdcY = std::min(minNdcY, ndcY);
+			maxNdcY = std::max(maxNdcY, ndcY);
+		}
+		if (bBehind == true)
+		{
+			minNdcX = -1.0f;
+			maxNdcX = 1.0f;
+			minNdcY = -1.0f;
+			maxNdcY = 1.0f;
+		}
+		if ((maxNdcX < -1.0f) || (minNdcX > 1.0f) || (maxNdcY < -1.0f) || (minNdcY > 1.0f))
+		{
+			continue;
+		}
+
+		// tiles count from the bottom left, like gl_FragCoord
+		bounds.minX = (int16_t)std::max(0, (int)std::floor((minNdcX * 0.5f + 0.5f) * g_ClusterCountX));
+		bounds.maxX = (int16_t)std::min(g_ClusterCountX - 1, (int)std::floor((maxNdcX * 0.5f + 0.5f) * g_ClusterCountX));
+		bounds.minY = (int16_t)std::max(0, (int)std::floor((minNdcY * 0.5f + 0.5f) * g_ClusterCountY));
+		bounds.maxY = (int16_t)std::min(g_ClusterCountY - 1, (int)std::floor((maxNdcY * 0.5f + 0.5f) * g_ClusterCountY));
+
+		float nearSlice = std::log(std::max(nearDistance, m_nearPlane)) * m_grid.depthScale + m_grid.depthBias;
+		float farSlice = std::log(std::min(farDistance, m_farPlane)) * m_grid.depthScale + m_grid.depthBias;
+		bounds.minZ = (int16_t)std::max(0, std::min(g_ClusterCountZ - 1, (int)std::floor(nearSlice)));
+		bounds.maxZ = (int16_t)std::max(0, std::min(g_ClusterCountZ - 1, (int)std::floor(farSlice)));
+	}
+}
+
+/***********************************************************
+ *  CountSliceLights()
+ *
+ *  This method is used for counting the lights that reach
+ *  each cluster of a depth slice.
+ ***********************************************************/
+void ClusteredLightCulling::CountSliceLights(int slice)
+{
+	uint32_t* pSlice = &m_clusterRanges[slice * g_ClusterCountX * g_ClusterCountY * 2];
+	for (int cluster = 0; cluster < g_ClusterCountX * g_ClusterCountY; cluster++)
+	{
+		pSlice[cluster * 2 + 1] = 0;
+	}
+
+	for (size_t i = 0; i < m_lightBounds.size(); i++)
+	{
+		const LIGHT_BOUNDS& bounds = m_lightBounds[i];
+		if ((slice < bounds.minZ) || (slice > bounds.maxZ))
+		{
+			continue;
+		}
+		for (int y = bounds.minY; y <= bounds.maxY; y++)
+		{
+			for (int x = bounds.minX; x <= bounds.maxX; x++)
+			{
+				pSlice[(y * g_ClusterCountX + x) * 2 + 1]++;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  WriteSliceLights()
+ *
+ *  This method is used for writing the indices of the
+ *  lights that reach each cluster of a depth slice, in
+ *  light order, at the offsets of the clusters.
+ ***********************************************************/
+void ClusteredLightCulling::WriteSliceLights(int slice)
+{
+	uint32_t* pSlice = &m_clusterRanges[slice * g_ClusterCountX * g_ClusterCountY * 2];
+	std::vector<uint32_t> written(g_ClusterCountX * g_ClusterCountY, 0);
+
+	for (size_t i = 0; i < m_lightBounds.size(); i++)
+	{
+		const LIGHT_BOUNDS& bounds = m_lightBounds[i];
+		if ((slice < bounds.minZ) || (slice > bounds.maxZ))
+		{
+			continue;
+		}
+		for (int y = bounds.minY; y <= bounds.maxY; y++)
+		{
+			for (int x = bounds.minX; x <= bounds.maxX; x++)
+			{
+				int cluster = y * g_ClusterCountX + x;
+				m_lightIndices[pSlice[cluster * 2] + written[cluster]] = (uint32_t)i;
+				written[cluster]++;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  RunParallel()
+ *
+ *  This method is used for running a task for every index
+ *  below the task count, spread over the worker threads
+ *  and the calling thread, and returns once every task has
+ *  finished.
+ ***********************************************************/
+void ClusteredLightCulling::RunParallel(int taskCount, const std::function<void(int)>& task)
+{
+	if (m_workers.empty() == true)
+	{
+		for (int i = 0; i < taskCount; i++)
+		{
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = task;
+		m_taskCount = taskCount;
+		m_nextTask = 0;
+		m_busyWorkers = (int)m_workers.size();
+		m_taskGeneration++;
+	}
+	m_taskCondition.notify_all();
+
+	RunTasks();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]() { return(m_busyWorkers == 0); });
+}
+
+/***********************************************************
+ *  RunTasks()
+ *
+ *  This method is used for taking the next task until none
+ *  are left.
+ ***********************************************************/
+void ClusteredLightCulling::RunTasks()
+{
+	int task = m_nextTask.fetch_add(1);
+	while (task < m_taskCount)
+	{
+		m_task(task);
+		task = m_nextTask.fetch_add(1);
+	}
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used by each worker thread for waiting
+ *  until tasks are handed out, taking tasks until none are
+ *  left, and reporting that it is done.
+ ***********************************************************/
+void ClusteredLightCulling::WorkerLoop()
+{
+	int generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskCondition.wait(lock, [this, generation]()
+				{ return((m_bCancel == true) || (m_taskGeneration != generation)); });
+			if (m_bCancel == true)
+			{
+				return;
+			}
+			generation = m_taskGeneration;
+		}
+
+		RunTasks();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busyWorkers--;
+		}
+		m_doneCondition.notify_one();
+	}
+}
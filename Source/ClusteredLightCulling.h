@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusteredlightculling.h
+// ============
+// assign the point lights to the clusters of the view frustum every frame
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "LightUniformBuffer.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  LIGHT_CLUSTER_STATS
+ *
+ *  Statistics of the light assignment of the last frame.
+ ***********************************************************/
+struct LIGHT_CLUSTER_STATS
+{
+	// point lights that touch the view frustum
+	int visibleLights;
+	// entries in the light index list, the sum of the lights of every cluster
+	int lightIndices;
+	// most lights in any one cluster
+	int maxClusterLights;
+	// time spent assigning the lights, in milliseconds
+	double assignTimeMs;
+};
+
+/***********************************************************
+ *  ClusteredLightCulling
+ *
+ *  This class splits the view frustum into a grid of
+ *  clusters, tiles across the screen and slices in depth
+ *  that get thicker further from the camera, and every
+ *  frame finds the point lights whose range reaches into
+ *  each cluster.  The fragment shader then only lights a
+ *  fragment with the lights of its own cluster.  The work
+ *  is split over worker threads - first the cluster bounds
+ *  of the lights are found, then each depth slice gathers
+ *  its lights without locks, since no two slices write the
+ *  same clusters.  The result is uploaded into two buffer
+ *  textures, the offset and count of every cluster and the
+ *  list of light indices they point into.
+ ***********************************************************/
+class ClusteredLightCulling
+{
+public:
+	// constructor
+	ClusteredLightCulling();
+	// destructor
+	~ClusteredLightCulling();
+
+	// create the buffer textures and start the worker threads
+	void Initialize();
+	// assign the point lights to the clusters of the passed in view and
+	// upload them, and set the cluster grid of the lights
+	void Update(LightUniformBuffer* pLights, const glm::mat4& view, const glm::mat4& projection,
+		int viewportWidth, int viewportHeight);
+
+	// get the buffer texture of the offset and count of each cluster
+	GLuint GetClusterTexture() const { return(m_clusterTexture); }
+	// get the buffer texture of the light index list
+	GLuint GetLightIndexTexture() const { return(m_lightIndexTexture); }
+	// get the statistics of the last frame
+	const LIGHT_CLUSTER_STATS& GetStats() const { return(m_stats); }
+
+private:
+	// the clusters a light reaches, inclusive, or an empty range
+	struct LIGHT_BOUNDS
+	{
+		int16_t minX;
+		int16_t maxX;
+		int16_t minY;
+		int16_t maxY;
+		int16_t minZ;
+		int16_t maxZ;
+	};
+
+	// find the clusters reached by a block of lights - runs on workers
+	void FindLightBounds(int block);
+	// count the lights of the clusters of a depth slice - runs on workers
+	void CountSliceLights(int slice);
+	// write the light indices of the clusters of a depth slice - runs on workers
+	void WriteSliceLights(int slice);
+
+	// run a task for every index below the count, on the workers and
+	// the calling thread, and wait for all of them to finish
+	void RunParallel(int taskCount, const std::function<void(int)>& task);
+	// take tasks until there are none left
+	void RunTasks();
+	// wait for tasks - runs on worker threads
+	void WorkerLoop();
+
+	// buffers and buffer textures of the cluster ranges and light indices
+	GLuint m_clusterBuffer;
+	GLuint m_clusterTexture;
+	GLuint m_lightIndexBuffer;
+	GLuint m_lightIndexTexture;
+
+	// the view of the frame being assigned
+	LightUniformBuffer* m_pLights;
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
+	float m_nearPlane;
+	float m_farPlane;
+	LIGHT_CLUSTER_GRID m_grid;
+
+	// cluster bounds of every light
+	std::vector<LIGHT_BOUNDS> m_lightBounds;
+	// offset and count of every cluster, as uploaded
+	std::vector<uint32_t> m_clusterRanges;
+	// light indices of every cluster, one after the other
+	std::vector<uint32_t> m_lightIndices;
+
+	// task handed out to the workers, guarded by m_mutex
+	std::function<void(int)> m_task;
+	int m_taskCount;
+	std::atomic<int> m_nextTask;
+	int m_taskGeneration;
+	int m_busyWorkers;
+	std::mutex m_mutex;
+	std::condition_variable m_taskCondition;
+	std::condition_variable m_doneCondition;
+	std::vector<std::thread> m_workers;
+	bool m_bCancel;
+
+	// statistics of the last frame
+	LIGHT_CLUSTER_STATS m_stats;
+};
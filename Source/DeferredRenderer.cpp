@@ -0,0 +1,512 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredrenderer.cpp
+// ============
+// light the scene once per pixel from a G-buffer instead of once per fragment
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DeferredRenderer.h"
+#include "CameraUniformBuffer.h"
+#include "GLResources.h"
+#include "LightUniformBuffer.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// G-buffer textures - albedo with 0 in alpha for unlit surfaces,
+	// normal with the shininess in w, the material diffuse and specular
+	// colors, and the depth
+	const GLenum g_GBufferFormats[DeferredRenderer::GBUFFER_TEXTURE_COUNT] =
+		{ GL_RGBA8, GL_RGBA16F, GL_RGBA8, GL_RGBA8, GL_DEPTH_COMPONENT24 };
+	const int g_GBufferPixelBytes[DeferredRenderer::GBUFFER_TEXTURE_COUNT] = { 4, 8, 4, 4, 4 };
+	const GLenum g_GBufferAttachments[DeferredRenderer::GBUFFER_TEXTURE_COUNT] =
+		{ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3, GL_DEPTH_ATTACHMENT };
+	const int g_GBufferColorCount = 4;
+
+	const char* g_AlbedoName = "gBufferAlbedo";
+	const char* g_NormalName = "gBufferNormal";
+	const char* g_DiffuseName = "gBufferDiffuse";
+	const char* g_SpecularName = "gBufferSpecular";
+	const char* g_DepthName = "gBufferDepth";
+	const char* g_PointLightDataName = "pointLightData";
+
+	// full screen triangle generated from the vertex index
+	const char* g_ScreenVertexShader = R"(#version 330 core
+void main()
+{
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+	// a box around the range of each point light, generated from the
+	// vertex index with its faces wound outwards
+	const char* g_PointLightVertexShader = R"(#version 330 core
+flat out int lightIndex;
+
+layout (std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 inverseView;
+	mat4 inverseProjection;
+	vec4 position;
+} camera;
+
+uniform samplerBuffer pointLightData;
+
+const int boxCorners[36] = int[36](
+	0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,  0, 4, 2, 2, 4, 6,
+	1, 3, 5, 3, 7, 5,  0, 1, 4, 1, 5, 4,  2, 6, 3, 3, 6, 7);
+
+void main()
+{
+	int corner = boxCorners[gl_VertexID];
+	vec3 offset = vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1) * 2.0 - 1.0;
+	vec4 positionRange = texelFetch(pointLightData, gl_InstanceID * 4);
+	lightIndex = gl_InstanceID;
+	gl_Position = camera.viewProjection * vec4(positionRange.xyz + offset * positionRange.w, 1.0);
+}
+)";
+
+	// reading the surface of a pixel back from the G-buffer, shared by
+	// both lighting passes
+	const char* g_LightingFragmentCommon = R"(#version 330 core
+out vec4 fragmentColor;
+
+struct DirectionalLight {
+	vec3 direction;
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+	bool bActive;
+};
+
+layout (std140) uniform Lights
+{
+	DirectionalLight directionalLight;
+	int pointLightCount;
+	ivec4 clusterGrid;
+	vec4 clusterDepth;
+};
+
+layout (std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 inverseView;
+	mat4 inverseProjection;
+	vec4 position;
+} camera;
+
+uniform sampler2D gBufferAlbedo;
+uniform sampler2D gBufferNormal;
+uniform sampler2D gBufferDiffuse;
+uniform sampler2D gBufferSpecular;
+uniform sampler2D gBufferDepth;
+
+struct Surface {
+	vec3 position;
+	vec3 normal;
+	vec4 albedo;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float shininess;
+};
+
+// reads the surface drawn into the pixel, false where nothing was drawn
+bool ReadSurface(out Surface surface)
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	float depth = texelFetch(gBufferDepth, pixel, 0).r;
+	if(depth >= 1.0)
+	{
+		return false;
+	}
+
+	// the world position is rebuilt from the depth
+	vec2 ndc = gl_FragCoord.xy / vec2(textureSize(gBufferDepth, 0)) * 2.0 - 1.0;
+	vec4 viewPosition = camera.inverseProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+	surface.position = (camera.inverseView * vec4(viewPosition.xyz / viewPosition.w, 1.0)).xyz;
+
+	vec4 normalShininess = texelFetch(gBufferNormal, pixel, 0);
+	surface.normal = normalize(normalShininess.xyz);
+	surface.shininess = normalShininess.w;
+	surface.albedo = texelFetch(gBufferAlbedo, pixel, 0);
+	surface.diffuseColor = texelFetch(gBufferDiffuse, pixel, 0).rgb;
+	surface.specularColor = texelFetch(gBufferSpecular, pixel, 0).rgb;
+	return true;
+}
+)";
+
+	// the directional light, and the color of the unlit surfaces
+	const char* g_ScreenFragmentShader = R"(
+void main()
+{
+	Surface surface;
+	if(ReadSurface(surface) == false)
+	{
+		discard;
+	}
+	if(surface.albedo.a == 0.0)
+	{
+		fragmentColor = vec4(surface.albedo.rgb, 1.0);
+		return;
+	}
+
+	vec3 color = vec3(0.0);
+	if(directionalLight.bActive == true)
+	{
+		vec3 viewDir = normalize(camera.position.xyz - surface.position);
+		vec3 lightDirection = normalize(-directionalLight.direction);
+		float diff = max(dot(surface.normal, lightDirection), 0.0);
+		vec3 reflectDir = reflect(-lightDirection, surface.normal);
+		float spec = pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess);
+		color = (directionalLight.ambient
+			+ directionalLight.diffuse * diff * surface.diffuseColor
+			+ directionalLight.specular * spec * surface.specularColor) * surface.albedo.rgb;
+	}
+	fragmentColor = vec4(color, 1.0);
+}
+)";
+
+	// one point light, added to the pixels its box covers
+	const char* g_PointLightFragmentShader = R"(
+flat in int lightIndex;
+
+uniform samplerBuffer pointLightData;
+
+void main()
+{
+	Surface surface;
+	if((ReadSurface(surface) == false) || (surface.albedo.a == 0.0))
+	{
+		discard;
+	}
+
+	vec4 positionRange = texelFetch(pointLightData, lightIndex * 4);
+	vec3 toLight = positionRange.xyz - surface.position;
+	float distance = length(toLight);
+	if(distance >= positionRange.w)
+	{
+		discard;
+	}
+	vec3 ambient = texelFetch(pointLightData, lightIndex * 4 + 1).rgb;
+	vec3 diffuse = texelFetch(pointLightData, lightIndex * 4 + 2).rgb;
+	vec3 specular = texelFetch(pointLightData, lightIndex * 4 + 3).rgb;
+
+	vec3 viewDir = normalize(camera.position.xyz - surface.position);
+	vec3 lightDir = toLight / distance;
+	float diff = max(dot(surface.normal, lightDir), 0.0);
+	vec3 reflectDir = reflect(-lightDir, surface.normal);
+	float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), surface.shininess);
+	vec3 color = (ambient + diffuse * diff * surface.diffuseColor) * surface.albedo.rgb
+		+ specular * specularComponent * surface.specularColor;
+
+	float falloff = clamp(1.0 - pow(distance / positionRange.w, 4.0), 0.0, 1.0);
+	fragmentColor = vec4(color * falloff * falloff, 0.0);
+}
+)";
+
+	// compile a lighting program from its vertex shader and the shared
+	// fragment code followed by its own, returns NULL on failure
+	ShaderManager* LoadLightingShader(const char* pVertexSource, const char* pFragmentSource)
+	{
+		std::string fragmentSource = std::string(g_LightingFragmentCommon) + pFragmentSource;
+
+		ShaderManager* pShader = new ShaderManager();
+		if (pShader->LoadShaderSources(pVertexSource, strlen(pVertexSource),
+			fragmentSource.c_str(), fragmentSource.size()) == 0)
+		{
+			delete pShader;
+			return(NULL);
+		}
+		pShader->BindUniformBlock(CameraUniformBuffer::BLOCK_NAME, CameraUniformBuffer::BINDING_POINT);
+		pShader->BindUniformBlock(LightUniformBuffer::BLOCK_NAME, LightUniformBuffer::BINDING_POINT);
+		return(pShader);
+	}
+}
+
+/***********************************************************
+ *  DeferredRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DeferredRenderer::DeferredRenderer()
+{
+	m_pScreenShader = NULL;
+	m_pPointLightShader = NULL;
+	m_framebuffer = 0;
+	for (int i = 0; i < GBUFFER_TEXTURE_COUNT; i++)
+	{
+		m_textures[i] = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+	m_firstTextureSlot = 0;
+	m_vertexArray = 0;
+	m_previousFramebuffer = 0;
+}
+
+/***********************************************************
+ *  ~DeferredRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DeferredRenderer::~DeferredRenderer()
+{
+	DestroyGBuffer();
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_vertexArray != 0)
+	{
+		RenderState::DeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	if (NULL != m_pScreenShader)
+	{
+		delete m_pScreenShader;
+		m_pScreenShader = NULL;
+	}
+	if (NULL != m_pPointLightShader)
+	{
+		delete m_pPointLightShader;
+		m_pPointLightShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for compiling the shaders of the
+ *  lighting passes and creating the G-buffer framebuffer.
+ *  The G-buffer textures are read through the texture
+ *  units starting at the passed in one, which the scene
+ *  keeps free for them.
+ ***********************************************************/
+bool DeferredRenderer::Initialize(int firstTextureSlot)
+{
+	m_firstTextureSlot = firstTextureSlot;
+	if (NULL != m_pScreenShader)
+	{
+		return(true);
+	}
+
+	GLuint previousProgram = RenderState::GetProgram();
+
+	m_pScreenShader = LoadLightingShader(g_ScreenVertexShader, g_ScreenFragmentShader);
+	m_pPointLightShader = LoadLightingShader(g_PointLightVertexShader, g_PointLightFragmentShader);
+	RenderState::UseProgram(previousProgram);
+	if ((NULL == m_pScreenShader) || (NULL == m_pPointLightShader))
+	{
+		std::cerr << "Failed to compile the deferred lighting shaders" << std::endl;
+		delete m_pScreenShader;
+		m_pScreenShader = NULL;
+		delete m_pPointLightShader;
+		m_pPointLightShader = NULL;
+		return(false);
+	}
+
+	ShaderManager* pShaders[2] = { m_pScreenShader, m_pPointLightShader };
+	LIGHTING_UNIFORMS* pUniforms[2] = { &m_screenUniforms, &m_pointLightUniforms };
+	for (int i = 0; i < 2; i++)
+	{
+		pUniforms[i]->albedo = pShaders[i]->GetUniform<int>(g_AlbedoName);
+		pUniforms[i]->normal = pShaders[i]->GetUniform<int>(g_NormalName);
+		pUniforms[i]->diffuse = pShaders[i]->GetUniform<int>(g_DiffuseName);
+		pUniforms[i]->specular = pShaders[i]->GetUniform<int>(g_SpecularName);
+		pUniforms[i]->depth = pShaders[i]->GetUniform<int>(g_DepthName);
+	}
+	m_pointLightData = m_pPointLightShader->GetUniform<int>(g_PointLightDataName);
+
+	m_framebuffer = GLResources::CreateFramebuffer();
+	// a core profile draw needs a vertex array bound, even an empty one
+	m_vertexArray = GLResources::CreateVertexArray();
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyGBuffer()
+ *
+ *  This method is used for freeing the G-buffer textures.
+ ***********************************************************/
+void DeferredRenderer::DestroyGBuffer()
+{
+	for (int i = 0; i < GBUFFER_TEXTURE_COUNT; i++)
+	{
+		if (m_textures[i] != 0)
+		{
+			RenderState::DeleteTextures(1, &m_textures[i]);
+			m_textures[i] = 0;
+		}
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  CreateGBuffer()
+ *
+ *  This method is used for creating the G-buffer textures
+ *  at the passed in size, attaching them to the framebuffer
+ *  and binding them to their texture units, where they stay
+ *  until the size changes again.
+ ***********************************************************/
+bool DeferredRenderer::CreateGBuffer(int width, int height)
+{
+	DestroyGBuffer();
+
+	for (int i = 0; i < GBUFFER_TEXTURE_COUNT; i++)
+	{
+		m_textures[i] = GLResources::CreateTexture(GL_TEXTURE_2D);
+		GLResources::TextureStorage(m_textures[i], GL_TEXTURE_2D, 1, g_GBufferFormats[i], width, height);
+		GLResources::FramebufferTexture(m_framebuffer, g_GBufferAttachments[i], m_textures[i], 0);
+		RenderState::BindTexture(m_firstTextureSlot + i, GL_TEXTURE_2D, m_textures[i]);
+	}
+	GLResources::FramebufferDrawBuffers(m_framebuffer, g_GBufferColorCount, g_GBufferAttachments);
+
+	if (GLResources::CheckFramebufferStatus(m_framebuffer) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "G-buffer framebuffer is incomplete" << std::endl;
+		DestroyGBuffer();
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetGBufferSamplers()
+ *
+ *  This method is used for pointing the G-buffer samplers
+ *  of a lighting program at the texture units the G-buffer
+ *  textures are bound to.
+ ***********************************************************/
+void DeferredRenderer::SetGBufferSamplers(ShaderManager* pShader, const LIGHTING_UNIFORMS& uniforms)
+{
+	pShader->setValue(uniforms.albedo, m_firstTextureSlot);
+	pShader->setValue(uniforms.normal, m_firstTextureSlot + 1);
+	pShader->setValue(uniforms.diffuse, m_firstTextureSlot + 2);
+	pShader->setValue(uniforms.specular, m_firstTextureSlot + 3);
+	pShader->setValue(uniforms.depth, m_firstTextureSlot + 4);
+}
+
+/***********************************************************
+ *  GetGBufferBytes()
+ *
+ *  This method is used for getting the memory taken by the
+ *  G-buffer textures at their current size.
+ ***********************************************************/
+size_t DeferredRenderer::GetGBufferBytes() const
+{
+	size_t pixelBytes = 0;
+	for (int i = 0; i < GBUFFER_TEXTURE_COUNT; i++)
+	{
+		pixelBytes += g_GBufferPixelBytes[i];
+	}
+	return((size_t)m_width * m_height * pixelBytes);
+}
+
+/***********************************************************
+ *  BeginGeometryPass()
+ *
+ *  This method is used for binding the G-buffer to draw
+ *  the scene into, recreated first when the viewport size
+ *  changed, and clearing it.  The surfaces are drawn
+ *  without blending, since the alpha of the albedo marks
+ *  the unlit surfaces.
+ ***********************************************************/
+bool DeferredRenderer::BeginGeometryPass()
+{
+	if (NULL == m_pScreenShader)
+	{
+		return(false);
+	}
+
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, m_previousViewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, m_previousClearColor);
+
+	int width = m_previousViewport[2];
+	int height = m_previousViewport[3];
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	if (((width != m_width) || (height != m_height)) && (CreateGBuffer(width, height) == false))
+	{
+		return(false);
+	}
+
+	GLResources::BindFramebuffer(m_framebuffer);
+	glViewport(0, 0, width, height);
+	RenderState::SetPipelineState(RenderState::GetOpaqueState());
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	return(true);
+}
+
+/***********************************************************
+ *  RenderLighting()
+ *
+ *  This method is used for shading every pixel of the
+ *  G-buffer into the framebuffer of the frame.  A full
+ *  screen pass writes the directional light, then a box
+ *  around the range of every point light is drawn with
+ *  additive blending.  Only the back faces of the boxes
+ *  are drawn, so each covered pixel is lit once by each
+ *  light even when the camera is inside its range.  The
+ *  program of the scene is made active again afterwards,
+ *  and the next pass sets the pipeline state it needs.
+ ***********************************************************/
+void DeferredRenderer::RenderLighting(int pointLightCount, int pointLightDataSlot)
+{
+	GLuint previousProgram = RenderState::GetProgram();
+
+	GLResources::BindFramebuffer(m_previousFramebuffer);
+	glViewport(m_previousViewport[0], m_previousViewport[1], m_previousViewport[2], m_previousViewport[3]);
+	glClearColor(m_previousClearColor[0], m_previousClearColor[1], m_previousClearColor[2], m_previousClearColor[3]);
+	RenderState::BindVertexArray(m_vertexArray);
+
+	// the directional light and the unlit surfaces
+	PIPELINE_STATE state = RenderState::GetOpaqueState();
+	state.bDepthTest = false;
+	RenderState::SetPipelineState(state);
+	m_pScreenShader->use();
+	SetGBufferSamplers(m_pScreenShader, m_screenUniforms);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	// every point light, one instance of the box each
+	if (pointLightCount > 0)
+	{
+		m_pPointLightShader->use();
+		SetGBufferSamplers(m_pPointLightShader, m_pointLightUniforms);
+		m_pPointLightShader->setValue(m_pointLightData, pointLightDataSlot);
+		state.bBlend = true;
+		state.blendSource = GL_ONE;
+		state.blendDestination = GL_ONE;
+		state.bCullFace = true;
+		state.cullFace = GL_FRONT;
+		RenderState::SetPipelineState(state);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 36, pointLightCount);
+	}
+
+	// the uniforms the scene sets next go to its own program
+	RenderState::UseProgram(previousProgram);
+}
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredrenderer.h
+// ============
+// light the scene once per pixel from a G-buffer instead of once per fragment
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderState.h"
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  DeferredRenderer
+ *
+ *  This class draws the lighting of the deferred shading
+ *  path.  The scene is first drawn into a G-buffer holding
+ *  the albedo, normal, shininess and material colors and
+ *  the depth of the closest surface of each pixel, without
+ *  any lighting.  The lighting pass then shades each pixel
+ *  once - a full screen pass adds the directional light,
+ *  and every point light is drawn as a box around its range
+ *  that adds its light to the pixels it covers, so a light
+ *  only costs the pixels it can reach.
+ ***********************************************************/
+class DeferredRenderer
+{
+public:
+	// number of G-buffer textures, read through that many texture
+	// units from the first one set
+	static const int GBUFFER_TEXTURE_COUNT = 5;
+
+	// constructor
+	DeferredRenderer();
+	// destructor
+	~DeferredRenderer();
+
+	// compile the lighting shaders and set the first of the texture
+	// units the G-buffer is read through, returns false on failure
+	bool Initialize(int firstTextureSlot);
+	// bind the G-buffer at the size of the viewport and clear it,
+	// returns false if it cannot be drawn into
+	bool BeginGeometryPass();
+	// bind back the framebuffer of the frame and light every pixel of
+	// the G-buffer into it, with the point lights from the buffer
+	// texture bound to the passed in texture unit
+	void RenderLighting(int pointLightCount, int pointLightDataSlot);
+
+	// get the bytes of the G-buffer textures
+	size_t GetGBufferBytes() const;
+
+private:
+	// free the G-buffer textures
+	void DestroyGBuffer();
+	// create the G-buffer textures at the passed in size, returns
+	// false if the framebuffer is incomplete
+	bool CreateGBuffer(int width, int height);
+
+	// shader program of the full screen pass and its samplers
+	ShaderManager* m_pScreenShader;
+	// shader program of the point light volumes and its samplers
+	ShaderManager* m_pPointLightShader;
+	struct LIGHTING_UNIFORMS
+	{
+		ShaderUniform<int> albedo;
+		ShaderUniform<int> normal;
+		ShaderUniform<int> diffuse;
+		ShaderUniform<int> specular;
+		ShaderUniform<int> depth;
+	};
+	LIGHTING_UNIFORMS m_screenUniforms;
+	LIGHTING_UNIFORMS m_pointLightUniforms;
+	ShaderUniform<int> m_pointLightData;
+
+	// point the G-buffer samplers of a lighting program at their units
+	void SetGBufferSamplers(ShaderManager* pShader, const LIGHTING_UNIFORMS& uniforms);
+
+	// framebuffer of the G-buffer, its textures and their size
+	GLuint m_framebuffer;
+	GLuint m_textures[GBUFFER_TEXTURE_COUNT];
+	int m_width;
+	int m_height;
+	// first texture unit the G-buffer textures are bound to
+	int m_firstTextureSlot;
+	// empty vertex array for the generated full screen triangle and boxes
+	GLuint m_vertexArray;
+
+	// state of the frame saved while the G-buffer is drawn
+	GLint m_previousFramebuffer;
+	GLint m_previousViewport[4];
+	GLfloat m_previousClearColor[4];
+};
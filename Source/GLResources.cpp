@@ -0,0 +1,796 @@
+///////////////////////////////////////////////////////////////////////////////
+// glresources.cpp
+// ============
+// create and update OpenGL resources without disturbing the bound state
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLResources.h"
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// edit the resources by name instead of binding them
+	bool g_bDirectStateAccess = false;
+	// counts of the calls made through the layer
+	GL_RESOURCE_STATS g_Stats = { 0, 0, 0, 0 };
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for choosing between the direct
+ *  state access entry points and the bind-to-edit fallback,
+ *  once GLEW is initialized.  Pass false to always use the
+ *  fallback, to compare the two paths.
+ ***********************************************************/
+void GLResources::Initialize(bool bAllowDirectStateAccess)
+{
+	bool bSupported = (GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access);
+	g_bDirectStateAccess = bAllowDirectStateAccess && bSupported;
+
+	std::cout << "INFO: OpenGL resources are edited "
+		<< ((g_bDirectStateAccess == true) ? "with direct state access" : "by binding them")
+		<< std::endl;
+}
+
+/***********************************************************
+ *  IsDirectStateAccess()
+ *
+ *  This method is used for checking whether the resources
+ *  are edited with the direct state access entry points.
+ ***********************************************************/
+bool GLResources::IsDirectStateAccess()
+{
+	return(g_bDirectStateAccess);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the counts of the calls
+ *  made through the resource layer so far.
+ ***********************************************************/
+const GL_RESOURCE_STATS& GLResources::GetStats()
+{
+	return(g_Stats);
+}
+
+/***********************************************************
+ *  GetTextureBinding()
+ *
+ *  This method is used for getting the query for the
+ *  texture bound to the passed in target.
+ ***********************************************************/
+GLenum GLResources::GetTextureBinding(GLenum target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D_ARRAY:
+		return(GL_TEXTURE_BINDING_2D_ARRAY);
+	case GL_TEXTURE_3D:
+		return(GL_TEXTURE_BINDING_3D);
+	case GL_TEXTURE_CUBE_MAP:
+		return(GL_TEXTURE_BINDING_CUBE_MAP);
+	case GL_TEXTURE_BUFFER:
+		return(GL_TEXTURE_BINDING_BUFFER);
+	default:
+		return(GL_TEXTURE_BINDING_2D);
+	}
+}
+
+/***********************************************************
+ *  GetBufferBinding()
+ *
+ *  This method is used for getting the query for the
+ *  buffer bound to the passed in target.
+ ***********************************************************/
+GLenum GLResources::GetBufferBinding(GLenum target)
+{
+	switch (target)
+	{
+	case GL_PIXEL_UNPACK_BUFFER:
+		return(GL_PIXEL_UNPACK_BUFFER_BINDING);
+	case GL_PIXEL_PACK_BUFFER:
+		return(GL_PIXEL_PACK_BUFFER_BINDING);
+	case GL_UNIFORM_BUFFER:
+		return(GL_UNIFORM_BUFFER_BINDING);
+	case GL_TEXTURE_BUFFER:
+		return(GL_TEXTURE_BUFFER_BINDING);
+	case GL_ELEMENT_ARRAY_BUFFER:
+		return(GL_ELEMENT_ARRAY_BUFFER_BINDING);
+	default:
+		return(GL_ARRAY_BUFFER_BINDING);
+	}
+}
+
+/***********************************************************
+ *  BeginTextureEdit()
+ *
+ *  This method is used for binding a texture to edit it on
+ *  the fallback path.  Returns the texture to bind back
+ *  afterwards.
+ ***********************************************************/
+GLuint GLResources::BeginTextureEdit(GLuint texture, GLenum target)
+{
+	GLint previousTexture = 0;
+	glGetIntegerv(GetTextureBinding(target), &previousTexture);
+	if ((GLuint)previousTexture != texture)
+	{
+		glBindTexture(target, texture);
+		g_Stats.editBinds++;
+	}
+	return((GLuint)previousTexture);
+}
+
+/***********************************************************
+ *  EndTextureEdit()
+ *
+ *  This method is used for binding back the texture that
+ *  was bound before an edit on the fallback path.
+ ***********************************************************/
+void GLResources::EndTextureEdit(GLuint texture, GLenum target, GLuint previousTexture)
+{
+	if (previousTexture != texture)
+	{
+		glBindTexture(target, previousTexture);
+		g_Stats.editBinds++;
+	}
+}
+
+/***********************************************************
+ *  BeginBufferEdit()
+ *
+ *  This method is used for binding a buffer to edit it on
+ *  the fallback path.  Returns the buffer to bind back
+ *  afterwards.
+ ***********************************************************/
+GLuint GLResources::BeginBufferEdit(GLuint buffer, GLenum target)
+{
+	GLint previousBuffer = 0;
+	glGetIntegerv(GetBufferBinding(target), &previousBuffer);
+	if ((GLuint)previousBuffer != buffer)
+	{
+		glBindBuffer(target, buffer);
+		g_Stats.editBinds++;
+	}
+	return((GLuint)previousBuffer);
+}
+
+/***********************************************************
+ *  EndBufferEdit()
+ *
+ *  This method is used for binding back the buffer that
+ *  was bound before an edit on the fallback path.
+ ***********************************************************/
+void GLResources::EndBufferEdit(GLuint buffer, GLenum target, GLuint previousBuffer)
+{
+	if (previousBuffer != buffer)
+	{
+		glBindBuffer(target, previousBuffer);
+		g_Stats.editBinds++;
+	}
+}
+
+/***********************************************************
+ *  BeginFramebufferEdit()
+ *
+ *  This method is used for binding a framebuffer to edit it
+ *  on the fallback path.  Returns the framebuffer to bind
+ *  back afterwards.
+ ***********************************************************/
+GLuint GLResources::BeginFramebufferEdit(GLuint framebuffer)
+{
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	if ((GLuint)previousFramebuffer != framebuffer)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		g_Stats.editBinds++;
+	}
+	return((GLuint)previousFramebuffer);
+}
+
+/***********************************************************
+ *  EndFramebufferEdit()
+ *
+ *  This method is used for binding back the framebuffer
+ *  that was bound before an edit on the fallback path.
+ ***********************************************************/
+void GLResources::EndFramebufferEdit(GLuint framebuffer, GLuint previousFramebuffer)
+{
+	if (previousFramebuffer != framebuffer)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+		g_Stats.editBinds++;
+	}
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  This method is used for creating a texture of the passed
+ *  in target.  With direct state access the texture object
+ *  exists right away, otherwise only its name is reserved
+ *  until it is first bound.
+ ***********************************************************/
+GLuint GLResources::CreateTexture(GLenum target)
+{
+	GLuint texture = 0;
+	if (g_bDirectStateAccess == true)
+	{
+		glCreateTextures(target, 1, &texture);
+	}
+	else
+	{
+		glGenTextures(1, &texture);
+	}
+	g_Stats.resourcesCreated++;
+
+	return(texture);
+}
+
+/***********************************************************
+ *  TextureStorage()
+ *
+ *  This method is used for allocating the storage of every
+ *  mip level of a texture.  The storage is immutable when
+ *  the context supports it, otherwise each level is
+ *  allocated on its own.
+ ***********************************************************/
+void GLResources::TextureStorage(GLuint texture, GLenum target, GLsizei levels, GLenum internalFormat,
+	GLsizei width, GLsizei height, GLsizei depth)
+{
+	g_Stats.resourceEdits++;
+	bool bArray = (target == GL_TEXTURE_2D_ARRAY) || (target == GL_TEXTURE_3D);
+
+	if (g_bDirectStateAccess == true)
+	{
+		if (bArray == true)
+		{
+			glTextureStorage3D(texture, levels, internalFormat, width, height, depth);
+		}
+		else
+		{
+			glTextureStorage2D(texture, levels, internalFormat, width, height);
+		}
+		return;
+	}
+
+	GLuint previousTexture = BeginTextureEdit(texture, target);
+
+	if ((GLEW_VERSION_4_2 || GLEW_ARB_texture_storage) && (bArray == true))
+	{
+		glTexStorage3D(target, levels, internalFormat, width, height, depth);
+	}
+	else if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+	{
+		glTexStorage2D(target, levels, internalFormat, width, height);
+	}
+	else
+	{
+		bool bCompressed = BlockCompressor::IsCompressedFormat(internalFormat);
+		GLenum pixelFormat = ((internalFormat == GL_RGB8) || (internalFormat == GL_RGB)) ? GL_RGB : GL_RGBA;
+		for (int level = 0; level < levels; level++)
+		{
+			GLsizei levelWidth = std::max(1, width >> level);
+			GLsizei levelHeight = std::max(1, height >> level);
+			GLsizei levelDepth = (target == GL_TEXTURE_3D) ? std::max(1, depth >> level) : depth;
+			GLsizei levelSize = (GLsizei)BlockCompressor::GetLevelSize(internalFormat, levelWidth, levelHeight, 4);
+
+			if ((bArray == true) && (bCompressed == true))
+			{
+				glCompressedTexImage3D(target, level, internalFormat, levelWidth, levelHeight, levelDepth,
+					0, levelSize * levelDepth, NULL);
+			}
+			else if (bArray == true)
+			{
+				glTexImage3D(target, level, internalFormat, levelWidth, levelHeight, levelDepth,
+					0, pixelFormat, GL_UNSIGNED_BYTE, NULL);
+			}
+			else if (bCompressed == true)
+			{
+				glCompressedTexImage2D(target, level, internalFormat, levelWidth, levelHeight,
+					0, levelSize, NULL);
+			}
+			else
+			{
+				glTexImage2D(target, level, internalFormat, levelWidth, levelHeight,
+					0, pixelFormat, GL_UNSIGNED_BYTE, NULL);
+			}
+		}
+	}
+
+	EndTextureEdit(texture, target, previousTexture);
+}
+
+/***********************************************************
+ *  TextureSubImage()
+ *
+ *  This method is used for copying pixels into a mip level
+ *  of a texture, or into one layer of a mip level of a
+ *  texture array.  The pixels are read from the bound pixel
+ *  unpack buffer when there is one.
+ ***********************************************************/
+void GLResources::TextureSubImage(GLuint texture, GLenum target, GLint level, GLint x, GLint y, GLint layer,
+	GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pPixels)
+{
+	g_Stats.resourceEdits++;
+	bool bArray = (target == GL_TEXTURE_2D_ARRAY);
+
+	if (g_bDirectStateAccess == true)
+	{
+		if (bArray == true)
+		{
+			glTextureSubImage3D(texture, level, x, y, layer, width, height, 1, format, type, pPixels);
+		}
+		else
+		{
+			glTextureSubImage2D(texture, level, x, y, width, height, format, type, pPixels);
+		}
+		return;
+	}
+
+	GLuint previousTexture = BeginTextureEdit(texture, target);
+	if (bArray == true)
+	{
+		glTexSubImage3D(target, level, x, y, layer, width, height, 1, format, type, pPixels);
+	}
+	else
+	{
+		glTexSubImage2D(target, level, x, y, width, height, format, type, pPixels);
+	}
+	EndTextureEdit(texture, target, previousTexture);
+}
+
+/***********************************************************
+ *  CompressedTextureSubImage()
+ *
+ *  This method is used for copying block compressed data
+ *  into a mip level of a texture, or into one layer of a
+ *  mip level of a texture array.
+ ***********************************************************/
+void GLResources::CompressedTextureSubImage(GLuint texture, GLenum target, GLint level, GLint x, GLint y,
+	GLint layer, GLsizei width, GLsizei height, GLenum internalFormat, GLsizei size, const void* pData)
+{
+	g_Stats.resourceEdits++;
+	bool bArray = (target == GL_TEXTURE_2D_ARRAY);
+
+	if (g_bDirectStateAccess == true)
+	{
+		if (bArray == true)
+		{
+			glCompressedTextureSubImage3D(texture, level, x, y, layer, width, height, 1, internalFormat, size, pData);
+		}
+		else
+		{
+			glCompressedTextureSubImage2D(texture, level, x, y, width, height, internalFormat, size, pData);
+		}
+		return;
+	}
+
+	GLuint previousTexture = BeginTextureEdit(texture, target);
+	if (bArray == true)
+	{
+		glCompressedTexSubImage3D(target, level, x, y, layer, width, height, 1, internalFormat, size, pData);
+	}
+	else
+	{
+		glCompressedTexSubImage2D(target, level, x, y, width, height, internalFormat, size, pData);
+	}
+	EndTextureEdit(texture, target, previousTexture);
+}
+
+/***********************************************************
+ *  TextureParameter()
+ *
+ *  This method is used for setting an integer parameter of
+ *  a texture, such as its base or maximum mip level.
+ ***********************************************************/
+void GLResources::TextureParameter(GLuint texture, GLenum target, GLenum name, GLint value)
+{
+	g_Stats.resourceEdits++;
+
+	if (g_bDirectStateAccess == true)
+	{
+		glTextureParameteri(texture, name, value);
+		return;
+	}
+
+	GLuint previousTexture = BeginTextureEdit(texture, target);
+	glTexParameteri(target, name, value);
+	EndTextureEdit(texture, target, previousTexture);
+}
+
+/***********************************************************
+ *  GenerateTextureMipmap()
+ *
+ *  This method is used for building the mip chain of a
+ *  texture on the GPU from its base level.
+ ***********************************************************/
+void GLResources::GenerateTextureMipmap(GLuint texture, GLenum target)
+{
+	g_Stats.resourceEdits++;
+
+	if (g_bDirectStateAccess == true)
+	{
+		glGenerateTextureMipmap(texture);
+		return;
+	}
+
+	GLuint previousTexture = BeginTextureEdit(texture, target);
+	glGenerateMipmap(target);
+	EndTextureEdit(texture, target, previousTexture);
+}
+
+/***********************************************************
+ *  TextureBuffer()
+ *
+ *  This method is used for attaching a buffer to a buffer
+ *  texture, which shaders read as a one dimensional array
+ *  of texels in the passed in format.  The buffer can be
+ *  updated afterwards without attaching it again.
+ ***********************************************************/
+void GLResources::TextureBuffer(GLuint texture, GLenum internalFormat, GLuint buffer)
+{
+	g_Stats.resourceEdits++;
+
+	if (g_bDirectStateAccess == true)
+	{
+		glTextureBuffer(texture, internalFormat, buffer);
+		return;
+	}
+
+	GLuint previousTexture = BeginTextureEdit(texture, GL_TEXTURE_BUFFER);
+	glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+	EndTextureEdit(texture, GL_TEXTURE_BUFFER, previousTexture);
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method is used for creating a buffer object.
+ ***********************************************************/
+GLuint GLResources::CreateBuffer()
+{
+	GLuint buffer = 0;
+	if (g_bDirectStateAccess == true)
+	{
+		glCreateBuffers(1, &buffer);
+	}
+	else
+	{
+		glGenBuffers(1, &buffer);
+	}
+	g_Stats.resourcesCreated++;
+
+	return(buffer);
+}
+
+/***********************************************************
+ *  BufferData()
+ *
+ *  This method is used for allocating the data store of a
+ *  buffer, which also orphans its previous contents.  The
+ *  target is only bound on the fallback path.
+ ***********************************************************/
+void GLResources::BufferData(GLuint buffer, GLenum target, GLsizeiptr size, const void* pData, GLenum usage)
+{
+	g_Stats.resourceEdits++;
+
+	if (g_bDirectStateAccess == true)
+	{
+		glNamedBufferData(buffer, size, pData, usage);
+		return;
+	}
+
+	GLuint previousBuffer = BeginBufferEdit(buffer, target);
+	glBufferData(target, size, pData, usage);
+	EndBufferEdit(buffer, target, previousBuffer);
+}
+
+/***********************************************************
+ *  BufferStorage()
+ *
+ *  This method is used for allocating the immutable data
+ *  store of a buffer, which can stay mapped while it is
+ *  used when the flags ask for a persistent mapping.
+ ***********************************************************/
+void GLResources::BufferStorage(GLuint buffer, GLenum target, GLsizeiptr size, const void* pData, GLbitfield flags)
+{
+	g_Stats.resourceEdits++;
+
+	if (g_bDirectStateAccess == true)
+	{
+		glNamedBufferStorage(buffer, size, pData, flags);
+		return;
+	}
+
+	GLuint previousBuffer = BeginBufferEdit(buffer, target);
+	glBufferStorage(target, size, pData, flags);
+	EndBufferEdit(buffer, target, previousBuffer);
+}
+
+/***********************************************************
+ *  BufferSubData()
+ *
+ *  This method is used for copying data into a range of a
+ *  buffer.
+ ***********************************************************/
+void GLResources::BufferSubData(GLuint buffer, GLenum target, GLintptr offset, GLsizeiptr size, const void* pData)
+{
+	g_Stats.resourceEdits++;
+
+	if (g_bDirectStateAccess == true)
+	{
+		glNamedBufferSubData(buffer, offset, size, pData);
+		return;
+	}
+
+	GLuint previousBuffer = BeginBufferEdit(buffer, target);
+	glBufferSubData(target, offset, size, pData);
+	EndBufferEdit(buffer, target, previousBuffer);
+}
+
+/***********************************************************
+ *  MapBufferRange()
+ *
+ *  This method is used for mapping a range of a buffer into
+ *  client memory.  Returns NULL if it cannot be mapped.
+ ***********************************************************/
+void* GLResources::MapBufferRange(GLuint buffer, GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	g_Stats.resourceEdits++;
+
+	if (g_bDirectStateAccess == true)
+	{
+		return(glMapNamedBufferRange(buffer, offset, length, access));
+	}
+
+	GLuint previousBuffer = BeginBufferEdit(buffer, target);
+	void* pMapped = glMapBufferRange(target, offset, length, access);
+	EndBufferEdit(buffer, target, previousBuffer);
+
+	return(pMapped);
+}
+
+/***********************************************************
+ *  UnmapBuffer()
+ *
+ *  This method is used for unmapping a mapped buffer.
+ *  Returns false if the contents of the buffer were lost
+ *  while it was mapped.
+ ***********************************************************/
+bool GLResources::UnmapBuffer(GLuint buffer, GLenum target)
+{
+	g_Stats.resourceEdits++;
+
+	if (g_bDirectStateAccess == true)
+	{
+		return(glUnmapNamedBuffer(buffer) == GL_TRUE);
+	}
+
+	GLuint previousBuffer = BeginBufferEdit(buffer, target);
+	GLboolean bResult = glUnmapBuffer(target);
+	EndBufferEdit(buffer, target, previousBuffer);
+
+	return(bResult == GL_TRUE);
+}
+
+/***********************************************************
+ *  BindBuffer()
+ *
+ *  This method is used for binding a buffer to use it, such
+ *  as a pixel buffer object that a transfer reads from or
+ *  writes into.  These binds are needed on both paths.
+ ***********************************************************/
+void GLResources::BindBuffer(GLenum target, GLuint buffer)
+{
+	glBindBuffer(target, buffer);
+	g_Stats.useBinds++;
+}
+
+/***********************************************************
+ *  BindBufferRange()
+ *
+ *  This method is used for binding a range of a buffer to
+ *  an indexed binding point that shaders read from, such as
+ *  a uniform block binding.  Like BindBuffer(), these binds
+ *  are needed on both paths.
+ ***********************************************************/
+void GLResources::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	glBindBufferRange(target, index, buffer, offset, size);
+	g_Stats.useBinds++;
+}
+
+/***********************************************************
+ *  CreateVertexArray()
+ *
+ *  This method is used for creating a vertex array object.
+ ***********************************************************/
+GLuint GLResources::CreateVertexArray()
+{
+	GLuint vertexArray = 0;
+	if (g_bDirectStateAccess == true)
+	{
+		glCreateVertexArrays(1, &vertexArray);
+	}
+	else
+	{
+		glGenVertexArrays(1, &vertexArray);
+	}
+	g_Stats.resourcesCreated++;
+
+	return(vertexArray);
+}
+
+/***********************************************************
+ *  CreateRenderbuffer()
+ *
+ *  This method is used for creating a renderbuffer.
+ ***********************************************************/
+GLuint GLResources::CreateRenderbuffer()
+{
+	GLuint renderbuffer = 0;
+	if (g_bDirectStateAccess == true)
+	{
+		glCreateRenderbuffers(1, &renderbuffer);
+	}
+	else
+	{
+		glGenRenderbuffers(1, &renderbuffer);
+	}
+	g_Stats.resourcesCreated++;
+
+	return(renderbuffer);
+}
+
+/***********************************************************
+ *  RenderbufferStorage()
+ *
+ *  This method is used for allocating the storage of a
+ *  renderbuffer.
+ ***********************************************************/
+void GLResources::RenderbufferStorage(GLuint renderbuffer, GLenum internalFormat, GLsizei width, GLsizei height)
+{
+	g_Stats.resourceEdits++;
+
+	if (g_bDirectStateAccess == true)
+	{
+		glNamedRenderbufferStorage(renderbuffer, internalFormat, width, height);
+		return;
+	}
+
+	GLint previousRenderbuffer = 0;
+	glGetIntegerv(GL_RENDERBUFFER_BINDING, &previousRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, (GLuint)previousRenderbuffer);
+	g_Stats.editBinds += 2;
+}
+
+/***********************************************************
+ *  CreateFramebuffer()
+ *
+ *  This method is used for creating a framebuffer.
+ ***********************************************************/
+GLuint GLResources::CreateFramebuffer()
+{
+	GLuint framebuffer = 0;
+	if (g_bDirectStateAccess == true)
+	{
+		glCreateFramebuffers(1, &framebuffer);
+	}
+	else
+	{
+		glGenFramebuffers(1, &framebuffer);
+	}
+	g_Stats.resourcesCreated++;
+
+	return(framebuffer);
+}
+
+/***********************************************************
+ *  FramebufferTexture()
+ *
+ *  This method is used for attaching a mip level of a 2D
+ *  texture to a framebuffer, or detaching the attachment
+ *  when the texture is 0.
+ ***********************************************************/
+void GLResources::FramebufferTexture(GLuint framebuffer, GLenum attachment, GLuint texture, GLint level)
+{
+	g_Stats.resourceEdits++;
+
+	if (g_bDirectStateAccess == true)
+	{
+		glNamedFramebufferTexture(framebuffer, attachment, texture, level);
+		return;
+	}
+
+	GLuint previousFramebuffer = BeginFramebufferEdit(framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, level);
+	EndFramebufferEdit(framebuffer, previousFramebuffer);
+}
+
+/***********************************************************
+ *  FramebufferRenderbuffer()
+ *
+ *  This method is used for attaching a renderbuffer to a
+ *  framebuffer.
+ ***********************************************************/
+void GLResources::FramebufferRenderbuffer(GLuint framebuffer, GLenum attachment, GLuint renderbuffer)
+{
+	g_Stats.resourceEdits++;
+
+	if (g_bDirectStateAccess == true)
+	{
+		glNamedFramebufferRenderbuffer(framebuffer, attachment, GL_RENDERBUFFER, renderbuffer);
+		return;
+	}
+
+	GLuint previousFramebuffer = BeginFramebufferEdit(framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, renderbuffer);
+	EndFramebufferEdit(framebuffer, previousFramebuffer);
+}
+
+/***********************************************************
+ *  FramebufferDrawBuffers()
+ *
+ *  This method is used for choosing the color attachments
+ *  of a framebuffer that the outputs of the fragment shader
+ *  are written to, in the order of their locations.
+ ***********************************************************/
+void GLResources::FramebufferDrawBuffers(GLuint framebuffer, GLsizei count, const GLenum* pBuffers)
+{
+	g_Stats.resourceEdits++;
+
+	if (g_bDirectStateAccess == true)
+	{
+		glNamedFramebufferDrawBuffers(framebuffer, count, pBuffers);
+		return;
+	}
+
+	GLuint previousFramebuffer = BeginFramebufferEdit(framebuffer);
+	glDrawBuffers(count, pBuffers);
+	EndFramebufferEdit(framebuffer, previousFramebuffer);
+}
+
+/***********************************************************
+ *  CheckFramebufferStatus()
+ *
+ *  This method is used for checking whether the images
+ *  attached to a framebuffer make it complete.
+ ***********************************************************/
+GLenum GLResources::CheckFramebufferStatus(GLuint framebuffer)
+{
+	if (g_bDirectStateAccess == true)
+	{
+		return(glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER));
+	}
+
+	GLuint previousFramebuffer = BeginFramebufferEdit(framebuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	EndFramebufferEdit(framebuffer, previousFramebuffer);
+
+	return(status);
+}
+
+/***********************************************************
+ *  BindFramebuffer()
+ *
+ *  This method is used for binding a framebuffer to draw
+ *  into it and read back from it.  These binds are needed
+ *  on both paths.
+ ***********************************************************/
+void GLResources::BindFramebuffer(GLuint framebuffer)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	g_Stats.useBinds++;
+}
@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// glresources.h
+// ============
+// create and update OpenGL resources without disturbing the bound state
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  GL_RESOURCE_STATS
+ *
+ *  Counts of the OpenGL calls made through the resource
+ *  layer, to compare the two paths.
+ ***********************************************************/
+struct GL_RESOURCE_STATS
+{
+	// textures, buffers, vertex arrays, renderbuffers and framebuffers created
+	int resourcesCreated;
+	// calls that created or updated a resource
+	int resourceEdits;
+	// binds made to edit a resource on the fallback path, including
+	// the binds restoring what was bound before
+	int editBinds;
+	// binds made through the layer to use a resource, such as a pixel
+	// buffer object for a transfer
+	int useBinds;
+};
+
+/***********************************************************
+ *  GLResources
+ *
+ *  This class is a thin layer over the creation and update
+ *  of textures, buffers, vertex arrays, renderbuffers and
+ *  framebuffers.  With OpenGL 4.5 or ARB_direct_state_access
+ *  the resources are edited by name, without binding them.
+ *  On older contexts each edit binds the resource, and binds
+ *  back whatever was bound before unless it was the same
+ *  resource, so the state the render path relies on is not
+ *  disturbed either way.
+ ***********************************************************/
+class GLResources
+{
+public:
+	// choose the direct state access path when the context supports it
+	// and it is allowed - call once after GLEW is initialized
+	static void Initialize(bool bAllowDirectStateAccess);
+	// check whether resources are edited with direct state access
+	static bool IsDirectStateAccess();
+	// get the counts of the calls made so far
+	static const GL_RESOURCE_STATS& GetStats();
+
+	// create a texture of the passed in target
+	static GLuint CreateTexture(GLenum target);
+	// allocate the storage of every mip level, the depth is the number
+	// of layers of a texture array
+	static void TextureStorage(GLuint texture, GLenum target, GLsizei levels, GLenum internalFormat,
+		GLsizei width, GLsizei height, GLsizei depth = 1);
+	// copy pixels into a mip level, or into one layer of it for a texture array
+	static void TextureSubImage(GLuint texture, GLenum target, GLint level, GLint x, GLint y, GLint layer,
+		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pPixels);
+	// copy block compressed data into a mip level, or into one layer of it
+	static void CompressedTextureSubImage(GLuint texture, GLenum target, GLint level, GLint x, GLint y,
+		GLint layer, GLsizei width, GLsizei height, GLenum internalFormat, GLsizei size, const void* pData);
+	// set an integer texture parameter
+	static void TextureParameter(GLuint texture, GLenum target, GLenum name, GLint value);
+	// build the mip chain of a texture from its base level
+	static void GenerateTextureMipmap(GLuint texture, GLenum target);
+	// attach a buffer as the storage of a buffer texture
+	static void TextureBuffer(GLuint texture, GLenum internalFormat, GLuint buffer);
+
+	// create a buffer object
+	static GLuint CreateBuffer();
+	// allocate the data store of a buffer, the target only matters on the fallback path
+	static void BufferData(GLuint buffer, GLenum target, GLsizeiptr size, const void* pData, GLenum usage);
+	// allocate an immutable data store, needs OpenGL 4.4 or ARB_buffer_storage
+	static void BufferStorage(GLuint buffer, GLenum target, GLsizeiptr size, const void* pData, GLbitfield flags);
+	// copy data into a range of a buffer
+	static void BufferSubData(GLuint buffer, GLenum target, GLintptr offset, GLsizeiptr size, const void* pData);
+	// map a range of a buffer into client memory
+	static void* MapBufferRange(GLuint buffer, GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+	// unmap a mapped buffer, returns false if its contents were lost
+	static bool UnmapBuffer(GLuint buffer, GLenum target);
+	// bind a buffer to use it, such as a pixel buffer object for a transfer
+	static void BindBuffer(GLenum target, GLuint buffer);
+	// bind a range of a buffer to an indexed binding point, such as a
+	// uniform block binding
+	static void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+	// create a vertex array object
+	static GLuint CreateVertexArray();
+
+	// create a renderbuffer and allocate its storage
+	static GLuint CreateRenderbuffer();
+	static void RenderbufferStorage(GLuint renderbuffer, GLenum internalFormat, GLsizei width, GLsizei height);
+
+	// create a framebuffer and attach images to it
+	static GLuint CreateFramebuffer();
+	static void FramebufferTexture(GLuint framebuffer, GLenum attachment, GLuint texture, GLint level);
+	static void FramebufferRenderbuffer(GLuint framebuffer, GLenum attachment, GLuint renderbuffer);
+	// choose the color attachments the fragment shader outputs are written to
+	static void FramebufferDrawBuffers(GLuint framebuffer, GLsizei count, const GLenum* pBuffers);
+	// check whether a framebuffer can be drawn into
+	static GLenum CheckFramebufferStatus(GLuint framebuffer);
+	// bind a framebuffer to draw into it and read from it
+	static void BindFramebuffer(GLuint framebuffer);
+
+private:
+	// get the query for the resource bound to a texture or buffer target
+	static GLenum GetTextureBinding(GLenum target);
+	static GLenum GetBufferBinding(GLenum target);
+	// bind a resource for the fallback path, returns the previous one
+	// to bind back, or the resource itself if it was already bound
+	static GLuint BeginTextureEdit(GLuint texture, GLenum target);
+	static void EndTextureEdit(GLuint texture, GLenum target, GLuint previousTexture);
+	static GLuint BeginBufferEdit(GLuint buffer, GLenum target);
+	static void EndBufferEdit(GLuint buffer, GLenum target, GLuint previousBuffer);
+	static GLuint BeginFramebufferEdit(GLuint framebuffer);
+	static void EndFramebufferEdit(GLuint framebuffer, GLuint previousFramebuffer);
+};
@@ -0,0 +1,363 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagedecoder.cpp
+// ============
+// decode compressed image files with the fastest available codec
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+
+#include "stb_image.h"
+
+#ifdef USE_LIBJPEG_TURBO
+#include <turbojpeg.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// declaration of the helper functions
+namespace
+{
+	// get a steady timestamp in milliseconds for the benchmark timings
+	double GetTimeMs()
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+/***********************************************************
+ *  GetDecoders()
+ *
+ *  This method is used for getting every decoder that is
+ *  compiled in, in the order they are tried.  The stb_image
+ *  decoder comes last since it handles every file type.
+ ***********************************************************/
+const std::vector<ImageDecoder*>& ImageDecoder::GetDecoders()
+{
+#ifdef USE_LIBJPEG_TURBO
+	static TurboJpegDecoder turboJpegDecoder;
+#endif
+	static StbImageDecoder stbImageDecoder;
+	static std::vector<ImageDecoder*> decoders;
+
+	if (decoders.empty() == true)
+	{
+#ifdef USE_LIBJPEG_TURBO
+		decoders.push_back(&turboJpegDecoder);
+#endif
+		decoders.push_back(&stbImageDecoder);
+	}
+	return(decoders);
+}
+
+/***********************************************************
+ *  DecodeImage()
+ *
+ *  This method is used for decoding an image file that is
+ *  in memory with the first decoder that can handle it.  A
+ *  decoder that fails hands the file on to the next one.
+ ***********************************************************/
+bool ImageDecoder::DecodeImage(const unsigned char* pSource, size_t sourceSize, int scale, TEXTURE_IMAGE& image)
+{
+	const std::vector<ImageDecoder*>& decoders = GetDecoders();
+	for (size_t i = 0; i < decoders.size(); i++)
+	{
+		if ((decoders[i]->CanDecode(pSource, sourceSize) == true) &&
+			(decoders[i]->Decode(pSource, sourceSize, scale, image) == true))
+		{
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  GetImageInfo()
+ *
+ *  This method is used for reading the full size of an
+ *  image file that is in memory without decoding it.
+ ***********************************************************/
+bool ImageDecoder::GetImageInfo(const unsigned char* pSource, size_t sourceSize, int& width, int& height)
+{
+	const std::vector<ImageDecoder*>& decoders = GetDecoders();
+	for (size_t i = 0; i < decoders.size(); i++)
+	{
+		if ((decoders[i]->CanDecode(pSource, sourceSize) == true) &&
+			(decoders[i]->GetInfo(pSource, sourceSize, width, height) == true))
+		{
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  ReduceImage()
+ *
+ *  This method is used for scaling the first level of an
+ *  image down by the passed in factor, averaging each block
+ *  of texels.  The blocks along the right and top edges may
+ *  be partial, the same as for a decode-time scale.
+ ***********************************************************/
+void ImageDecoder::ReduceImage(TEXTURE_IMAGE& image, int scale)
+{
+	if (scale <= 1)
+	{
+		return;
+	}
+
+	int width = GetScaledSize(image.width, scale);
+	int height = GetScaledSize(image.height, scale);
+	int colorChannels = image.colorChannels;
+	std::vector<unsigned char> reduced((size_t)width * height * colorChannels);
+
+	for (int y = 0; y < height; y++)
+	{
+		int lastY = std::min(image.height, (y + 1) * scale);
+		for (int x = 0; x < width; x++)
+		{
+			int lastX = std::min(image.width, (x + 1) * scale);
+			int count = (lastY - y * scale) * (lastX - x * scale);
+			for (int c = 0; c < colorChannels; c++)
+			{
+				int sum = 0;
+				for (int sourceY = y * scale; sourceY < lastY; sourceY++)
+				{
+					for (int sourceX = x * scale; sourceX < lastX; sourceX++)
+					{
+						sum += image.pixels[((size_t)sourceY * image.width + sourceX) * colorChannels + c];
+					}
+				}
+				reduced[((size_t)y * width + x) * colorChannels + c] = (unsigned char)((sum + count / 2) / count);
+			}
+		}
+	}
+
+	image.width = width;
+	image.height = height;
+	image.pixels.swap(reduced);
+	image.pData = image.pixels.data();
+}
+
+/***********************************************************
+ *  CanDecode()
+ *
+ *  This method is used for checking whether stb_image can
+ *  decode the passed in file contents.
+ ***********************************************************/
+bool StbImageDecoder::CanDecode(const unsigned char* pSource, size_t sourceSize) const
+{
+	int width, height;
+	return(GetInfo(pSource, sourceSize, width, height));
+}
+
+/***********************************************************
+ *  GetInfo()
+ *
+ *  This method is used for reading the size of an image
+ *  from its header with stb_image.
+ ***********************************************************/
+bool StbImageDecoder::GetInfo(const unsigned char* pSource, size_t sourceSize, int& width, int& height) const
+{
+	int colorChannels = 0;
+	return(stbi_info_from_memory(pSource, (int)sourceSize, &width, &height, &colorChannels) != 0);
+}
+
+/***********************************************************
+ *  Decode()
+ *
+ *  This method is used for decoding an image with stb_image
+ *  at full resolution and then scaling it down.  The rows
+ *  are flipped by stb_image, which the texture loader sets
+ *  up once before its worker threads start.
+ ***********************************************************/
+bool StbImageDecoder::Decode(const unsigned char* pSource, size_t sourceSize, int scale, TEXTURE_IMAGE& image) const
+{
+	unsigned char* pDecoded = stbi_load_from_memory(
+		pSource,
+		(int)sourceSize,
+		&image.width,
+		&image.height,
+		&image.colorChannels,
+		0);
+
+	if (pDecoded == NULL)
+	{
+		std::cerr << "STB Error: " << stbi_failure_reason() << std::endl;
+		return(false);
+	}
+
+	image.pixels.assign(pDecoded, pDecoded + (size_t)image.width * image.height * image.colorChannels);
+	image.pData = image.pixels.data();
+	image.mips.clear();
+
+	// free the decoded image data from local memory
+	stbi_image_free(pDecoded);
+
+	ReduceImage(image, scale);
+
+	return(true);
+}
+
+#ifdef USE_LIBJPEG_TURBO
+/***********************************************************
+ *  CanDecode()
+ *
+ *  This method is used for checking whether the passed in
+ *  file contents start with a JPEG marker.
+ ***********************************************************/
+bool TurboJpegDecoder::CanDecode(const unsigned char* pSource, size_t sourceSize) const
+{
+	return((sourceSize > 3) && (pSource[0] == 0xFF) && (pSource[1] == 0xD8) && (pSource[2] == 0xFF));
+}
+
+/***********************************************************
+ *  GetInfo()
+ *
+ *  This method is used for reading the size of a JPEG image
+ *  from its header with libjpeg-turbo.
+ ***********************************************************/
+bool TurboJpegDecoder::GetInfo(const unsigned char* pSource, size_t sourceSize, int& width, int& height) const
+{
+	tjhandle handle = tjInitDecompress();
+	if (handle == NULL)
+	{
+		return(false);
+	}
+
+	int subsampling, colorspace;
+	bool bSuccess = (tjDecompressHeader3(handle, pSource, (unsigned long)sourceSize,
+		&width, &height, &subsampling, &colorspace) == 0);
+
+	tjDestroy(handle);
+	return(bSuccess);
+}
+
+/***********************************************************
+ *  Decode()
+ *
+ *  This method is used for decoding a JPEG image into RGB
+ *  rows, bottom row first, with libjpeg-turbo.  The image
+ *  is scaled down in the DCT domain while it is decoded.
+ ***********************************************************/
+bool TurboJpegDecoder::Decode(const unsigned char* pSource, size_t sourceSize, int scale, TEXTURE_IMAGE& image) const
+{
+	// the decompressor keeps per-image state, so every decode has its own
+	tjhandle handle = tjInitDecompress();
+	if (handle == NULL)
+	{
+		return(false);
+	}
+
+	int width, height, subsampling, colorspace;
+	bool bSuccess = (tjDecompressHeader3(handle, pSource, (unsigned long)sourceSize,
+		&width, &height, &subsampling, &colorspace) == 0);
+
+	if (bSuccess == true)
+	{
+		tjscalingfactor scalingFactor = { 1, std::max(1, scale) };
+		image.width = TJSCALED(width, scalingFactor);
+		image.height = TJSCALED(height, scalingFactor);
+		image.colorChannels = 3;
+		image.pixels.resize((size_t)image.width * image.height * image.colorChannels);
+
+		bSuccess = (tjDecompress2(handle, pSource, (unsigned long)sourceSize,
+			image.pixels.data(), image.width, 0, image.height, TJPF_RGB, TJFLAG_BOTTOMUP) == 0);
+		if (bSuccess == false)
+		{
+			std::cerr << "libjpeg-turbo Error: " << tjGetErrorStr2(handle) << std::endl;
+		}
+	}
+
+	tjDestroy(handle);
+
+	image.pData = image.pixels.data();
+	image.mips.clear();
+	return(bSuccess);
+}
+#endif
+
+/***********************************************************
+ *  RunBenchmark()
+ *
+ *  This method is used for measuring the decode throughput
+ *  of every decoder at each scale on the passed in image
+ *  files, against the plain stbi_load_from_memory path the
+ *  textures were loaded with before.  The throughput is in
+ *  megapixels of the full size image per second.
+ ***********************************************************/
+void ImageDecoder::RunBenchmark(const std::vector<std::string>& filenames)
+{
+	const int iterations = 5;
+	const int scales[] = { 1, 2, 4, 8 };
+	const std::vector<ImageDecoder*>& decoders = GetDecoders();
+
+	stbi_set_flip_vertically_on_load(true);
+
+	for (size_t i = 0; i < filenames.size(); i++)
+	{
+		MappedFile sourceFile;
+		int width = 0;
+		int height = 0;
+		if ((sourceFile.Open(filenames[i].c_str()) == false) ||
+			(GetImageInfo(sourceFile.GetData(), sourceFile.GetSize(), width, height) == false))
+		{
+			std::cerr << "Failed to open: " << filenames[i] << std::endl;
+			continue;
+		}
+
+		double megapixels = (double)width * height / 1.0e6;
+		std::cout << filenames[i] << " (" << width << "x" << height << ", "
+			<< (sourceFile.GetSize() / 1024) << " KB)" << std::endl;
+
+		// the previous path, a full resolution stb_image decode
+		double startTime = GetTimeMs();
+		for (int iteration = 0; iteration < iterations; iteration++)
+		{
+			int decodedWidth, decodedHeight, colorChannels;
+			unsigned char* pDecoded = stbi_load_from_memory(sourceFile.GetData(), (int)sourceFile.GetSize(),
+				&decodedWidth, &decodedHeight, &colorChannels, 0);
+			stbi_image_free(pDecoded);
+		}
+		double baselineMs = (GetTimeMs() - startTime) / iterations;
+		std::cout << "  stbi_load: " << baselineMs << " ms, "
+			<< (megapixels * 1000.0 / baselineMs) << " MP/s" << std::endl;
+
+		for (size_t decoder = 0; decoder < decoders.size(); decoder++)
+		{
+			if (decoders[decoder]->CanDecode(sourceFile.GetData(), sourceFile.GetSize()) == false)
+			{
+				continue;
+			}
+
+			for (size_t scale = 0; scale < sizeof(scales) / sizeof(scales[0]); scale++)
+			{
+				bool bSuccess = true;
+				TEXTURE_IMAGE image;
+				startTime = GetTimeMs();
+				for (int iteration = 0; (iteration < iterations) && bSuccess; iteration++)
+				{
+					bSuccess = decoders[decoder]->Decode(sourceFile.GetData(), sourceFile.GetSize(), scales[scale], image);
+				}
+				double decodeMs = (GetTimeMs() - startTime) / iterations;
+
+				if (bSuccess == false)
+				{
+					std::cerr << "  " << decoders[decoder]->GetName() << " failed" << std::endl;
+					break;
+				}
+
+				std::cout << "  " << decoders[decoder]->GetName() << " 1/" << scales[scale]
+					<< " (" << image.width << "x" << image.height << "): " << decodeMs << " ms, "
+					<< (megapixels * 1000.0 / decodeMs) << " MP/s, "
+					<< (baselineMs / decodeMs) << "x" << std::endl;
+			}
+		}
+	}
+}
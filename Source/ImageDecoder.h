@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagedecoder.h
+// ============
+// decode compressed image files with the fastest available codec
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCache.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ImageDecoder
+ *
+ *  This class is the interface of the image file decoders.
+ *  Each decoder fills the first level of a texture image
+ *  with the decoded rows, bottom row first, optionally
+ *  scaled down by 2, 4 or 8 while decoding.  The decoders
+ *  are tried in order, so a faster codec for a file type
+ *  comes before the stb_image fallback.
+ ***********************************************************/
+class ImageDecoder
+{
+public:
+	// destructor
+	virtual ~ImageDecoder() {}
+
+	// get the name of the decoder for the log messages
+	virtual const char* GetName() const = 0;
+	// check whether the decoder handles the passed in file contents
+	virtual bool CanDecode(const unsigned char* pSource, size_t sourceSize) const = 0;
+	// read the full size of the image without decoding it
+	virtual bool GetInfo(const unsigned char* pSource, size_t sourceSize, int& width, int& height) const = 0;
+	// decode the image, scaled down by the passed in factor of 1, 2, 4 or 8
+	virtual bool Decode(const unsigned char* pSource, size_t sourceSize, int scale, TEXTURE_IMAGE& image) const = 0;
+
+	// get every available decoder, in the order they are tried
+	static const std::vector<ImageDecoder*>& GetDecoders();
+	// decode an image with the first decoder that can handle it
+	static bool DecodeImage(const unsigned char* pSource, size_t sourceSize, int scale, TEXTURE_IMAGE& image);
+	// read the full size of an image with the first decoder that can handle it
+	static bool GetImageInfo(const unsigned char* pSource, size_t sourceSize, int& width, int& height);
+	// get the size of an image dimension after scaling it down while decoding
+	static int GetScaledSize(int size, int scale) { return (size + scale - 1) / scale; }
+
+	// compare the decoders against a plain stbi_load on the passed in image files
+	static void RunBenchmark(const std::vector<std::string>& filenames);
+
+protected:
+	// scale a decoded image down by averaging blocks of texels
+	static void ReduceImage(TEXTURE_IMAGE& image, int scale);
+};
+
+/***********************************************************
+ *  StbImageDecoder
+ *
+ *  This class decodes any image file supported by stb_image.
+ *  It decodes at full resolution and scales afterwards.
+ ***********************************************************/
+class StbImageDecoder : public ImageDecoder
+{
+public:
+	const char* GetName() const { return "stb_image"; }
+	bool CanDecode(const unsigned char* pSource, size_t sourceSize) const;
+	bool GetInfo(const unsigned char* pSource, size_t sourceSize, int& width, int& height) const;
+	bool Decode(const unsigned char* pSource, size_t sourceSize, int scale, TEXTURE_IMAGE& image) const;
+};
+
+#ifdef USE_LIBJPEG_TURBO
+/***********************************************************
+ *  TurboJpegDecoder
+ *
+ *  This class decodes JPEG files with the SIMD optimized
+ *  libjpeg-turbo codec, which scales the image down in the
+ *  DCT domain so the skipped detail is never decoded.
+ ***********************************************************/
+class TurboJpegDecoder : public ImageDecoder
+{
+public:
+	const char* GetName() const { return "libjpeg-turbo"; }
+	bool CanDecode(const unsigned char* pSource, size_t sourceSize) const;
+	bool GetInfo(const unsigned char* pSource, size_t sourceSize, int& width, int& height) const;
+	bool Decode(const unsigned char* pSource, size_t sourceSize, int scale, TEXTURE_IMAGE& image) const;
+};
+#endif
@@ -0,0 +1,310 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightuniformbuffer.cpp
+// ============
+// keep the scene lights in GPU buffers updated only where they change
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightUniformBuffer.h"
+#include "GLResources.h"
+#include "RenderState.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+const char* const LightUniformBuffer::BLOCK_NAME = "Lights";
+
+// declaration of global variables
+namespace
+{
+	// number of point lights the point light buffer starts out fitting
+	const int g_InitialPointLightCapacity = 64;
+	// RGBA32F texels of the buffer texture that each point light takes
+	const int g_TexelsPerPointLight = 4;
+}
+
+/***********************************************************
+ *  LightUniformBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightUniformBuffer::LightUniformBuffer()
+{
+	m_buffer = 0;
+	m_pointLightBuffer = 0;
+	m_pointLightTexture = 0;
+	m_pointLightCapacity = 0;
+	m_maxPointLights = 0;
+	m_header = GPU_LIGHTS_HEADER();
+	m_headerDirtyBegin = 0;
+	m_headerDirtyEnd = sizeof(GPU_LIGHTS_HEADER);
+	m_lightsDirtyBegin = 0;
+	m_lightsDirtyEnd = 0;
+	m_uploadedBytes = 0;
+}
+
+/***********************************************************
+ *  ~LightUniformBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightUniformBuffer::~LightUniformBuffer()
+{
+	if (m_pointLightTexture != 0)
+	{
+		RenderState::DeleteTextures(1, &m_pointLightTexture);
+		m_pointLightTexture = 0;
+	}
+	if (m_pointLightBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_pointLightBuffer);
+		m_pointLightBuffer = 0;
+	}
+	if (m_buffer != 0)
+	{
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+	}
+}
+
+/***********************************************************
+ *  GetMaxPointLights()
+ *
+ *  This method is used for getting the most point lights
+ *  that fit in the largest buffer texture the context
+ *  allows, at least 16384 on any OpenGL 3.3 context.
+ ***********************************************************/
+int LightUniformBuffer::GetMaxPointLights()
+{
+	GLint maxTexels = 65536;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+
+	return(std::max(1, maxTexels / g_TexelsPerPointLight));
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the uniform buffer of
+ *  the Lights block, binding it to its binding point, and
+ *  creating the point light buffer and its buffer texture.
+ ***********************************************************/
+void LightUniformBuffer::Initialize()
+{
+	if (m_buffer != 0)
+	{
+		return;
+	}
+
+	m_maxPointLights = GetMaxPointLights();
+
+	m_buffer = GLResources::CreateBuffer();
+	GLResources::BufferData(m_buffer, GL_UNIFORM_BUFFER, sizeof(GPU_LIGHTS_HEADER), NULL, GL_DYNAMIC_DRAW);
+	GLResources::BindBufferRange(GL_UNIFORM_BUFFER, BINDING_POINT, m_buffer, 0, sizeof(GPU_LIGHTS_HEADER));
+
+	m_pointLightCapacity = std::max(g_InitialPointLightCapacity, (int)m_pointLights.size());
+	m_pointLightBuffer = GLResources::CreateBuffer();
+	GLResources::BufferData(m_pointLightBuffer, GL_TEXTURE_BUFFER,
+		m_pointLightCapacity * sizeof(GPU_POINT_LIGHT), NULL, GL_DYNAMIC_DRAW);
+	m_pointLightTexture = GLResources::CreateTexture(GL_TEXTURE_BUFFER);
+	GLResources::TextureBuffer(m_pointLightTexture, GL_RGBA32F, m_pointLightBuffer);
+
+	// everything set before the buffers existed is written the first time
+	MarkDirty(m_headerDirtyBegin, m_headerDirtyEnd, 0, sizeof(GPU_LIGHTS_HEADER));
+	MarkDirty(m_lightsDirtyBegin, m_lightsDirtyEnd, 0, m_pointLights.size() * sizeof(GPU_POINT_LIGHT));
+}
+
+/***********************************************************
+ *  SetDirectionalLight()
+ *
+ *  This method is used for setting the directional light.
+ ***********************************************************/
+void LightUniformBuffer::SetDirectionalLight(const glm::vec3& direction, const glm::vec3& ambient,
+	const glm::vec3& diffuse, const glm::vec3& specular, bool bActive)
+{
+	GPU_DIRECTIONAL_LIGHT& light = m_header.directionalLight;
+	light.direction = direction;
+	light.ambient = ambient;
+	light.diffuse = diffuse;
+	light.specular = specular;
+	light.bActive = (bActive == true) ? 1 : 0;
+
+	MarkDirty(m_headerDirtyBegin, m_headerDirtyEnd,
+		offsetof(GPU_LIGHTS_HEADER, directionalLight), sizeof(GPU_DIRECTIONAL_LIGHT));
+}
+
+/***********************************************************
+ *  AddPointLight()
+ *
+ *  This method is used for adding a point light after the
+ *  ones already added.  Returns the index of the light, or
+ *  -1 if the buffer texture cannot hold any more lights.
+ ***********************************************************/
+int LightUniformBuffer::AddPointLight(const glm::vec3& position, float range, const glm::vec3& ambient,
+	const glm::vec3& diffuse, const glm::vec3& specular)
+{
+	if (m_maxPointLights == 0)
+	{
+		m_maxPointLights = GetMaxPointLights();
+	}
+	if ((int)m_pointLights.size() >= m_maxPointLights)
+	{
+		std::cerr << "The point light buffer holds at most " << m_maxPointLights << " point lights" << std::endl;
+		return(-1);
+	}
+
+	int index = (int)m_pointLights.size();
+	m_pointLights.push_back(GPU_POINT_LIGHT());
+	m_header.pointLightCount = (int)m_pointLights.size();
+	MarkDirty(m_headerDirtyBegin, m_headerDirtyEnd, offsetof(GPU_LIGHTS_HEADER, pointLightCount), sizeof(int));
+
+	SetPointLight(index, position, range, ambient, diffuse, specular);
+
+	return(index);
+}
+
+/***********************************************************
+ *  SetPointLight()
+ *
+ *  This method is used for changing every value of a point
+ *  light that was added.
+ ***********************************************************/
+void LightUniformBuffer::SetPointLight(int index, const glm::vec3& position, float range, const glm::vec3& ambient,
+	const glm::vec3& diffuse, const glm::vec3& specular)
+{
+	if ((index < 0) || (index >= (int)m_pointLights.size()))
+	{
+		return;
+	}
+
+	GPU_POINT_LIGHT& light = m_pointLights[index];
+	light.position = position;
+	light.range = range;
+	light.ambient = ambient;
+	light.diffuse = diffuse;
+	light.specular = specular;
+
+	MarkDirty(m_lightsDirtyBegin, m_lightsDirtyEnd, index * sizeof(GPU_POINT_LIGHT), sizeof(GPU_POINT_LIGHT));
+}
+
+/***********************************************************
+ *  SetPointLightPosition()
+ *
+ *  This method is used for moving a point light that was
+ *  added, which only changes its position.
+ ***********************************************************/
+void LightUniformBuffer::SetPointLightPosition(int index, const glm::vec3& position)
+{
+	if ((index < 0) || (index >= (int)m_pointLights.size()))
+	{
+		return;
+	}
+
+	m_pointLights[index].position = position;
+
+	MarkDirty(m_lightsDirtyBegin, m_lightsDirtyEnd,
+		index * sizeof(GPU_POINT_LIGHT) + offsetof(GPU_POINT_LIGHT, position), sizeof(glm::vec3));
+}
+
+/***********************************************************
+ *  GetPointLightSphere()
+ *
+ *  This method is used for getting the sphere a point light
+ *  can light, its position in xyz and its range in w.
+ ***********************************************************/
+glm::vec4 LightUniformBuffer::GetPointLightSphere(int index) const
+{
+	const GPU_POINT_LIGHT& light = m_pointLights[index];
+	return(glm::vec4(light.position, light.range));
+}
+
+/***********************************************************
+ *  SetClusterGrid()
+ *
+ *  This method is used for setting the cluster grid the
+ *  shader looks up the lights of a fragment in.  The grid
+ *  only changes with the viewport and the depth range, so
+ *  it is only uploaded again when it differs.
+ ***********************************************************/
+void LightUniformBuffer::SetClusterGrid(const LIGHT_CLUSTER_GRID& grid)
+{
+	if (memcmp(&m_header.clusterGrid, &grid, sizeof(LIGHT_CLUSTER_GRID)) == 0)
+	{
+		return;
+	}
+
+	m_header.clusterGrid = grid;
+	MarkDirty(m_headerDirtyBegin, m_headerDirtyEnd,
+		offsetof(GPU_LIGHTS_HEADER, clusterGrid), sizeof(LIGHT_CLUSTER_GRID));
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for adding a range of bytes to the
+ *  range waiting to be uploaded.
+ ***********************************************************/
+void LightUniformBuffer::MarkDirty(size_t& dirtyBegin, size_t& dirtyEnd, size_t offset, size_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	if (dirtyBegin >= dirtyEnd)
+	{
+		dirtyBegin = offset;
+		dirtyEnd = offset + size;
+	}
+	else
+	{
+		dirtyBegin = std::min(dirtyBegin, offset);
+		dirtyEnd = std::max(dirtyEnd, offset + size);
+	}
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for copying the ranges of the light
+ *  data that changed since the last upload into the GPU
+ *  buffers.  The point light buffer grows to twice its
+ *  size when the lights outgrow it, which uploads all of
+ *  them.  Nothing is copied when no light changed.
+ ***********************************************************/
+void LightUniformBuffer::Upload()
+{
+	Initialize();
+
+	if ((int)m_pointLights.size() > m_pointLightCapacity)
+	{
+		while ((int)m_pointLights.size() > m_pointLightCapacity)
+		{
+			m_pointLightCapacity *= 2;
+		}
+		GLResources::BufferData(m_pointLightBuffer, GL_TEXTURE_BUFFER,
+			m_pointLightCapacity * sizeof(GPU_POINT_LIGHT), NULL, GL_DYNAMIC_DRAW);
+		MarkDirty(m_lightsDirtyBegin, m_lightsDirtyEnd, 0, m_pointLights.size() * sizeof(GPU_POINT_LIGHT));
+	}
+
+	if (m_headerDirtyBegin < m_headerDirtyEnd)
+	{
+		GLResources::BufferSubData(m_buffer, GL_UNIFORM_BUFFER, m_headerDirtyBegin,
+			m_headerDirtyEnd - m_headerDirtyBegin, (const unsigned char*)&m_header + m_headerDirtyBegin);
+		m_uploadedBytes += m_headerDirtyEnd - m_headerDirtyBegin;
+		m_headerDirtyBegin = 0;
+		m_headerDirtyEnd = 0;
+	}
+
+	if (m_lightsDirtyBegin < m_lightsDirtyEnd)
+	{
+		GLResources::BufferSubData(m_pointLightBuffer, GL_TEXTURE_BUFFER, m_lightsDirtyBegin,
+			m_lightsDirtyEnd - m_lightsDirtyBegin, (const unsigned char*)&m_pointLights[0] + m_lightsDirtyBegin);
+		m_uploadedBytes += m_lightsDirtyEnd - m_lightsDirtyBegin;
+		m_lightsDirtyBegin = 0;
+		m_lightsDirtyEnd = 0;
+	}
+}
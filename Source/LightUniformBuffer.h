@@ -0,0 +1,161 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightuniformbuffer.h
+// ============
+// keep the scene lights in GPU buffers updated only where they change
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  LIGHT_CLUSTER_GRID
+ *
+ *  How the view frustum is split into light clusters, laid
+ *  out like the ivec4 and vec4 at the end of the Lights
+ *  uniform block.
+ ***********************************************************/
+struct LIGHT_CLUSTER_GRID
+{
+	// number of clusters across, down and in depth
+	int countX;
+	int countY;
+	int countZ;
+	// 1 when the lights are assigned to the clusters, so the shader
+	// variant reading the lights of its cluster is drawn with, 0 when
+	// the variant looping over every point light is
+	int bEnabled;
+	// depth slice of a view distance is log(distance) * scale + bias
+	float depthScale;
+	float depthBias;
+	// size of a cluster on the screen in pixels
+	float tileWidth;
+	float tileHeight;
+};
+
+/***********************************************************
+ *  LightUniformBuffer
+ *
+ *  This class keeps the lights of the scene on the CPU and
+ *  copies into the GPU only the bytes that changed since
+ *  the last upload, so moving one light uploads only that
+ *  light.  The directional light, the number of point
+ *  lights and the cluster grid are read from the Lights
+ *  uniform block.  The point lights are read from a buffer
+ *  texture, four texels each, so there can be thousands of
+ *  them.
+ ***********************************************************/
+class LightUniformBuffer
+{
+public:
+	// uniform buffer binding point the Lights block is read from
+	static const GLuint BINDING_POINT = 1;
+	// name of the uniform block in the shader code
+	static const char* const BLOCK_NAME;
+
+	// constructor
+	LightUniformBuffer();
+	// destructor
+	~LightUniformBuffer();
+
+	// get the most point lights the buffer texture of this context can hold
+	static int GetMaxPointLights();
+
+	// create the buffers and bind the uniform block
+	void Initialize();
+	// get the buffer texture holding the point lights
+	GLuint GetPointLightTexture() const { return(m_pointLightTexture); }
+
+	// set the directional light, an inactive light adds nothing
+	void SetDirectionalLight(const glm::vec3& direction, const glm::vec3& ambient,
+		const glm::vec3& diffuse, const glm::vec3& specular, bool bActive);
+	// check whether the directional light adds any light
+	bool IsDirectionalLightActive() const { return(m_header.directionalLight.bActive != 0); }
+	// add a point light that lights nothing beyond its range, returns
+	// its index or -1 when no more lights fit
+	int AddPointLight(const glm::vec3& position, float range, const glm::vec3& ambient,
+		const glm::vec3& diffuse, const glm::vec3& specular);
+	// change a point light that was added
+	void SetPointLight(int index, const glm::vec3& position, float range, const glm::vec3& ambient,
+		const glm::vec3& diffuse, const glm::vec3& specular);
+	// move a point light that was added
+	void SetPointLightPosition(int index, const glm::vec3& position);
+	// get the number of point lights
+	int GetPointLightCount() const { return(m_header.pointLightCount); }
+	// get the position and range of a point light as a bounding sphere
+	glm::vec4 GetPointLightSphere(int index) const;
+	// set how the shader finds the lights of a fragment
+	void SetClusterGrid(const LIGHT_CLUSTER_GRID& grid);
+	// get how the shader finds the lights of a fragment
+	const LIGHT_CLUSTER_GRID& GetClusterGrid() const { return(m_header.clusterGrid); }
+
+	// copy the changed lights into the GPU buffers
+	void Upload();
+	// get the number of bytes uploaded so far
+	size_t GetUploadedBytes() const { return(m_uploadedBytes); }
+
+private:
+	// the directional light as laid out by the std140 rules, every
+	// vec3 starts 16 bytes apart and a scalar can fill the gap
+	struct GPU_DIRECTIONAL_LIGHT
+	{
+		glm::vec3 direction;
+		float padding0;
+		glm::vec3 ambient;
+		float padding1;
+		glm::vec3 diffuse;
+		float padding2;
+		glm::vec3 specular;
+		int bActive;
+	};
+
+	// the Lights uniform block
+	struct GPU_LIGHTS_HEADER
+	{
+		GPU_DIRECTIONAL_LIGHT directionalLight;
+		int pointLightCount;
+		int padding[3];
+		LIGHT_CLUSTER_GRID clusterGrid;
+	};
+
+	// a point light as four RGBA32F texels of the buffer texture
+	struct GPU_POINT_LIGHT
+	{
+		glm::vec3 position;
+		float range;
+		glm::vec3 ambient;
+		float padding0;
+		glm::vec3 diffuse;
+		float padding1;
+		glm::vec3 specular;
+		float padding2;
+	};
+
+	// widen a range of bytes waiting to be uploaded
+	static void MarkDirty(size_t& dirtyBegin, size_t& dirtyEnd, size_t offset, size_t size);
+
+	// the uniform buffer of the Lights block
+	GLuint m_buffer;
+	// the point light buffer, its buffer texture and how many lights it fits
+	GLuint m_pointLightBuffer;
+	GLuint m_pointLightTexture;
+	int m_pointLightCapacity;
+	int m_maxPointLights;
+	// the contents of the buffers
+	GPU_LIGHTS_HEADER m_header;
+	std::vector<GPU_POINT_LIGHT> m_pointLights;
+	// ranges of bytes changed since the last upload
+	size_t m_headerDirtyBegin;
+	size_t m_headerDirtyEnd;
+	size_t m_lightsDirtyBegin;
+	size_t m_lightsDirtyEnd;
+	// bytes uploaded so far
+	size_t m_uploadedBytes;
+};
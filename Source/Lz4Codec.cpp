@@ -0,0 +1,224 @@
+///////////////////////////////////////////////////////////////////////////////
+// lz4codec.cpp
+// ============
+// compress and decompress data in the LZ4 block format
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Lz4Codec.h"
+
+#include <cstdint>
+#include <cstring>
+
+// declaration of the block format limits and helper functions
+namespace
+{
+	// shortest match that can be encoded
+	const size_t g_MinMatch = 4;
+	// the last match must start at least this many bytes before the end
+	const size_t g_MatchStartLimit = 12;
+	// the last bytes of a block are always literals
+	const size_t g_LastLiterals = 5;
+	// farthest back a match can reference
+	const size_t g_MaxOffset = 65535;
+	// number of bits in the match finder hash table index
+	const int g_HashBits = 12;
+
+	uint32_t Read32(const unsigned char* pData)
+	{
+		uint32_t value;
+		memcpy(&value, pData, sizeof(value));
+		return(value);
+	}
+
+	uint32_t HashSequence(uint32_t sequence)
+	{
+		return((sequence * 2654435761u) >> (32 - g_HashBits));
+	}
+
+	// write the extra bytes of a literal or match length of 15 or more
+	void WriteLength(std::vector<unsigned char>& output, size_t length)
+	{
+		while (length >= 255)
+		{
+			output.push_back(255);
+			length -= 255;
+		}
+		output.push_back((unsigned char)length);
+	}
+
+	// write one sequence of literals, followed by a match when matchLength is not 0
+	void WriteSequence(
+		std::vector<unsigned char>& output,
+		const unsigned char* pLiterals, size_t literalLength,
+		size_t offset, size_t matchLength)
+	{
+		size_t matchCode = (matchLength > 0) ? matchLength - g_MinMatch : 0;
+		unsigned char token = (unsigned char)(
+			((literalLength < 15 ? literalLength : 15) << 4) |
+			(matchCode < 15 ? matchCode : 15));
+		output.push_back(token);
+
+		if (literalLength >= 15)
+		{
+			WriteLength(output, literalLength - 15);
+		}
+		output.insert(output.end(), pLiterals, pLiterals + literalLength);
+
+		if (matchLength > 0)
+		{
+			output.push_back((unsigned char)(offset & 0xFF));
+			output.push_back((unsigned char)(offset >> 8));
+			if (matchCode >= 15)
+			{
+				WriteLength(output, matchCode - 15);
+			}
+		}
+	}
+
+	// read the extra bytes of a literal or match length of 15 or more
+	bool ReadLength(const unsigned char* pSource, size_t sourceSize, size_t& position, size_t& length)
+	{
+		unsigned char value = 255;
+		while (value == 255)
+		{
+			if (position >= sourceSize)
+			{
+				return(false);
+			}
+			value = pSource[position++];
+			length += value;
+		}
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  Compress()
+ *
+ *  This method is used for compressing the passed in data
+ *  into a single LZ4 block with a greedy hash match finder.
+ ***********************************************************/
+void Lz4Codec::Compress(const unsigned char* pSource, size_t sourceSize, std::vector<unsigned char>& compressed)
+{
+	compressed.clear();
+	compressed.reserve(sourceSize + sourceSize / 255 + 16);
+
+	size_t anchor = 0;
+
+	if (sourceSize > g_MatchStartLimit)
+	{
+		std::vector<int64_t> hashTable((size_t)1 << g_HashBits, -1);
+		size_t matchStartLimit = sourceSize - g_MatchStartLimit;
+		size_t matchEndLimit = sourceSize - g_LastLiterals;
+		size_t position = 0;
+
+		while (position < matchStartLimit)
+		{
+			uint32_t sequence = Read32(pSource + position);
+			uint32_t hash = HashSequence(sequence);
+			int64_t candidate = hashTable[hash];
+			hashTable[hash] = (int64_t)position;
+
+			if ((candidate >= 0) &&
+				(position - (size_t)candidate <= g_MaxOffset) &&
+				(Read32(pSource + candidate) == sequence))
+			{
+				size_t matchLength = g_MinMatch;
+				while ((position + matchLength < matchEndLimit) &&
+					(pSource[candidate + matchLength] == pSource[position + matchLength]))
+				{
+					matchLength++;
+				}
+
+				WriteSequence(compressed, pSource + anchor, position - anchor,
+					position - (size_t)candidate, matchLength);
+
+				position += matchLength;
+				anchor = position;
+			}
+			else
+			{
+				position++;
+			}
+		}
+	}
+
+	// the block always ends with a sequence of literals only
+	WriteSequence(compressed, pSource + anchor, sourceSize - anchor, 0, 0);
+}
+
+/***********************************************************
+ *  Decompress()
+ *
+ *  This method is used for decompressing a single LZ4 block
+ *  into the passed in buffer.  Every length and offset is
+ *  checked, so corrupt data returns false instead of reading
+ *  or writing outside of the buffers.
+ ***********************************************************/
+bool Lz4Codec::Decompress(const unsigned char* pSource, size_t sourceSize, unsigned char* pDestination, size_t destinationSize)
+{
+	size_t inputPosition = 0;
+	size_t outputPosition = 0;
+
+	while (inputPosition < sourceSize)
+	{
+		unsigned char token = pSource[inputPosition++];
+
+		size_t literalLength = token >> 4;
+		if ((literalLength == 15) &&
+			(ReadLength(pSource, sourceSize, inputPosition, literalLength) == false))
+		{
+			return(false);
+		}
+		if ((literalLength > sourceSize - inputPosition) ||
+			(literalLength > destinationSize - outputPosition))
+		{
+			return(false);
+		}
+		memcpy(pDestination + outputPosition, pSource + inputPosition, literalLength);
+		inputPosition += literalLength;
+		outputPosition += literalLength;
+
+		// the last sequence has no match
+		if (inputPosition == sourceSize)
+		{
+			break;
+		}
+
+		if (sourceSize - inputPosition < 2)
+		{
+			return(false);
+		}
+		size_t offset = pSource[inputPosition] | ((size_t)pSource[inputPosition + 1] << 8);
+		inputPosition += 2;
+		if ((offset == 0) || (offset > outputPosition))
+		{
+			return(false);
+		}
+
+		size_t matchLength = token & 0x0F;
+		if ((matchLength == 15) &&
+			(ReadLength(pSource, sourceSize, inputPosition, matchLength) == false))
+		{
+			return(false);
+		}
+		matchLength += g_MinMatch;
+		if (matchLength > destinationSize - outputPosition)
+		{
+			return(false);
+		}
+
+		// matches may overlap the bytes they are producing
+		const unsigned char* pMatch = pDestination + outputPosition - offset;
+		for (size_t i = 0; i < matchLength; i++)
+		{
+			pDestination[outputPosition + i] = pMatch[i];
+		}
+		outputPosition += matchLength;
+	}
+
+	return(outputPosition == destinationSize);
+}
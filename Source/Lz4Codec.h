@@ -0,0 +1,29 @@
+///////////////////////////////////////////////////////////////////////////////
+// lz4codec.h
+// ============
+// compress and decompress data in the LZ4 block format
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  Lz4Codec
+ *
+ *  This class compresses and decompresses data using the
+ *  LZ4 block format, so packed assets can be read back
+ *  with a fast decompressor and no external library.
+ ***********************************************************/
+class Lz4Codec
+{
+public:
+	// compress data into a single LZ4 block
+	static void Compress(const unsigned char* pSource, size_t sourceSize, std::vector<unsigned char>& compressed);
+	// decompress a single LZ4 block into a buffer of the exact original size
+	static bool Decompress(const unsigned char* pSource, size_t sourceSize, unsigned char* pDestination, size_t destinationSize);
+};
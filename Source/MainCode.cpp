@@ -9,6 +9,9 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // command line option parsing
+#include <string>
+#include <vector>
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -22,6 +25,13 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "TextureLoader.h"
+#include "ImageDecoder.h"
+#include "AssetPack.h"
+#include "GLResources.h"
+#include "RenderState.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderFileWatcher.h"
 
 // Namespace for declaring global variables
 namespace
@@ -40,12 +50,31 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// asset pack that the shaders and textures are read from, if it exists
+	AssetPack* g_AssetPack = nullptr;
+	// linked shader programs kept from earlier launches
+	ProgramBinaryCache* g_ProgramCache = nullptr;
+	// watches the shader files so saved edits are reloaded while running
+	ShaderFileWatcher* g_ShaderWatcher = nullptr;
+
+	// pack file built with the --pack option
+	const char* const ASSET_PACK_FILENAME = "assets.pak";
+	// shader source files, also used as their asset pack entry names
+	const char* const VERTEX_SHADER_FILENAME = "shaders/vertexShader.glsl";
+	const char* const FRAGMENT_SHADER_FILENAME = "shaders/fragmentShader.glsl";
+	// directory of the program binary cache
+	const char* const PROGRAM_CACHE_DIRECTORY = "cache/programs";
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void RenderFrame(SceneManager* pSceneManager);
+void RunProceduralTextureBenchmark();
+void RunDeferredShadingBenchmark();
+void RunLightingBenchmark();
+void PrintProgramCacheStats();
 
 
 /***********************************************************
@@ -56,6 +85,49 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// compare the texture cache against decoding the passed in
+	// image files instead of running the 3D scene
+	if ((argc > 1) && (strcmp(argv[1], "--benchmark-texture-cache") == 0))
+	{
+		std::vector<std::string> filenames(argv + 2, argv + argc);
+		TextureLoader::RunCacheBenchmark(filenames);
+		return(EXIT_SUCCESS);
+	}
+
+	// compare the image decoders at each decode-time scale on the
+	// passed in image files instead of running the 3D scene
+	if ((argc > 1) && (strcmp(argv[1], "--benchmark-image-decoders") == 0))
+	{
+		std::vector<std::string> filenames(argv + 2, argv + argc);
+		ImageDecoder::RunBenchmark(filenames);
+		return(EXIT_SUCCESS);
+	}
+
+	// encode the passed in image files into the texture cache, block
+	// compressed the way the 3D scene loads them
+	if ((argc > 1) && (strcmp(argv[1], "--bake-textures") == 0))
+	{
+		std::vector<std::string> filenames(argv + 2, argv + argc);
+		TextureLoader textureLoader;
+		textureLoader.SetCompressTextures(true);
+		textureLoader.BakeTextures(filenames, true);
+		return(EXIT_SUCCESS);
+	}
+
+	// split a very large image into the tiles of a virtual texture
+	if ((argc > 3) && (strcmp(argv[1], "--build-virtual-texture") == 0))
+	{
+		return(VirtualTextureSystem::Build(argv[2], argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// write the passed in files and directories into an asset pack
+	// instead of running the 3D scene
+	if ((argc > 2) && (strcmp(argv[1], "--pack") == 0))
+	{
+		std::vector<std::string> paths(argv + 3, argv + argc);
+		return(AssetPack::Build(argv[2], paths) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -79,15 +151,178 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
+	// edit the OpenGL resources with direct state access when the
+	// context has it, unless the bind-to-edit path is asked for, and
+	// load the shader programs from the program binary cache unless
+	// compiling every program is asked for
+	bool bAllowDirectStateAccess = true;
+	bool bProgramCache = true;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--no-direct-state-access") == 0)
+		{
+			bAllowDirectStateAccess = false;
+		}
+		else if (strcmp(argv[i], "--no-program-cache") == 0)
+		{
+			bProgramCache = false;
+		}
+	}
+	GLResources::Initialize(bAllowDirectStateAccess);
+	RenderState::Initialize();
+	g_ProgramCache = new ProgramBinaryCache(PROGRAM_CACHE_DIRECTORY);
+	if (bProgramCache == true)
+	{
+		g_ProgramCache->Initialize();
+	}
+	g_ShaderManager->SetProgramCache(g_ProgramCache);
+
+	// map the asset pack, so the assets it holds need no file opens
+	g_AssetPack = new AssetPack();
+	if (g_AssetPack->Open(ASSET_PACK_FILENAME) == false)
+	{
+		delete g_AssetPack;
+		g_AssetPack = NULL;
+	}
+
+	// load the shader code from the asset pack, or from the external
+	// GLSL files when the pack does not hold them
+	const unsigned char* pVertexSource = NULL;
+	const unsigned char* pFragmentSource = NULL;
+	size_t vertexSourceSize = 0;
+	size_t fragmentSourceSize = 0;
+	if ((NULL != g_AssetPack) &&
+		(g_AssetPack->Find(VERTEX_SHADER_FILENAME, pVertexSource, vertexSourceSize) == true) &&
+		(g_AssetPack->Find(FRAGMENT_SHADER_FILENAME, pFragmentSource, fragmentSourceSize) == true))
+	{
+		g_ShaderManager->LoadShaderSources(
+			(const char*)pVertexSource, vertexSourceSize,
+			(const char*)pFragmentSource, fragmentSourceSize);
+	}
+	else
+	{
+		g_ShaderManager->LoadShaders(
+			VERTEX_SHADER_FILENAME,
+			FRAGMENT_SHADER_FILENAME);
+
+		// only shaders read from their files can be edited and reloaded
+		std::vector<std::string> shaderFiles;
+		shaderFiles.push_back(VERTEX_SHADER_FILENAME);
+		shaderFiles.push_back(FRAGMENT_SHADER_FILENAME);
+		g_ShaderWatcher = new ShaderFileWatcher();
+		if (g_ShaderWatcher->Watch(shaderFiles) == false)
+		{
+			delete g_ShaderWatcher;
+			g_ShaderWatcher = NULL;
+		}
+	}
 	g_ShaderManager->use();
 
+	// compare loading the wood and drywall textures from their image
+	// files against baking them on the GPU, or the forward and deferred
+	// shading paths, or measure the cost of lighting a fragment, instead
+	// of running the scene
+	bool bProceduralBenchmark = (argc > 1) && (strcmp(argv[1], "--benchmark-procedural-textures") == 0);
+	bool bDeferredBenchmark = (argc > 1) && (strcmp(argv[1], "--benchmark-deferred-shading") == 0);
+	bool bLightingBenchmark = (argc > 1) && (strcmp(argv[1], "--benchmark-lighting") == 0);
+	if ((bProceduralBenchmark == true) || (bDeferredBenchmark == true) || (bLightingBenchmark == true))
+	{
+		if (bProceduralBenchmark == true)
+		{
+			RunProceduralTextureBenchmark();
+		}
+		else if (bDeferredBenchmark == true)
+		{
+			RunDeferredShadingBenchmark();
+		}
+		else
+		{
+			RunLightingBenchmark();
+		}
+
+		delete g_ViewManager;
+		g_ViewManager = NULL;
+		delete g_ShaderManager;
+		g_ShaderManager = NULL;
+		delete g_ProgramCache;
+		g_ProgramCache = NULL;
+		delete g_ShaderWatcher;
+		g_ShaderWatcher = NULL;
+		if (NULL != g_AssetPack)
+		{
+			delete g_AssetPack;
+			g_AssetPack = NULL;
+		}
+		return(EXIT_SUCCESS);
+	}
+
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager->SetAssetPack(g_AssetPack);
+	for (int i = 1; i < argc; i++)
+	{
+		// load uncompressed textures instead, to compare the frame times
+		if (strcmp(argv[i], "--uncompressed-textures") == 0)
+		{
+			g_SceneManager->SetCompressTextures(false);
+		}
+		// bake the wood and drywall textures on the GPU instead
+		else if (strcmp(argv[i], "--procedural-textures") == 0)
+		{
+			g_SceneManager->SetProceduralTextures(true);
+		}
+		// load the textures at a lower resolution
+		else if ((strcmp(argv[i], "--texture-scale") == 0) && (i + 1 < argc))
+		{
+			g_SceneManager->SetTextureDecodeScale(atoi(argv[++i]));
+		}
+		// pack every texture into the texture array at this size
+		else if ((strcmp(argv[i], "--texture-array-size") == 0) && (i + 1 < argc))
+		{
+			g_SceneManager->SetTextureArraySize(atoi(argv[++i]));
+		}
+		// filter the textures bilinear, trilinear or anisotropic
+		else if ((strcmp(argv[i], "--texture-quality") == 0) && (i + 1 < argc))
+		{
+			i++;
+			if (strcmp(argv[i], "low") == 0)
+			{
+				g_SceneManager->SetTextureQuality(TEXTURE_QUALITY_LOW);
+			}
+			else if (strcmp(argv[i], "medium") == 0)
+			{
+				g_SceneManager->SetTextureQuality(TEXTURE_QUALITY_MEDIUM);
+			}
+			else if (strcmp(argv[i], "high") == 0)
+			{
+				g_SceneManager->SetTextureQuality(TEXTURE_QUALITY_HIGH);
+			}
+			else
+			{
+				std::cout << "Unknown texture quality: " << argv[i] << std::endl;
+			}
+		}
+		// light every fragment with every point light, to compare the frame times
+		else if (strcmp(argv[i], "--no-clustered-lighting") == 0)
+		{
+			g_SceneManager->SetClusteredLighting(false);
+		}
+		// scatter extra small point lights over the scene
+		else if ((strcmp(argv[i], "--point-lights") == 0) && (i + 1 < argc))
+		{
+			g_SceneManager->SetExtraPointLights(atoi(argv[++i]));
+		}
+		// start with the deferred shading path
+		else if (strcmp(argv[i], "--deferred-shading") == 0)
+		{
+			g_SceneManager->SetDeferredShading(true);
+		}
+	}
 	g_SceneManager->PrepareScene();
+	GL_RESOURCE_STATS startupResourceStats = GLResources::GetStats();
+	UNIFORM_UPLOAD_STATS startupUniformStats = ShaderManager::GetUniformStats();
+	RENDER_STATE_STATS startupRenderStateStats = RenderState::GetStats();
+	SCENE_GRAPH_STATS startupSceneGraphStats = g_SceneManager->GetSceneGraph().GetStats();
 
 	std::cout << "\n*** KEY FUNCTIONS: ***\n";
 	std::cout << "ESC - close the window and exit\n";
@@ -95,35 +330,149 @@ int main(int argc, char* argv[])
 	std::cout << "A - pan left\t" << "D - pan right\n";
 	std::cout << "Q - pan up\t" << "E - pan down\n";
 	std::cout << "1 - perspective view\n";
+	std::cout << "F - switch between forward and deferred shading\n";
+	if (NULL != g_ShaderWatcher)
+	{
+		std::cout << "Saving a shader file reloads it\n";
+	}
+
+	// frame timing, reported when the application is closed
+	int frameCount = 0;
+	double frameStartTime = glfwGetTime();
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
+	bool bShadingKeyDown = false;
+	// timing of the shader reload in progress
+	double reloadStartTime = 0.0;
+	double reloadFrameTime = 0.0;
+	double reloadLongestFrameMs = 0.0;
+	int reloadFrames = 0;
 	while (!glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
-
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
-
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
-
-
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		// start rebuilding the shader programs when a shader file was
+		// saved, the current programs keep drawing until the new ones link
+		if ((NULL != g_ShaderWatcher) && (g_ShaderWatcher->HasChanged() == true))
+		{
+			if (g_ShaderManager->BeginReloadShaders(VERTEX_SHADER_FILENAME, FRAGMENT_SHADER_FILENAME) == true)
+			{
+				std::cout << "Reloading shaders" << std::endl;
+				reloadStartTime = glfwGetTime();
+				reloadFrameTime = reloadStartTime;
+				reloadLongestFrameMs = 0.0;
+				reloadFrames = 0;
+			}
+		}
+		if (g_ShaderManager->IsReloading() == true)
+		{
+			SHADER_RELOAD_STATE reloadState = g_ShaderManager->UpdateReload();
+			if (reloadState == SHADER_RELOAD_DONE)
+			{
+				std::cout << "Shaders reloaded in " << ((glfwGetTime() - reloadStartTime) * 1000.0)
+					<< " ms over " << reloadFrames << " frames, longest frame "
+					<< reloadLongestFrameMs << " ms" << std::endl;
+			}
+		}
+
+		// switch the shading path once each time the key goes down
+		bool bShadingKey = (glfwGetKey(g_Window, GLFW_KEY_F) == GLFW_PRESS);
+		if ((bShadingKey == true) && (bShadingKeyDown == false))
+		{
+			g_SceneManager->SetDeferredShading(!g_SceneManager->IsDeferredShading());
+			std::cout << ((g_SceneManager->IsDeferredShading() == true) ? "Deferred" : "Forward")
+				<< " shading" << std::endl;
+		}
+		bShadingKeyDown = bShadingKey;
+
+		RenderFrame(g_SceneManager);
+
+		// the frames drawn while a reload runs should take no longer
+		// than any other frame
+		if (g_ShaderManager->IsReloading() == true)
+		{
+			double currentTime = glfwGetTime();
+			double frameMs = (currentTime - reloadFrameTime) * 1000.0;
+			reloadLongestFrameMs = (frameMs > reloadLongestFrameMs) ? frameMs : reloadLongestFrameMs;
+			reloadFrameTime = currentTime;
+			reloadFrames++;
+		}
+
+		// the shader variants of the scene are built by the first frame
+		frameCount++;
+		if (frameCount == 1)
+		{
+			PrintProgramCacheStats();
+		}
+	}
 
-		// query the latest GLFW events
-		glfwPollEvents();
+	if (frameCount > 0)
+	{
+		std::cout << "Average frame time: " << ((glfwGetTime() - frameStartTime) * 1000.0 / frameCount)
+			<< " ms over " << frameCount << " frames" << std::endl;
+
+		// the frames keep streaming textures and virtual texture tiles
+		const GL_RESOURCE_STATS& resourceStats = GLResources::GetStats();
+		int startupBinds = startupResourceStats.editBinds + startupResourceStats.useBinds;
+		int frameBinds = resourceStats.editBinds + resourceStats.useBinds - startupBinds;
+		std::cout << "Resource binds " << ((GLResources::IsDirectStateAccess() == true) ?
+			"with direct state access: " : "with bind-to-edit: ")
+			<< startupBinds << " for " << startupResourceStats.resourceEdits << " edits at startup, "
+			<< ((double)frameBinds / frameCount) << " for "
+			<< ((double)(resourceStats.resourceEdits - startupResourceStats.resourceEdits) / frameCount)
+			<< " edits per frame, " << resourceStats.resourcesCreated << " resources created" << std::endl;
+
+		// uniform values the programs already held are not sent again
+		const UNIFORM_UPLOAD_STATS& uniformStats = ShaderManager::GetUniformStats();
+		int frameUploads = uniformStats.uploads - startupUniformStats.uploads;
+		int frameSkipped = uniformStats.skipped - startupUniformStats.skipped;
+		std::cout << "Uniform values: " << ((double)frameUploads / frameCount) << " sent and "
+			<< ((double)frameSkipped / frameCount) << " skipped per frame ("
+			<< ((frameUploads + frameSkipped > 0) ? (100.0 * frameSkipped / (frameUploads + frameSkipped)) : 0.0)
+			<< "% skipped)" << std::endl;
+
+		// state that was already bound is not set again
+		const RENDER_STATE_STATS& renderStateStats = RenderState::GetStats();
+		int frameCalls = renderStateStats.calls - startupRenderStateStats.calls;
+		int frameStatesSkipped = renderStateStats.skipped - startupRenderStateStats.skipped;
+		std::cout << "Render state changes: " << ((double)frameCalls / frameCount) << " made and "
+			<< ((double)frameStatesSkipped / frameCount) << " skipped per frame ("
+			<< ((frameCalls + frameStatesSkipped > 0) ? (100.0 * frameStatesSkipped / (frameCalls + frameStatesSkipped)) : 0.0)
+			<< "% skipped)" << std::endl;
+
+		// the scene graph only places the objects that moved again
+		const SceneGraph& sceneGraph = g_SceneManager->GetSceneGraph();
+		std::cout << "Scene graph: " << sceneGraph.GetNodeCount() << " nodes, "
+			<< ((double)(sceneGraph.GetStats().nodesUpdated - startupSceneGraphStats.nodesUpdated) / frameCount)
+			<< " world transforms recomputed per frame" << std::endl;
 	}
 
 	// clear the allocated manager objects from memory
 	if (NULL != g_SceneManager)
 	{
+		const TEXTURE_MEMORY_STATS& stats = g_SceneManager->GetTextureMemoryStats();
+		std::cout << "Texture memory: " << (stats.residentBytes / 1024) << " KB in " << stats.textureCount
+			<< " textures, peak " << (stats.peakBytes / 1024) << " KB, budget " << (stats.budgetBytes / 1024)
+			<< " KB, " << stats.downgrades << " mip levels dropped, " << stats.restores << " textures restored" << std::endl;
+		if (stats.overBudgetFrames > 0)
+		{
+			std::cout << "Texture memory over budget with nothing evictable for " << stats.overBudgetFrames
+				<< " frames, " << (stats.pinnedBytes / 1024) << " KB in textures that are never downgraded" << std::endl;
+		}
+		const LIGHT_CLUSTER_STATS& lightStats = g_SceneManager->GetLightClusterStats();
+		std::cout << "Point lights: " << g_SceneManager->GetPointLightCount() << ", " << lightStats.visibleLights
+			<< " visible, " << lightStats.lightIndices << " light indices, max " << lightStats.maxClusterLights
+			<< " per cluster, assigned in " << lightStats.assignTimeMs << " ms" << std::endl;
+		std::cout << "Shader variants: " << g_SceneManager->GetShaderVariantCount() << " built" << std::endl;
+		PrintProgramCacheStats();
+		const VIRTUAL_TEXTURE_STATS& virtualStats = g_SceneManager->GetVirtualTextureStats();
+		if (virtualStats.textureCount > 0)
+		{
+			std::cout << "Virtual textures: " << virtualStats.textureCount << " textures of "
+				<< (virtualStats.virtualBytes / 1024) << " KB drawn from a " << (virtualStats.cacheBytes / 1024)
+				<< " KB tile cache, " << virtualStats.residentTiles << " of " << virtualStats.cacheSlots
+				<< " tiles resident, " << virtualStats.tilesLoaded << " loaded, " << virtualStats.tilesEvicted
+				<< " evicted, " << virtualStats.feedbackDelays << " frames waiting for feedback" << std::endl;
+		}
 		delete g_SceneManager;
 		g_SceneManager = NULL;
 	}
@@ -137,6 +486,22 @@ int main(int argc, char* argv[])
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
+	if (NULL != g_ProgramCache)
+	{
+		delete g_ProgramCache;
+		g_ProgramCache = NULL;
+	}
+	if (NULL != g_ShaderWatcher)
+	{
+		delete g_ShaderWatcher;
+		g_ShaderWatcher = NULL;
+	}
+	// the scene textures may point into the pack until the scene is freed
+	if (NULL != g_AssetPack)
+	{
+		delete g_AssetPack;
+		g_AssetPack = NULL;
+	}
 
 	// Terminates the program successfully
 	exit(EXIT_SUCCESS); 
@@ -194,4 +559,281 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
-}
\ No newline at end of file
+}
+
+/***********************************************************
+ *	RenderFrame()
+ *
+ *  This function is used to draw a single frame of the 3D
+ *  scene and present it in the display window.
+ ***********************************************************/
+void RenderFrame(SceneManager* pSceneManager)
+{
+	// Clear the frame and z buffers
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// convert from 3D object space to 2D view
+	g_ViewManager->PrepareSceneView();
+	pSceneManager->SetCameraMatrices(g_ViewManager->GetViewMatrix(), g_ViewManager->GetProjectionMatrix());
+
+	// refresh the 3D scene
+	pSceneManager->RenderScene();
+
+
+	// Flips the the back buffer with the front buffer every frame.
+	glfwSwapBuffers(g_Window);
+
+	// query the latest GLFW events
+	glfwPollEvents();
+}
+
+/***********************************************************
+ *	PrintProgramCacheStats()
+ *
+ *  This function is used to print how many of the shader
+ *  programs built so far were loaded from the program
+ *  binary cache, and the compile time that saved.
+ ***********************************************************/
+void PrintProgramCacheStats()
+{
+	const PROGRAM_CACHE_STATS& stats = g_ProgramCache->GetStats();
+	int programCount = stats.hits + stats.misses;
+	if (g_ProgramCache->IsEnabled() == false)
+	{
+		std::cout << "Program cache: off, " << programCount << " programs compiled in "
+			<< stats.compileTimeMs << " ms" << std::endl;
+		return;
+	}
+
+	std::cout << "Program cache: " << stats.hits << " of " << programCount << " programs loaded ("
+		<< ((programCount > 0) ? (100.0 * stats.hits / programCount) : 0.0) << "% hit rate) in "
+		<< stats.loadTimeMs << " ms, " << stats.misses << " compiled in " << stats.compileTimeMs << " ms, "
+		<< stats.rejected << " rejected, " << stats.savedTimeMs << " ms of compiling saved" << std::endl;
+}
+
+/***********************************************************
+ *	RunProceduralTextureBenchmark()
+ *
+ *  This function is used to prepare the 3D scene once with
+ *  the wood and drywall textures loaded from their image
+ *  files, and once with them baked on the GPU.  For each
+ *  it reports the time until every texture is loaded, the
+ *  average frame time afterwards, and the texture memory.
+ *  The image files are read from the texture cache when it
+ *  holds them, so run the scene once beforehand to compare
+ *  against a warm cache.
+ ***********************************************************/
+void RunProceduralTextureBenchmark()
+{
+	const int frameCount = 300;
+	const char* modeNames[2] = { "image files", "procedural" };
+
+	// draw as fast as possible, so the frame times are not tied to vsync
+	glfwSwapInterval(0);
+
+	for (int mode = 0; mode < 2; mode++)
+	{
+		SceneManager* pSceneManager = new SceneManager(g_ShaderManager);
+		pSceneManager->SetAssetPack(g_AssetPack);
+		pSceneManager->SetProceduralTextures(mode == 1);
+
+		// the textures are streamed in while the first frames are drawn
+		double startTime = glfwGetTime();
+		pSceneManager->PrepareScene();
+		int loadFrames = 0;
+		do
+		{
+			RenderFrame(pSceneManager);
+			loadFrames++;
+		} while (pSceneManager->AreTexturesLoaded() == false);
+		glFinish();
+		double loadMs = (glfwGetTime() - startTime) * 1000.0;
+
+		startTime = glfwGetTime();
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			RenderFrame(pSceneManager);
+		}
+		glFinish();
+		double frameMs = (glfwGetTime() - startTime) * 1000.0 / frameCount;
+
+		const TEXTURE_MEMORY_STATS& stats = pSceneManager->GetTextureMemoryStats();
+		std::cout << modeNames[mode] << ": textures loaded in " << loadMs << " ms over " << loadFrames
+			<< " frames, " << frameMs << " ms per frame, " << (stats.residentBytes / 1024)
+			<< " KB texture memory" << std::endl;
+
+		delete pSceneManager;
+	}
+}
+
+/***********************************************************
+ *	RunDeferredShadingBenchmark()
+ *
+ *  This function is used to draw the 3D scene with the
+ *  forward and the deferred shading paths as the number of
+ *  point lights and the overdraw grow.  The overdraw is
+ *  added by drawing copies of the wall behind it, each one
+ *  covered by the next.  For each combination it reports
+ *  the average frame time once every texture is loaded.
+ ***********************************************************/
+void RunDeferredShadingBenchmark()
+{
+	const int frameCount = 200;
+	const int warmupFrames = 10;
+	const int lightCounts[4] = { 0, 256, 1024, 4096 };
+	const int overdrawLayers[2] = { 0, 8 };
+	const char* modeNames[2] = { "forward", "deferred" };
+
+	// draw as fast as possible, so the frame times are not tied to vsync
+	glfwSwapInterval(0);
+
+	for (int lights = 0; lights < 4; lights++)
+	{
+		SceneManager* pSceneManager = new SceneManager(g_ShaderManager);
+		pSceneManager->SetAssetPack(g_AssetPack);
+		pSceneManager->SetExtraPointLights(lightCounts[lights]);
+		pSceneManager->PrepareScene();
+		do
+		{
+			RenderFrame(pSceneManager);
+		} while (pSceneManager->AreTexturesLoaded() == false);
+
+		for (int overdraw = 0; overdraw < 2; overdraw++)
+		{
+			pSceneManager->SetOverdrawLayers(overdrawLayers[overdraw]);
+			for (int mode = 0; mode < 2; mode++)
+			{
+				// the first frames of a path create its buffers
+				pSceneManager->SetDeferredShading(mode == 1);
+				for (int frame = 0; frame < warmupFrames; frame++)
+				{
+					RenderFrame(pSceneManager);
+				}
+				glFinish();
+
+				double startTime = glfwGetTime();
+				for (int frame = 0; frame < frameCount; frame++)
+				{
+					RenderFrame(pSceneManager);
+				}
+				glFinish();
+				double frameMs = (glfwGetTime() - startTime) * 1000.0 / frameCount;
+
+				std::cout << modeNames[mode] << ", " << pSceneManager->GetPointLightCount() << " point lights, "
+					<< overdrawLayers[overdraw] << " overdraw layers: " << frameMs << " ms per frame" << std::endl;
+			}
+		}
+
+		delete pSceneManager;
+	}
+}
+
+/***********************************************************
+ *	RunLightingBenchmark()
+ *
+ *  This function is used to measure the cost of lighting a
+ *  fragment in the forward path as the number of point
+ *  lights grows.  Every frame draws planes that each cover
+ *  the whole view at the window resolution, so the number
+ *  of fragments shaded is fixed, once textured and once in
+ *  a flat color, with the previous per-light kernel and the
+ *  shared surface kernel.  For each combination it reports
+ *  the time per frame and per fragment, and the time each
+ *  added light costs a fragment, from the slope between
+ *  the rows with fewer and more lights, so the cost of the
+ *  fragment that does not depend on the lights is left
+ *  out.  The difference between the textured and flat rows
+ *  is the cost of sampling the texture, which the shared
+ *  surface kernel pays once per fragment and the per-light
+ *  kernel again in every light.
+ ***********************************************************/
+void RunLightingBenchmark()
+{
+	const int frameCount = 100;
+	const int warmupFrames = 10;
+	const int planeLayers = 4;
+	const int extraLightCounts[4] = { 0, 16, 64, 256 };
+	const char* surfaceNames[2] = { "flat color", "textured" };
+	const char* kernelNames[2] = { "per-light kernel", "shared surface kernel" };
+	const SHADER_LIGHTING_KERNEL kernels[2] = {
+		SHADER_LIGHTING_KERNEL_PER_LIGHT, SHADER_LIGHTING_KERNEL_SHARED_SURFACE };
+
+	// time per fragment of each light count, kernel and surface, and the
+	// point lights of each light count
+	double fragmentNs[4][2][2] = {};
+	int lightCounts[4] = {};
+
+	// draw as fast as possible, so the frame times are not tied to vsync
+	glfwSwapInterval(0);
+
+	for (int lights = 0; lights < 4; lights++)
+	{
+		SceneManager* pSceneManager = new SceneManager(g_ShaderManager);
+		pSceneManager->SetAssetPack(g_AssetPack);
+		pSceneManager->SetClusteredLighting(false);
+		pSceneManager->SetExtraPointLights(extraLightCounts[lights]);
+		pSceneManager->PrepareScene();
+		do
+		{
+			RenderFrame(pSceneManager);
+		} while (pSceneManager->AreTexturesLoaded() == false);
+
+		lightCounts[lights] = pSceneManager->GetPointLightCount();
+		for (int kernel = 0; kernel < 2; kernel++)
+		{
+			pSceneManager->SetLightingKernel(kernels[kernel]);
+			for (int surface = 0; surface < 2; surface++)
+			{
+				double startTime = 0.0;
+				for (int frame = 0; frame < warmupFrames + frameCount; frame++)
+				{
+					// the first frames build the shader variant
+					if (frame == warmupFrames)
+					{
+						glFinish();
+						startTime = glfwGetTime();
+					}
+
+					glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					g_ViewManager->PrepareSceneView();
+					pSceneManager->SetCameraMatrices(g_ViewManager->GetViewMatrix(), g_ViewManager->GetProjectionMatrix());
+					pSceneManager->RenderShadingTest(surface == 1, planeLayers);
+					glfwSwapBuffers(g_Window);
+					glfwPollEvents();
+				}
+				glFinish();
+				double frameMs = (glfwGetTime() - startTime) * 1000.0 / frameCount;
+
+				GLint viewport[4];
+				glGetIntegerv(GL_VIEWPORT, viewport);
+				double fragments = (double)viewport[2] * viewport[3] * planeLayers;
+				fragmentNs[lights][kernel][surface] = frameMs * 1000000.0 / fragments;
+				std::cout << kernelNames[kernel] << ", " << surfaceNames[surface] << ", " << lightCounts[lights]
+					<< " point lights, " << viewport[2] << "x" << viewport[3] << " x " << planeLayers << " planes: "
+					<< frameMs << " ms per frame, " << fragmentNs[lights][kernel][surface] << " ns per fragment";
+				if (lights > 0)
+				{
+					// the slope from the previous row, per light added
+					std::cout << ", " << ((fragmentNs[lights][kernel][surface] - fragmentNs[lights - 1][kernel][surface]) /
+						(lightCounts[lights] - lightCounts[lights - 1])) << " ns per added light";
+				}
+				std::cout << std::endl;
+			}
+		}
+
+		delete pSceneManager;
+	}
+
+	// the slope over every light count gives the cost of one light
+	for (int kernel = 0; kernel < 2; kernel++)
+	{
+		for (int surface = 0; surface < 2; surface++)
+		{
+			std::cout << kernelNames[kernel] << ", " << surfaceNames[surface] << ": "
+				<< ((fragmentNs[3][kernel][surface] - fragmentNs[0][kernel][surface]) / (lightCounts[3] - lightCounts[0]))
+				<< " ns per light from " << lightCounts[0] << " to " << lightCounts[3] << " point lights" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// map files read-only into memory
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class maps the contents of a file read-only into
+ *  memory so it can be read without copying it into a
+ *  separate buffer first.
+ ***********************************************************/
+class MappedFile
+{
+public:
+	// constructor
+	MappedFile();
+	// destructor
+	~MappedFile();
+
+	// map the passed in file into memory
+	bool Open(const char* filename);
+	// unmap the file from memory
+	void Close();
+
+	// get the mapped contents of the file
+	const unsigned char* GetData() const { return m_pData; }
+	// get the size of the mapped file in bytes
+	size_t GetSize() const { return m_size; }
+
+private:
+	// the mapped file contents
+	const unsigned char* m_pData;
+	// size of the mapped file in bytes
+	size_t m_size;
+#ifdef _WIN32
+	// operating system handles for the file and its mapping
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+
+	// mapped files cannot be copied
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
@@ -0,0 +1,266 @@
+///////////////////////////////////////////////////////////////////////////////
+// proceduraltexturebaker.cpp
+// ============
+// bake tileable noise textures on the GPU from material parameters
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ProceduralTextureBaker.h"
+#include "GLResources.h"
+#include "RenderState.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// full screen triangle generated from the vertex index
+	const char* g_BakeVertexShader = R"(#version 330 core
+out vec2 textureCoordinate;
+
+void main()
+{
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	textureCoordinate = position;
+	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+	// periodic value noise, summed over octaves, shaped into the patterns
+	const char* g_BakeFragmentShader = R"(#version 330 core
+in vec2 textureCoordinate;
+out vec4 fragmentColor;
+
+uniform int pattern;
+uniform vec3 baseColor;
+uniform vec3 detailColor;
+uniform float frequency;
+uniform float noiseCells;
+uniform float turbulence;
+uniform float seed;
+
+// random value of a lattice point, wrapped to the period so the noise tiles
+float Hash(vec2 cell, vec2 period)
+{
+	cell = mod(cell, period);
+	return fract(sin(dot(cell, vec2(127.1, 311.7)) + seed * 17.13) * 43758.5453);
+}
+
+// smoothly interpolated value noise with the passed in period in cells
+float Noise(vec2 position, vec2 period)
+{
+	vec2 cell = floor(position);
+	vec2 blend = fract(position);
+	blend = blend * blend * (3.0 - 2.0 * blend);
+
+	float a = Hash(cell, period);
+	float b = Hash(cell + vec2(1.0, 0.0), period);
+	float c = Hash(cell + vec2(0.0, 1.0), period);
+	float d = Hash(cell + vec2(1.0, 1.0), period);
+	return mix(mix(a, b, blend.x), mix(c, d, blend.x), blend.y);
+}
+
+// five octaves of noise, each with double the cells of the last
+float Fbm(vec2 uv, vec2 cells)
+{
+	float value = 0.0;
+	float amplitude = 0.5;
+	for (int octave = 0; octave < 5; octave++)
+	{
+		value += amplitude * Noise(uv * cells, cells);
+		cells *= 2.0;
+		amplitude *= 0.5;
+	}
+	return value;
+}
+
+// rings bent by the noise, with fine fibers stretched along the grain
+vec3 Wood(vec2 uv)
+{
+	float grain = uv.y * frequency + Fbm(uv, vec2(noiseCells)) * turbulence;
+	float ring = fract(grain);
+	ring = smoothstep(0.0, 0.35, ring) - smoothstep(0.65, 1.0, ring);
+	float fibers = Noise(uv * vec2(noiseCells, noiseCells * 24.0), vec2(noiseCells, noiseCells * 24.0));
+	return mix(baseColor, detailColor, clamp(ring * 0.75 + fibers * 0.25, 0.0, 1.0));
+}
+
+// soft blotches with a fine speckle, like painted drywall
+vec3 Drywall(vec2 uv)
+{
+	float blotches = Fbm(uv, vec2(noiseCells));
+	float speckle = Noise(uv * noiseCells * 32.0, vec2(noiseCells * 32.0));
+	float amount = clamp((blotches - 0.5) * 0.5 + speckle * turbulence, 0.0, 1.0);
+	return mix(baseColor, detailColor, amount);
+}
+
+void main()
+{
+	vec3 color = (pattern == 1) ? Wood(textureCoordinate) : Drywall(textureCoordinate);
+	fragmentColor = vec4(color, 1.0);
+}
+)";
+}
+
+/***********************************************************
+ *  ProceduralTextureBaker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ProceduralTextureBaker::ProceduralTextureBaker()
+{
+	m_pShaderManager = NULL;
+	m_framebuffer = 0;
+	m_vertexArray = 0;
+	m_bFailed = false;
+}
+
+/***********************************************************
+ *  ~ProceduralTextureBaker()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ProceduralTextureBaker::~ProceduralTextureBaker()
+{
+	if (NULL != m_pShaderManager)
+	{
+		delete m_pShaderManager;
+		m_pShaderManager = NULL;
+	}
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_vertexArray != 0)
+	{
+		RenderState::DeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for compiling the baking shaders
+ *  and creating the framebuffer the first time a texture
+ *  is baked.
+ ***********************************************************/
+bool ProceduralTextureBaker::Initialize()
+{
+	if (NULL != m_pShaderManager)
+	{
+		return(true);
+	}
+	if (m_bFailed == true)
+	{
+		return(false);
+	}
+
+	m_pShaderManager = new ShaderManager();
+	if (m_pShaderManager->LoadShaderSources(
+		g_BakeVertexShader, strlen(g_BakeVertexShader),
+		g_BakeFragmentShader, strlen(g_BakeFragmentShader)) == 0)
+	{
+		std::cerr << "Failed to compile the procedural texture shaders" << std::endl;
+		delete m_pShaderManager;
+		m_pShaderManager = NULL;
+		m_bFailed = true;
+		return(false);
+	}
+
+	m_framebuffer = GLResources::CreateFramebuffer();
+	// a core profile draw needs a vertex array bound, even an empty one
+	m_vertexArray = GLResources::CreateVertexArray();
+
+	return(true);
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method is used for baking a procedural texture
+ *  with the passed in parameters.  The pattern is drawn
+ *  into the first mip level and the rest of the chain is
+ *  generated from it.  The framebuffer, viewport and
+ *  program of the scene are restored afterwards.  The
+ *  bytes of every mip level are returned for the texture
+ *  memory budget.  Returns the new texture, or 0 if it
+ *  could not be baked.
+ ***********************************************************/
+GLuint ProceduralTextureBaker::Bake(const PROCEDURAL_TEXTURE_PARAMS& params, std::vector<size_t>& levelBytes)
+{
+	levelBytes.clear();
+	if ((params.pattern == PROCEDURAL_PATTERN_NONE) || (params.size <= 0) || (Initialize() == false))
+	{
+		return(0);
+	}
+
+	// save the state that the bake changes
+	GLuint previousProgram = RenderState::GetProgram();
+	GLint previousFramebuffer = 0;
+	GLint previousViewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	int levelCount = 1;
+	while ((params.size >> levelCount) > 0)
+	{
+		levelCount++;
+	}
+
+	GLuint textureID = GLResources::CreateTexture(GL_TEXTURE_2D);
+	GLResources::TextureStorage(textureID, GL_TEXTURE_2D, levelCount, GL_RGBA8, params.size, params.size);
+	GLResources::TextureParameter(textureID, GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+	GLResources::FramebufferTexture(m_framebuffer, GL_COLOR_ATTACHMENT0, textureID, 0);
+	bool bComplete = (GLResources::CheckFramebufferStatus(m_framebuffer) == GL_FRAMEBUFFER_COMPLETE);
+
+	if (bComplete == true)
+	{
+		GLResources::BindFramebuffer(m_framebuffer);
+		glViewport(0, 0, params.size, params.size);
+		PIPELINE_STATE state = RenderState::GetOpaqueState();
+		state.bDepthTest = false;
+		RenderState::SetPipelineState(state);
+
+		m_pShaderManager->use();
+		m_pShaderManager->setIntValue("pattern", (int)params.pattern);
+		m_pShaderManager->setVec3Value("baseColor", params.baseColor);
+		m_pShaderManager->setVec3Value("detailColor", params.detailColor);
+		m_pShaderManager->setFloatValue("frequency", (float)params.frequency);
+		m_pShaderManager->setFloatValue("noiseCells", (float)params.noiseCells);
+		m_pShaderManager->setFloatValue("turbulence", params.turbulence);
+		m_pShaderManager->setFloatValue("seed", params.seed);
+
+		RenderState::BindVertexArray(m_vertexArray);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+
+	GLResources::FramebufferTexture(m_framebuffer, GL_COLOR_ATTACHMENT0, 0, 0);
+
+	if (bComplete == true)
+	{
+		GLResources::GenerateTextureMipmap(textureID, GL_TEXTURE_2D);
+		for (int level = 0; level < levelCount; level++)
+		{
+			int levelSize = params.size >> level;
+			levelBytes.push_back((size_t)levelSize * levelSize * 4);
+		}
+	}
+	else
+	{
+		std::cerr << "Procedural texture framebuffer is incomplete" << std::endl;
+		RenderState::DeleteTextures(1, &textureID);
+		textureID = 0;
+	}
+
+	// restore the state of the scene
+	GLResources::BindFramebuffer(previousFramebuffer);
+	RenderState::UseProgram(previousProgram);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+
+	return(textureID);
+}
@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// proceduraltexturebaker.h
+// ============
+// bake tileable noise textures on the GPU from material parameters
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  PROCEDURAL_PATTERN
+ *
+ *  The patterns the procedural textures can be baked with.
+ ***********************************************************/
+enum PROCEDURAL_PATTERN
+{
+	PROCEDURAL_PATTERN_NONE,
+	PROCEDURAL_PATTERN_WOOD,
+	PROCEDURAL_PATTERN_DRYWALL
+};
+
+/***********************************************************
+ *  PROCEDURAL_TEXTURE_PARAMS
+ *
+ *  The parameters a procedural texture is baked from.
+ ***********************************************************/
+struct PROCEDURAL_TEXTURE_PARAMS
+{
+	PROCEDURAL_PATTERN pattern;
+	// colors the pattern blends between
+	glm::vec3 baseColor;
+	glm::vec3 detailColor;
+	// number of wood rings across the texture, a whole number so it tiles
+	int frequency;
+	// number of noise cells across the texture at the coarsest octave
+	int noiseCells;
+	// how far the noise bends the rings, or how strong the speckle is
+	float turbulence;
+	// varies the noise between textures with the same parameters
+	float seed;
+	// width and height of the baked texture in texels
+	int size;
+};
+
+/***********************************************************
+ *  ProceduralTextureBaker
+ *
+ *  This class renders procedural textures into OpenGL
+ *  textures with a single full screen fragment pass, then
+ *  builds their mipmap chains on the GPU.  The noise wraps
+ *  around at the texture edges, so the baked textures tile
+ *  seamlessly, and no image file has to be read or decoded.
+ ***********************************************************/
+class ProceduralTextureBaker
+{
+public:
+	// constructor
+	ProceduralTextureBaker();
+	// destructor
+	~ProceduralTextureBaker();
+
+	// bake a texture from the passed in parameters, with the bytes of
+	// each of its mip levels, returns 0 on failure
+	GLuint Bake(const PROCEDURAL_TEXTURE_PARAMS& params, std::vector<size_t>& levelBytes);
+
+private:
+	// compile the baking shaders and create the framebuffer
+	bool Initialize();
+
+	// shader program that draws the patterns
+	ShaderManager* m_pShaderManager;
+	// framebuffer the textures are drawn into
+	GLuint m_framebuffer;
+	// empty vertex array for the full screen triangle
+	GLuint m_vertexArray;
+	// set once initializing has failed, so it is not retried
+	bool m_bFailed;
+};
@@ -0,0 +1,315 @@
+///////////////////////////////////////////////////////////////////////////////
+// programbinarycache.cpp
+// ============
+// keep linked shader programs on disk so later launches skip compiling them
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ProgramBinaryCache.h"
+#include "MappedFile.h"
+#include "TextureCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// declaration of the cache file layout and helper functions
+namespace
+{
+	// identifies a program cache file
+	const char g_CacheMagic[4] = { 'G', 'P', 'R', 'G' };
+	// bump whenever the layout or the key changes
+	const uint32_t g_CacheVersion = 1;
+
+	struct CACHE_FILE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t programKey;
+		uint32_t binaryFormat;
+		uint32_t binarySize;
+		uint64_t binaryHash;
+		double compileTimeMs;
+	};
+
+	// hash the contents of a string
+	uint64_t HashString(const std::string& text)
+	{
+		return(TextureCache::HashData((const unsigned char*)text.data(), text.size()));
+	}
+
+	// get a steady timestamp in milliseconds for the load timings
+	double GetTimeMs()
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// create every directory in the passed in path that does not exist yet
+	void CreateDirectories(const std::string& path)
+	{
+		for (size_t i = 1; i <= path.size(); i++)
+		{
+			if ((i == path.size()) || (path[i] == '/') || (path[i] == '\\'))
+			{
+				std::string directory = path.substr(0, i);
+#ifdef _WIN32
+				_mkdir(directory.c_str());
+#else
+				mkdir(directory.c_str(), 0755);
+#endif
+			}
+		}
+	}
+
+	// move the completed file over the previous one in a single step,
+	// so a load finds either the old file or the new one, never none
+	bool MoveOverFile(const std::string& source, const std::string& destination)
+	{
+#ifdef _WIN32
+		return(MoveFileExA(source.c_str(), destination.c_str(), MOVEFILE_REPLACE_EXISTING) != 0);
+#else
+		return(rename(source.c_str(), destination.c_str()) == 0);
+#endif
+	}
+}
+
+/***********************************************************
+ *  ProgramBinaryCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ProgramBinaryCache::ProgramBinaryCache(const char* directory)
+{
+	m_directory = directory;
+	m_bEnabled = false;
+	m_driverHash = 0;
+	m_stats = PROGRAM_CACHE_STATS();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for checking that the context can
+ *  save program binaries in at least one format, and for
+ *  hashing the driver, since a binary is only valid for
+ *  the driver that made it.
+ ***********************************************************/
+void ProgramBinaryCache::Initialize()
+{
+	m_bEnabled = false;
+	if (!(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+	{
+		return;
+	}
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	if (formatCount <= 0)
+	{
+		return;
+	}
+
+	const GLenum driverStrings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	m_driverHash = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const GLubyte* pText = glGetString(driverStrings[i]);
+		std::string text = (pText != NULL) ? (const char*)pText : "";
+		m_driverHash = TextureCache::HashCombine(m_driverHash, HashString(text));
+	}
+	m_bEnabled = true;
+}
+
+/***********************************************************
+ *  GetProgramKey()
+ *
+ *  This method is used for getting the key of the program
+ *  built from the passed in sources and defines, which
+ *  changes whenever any of them or the driver changes.
+ ***********************************************************/
+uint64_t ProgramBinaryCache::GetProgramKey(const std::string& vertexSource, const std::string& fragmentSource,
+	const std::string& defines) const
+{
+	uint64_t key = m_driverHash;
+	key = TextureCache::HashCombine(key, HashString(vertexSource));
+	key = TextureCache::HashCombine(key, HashString(fragmentSource));
+	key = TextureCache::HashCombine(key, HashString(defines));
+
+	return(key);
+}
+
+/***********************************************************
+ *  GetCacheFilename()
+ *
+ *  This method is used for getting the name of the cache
+ *  file that belongs to the passed in program key.
+ ***********************************************************/
+std::string ProgramBinaryCache::GetCacheFilename(uint64_t programKey) const
+{
+	char keyText[17];
+	snprintf(keyText, sizeof(keyText), "%016llx", (unsigned long long)programKey);
+	return(m_directory + "/" + keyText + ".gprg");
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for creating a program from the
+ *  cached binary of the passed in key.  The header and a
+ *  hash of the binary are checked before it is handed to
+ *  the driver, and the driver can still refuse it, in
+ *  which case the file is deleted so the program is stored
+ *  again once it is compiled.  Returns the linked program,
+ *  or 0 if there is no usable binary.
+ ***********************************************************/
+GLuint ProgramBinaryCache::Load(uint64_t programKey)
+{
+	if (m_bEnabled == false)
+	{
+		return(0);
+	}
+
+	double startTime = GetTimeMs();
+	std::string filename = GetCacheFilename(programKey);
+	GLuint programID = 0;
+	double compileTimeMs = 0.0;
+	bool bRejected = false;
+	{
+		MappedFile mappedFile;
+		if (mappedFile.Open(filename.c_str()) == false)
+		{
+			m_stats.misses++;
+			return(0);
+		}
+		const unsigned char* pData = mappedFile.GetData();
+		size_t fileSize = mappedFile.GetSize();
+
+		// validate the header before trusting any of the sizes in it
+		CACHE_FILE_HEADER header;
+		if (fileSize >= sizeof(header))
+		{
+			memcpy(&header, pData, sizeof(header));
+		}
+		if ((fileSize < sizeof(header)) ||
+			(memcmp(header.magic, g_CacheMagic, sizeof(g_CacheMagic)) != 0) ||
+			(header.version != g_CacheVersion) ||
+			(header.programKey != programKey) ||
+			(header.binarySize == 0) ||
+			(fileSize - sizeof(header) != header.binarySize) ||
+			(TextureCache::HashData(pData + sizeof(header), header.binarySize) != header.binaryHash))
+		{
+			std::cout << "Ignoring invalid program cache file: " << filename << std::endl;
+			bRejected = true;
+		}
+		else
+		{
+			programID = glCreateProgram();
+			glProgramBinary(programID, (GLenum)header.binaryFormat, pData + sizeof(header), (GLsizei)header.binarySize);
+
+			GLint success = GL_FALSE;
+			glGetProgramiv(programID, GL_LINK_STATUS, &success);
+			if (success == GL_FALSE)
+			{
+				std::cout << "The driver rejected program cache file: " << filename << std::endl;
+				glDeleteProgram(programID);
+				programID = 0;
+				bRejected = true;
+			}
+			compileTimeMs = header.compileTimeMs;
+		}
+	}
+
+	if (bRejected == true)
+	{
+		remove(filename.c_str());
+		m_stats.rejected++;
+		m_stats.misses++;
+		return(0);
+	}
+
+	double loadTimeMs = GetTimeMs() - startTime;
+	m_stats.hits++;
+	m_stats.loadTimeMs += loadTimeMs;
+	m_stats.savedTimeMs += compileTimeMs - loadTimeMs;
+
+	return(programID);
+}
+
+/***********************************************************
+ *  Store()
+ *
+ *  This method is used for writing the binary of a linked
+ *  program into the cache file of the passed in key.  The
+ *  file is written under a temporary name first so a partly
+ *  written file is never picked up by a later load.
+ ***********************************************************/
+bool ProgramBinaryCache::Store(uint64_t programKey, GLuint programID, double compileTimeMs)
+{
+	m_stats.compileTimeMs += compileTimeMs;
+	if (m_bEnabled == false)
+	{
+		return(false);
+	}
+
+	GLint binaryLength = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0)
+	{
+		return(false);
+	}
+
+	std::vector<unsigned char> binary(binaryLength);
+	GLsizei writtenLength = 0;
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(programID, binaryLength, &writtenLength, &binaryFormat, &binary[0]);
+	if (writtenLength <= 0)
+	{
+		return(false);
+	}
+
+	CACHE_FILE_HEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, g_CacheMagic, sizeof(g_CacheMagic));
+	header.version = g_CacheVersion;
+	header.programKey = programKey;
+	header.binaryFormat = (uint32_t)binaryFormat;
+	header.binarySize = (uint32_t)writtenLength;
+	header.binaryHash = TextureCache::HashData(&binary[0], (size_t)writtenLength);
+	header.compileTimeMs = compileTimeMs;
+
+	CreateDirectories(m_directory);
+	std::string filename = GetCacheFilename(programKey);
+	std::string tempFilename = filename + ".tmp";
+
+	FILE* pFile = fopen(tempFilename.c_str(), "wb");
+	if (pFile == NULL)
+	{
+		return(false);
+	}
+	bool bSuccess = (fwrite(&header, sizeof(header), 1, pFile) == 1);
+	bSuccess = bSuccess && (fwrite(&binary[0], 1, (size_t)writtenLength, pFile) == (size_t)writtenLength);
+	bSuccess = (fclose(pFile) == 0) && bSuccess;
+
+	// replace any previous cache file with the completed one
+	if ((bSuccess == false) || (MoveOverFile(tempFilename, filename) == false))
+	{
+		remove(tempFilename.c_str());
+		return(false);
+	}
+
+	return(true);
+}
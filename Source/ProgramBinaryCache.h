@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// programbinarycache.h
+// ============
+// keep linked shader programs on disk so later launches skip compiling them
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  PROGRAM_CACHE_STATS
+ *
+ *  Statistics of the programs looked up in the cache.
+ ***********************************************************/
+struct PROGRAM_CACHE_STATS
+{
+	// programs loaded from the cache
+	int hits;
+	// programs compiled because the cache had no binary for them
+	int misses;
+	// binaries found but rejected as invalid or by the driver
+	int rejected;
+	// time spent compiling and linking the missed programs, in milliseconds
+	double compileTimeMs;
+	// time spent loading the cached binaries, in milliseconds
+	double loadTimeMs;
+	// time the loaded programs took to compile when they were stored,
+	// less the time spent loading them, in milliseconds
+	double savedTimeMs;
+};
+
+/***********************************************************
+ *  ProgramBinaryCache
+ *
+ *  This class stores the binaries of linked shader programs
+ *  in a directory of cache files, keyed by a hash of the
+ *  shader sources, their defines and the driver, so a later
+ *  launch on the same driver loads each program instead of
+ *  compiling it.  A binary that is damaged, or that the
+ *  driver no longer accepts after an update, is deleted and
+ *  the program is compiled again.
+ ***********************************************************/
+class ProgramBinaryCache
+{
+public:
+	// constructor
+	ProgramBinaryCache(const char* directory);
+
+	// check whether the context can save program binaries and hash the
+	// driver that made them - call once the context exists
+	void Initialize();
+	// check whether programs are looked up in the cache
+	bool IsEnabled() const { return(m_bEnabled); }
+
+	// get the key of the program linked from the passed in sources and
+	// defines on this driver
+	uint64_t GetProgramKey(const std::string& vertexSource, const std::string& fragmentSource,
+		const std::string& defines) const;
+	// create a program from the cached binary of the passed in key,
+	// returns 0 if there is none or it was rejected
+	GLuint Load(uint64_t programKey);
+	// write the binary of a linked program into the cache, with the time
+	// it took to compile and link
+	bool Store(uint64_t programKey, GLuint programID, double compileTimeMs);
+
+	// get the statistics of the cache lookups
+	const PROGRAM_CACHE_STATS& GetStats() const { return(m_stats); }
+
+private:
+	// directory that holds the cache files
+	std::string m_directory;
+	// whether the context can save program binaries
+	bool m_bEnabled;
+	// hash of the vendor, renderer and version of the driver
+	uint64_t m_driverHash;
+	// statistics of the cache lookups
+	PROGRAM_CACHE_STATS m_stats;
+
+	// get the cache filename for the passed in program key
+	std::string GetCacheFilename(uint64_t programKey) const;
+};
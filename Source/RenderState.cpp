@@ -0,0 +1,385 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderstate.cpp
+// ============
+// keep the bound OpenGL state so only real changes reach the driver
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderState.h"
+
+#include <algorithm>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// name of an object whose binding is unknown, which OpenGL never
+	// hands out, and the state of a capability that is unknown
+	const GLuint g_UnknownName = 0xFFFFFFFF;
+	const int g_UnknownCapability = -1;
+	// texture targets tracked for each texture unit
+	const int g_TargetCount = 5;
+
+	// counts of the state changes asked for
+	RENDER_STATE_STATS g_Stats = { 0, 0 };
+
+	// the state as last set through the cache
+	GLuint g_program = g_UnknownName;
+	GLuint g_vertexArray = g_UnknownName;
+	int g_activeTextureUnit = -1;
+	// textures bound to every target of every unit, one unit after another
+	std::vector<GLuint> g_textures;
+	std::vector<GLuint> g_samplers;
+	int g_depthTest = g_UnknownCapability;
+	int g_blend = g_UnknownCapability;
+	int g_cullFace = g_UnknownCapability;
+	GLenum g_blendSource = GL_NONE;
+	GLenum g_blendDestination = GL_NONE;
+	GLenum g_culledFace = GL_NONE;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for sizing the binding tables to
+ *  the texture units of the context and marking every
+ *  state unknown, once GLEW is initialized.
+ ***********************************************************/
+void RenderState::Initialize()
+{
+	GLint unitCount = 0;
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &unitCount);
+	g_textures.resize((size_t)((unitCount > 0) ? unitCount : 16) * g_TargetCount);
+	g_samplers.resize((size_t)((unitCount > 0) ? unitCount : 16));
+	Invalidate();
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for marking every state unknown, so
+ *  the next request for each one calls OpenGL.
+ ***********************************************************/
+void RenderState::Invalidate()
+{
+	g_program = g_UnknownName;
+	g_vertexArray = g_UnknownName;
+	g_activeTextureUnit = -1;
+	std::fill(g_textures.begin(), g_textures.end(), g_UnknownName);
+	std::fill(g_samplers.begin(), g_samplers.end(), g_UnknownName);
+	g_depthTest = g_UnknownCapability;
+	g_blend = g_UnknownCapability;
+	g_cullFace = g_UnknownCapability;
+	g_blendSource = GL_NONE;
+	g_blendDestination = GL_NONE;
+	g_culledFace = GL_NONE;
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the counts of the state
+ *  changes asked of the cache so far.
+ ***********************************************************/
+const RENDER_STATE_STATS& RenderState::GetStats()
+{
+	return(g_Stats);
+}
+
+/***********************************************************
+ *  GetOpaqueState()
+ *
+ *  This method is used for getting the pipeline state of
+ *  opaque geometry, for a pass to change what it needs.
+ ***********************************************************/
+PIPELINE_STATE RenderState::GetOpaqueState()
+{
+	PIPELINE_STATE state;
+	state.bDepthTest = true;
+	state.bBlend = false;
+	state.blendSource = GL_ONE;
+	state.blendDestination = GL_ZERO;
+	state.bCullFace = false;
+	state.cullFace = GL_BACK;
+	return(state);
+}
+
+/***********************************************************
+ *  SetCapability()
+ *
+ *  This method is used for turning a capability on or off
+ *  unless the cache holds that it already is.
+ ***********************************************************/
+void RenderState::SetCapability(GLenum capability, bool bEnabled, int& cachedState)
+{
+	int state = (bEnabled == true) ? 1 : 0;
+	if (cachedState == state)
+	{
+		g_Stats.skipped++;
+		return;
+	}
+
+	if (bEnabled == true)
+	{
+		glEnable(capability);
+	}
+	else
+	{
+		glDisable(capability);
+	}
+	cachedState = state;
+	g_Stats.calls++;
+}
+
+/***********************************************************
+ *  SetPipelineState()
+ *
+ *  This method is used for setting the depth test, blending
+ *  and face culling the next draws need.  The blend factors
+ *  and the culled face are left as they are while blending
+ *  or culling is off.
+ ***********************************************************/
+void RenderState::SetPipelineState(const PIPELINE_STATE& state)
+{
+	SetCapability(GL_DEPTH_TEST, state.bDepthTest, g_depthTest);
+	SetCapability(GL_BLEND, state.bBlend, g_blend);
+	if (state.bBlend == true)
+	{
+		if ((g_blendSource != state.blendSource) || (g_blendDestination != state.blendDestination))
+		{
+			glBlendFunc(state.blendSource, state.blendDestination);
+			g_blendSource = state.blendSource;
+			g_blendDestination = state.blendDestination;
+			g_Stats.calls++;
+		}
+		else
+		{
+			g_Stats.skipped++;
+		}
+	}
+	SetCapability(GL_CULL_FACE, state.bCullFace, g_cullFace);
+	if (state.bCullFace == true)
+	{
+		if (g_culledFace != state.cullFace)
+		{
+			glCullFace(state.cullFace);
+			g_culledFace = state.cullFace;
+			g_Stats.calls++;
+		}
+		else
+		{
+			g_Stats.skipped++;
+		}
+	}
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for making a program the active
+ *  program unless it already is.
+ ***********************************************************/
+void RenderState::UseProgram(GLuint program)
+{
+	if (g_program == program)
+	{
+		g_Stats.skipped++;
+		return;
+	}
+
+	glUseProgram(program);
+	g_program = program;
+	g_Stats.calls++;
+}
+
+/***********************************************************
+ *  GetProgram()
+ *
+ *  This method is used for getting the program last made
+ *  active through the cache, to make it active again after
+ *  a pass that draws with a program of its own.
+ ***********************************************************/
+GLuint RenderState::GetProgram()
+{
+	return((g_program != g_UnknownName) ? g_program : 0);
+}
+
+/***********************************************************
+ *  GetTargetIndex()
+ *
+ *  This method is used for getting the index of a texture
+ *  target in the binding table of a texture unit.
+ ***********************************************************/
+int RenderState::GetTargetIndex(GLenum target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D_ARRAY:
+		return(1);
+	case GL_TEXTURE_BUFFER:
+		return(2);
+	case GL_TEXTURE_3D:
+		return(3);
+	case GL_TEXTURE_CUBE_MAP:
+		return(4);
+	default:
+		return(0);
+	}
+}
+
+/***********************************************************
+ *  SetActiveTextureUnit()
+ *
+ *  This method is used for switching the active texture
+ *  unit for a bind, unless it is already active.
+ ***********************************************************/
+void RenderState::SetActiveTextureUnit(int unit)
+{
+	if (g_activeTextureUnit != unit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		g_activeTextureUnit = unit;
+		g_Stats.calls++;
+	}
+}
+
+/***********************************************************
+ *  BindTexture()
+ *
+ *  This method is used for binding a texture to a target
+ *  of a texture unit.  The active texture unit is only
+ *  switched when the binding changes.  Nothing is bound for
+ *  a unit below 0.
+ ***********************************************************/
+void RenderState::BindTexture(int unit, GLenum target, GLuint texture)
+{
+	if (unit < 0)
+	{
+		return;
+	}
+
+	size_t index = (size_t)unit * g_TargetCount + GetTargetIndex(target);
+	if ((index < g_textures.size()) && (g_textures[index] == texture))
+	{
+		g_Stats.skipped++;
+		return;
+	}
+
+	SetActiveTextureUnit(unit);
+	glBindTexture(target, texture);
+	if (index < g_textures.size())
+	{
+		g_textures[index] = texture;
+	}
+	g_Stats.calls++;
+}
+
+/***********************************************************
+ *  BindSampler()
+ *
+ *  This method is used for binding a sampler object to a
+ *  texture unit unless it is already bound there.  Nothing
+ *  is bound for a unit below 0, which the draws without a
+ *  texture unit of their own pass.
+ ***********************************************************/
+void RenderState::BindSampler(int unit, GLuint sampler)
+{
+	if (unit < 0)
+	{
+		return;
+	}
+
+	if (((size_t)unit < g_samplers.size()) && (g_samplers[unit] == sampler))
+	{
+		g_Stats.skipped++;
+		return;
+	}
+
+	glBindSampler((GLuint)unit, sampler);
+	if ((size_t)unit < g_samplers.size())
+	{
+		g_samplers[unit] = sampler;
+	}
+	g_Stats.calls++;
+}
+
+/***********************************************************
+ *  BindVertexArray()
+ *
+ *  This method is used for binding a vertex array object
+ *  unless it is already bound.
+ ***********************************************************/
+void RenderState::BindVertexArray(GLuint vertexArray)
+{
+	if (g_vertexArray == vertexArray)
+	{
+		g_Stats.skipped++;
+		return;
+	}
+
+	glBindVertexArray(vertexArray);
+	g_vertexArray = vertexArray;
+	g_Stats.calls++;
+}
+
+/***********************************************************
+ *  InvalidateVertexArray()
+ *
+ *  This method is used for marking the bound vertex array
+ *  unknown, after code that binds its own vertex arrays
+ *  without the cache has drawn.
+ ***********************************************************/
+void RenderState::InvalidateVertexArray()
+{
+	g_vertexArray = g_UnknownName;
+}
+
+/***********************************************************
+ *  DeleteTextures()
+ *
+ *  This method is used for deleting textures.  OpenGL binds
+ *  0 in place of a deleted texture, so the cache does too.
+ ***********************************************************/
+void RenderState::DeleteTextures(GLsizei count, const GLuint* pTextures)
+{
+	for (GLsizei i = 0; i < count; i++)
+	{
+		std::replace(g_textures.begin(), g_textures.end(), pTextures[i], (GLuint)0);
+	}
+	glDeleteTextures(count, pTextures);
+}
+
+/***********************************************************
+ *  DeleteSamplers()
+ *
+ *  This method is used for deleting sampler objects, which
+ *  leaves 0 bound to the units they were bound to.
+ ***********************************************************/
+void RenderState::DeleteSamplers(GLsizei count, const GLuint* pSamplers)
+{
+	for (GLsizei i = 0; i < count; i++)
+	{
+		std::replace(g_samplers.begin(), g_samplers.end(), pSamplers[i], (GLuint)0);
+	}
+	glDeleteSamplers(count, pSamplers);
+}
+
+/***********************************************************
+ *  DeleteVertexArrays()
+ *
+ *  This method is used for deleting vertex array objects,
+ *  which leaves 0 bound if one of them was bound.
+ ***********************************************************/
+void RenderState::DeleteVertexArrays(GLsizei count, const GLuint* pVertexArrays)
+{
+	for (GLsizei i = 0; i < count; i++)
+	{
+		if (g_vertexArray == pVertexArrays[i])
+		{
+			g_vertexArray = 0;
+		}
+	}
+	glDeleteVertexArrays(count, pVertexArrays);
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderstate.h
+// ============
+// keep the bound OpenGL state so only real changes reach the driver
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  RENDER_STATE_STATS
+ *
+ *  Counts of the state changes asked of the render state
+ *  cache.
+ ***********************************************************/
+struct RENDER_STATE_STATS
+{
+	// OpenGL calls made for a state that changed
+	int calls;
+	// state changes skipped since the state was already set
+	int skipped;
+};
+
+/***********************************************************
+ *  PIPELINE_STATE
+ *
+ *  The fixed function state a draw needs.  The blend
+ *  factors only matter with blending on, and the culled
+ *  face only with culling on.
+ ***********************************************************/
+struct PIPELINE_STATE
+{
+	bool bDepthTest;
+	bool bBlend;
+	GLenum blendSource;
+	GLenum blendDestination;
+	bool bCullFace;
+	GLenum cullFace;
+};
+
+/***********************************************************
+ *  RenderState
+ *
+ *  This class keeps a copy of the OpenGL state the render
+ *  path binds - the program, the textures and samplers of
+ *  each texture unit, the vertex array, and the depth test,
+ *  blending and face culling - and only calls OpenGL when
+ *  the state asked for differs from the state already set.
+ *  Each pass declares the pipeline state it draws with, so
+ *  nothing needs to be read back from OpenGL or restored
+ *  afterwards.  State changed behind its back, such as the
+ *  vertex arrays bound by the shape meshes, is marked as
+ *  unknown so it is set again on next use.
+ ***********************************************************/
+class RenderState
+{
+public:
+	// size the texture unit tables and mark every state unknown - call
+	// once after GLEW is initialized
+	static void Initialize();
+	// mark every state unknown, so each one is set again on next use
+	static void Invalidate();
+	// get the counts of the state changes asked for so far
+	static const RENDER_STATE_STATS& GetStats();
+
+	// get the pipeline state that opaque geometry is drawn with - depth
+	// tested, not blended and not culled
+	static PIPELINE_STATE GetOpaqueState();
+	// set the depth test, blending and face culling of the next draws
+	static void SetPipelineState(const PIPELINE_STATE& state);
+
+	// make a program the active program
+	static void UseProgram(GLuint program);
+	// get the program made active through the cache
+	static GLuint GetProgram();
+	// bind a texture to a target of a texture unit
+	static void BindTexture(int unit, GLenum target, GLuint texture);
+	// bind a sampler object to a texture unit
+	static void BindSampler(int unit, GLuint sampler);
+	// bind a vertex array object
+	static void BindVertexArray(GLuint vertexArray);
+	// mark the bound vertex array unknown after code outside the cache
+	// bound one of its own
+	static void InvalidateVertexArray();
+
+	// delete resources, dropping them from the cached bindings first so
+	// a name OpenGL hands out again is not taken as bound
+	static void DeleteTextures(GLsizei count, const GLuint* pTextures);
+	static void DeleteSamplers(GLsizei count, const GLuint* pSamplers);
+	static void DeleteVertexArrays(GLsizei count, const GLuint* pVertexArrays);
+
+private:
+	// get the index of a texture target in the binding table of a unit
+	static int GetTargetIndex(GLenum target);
+	// switch the active texture unit unless it is already active
+	static void SetActiveTextureUnit(int unit);
+	// turn a capability on or off unless it already is
+	static void SetCapability(GLenum capability, bool bEnabled, int& cachedState);
+};
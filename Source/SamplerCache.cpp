@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+// samplercache.cpp
+// ============
+// share OpenGL sampler objects between textures with the same sampling state
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SamplerCache.h"
+#include "RenderState.h"
+
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// anisotropy used by the high quality tier
+	const float g_HighQualityAnisotropy = 16.0f;
+}
+
+/***********************************************************
+ *  SamplerCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SamplerCache::SamplerCache()
+{
+	m_maxAnisotropy = 1.0f;
+	if (GLEW_ARB_texture_filter_anisotropic || GLEW_EXT_texture_filter_anisotropic)
+	{
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &m_maxAnisotropy);
+	}
+}
+
+/***********************************************************
+ *  ~SamplerCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SamplerCache::~SamplerCache()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  GetSampler()
+ *
+ *  This method is used for getting the sampler object with
+ *  the passed in sampling state.  The sampler is created
+ *  the first time the state is asked for, and shared after
+ *  that.
+ ***********************************************************/
+GLuint SamplerCache::GetSampler(const SAMPLER_DESC& desc)
+{
+	// there are only ever a handful of samplers
+	for (size_t i = 0; i < m_samplers.size(); i++)
+	{
+		if (m_samplers[i].desc == desc)
+		{
+			return(m_samplers[i].ID);
+		}
+	}
+
+	SAMPLER sampler;
+	sampler.desc = desc;
+	sampler.ID = 0;
+	glGenSamplers(1, &sampler.ID);
+	glSamplerParameteri(sampler.ID, GL_TEXTURE_MIN_FILTER, desc.minFilter);
+	glSamplerParameteri(sampler.ID, GL_TEXTURE_MAG_FILTER, desc.magFilter);
+	glSamplerParameteri(sampler.ID, GL_TEXTURE_WRAP_S, desc.wrapS);
+	glSamplerParameteri(sampler.ID, GL_TEXTURE_WRAP_T, desc.wrapT);
+	if (desc.anisotropy > 1.0f)
+	{
+		glSamplerParameterf(sampler.ID, GL_TEXTURE_MAX_ANISOTROPY_EXT, desc.anisotropy);
+	}
+	m_samplers.push_back(sampler);
+
+	return(sampler.ID);
+}
+
+/***********************************************************
+ *  GetSampler()
+ *
+ *  This method is used for getting the sampler object that
+ *  mipmapped textures are drawn with at the passed in
+ *  quality tier and wrap mode.
+ ***********************************************************/
+GLuint SamplerCache::GetSampler(TEXTURE_QUALITY quality, GLenum wrapMode)
+{
+	return(GetSampler(GetQualityDesc(quality, wrapMode)));
+}
+
+/***********************************************************
+ *  GetQualityDesc()
+ *
+ *  This method is used for getting the sampling state of
+ *  the passed in quality tier.  Every tier samples from the
+ *  mip levels, and the anisotropy is limited to what the
+ *  driver supports.
+ ***********************************************************/
+SAMPLER_DESC SamplerCache::GetQualityDesc(TEXTURE_QUALITY quality, GLenum wrapMode) const
+{
+	SAMPLER_DESC desc;
+	desc.minFilter = GL_LINEAR_MIPMAP_LINEAR;
+	desc.magFilter = GL_LINEAR;
+	desc.wrapS = wrapMode;
+	desc.wrapT = wrapMode;
+	desc.anisotropy = 1.0f;
+
+	if (quality == TEXTURE_QUALITY_LOW)
+	{
+		desc.minFilter = GL_LINEAR_MIPMAP_NEAREST;
+	}
+	else if (quality == TEXTURE_QUALITY_HIGH)
+	{
+		desc.anisotropy = std::min(g_HighQualityAnisotropy, m_maxAnisotropy);
+	}
+
+	return(desc);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for deleting every sampler object
+ *  that was created.
+ ***********************************************************/
+void SamplerCache::Clear()
+{
+	for (size_t i = 0; i < m_samplers.size(); i++)
+	{
+		RenderState::DeleteSamplers(1, &m_samplers[i].ID);
+	}
+	m_samplers.clear();
+}
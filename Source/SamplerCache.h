@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// samplercache.h
+// ============
+// share OpenGL sampler objects between textures with the same sampling state
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+// filtering quality tiers for the mipmapped scene textures
+enum TEXTURE_QUALITY
+{
+	// bilinear filtering within the nearest mip level
+	TEXTURE_QUALITY_LOW,
+	// trilinear filtering between the two nearest mip levels
+	TEXTURE_QUALITY_MEDIUM,
+	// trilinear filtering with 16x anisotropic filtering
+	TEXTURE_QUALITY_HIGH
+};
+
+/***********************************************************
+ *  SAMPLER_DESC
+ *
+ *  The sampling state of a sampler object - two
+ *  descriptions that compare equal share one sampler.
+ ***********************************************************/
+struct SAMPLER_DESC
+{
+	GLenum minFilter;
+	GLenum magFilter;
+	GLenum wrapS;
+	GLenum wrapT;
+	// maximum anisotropy, 1 for none
+	float anisotropy;
+
+	bool operator==(const SAMPLER_DESC& other) const
+	{
+		return((minFilter == other.minFilter) && (magFilter == other.magFilter) &&
+			(wrapS == other.wrapS) && (wrapT == other.wrapT) && (anisotropy == other.anisotropy));
+	}
+};
+
+/***********************************************************
+ *  SamplerCache
+ *
+ *  This class creates each distinct OpenGL sampler object
+ *  once and hands out the same sampler to everything that
+ *  asks for the same sampling state, so the filter and wrap
+ *  modes are not duplicated on every texture.
+ ***********************************************************/
+class SamplerCache
+{
+public:
+	// constructor
+	SamplerCache();
+	// destructor
+	~SamplerCache();
+
+	// get the sampler with the passed in sampling state, creating it if needed
+	GLuint GetSampler(const SAMPLER_DESC& desc);
+	// get the sampler for mipmapped textures at a quality tier
+	GLuint GetSampler(TEXTURE_QUALITY quality, GLenum wrapMode);
+	// get the sampling state used for mipmapped textures at a quality tier
+	SAMPLER_DESC GetQualityDesc(TEXTURE_QUALITY quality, GLenum wrapMode) const;
+	// get the number of distinct sampler objects
+	int GetCount() const { return (int)m_samplers.size(); }
+	// delete every sampler object
+	void Clear();
+
+private:
+	struct SAMPLER
+	{
+		SAMPLER_DESC desc;
+		GLuint ID;
+	};
+
+	// all of the created sampler objects
+	std::vector<SAMPLER> m_samplers;
+	// highest anisotropy supported by the driver, 1 if none
+	float m_maxAnisotropy;
+};
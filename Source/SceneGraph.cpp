@@ -0,0 +1,151 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.cpp
+// ============
+// keep the transforms of the scene objects in a hierarchy of cached nodes
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGraph.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+
+/***********************************************************
+ *  SceneGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneGraph::SceneGraph()
+{
+	m_bDirty = false;
+	m_stats = SCENE_GRAPH_STATS();
+}
+
+/***********************************************************
+ *  AddNode()
+ *
+ *  This method is used for adding a node with the passed
+ *  in transform relative to its parent.  The parent has to
+ *  be added first, which keeps every parent ahead of its
+ *  children in the arrays.  The node is worked out in the
+ *  next update.  Returns the index of the node, or -1 if
+ *  the parent does not exist.
+ ***********************************************************/
+int SceneGraph::AddNode(int parent, const glm::vec3& position, const glm::vec3& rotationDegrees,
+	const glm::vec3& scale)
+{
+	if (parent >= GetNodeCount())
+	{
+		return(-1);
+	}
+
+	LOCAL_TRANSFORM transform;
+	transform.position = position;
+	transform.rotationDegrees = rotationDegrees;
+	transform.scale = scale;
+
+	m_parents.push_back((parent >= 0) ? parent : -1);
+	m_localTransforms.push_back(transform);
+	m_worldMatrices.push_back(glm::mat4(1.0f));
+	m_modelMatrices.push_back(glm::mat4(1.0f));
+	m_normalMatrices.push_back(glm::mat3(1.0f));
+	m_dirty.push_back(1);
+	m_bDirty = true;
+
+	return(GetNodeCount() - 1);
+}
+
+/***********************************************************
+ *  SetLocalTransform()
+ *
+ *  This method is used for changing the transform of a
+ *  node relative to its parent.  Only the node is marked,
+ *  its descendants are found in the next update.
+ ***********************************************************/
+void SceneGraph::SetLocalTransform(int node, const glm::vec3& position, const glm::vec3& rotationDegrees,
+	const glm::vec3& scale)
+{
+	if ((node < 0) || (node >= GetNodeCount()))
+	{
+		return;
+	}
+
+	m_localTransforms[node].position = position;
+	m_localTransforms[node].rotationDegrees = rotationDegrees;
+	m_localTransforms[node].scale = scale;
+	m_dirty[node] = 1;
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  UpdateWorldTransforms()
+ *
+ *  This method is used for recomputing the matrices of the
+ *  dirty nodes.  Since every parent comes before its
+ *  children, one pass in order passes the dirty mark of a
+ *  parent on to its children before they are reached, and
+ *  always finds the world matrix of the parent up to date.
+ *  Nothing is walked when no node is dirty.
+ ***********************************************************/
+int SceneGraph::UpdateWorldTransforms()
+{
+	if (m_bDirty == false)
+	{
+		return(0);
+	}
+
+	int nodesUpdated = 0;
+	for (int i = 0; i < GetNodeCount(); i++)
+	{
+		int parent = m_parents[i];
+		if ((parent >= 0) && (m_dirty[parent] != 0))
+		{
+			m_dirty[i] = 1;
+		}
+		if (m_dirty[i] == 0)
+		{
+			continue;
+		}
+
+		// the same order the objects have always been placed in - scaled,
+		// rotated about X, Y and then Z, and moved into place
+		const LOCAL_TRANSFORM& transform = m_localTransforms[i];
+		glm::mat4 local =
+			glm::translate(transform.position) *
+			glm::rotate(glm::radians(transform.rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f)) *
+			glm::rotate(glm::radians(transform.rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f)) *
+			glm::rotate(glm::radians(transform.rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f));
+
+		m_worldMatrices[i] = (parent >= 0) ? m_worldMatrices[parent] * local : local;
+		m_modelMatrices[i] = m_worldMatrices[i] * glm::scale(transform.scale);
+		m_normalMatrices[i] = glm::transpose(glm::inverse(glm::mat3(m_modelMatrices[i])));
+		nodesUpdated++;
+	}
+
+	std::fill(m_dirty.begin(), m_dirty.end(), (unsigned char)0);
+	m_bDirty = false;
+	m_stats.updates++;
+	m_stats.nodesUpdated += nodesUpdated;
+
+	return(nodesUpdated);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every node, keeping
+ *  the statistics of the updates made so far.
+ ***********************************************************/
+void SceneGraph::Clear()
+{
+	m_parents.clear();
+	m_localTransforms.clear();
+	m_worldMatrices.clear();
+	m_modelMatrices.clear();
+	m_normalMatrices.clear();
+	m_dirty.clear();
+	m_bDirty = false;
+}
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.h
+// ============
+// keep the transforms of the scene objects in a hierarchy of cached nodes
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SCENE_GRAPH_STATS
+ *
+ *  Statistics of the world transforms worked out by the
+ *  scene graph.
+ ***********************************************************/
+struct SCENE_GRAPH_STATS
+{
+	// updates that found at least one node to recompute
+	int updates;
+	// world transforms recomputed over every update
+	int nodesUpdated;
+};
+
+/***********************************************************
+ *  SceneGraph
+ *
+ *  This class holds the nodes of the scene in flat arrays,
+ *  each parent before its children.  Every node keeps its
+ *  position, rotation and scale relative to its parent, and
+ *  the world matrix, drawn model matrix and normal matrix
+ *  worked out from them.  A node whose transform changes is
+ *  marked dirty, and the next update recomputes it and its
+ *  descendants in one pass over the arrays, so a scene that
+ *  does not move costs no transform math per frame.  The
+ *  scale of a node only sizes its own mesh and is not passed
+ *  on to its children, so a child is placed in the units of
+ *  the scene rather than stretched along with its parent.
+ ***********************************************************/
+class SceneGraph
+{
+public:
+	// constructor
+	SceneGraph();
+
+	// add a node under the passed in parent, or at the root for -1, with
+	// its rotation in degrees about X, then Y, then Z, returns its index
+	int AddNode(int parent, const glm::vec3& position, const glm::vec3& rotationDegrees,
+		const glm::vec3& scale);
+	// change the transform of a node relative to its parent and mark it
+	// and its descendants for the next update
+	void SetLocalTransform(int node, const glm::vec3& position, const glm::vec3& rotationDegrees,
+		const glm::vec3& scale);
+	// recompute the matrices of every dirty node and its descendants,
+	// returns the number of nodes recomputed
+	int UpdateWorldTransforms();
+	// remove every node
+	void Clear();
+
+	// get the number of nodes
+	int GetNodeCount() const { return((int)m_parents.size()); }
+	// get the matrix a node's mesh is drawn with, as of the last update
+	const glm::mat4& GetModelMatrix(int node) const { return(m_modelMatrices[node]); }
+	// get the matrix that turns the normals of a node's mesh
+	const glm::mat3& GetNormalMatrix(int node) const { return(m_normalMatrices[node]); }
+	// get the statistics of the updates so far
+	const SCENE_GRAPH_STATS& GetStats() const { return(m_stats); }
+
+private:
+	// transform of a node relative to its parent
+	struct LOCAL_TRANSFORM
+	{
+		glm::vec3 position;
+		glm::vec3 rotationDegrees;
+		glm::vec3 scale;
+	};
+
+	// parent of each node, -1 for a root, always lower than the node
+	std::vector<int> m_parents;
+	std::vector<LOCAL_TRANSFORM> m_localTransforms;
+	// placement of each node in the world without its own scale, which
+	// its children are placed in
+	std::vector<glm::mat4> m_worldMatrices;
+	// placement of each node in the world with its scale, and the
+	// inverse transpose of it for the normals
+	std::vector<glm::mat4> m_modelMatrices;
+	std::vector<glm::mat3> m_normalMatrices;
+	// nodes whose transform changed since the last update
+	std::vector<unsigned char> m_dirty;
+	// whether any node is dirty
+	bool m_bDirty;
+	// statistics of the updates so far
+	SCENE_GRAPH_STATS m_stats;
+};
@@ -8,6 +8,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "BlockCompressor.h"
+#include "GLResources.h"
+#include "RenderState.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,14 +19,55 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
 // declaration of global variables
 namespace
 {
 	const char* g_ModelName = "model";
+	const char* g_ModelViewProjectionName = "modelViewProjection";
+	const char* g_NormalMatrixName = "normalMatrix";
 	const char* g_ColorValueName = "objectColor";
 	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	const char* g_TextureArrayValueName = "objectTextureArray";
+	const char* g_TextureLayerName = "textureLayer";
+	const char* g_TextureLayerMinLevelName = "textureLayerMinLevel";
+	const char* g_VirtualPageTableName = "virtualPageTable";
+	const char* g_VirtualTileCacheName = "virtualTileCache";
+	const char* g_VirtualTextureInfoName = "virtualTextureInfo";
+	const char* g_VirtualTextureIDName = "virtualTextureID";
+	const char* g_VirtualMipBiasName = "virtualMipBias";
+	const char* g_PointLightDataName = "pointLightData";
+	const char* g_ClusterLightRangesName = "clusterLightRanges";
+	const char* g_ClusterLightIndicesName = "clusterLightIndices";
+	const char* g_UVScaleName = "UVscale";
+	const char* g_MaterialDiffuseName = "material.diffuseColor";
+	const char* g_MaterialSpecularName = "material.specularColor";
+	const char* g_MaterialShininessName = "material.shininess";
+
+	// bits of the shader variant key that each shader define is read from
+	const int g_TextureSourceBit = 0;
+	const int g_LightingBit = 2;
+	const int g_DirectionalLightBit = 3;
+	const int g_PointLightsBit = 4;
+	const int g_SpotLightBit = 6;
+	const int g_RenderPassBit = 7;
+	const int g_LightingKernelBit = 9;
+
+	// maximum number of texture bytes streamed to OpenGL per frame
+	const size_t g_TextureUploadBudget = 8 * 1024 * 1024;
+	// texture memory kept in use before cold textures are downgraded
+	const size_t g_TextureMemoryBudget = 256 * 1024 * 1024;
+
+	// get a steady timestamp in milliseconds for the bake timings
+	double GetTimeMs()
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
 }
 
 /***********************************************************
@@ -34,15 +78,122 @@ namespace
 SceneManager::SceneManager(ShaderManager *pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
+	m_uniformProgramID = 0;
+	m_shaderGeneration = m_pShaderManager->GetProgramGeneration();
+	m_shaderVariant.textureSource = SHADER_TEXTURE_SOURCE_NONE;
+	m_shaderVariant.bLighting = false;
+	m_shaderVariant.bDirectionalLight = false;
+	m_shaderVariant.pointLights = SHADER_POINT_LIGHTS_NONE;
+	m_shaderVariant.bSpotLight = false;
+	m_shaderVariant.renderPass = SHADER_RENDER_PASS_FORWARD;
+	m_shaderVariant.lightingKernel = SHADER_LIGHTING_KERNEL_SHARED_SURFACE;
+	m_drawState.model = glm::mat4(1.0f);
+	m_drawState.modelViewProjection = glm::mat4(1.0f);
+	m_drawState.normalMatrix = glm::mat3(1.0f);
+	m_drawState.objectColor = glm::vec4(1.0f);
+	m_drawState.UVscale = glm::vec2(1.0f);
+	m_drawState.materialDiffuseColor = glm::vec3(0.0f);
+	m_drawState.materialSpecularColor = glm::vec3(0.0f);
+	m_drawState.materialShininess = 0.0f;
+	m_drawState.objectTexture = 0;
+	m_drawState.textureLayer = 0;
+	m_drawState.textureLayerMinLevel = 0.0f;
+	m_drawState.virtualTextureInfo = glm::vec4(0.0f);
+	m_drawState.virtualTextureID = 0;
+	m_drawState.virtualMipBias = 0.0f;
+
+	// the scene shaders are built into a variant for each combination
+	// of surface, lights and pass drawn, so no draw branches on them
+	m_pShaderManager->AddVariantDefine("TEXTURE_SOURCE", g_TextureSourceBit, 2);
+	m_pShaderManager->AddVariantDefine("LIGHTING", g_LightingBit, 1);
+	m_pShaderManager->AddVariantDefine("DIRECTIONAL_LIGHT", g_DirectionalLightBit, 1);
+	m_pShaderManager->AddVariantDefine("POINT_LIGHTS", g_PointLightsBit, 2);
+	m_pShaderManager->AddVariantDefine("SPOT_LIGHT", g_SpotLightBit, 1);
+	m_pShaderManager->AddVariantDefine("RENDER_PASS", g_RenderPassBit, 2);
+	m_pShaderManager->AddVariantDefine("LIGHTING_KERNEL", g_LightingKernelBit, 1);
+	m_pShaderManager->BindUniformBlock(LightUniformBuffer::BLOCK_NAME, LightUniformBuffer::BINDING_POINT);
+
+	m_pLights = new LightUniformBuffer();
+	m_pLightClusters = new ClusteredLightCulling();
+	m_bClusteredLighting = true;
+	m_extraPointLights = 0;
+	m_pointLightDataSlot = 0;
+	m_clusterRangesSlot = 0;
+	m_clusterIndicesSlot = 0;
+	m_pDeferredRenderer = new DeferredRenderer();
+	m_bDeferredShading = false;
+	m_gBufferSlot = 0;
+	m_overdrawLayers = 0;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_viewProjectionMatrix = glm::mat4(1.0f);
+	m_isPerspective = true;
 	m_basicMeshes = new ShapeMeshes();
-
-	// initialize the texture collection
-	for (int i = 0; i < 16; i++)
-	{
-		m_textureIDs[i].tag = "/0";
-		m_textureIDs[i].ID = -1;
-	}
-	m_loadedTextures = 0;
+	m_pTextureLoader = new TextureLoader();
+	m_pTextureResidency = new TextureResidency(g_TextureMemoryBudget);
+	m_pSamplerCache = new SamplerCache();
+	m_pVirtualTextures = new VirtualTextureSystem();
+	m_pProceduralTextures = NULL;
+	m_bProceduralTextures = false;
+	m_textureQuality = TEXTURE_QUALITY_HIGH;
+	m_defaultSamplerID = 0;
+	m_activeTextureSlot = -1;
+	SetCompressTextures(true);
+
+	// identical images loaded from different files share one texture
+	m_pTextureLoader->SetDuplicateCallback(
+		[this](GLuint duplicateID, int duplicateLayer, GLuint originalID, int originalLayer)
+		{
+			m_textureRegistry.ReplaceTexture(duplicateID, duplicateLayer, originalID, originalLayer);
+			if (duplicateID != originalID)
+			{
+				RenderState::DeleteTextures(1, &duplicateID);
+			}
+		});
+
+	// the texture memory is tracked once each texture is loaded, and
+	// downgraded textures replace the originals
+	m_pTextureLoader->SetLoadedCallback(
+		[this](GLuint textureID, const TEXTURE_IMAGE& image)
+		{
+			OnTextureLoaded(textureID, image);
+		});
+	// the layers of the texture array are drawn from the levels that
+	// have arrived so far
+	m_pTextureLoader->SetLayerLevelCallback(
+		[this](GLuint textureID, int layer, int level)
+		{
+			if ((textureID == m_textureArrayID) && (layer < (int)m_textureLayerLevels.size()))
+			{
+				m_textureLayerLevels[layer] = std::min(m_textureLayerLevels[layer], level);
+				if (level == 0)
+				{
+					std::cout << "Texture array layer " << layer << " has all " << m_textureArrayLevels
+						<< " of its mip levels" << std::endl;
+				}
+			}
+		});
+	m_pTextureResidency->SetReplaceCallback(
+		[this](GLuint oldTextureID, GLuint newTextureID)
+		{
+			ReplaceTexture(oldTextureID, newTextureID);
+		});
+
+	m_overflowTextureSlot = 0;
+	// set to false to give every texture its own texture unit
+	m_bUseTextureArray = true;
+	m_textureArrayID = 0;
+	m_textureArrayLayers = 0;
+	m_maxTextureArrayLayers = -1;
+	m_textureArraySize = 0;
+	m_textureArrayLevels = 0;
+	m_textureArraySlot = 0;
+	m_virtualTileCacheSlot = 0;
+	m_virtualPageTableSlot = 0;
+	m_tableTexture = INVALID_TEXTURE_HANDLE;
+	m_wallTexture = INVALID_TEXTURE_HANDLE;
+	m_ballTexture = INVALID_TEXTURE_HANDLE;
+	m_windowTexture = INVALID_TEXTURE_HANDLE;
 }
 
 /***********************************************************
@@ -59,11 +210,307 @@ SceneManager::~SceneManager()
 		m_basicMeshes = NULL;
 	}
 
+	// stop the texture loading before the textures are freed
+	if (NULL != m_pTextureLoader)
+	{
+		delete m_pTextureLoader;
+		m_pTextureLoader = NULL;
+	}
+
 	// free the allocated OpenGL textures
 	DestroyGLTextures();
 
+	if (NULL != m_pVirtualTextures)
+	{
+		delete m_pVirtualTextures;
+		m_pVirtualTextures = NULL;
+	}
+
+	if (NULL != m_pDeferredRenderer)
+	{
+		delete m_pDeferredRenderer;
+		m_pDeferredRenderer = NULL;
+	}
+
+	if (NULL != m_pLightClusters)
+	{
+		delete m_pLightClusters;
+		m_pLightClusters = NULL;
+	}
+
+	if (NULL != m_pLights)
+	{
+		delete m_pLights;
+		m_pLights = NULL;
+	}
+
+	if (NULL != m_pTextureResidency)
+	{
+		delete m_pTextureResidency;
+		m_pTextureResidency = NULL;
+	}
+
+	if (NULL != m_pSamplerCache)
+	{
+		delete m_pSamplerCache;
+		m_pSamplerCache = NULL;
+	}
+
+	if (NULL != m_pProceduralTextures)
+	{
+		delete m_pProceduralTextures;
+		m_pProceduralTextures = NULL;
+	}
+
+}
+
+/***********************************************************
+ *  ResolveUniforms()
+ *
+ *  This method is used for resolving the handles of the
+ *  shader uniforms the scene sets, once for each shader
+ *  variant, so drawing needs no uniform names.  A uniform
+ *  the variant compiled out gets a handle that sets
+ *  nothing.
+ ***********************************************************/
+void SceneManager::ResolveUniforms()
+{
+	m_uniforms.model = m_pShaderManager->GetUniform<glm::mat4>(g_ModelName);
+	m_uniforms.modelViewProjection = m_pShaderManager->GetUniform<glm::mat4>(g_ModelViewProjectionName);
+	m_uniforms.normalMatrix = m_pShaderManager->GetUniform<glm::mat3>(g_NormalMatrixName);
+	m_uniforms.objectColor = m_pShaderManager->GetUniform<glm::vec4>(g_ColorValueName);
+	m_uniforms.objectTexture = m_pShaderManager->GetUniform<int>(g_TextureValueName);
+	m_uniforms.objectTextureArray = m_pShaderManager->GetUniform<int>(g_TextureArrayValueName);
+	m_uniforms.textureLayer = m_pShaderManager->GetUniform<int>(g_TextureLayerName);
+	m_uniforms.textureLayerMinLevel = m_pShaderManager->GetUniform<float>(g_TextureLayerMinLevelName);
+	m_uniforms.UVscale = m_pShaderManager->GetUniform<glm::vec2>(g_UVScaleName);
+	m_uniforms.materialDiffuseColor = m_pShaderManager->GetUniform<glm::vec3>(g_MaterialDiffuseName);
+	m_uniforms.materialSpecularColor = m_pShaderManager->GetUniform<glm::vec3>(g_MaterialSpecularName);
+	m_uniforms.materialShininess = m_pShaderManager->GetUniform<float>(g_MaterialShininessName);
+	m_uniforms.virtualPageTable = m_pShaderManager->GetUniform<int>(g_VirtualPageTableName);
+	m_uniforms.virtualTileCache = m_pShaderManager->GetUniform<int>(g_VirtualTileCacheName);
+	m_uniforms.virtualTextureInfo = m_pShaderManager->GetUniform<glm::vec4>(g_VirtualTextureInfoName);
+	m_uniforms.virtualTextureID = m_pShaderManager->GetUniform<int>(g_VirtualTextureIDName);
+	m_uniforms.virtualMipBias = m_pShaderManager->GetUniform<float>(g_VirtualMipBiasName);
+	m_uniforms.pointLightData = m_pShaderManager->GetUniform<int>(g_PointLightDataName);
+	m_uniforms.clusterLightRanges = m_pShaderManager->GetUniform<int>(g_ClusterLightRangesName);
+	m_uniforms.clusterLightIndices = m_pShaderManager->GetUniform<int>(g_ClusterLightIndicesName);
+}
+
+/***********************************************************
+ *  GetShaderVariantKey()
+ *
+ *  This method is used for packing the features of the
+ *  shader variant of the next draw into its variant key.
+ ***********************************************************/
+unsigned int SceneManager::GetShaderVariantKey() const
+{
+	unsigned int key = 0;
+	key |= (unsigned int)m_shaderVariant.textureSource << g_TextureSourceBit;
+	key |= (m_shaderVariant.bLighting ? 1u : 0u) << g_LightingBit;
+	key |= (m_shaderVariant.bDirectionalLight ? 1u : 0u) << g_DirectionalLightBit;
+	key |= (unsigned int)m_shaderVariant.pointLights << g_PointLightsBit;
+	key |= (m_shaderVariant.bSpotLight ? 1u : 0u) << g_SpotLightBit;
+	key |= (unsigned int)m_shaderVariant.renderPass << g_RenderPassBit;
+	key |= (unsigned int)m_shaderVariant.lightingKernel << g_LightingKernelBit;
+
+	return(key);
+}
+
+/***********************************************************
+ *  ApplyShaderVariant()
+ *
+ *  This method is used for switching to the shader variant
+ *  of the next draw.  The uniform handles of a variant are
+ *  resolved and its samplers pointed at their texture units
+ *  the first time it is used, and the uniform values of the
+ *  draw are set into it whenever it becomes active, since
+ *  they were set into the variant drawn with before.  The
+ *  handles of every variant are dropped when the shaders
+ *  are reloaded.
+ ***********************************************************/
+void SceneManager::ApplyShaderVariant()
+{
+	// every handle is resolved again once the programs are reloaded
+	if (m_shaderGeneration != m_pShaderManager->GetProgramGeneration())
+	{
+		m_variantUniforms.clear();
+		m_uniformProgramID = 0;
+		m_shaderGeneration = m_pShaderManager->GetProgramGeneration();
+	}
+
+	unsigned int key = GetShaderVariantKey();
+	GLuint programID = m_pShaderManager->UseVariant(key);
+	if ((programID == 0) || (programID == m_uniformProgramID))
+	{
+		return;
+	}
+
+	VARIANT_UNIFORMS& variant = m_variantUniforms[key];
+	if (variant.programID != programID)
+	{
+		ResolveUniforms();
+		// the samplers of every type each get their own texture unit
+		m_pShaderManager->setValue(m_uniforms.objectTextureArray, m_textureArraySlot);
+		m_pShaderManager->setValue(m_uniforms.virtualTileCache, m_virtualTileCacheSlot);
+		m_pShaderManager->setValue(m_uniforms.virtualPageTable, m_virtualPageTableSlot);
+		m_pShaderManager->setValue(m_uniforms.pointLightData, m_pointLightDataSlot);
+		m_pShaderManager->setValue(m_uniforms.clusterLightRanges, m_clusterRangesSlot);
+		m_pShaderManager->setValue(m_uniforms.clusterLightIndices, m_clusterIndicesSlot);
+		variant.programID = programID;
+		variant.uniforms = m_uniforms;
+	}
+	else
+	{
+		m_uniforms = variant.uniforms;
+	}
+	m_uniformProgramID = programID;
+
+	m_pShaderManager->setValue(m_uniforms.model, m_drawState.model);
+	m_pShaderManager->setValue(m_uniforms.modelViewProjection, m_drawState.modelViewProjection);
+	m_pShaderManager->setValue(m_uniforms.normalMatrix, m_drawState.normalMatrix);
+	m_pShaderManager->setValue(m_uniforms.objectColor, m_drawState.objectColor);
+	m_pShaderManager->setValue(m_uniforms.UVscale, m_drawState.UVscale);
+	m_pShaderManager->setValue(m_uniforms.materialDiffuseColor, m_drawState.materialDiffuseColor);
+	m_pShaderManager->setValue(m_uniforms.materialSpecularColor, m_drawState.materialSpecularColor);
+	m_pShaderManager->setValue(m_uniforms.materialShininess, m_drawState.materialShininess);
+	m_pShaderManager->setValue(m_uniforms.objectTexture, m_drawState.objectTexture);
+	m_pShaderManager->setValue(m_uniforms.textureLayer, m_drawState.textureLayer);
+	m_pShaderManager->setValue(m_uniforms.textureLayerMinLevel, m_drawState.textureLayerMinLevel);
+	m_pShaderManager->setValue(m_uniforms.virtualTextureInfo, m_drawState.virtualTextureInfo);
+	m_pShaderManager->setValue(m_uniforms.virtualTextureID, m_drawState.virtualTextureID);
+	m_pShaderManager->setValue(m_uniforms.virtualMipBias, m_drawState.virtualMipBias);
+}
+
+/***********************************************************
+ *  SetCameraMatrices()
+ *
+ *  This method is used for setting the view and projection
+ *  of the frame about to be drawn, which the lights are
+ *  assigned to clusters with and the objects are drawn
+ *  with.
+ ***********************************************************/
+void SceneManager::SetCameraMatrices(const glm::mat4& view, const glm::mat4& projection)
+{
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+	m_viewProjectionMatrix = projection * view;
+}
+
+/***********************************************************
+ *  SetAssetPack()
+ *
+ *  This method is used for setting the asset pack that the
+ *  scene textures are read from before any file on disk.
+ *  It needs to be called before PrepareScene().
+ ***********************************************************/
+void SceneManager::SetAssetPack(AssetPack* pAssetPack)
+{
+	m_pTextureLoader->SetAssetPack(pAssetPack);
+	m_pVirtualTextures->SetAssetPack(pAssetPack);
+}
+
+/***********************************************************
+ *  SetCompressTextures()
+ *
+ *  This method is used for choosing whether the scene
+ *  textures are loaded in a block compressed format.  They
+ *  fall back to uncompressed textures when the driver has
+ *  no S3TC support.  It needs to be called before
+ *  PrepareScene().
+ ***********************************************************/
+void SceneManager::SetCompressTextures(bool bCompress)
+{
+	bool bSupported = (GLEW_EXT_texture_compression_s3tc == GL_TRUE);
+	if ((bCompress == true) && (bSupported == false))
+	{
+		std::cout << "S3TC texture compression is not supported, loading uncompressed textures" << std::endl;
+	}
+	m_pTextureLoader->SetCompressTextures(bCompress && bSupported);
+}
+
+/***********************************************************
+ *  SetTextureDecodeScale()
+ *
+ *  This method is used for loading the scene textures at a
+ *  lower resolution, scaled down by 2, 4 or 8 while the
+ *  images are decoded.  It needs to be called before
+ *  PrepareScene().
+ ***********************************************************/
+void SceneManager::SetTextureDecodeScale(int scale)
+{
+	m_pTextureLoader->SetDecodeScale(scale);
+}
+
+/***********************************************************
+ *  SetTextureQuality()
+ *
+ *  This method is used for choosing the filtering quality
+ *  tier the scene textures are drawn with - bilinear,
+ *  trilinear, or trilinear with anisotropic filtering.  It
+ *  can be changed at any time.
+ ***********************************************************/
+void SceneManager::SetTextureQuality(TEXTURE_QUALITY quality)
+{
+	m_textureQuality = quality;
+	ResolveSamplers();
+}
+
+/***********************************************************
+ *  SetOverdrawLayers()
+ *
+ *  This method is used for choosing how many copies of the
+ *  wall are drawn behind it.  The nodes and draws of the
+ *  scene are built again for the new number of copies.
+ ***********************************************************/
+void SceneManager::SetOverdrawLayers(int layers)
+{
+	if (layers == m_overdrawLayers)
+	{
+		return;
+	}
+
+	m_overdrawLayers = layers;
+	if (m_sceneGraph.GetNodeCount() > 0)
+	{
+		BuildScene();
+	}
+}
+
+/***********************************************************
+ *  AreTexturesLoaded()
+ *
+ *  This method is used for checking whether every scene
+ *  texture queued by PrepareScene() has been decoded and
+ *  completely uploaded.
+ ***********************************************************/
+bool SceneManager::AreTexturesLoaded() const
+{
+	return(m_pTextureLoader->IsFinished());
+}
+
+/***********************************************************
+ *  GetTextureMemoryStats()
+ *
+ *  This method is used for getting the live statistics of
+ *  the texture memory used by the scene.
+ ***********************************************************/
+const TEXTURE_MEMORY_STATS& SceneManager::GetTextureMemoryStats() const
+{
+	return(m_pTextureResidency->GetStats());
+}
 
+/***********************************************************
+ *  GetVirtualTextureStats()
+ *
+ *  This method is used for getting the live statistics of
+ *  the virtual texture tile streaming.
+ ***********************************************************/
+const VIRTUAL_TEXTURE_STATS& SceneManager::GetVirtualTextureStats() const
+{
+	return(m_pVirtualTextures->GetStats());
 }
+
 void SceneManager::SetProjectionMode(bool isPerspective)
 {
 	m_isPerspective = isPerspective;
@@ -77,99 +524,362 @@ void SceneManager::UpdateProjectionMatrix(float aspectRatio)
 	else {
 		m_projectionMatrix = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 100.0f);
 	}
-	m_pShaderManager->use(); // Make sure to activate the shader first
-	m_pShaderManager->setMat4Value("projection", m_projectionMatrix); // Update the projection matrix in the shader
+	m_viewProjectionMatrix = m_projectionMatrix * m_viewMatrix;
+	// the shaders read the projection from the camera uniform buffer,
+	// which the view manager writes once per frame
 }
 
 
 /***********************************************************
  *  CreateGLTexture()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  This method is used for creating an OpenGL texture for an
+ *  image file and queueing the image to be decoded into it.
+ *  The image is decoded on a worker thread and its mipmaps
+ *  are streamed into the texture by the texture loader while
+ *  the scene renders.  When the texture array is used and
+ *  not allocated yet, the image only has its size read, and
+ *  AllocateTextureArray() decides whether it is loaded into
+ *  a layer of the array or into a texture of its own.  An
+ *  image file that was already loaded under another tag is
+ *  not loaded again.  Returns the handle used for rendering
+ *  with the texture.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+TextureHandle SceneManager::CreateGLTexture(const char* filename, const char* tag)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
+	TextureHandle handle = m_textureRegistry.FindBySource(filename);
+
+	ARRAY_CANDIDATE candidate;
+	if ((handle == INVALID_TEXTURE_HANDLE) && (m_bUseTextureArray == true) &&
+		(m_maxTextureArrayLayers < 0) &&
+		(m_pTextureLoader->GetImageSize(filename, candidate.width, candidate.height) == true))
+	{
+		candidate.texture = m_textureRegistry.Register(filename, 0);
+		m_arrayCandidates.push_back(candidate);
+		handle = candidate.texture;
+	}
 
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
+	if (handle == INVALID_TEXTURE_HANDLE)
+	{
+		std::cout << "Queueing texture: " << filename << std::endl;
 
-	std::cout << "Attempting to load texture: " << filename << std::endl;
+		GLuint textureID = GLResources::CreateTexture(GL_TEXTURE_2D);
+		m_pTextureLoader->QueueTexture(filename, textureID);
 
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
+		handle = m_textureRegistry.Register(filename, textureID);
+	}
 
-	// if the image was successfully read from the image file
-	if (image)
+	// associate the texture with the special tag string
+	if (m_textureRegistry.AddTag(tag, handle) == false)
 	{
-		std::cout << "Successfully loaded image: " << filename << ", width: " << width << ", height: " << height << ", channels: " << colorChannels << std::endl;
+		std::cout << "Texture tag is already in use: " << tag << std::endl;
+	}
 
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
+	return(handle);
+}
 
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+/***********************************************************
+ *  CreateVirtualTexture()
+ *
+ *  This method is used for opening a virtual texture tile
+ *  file, for a texture too large to be loaded whole.  Only
+ *  the tiles that the scene samples are streamed into
+ *  texture memory.  Returns the handle used for rendering
+ *  with the texture, or INVALID_TEXTURE_HANDLE if the tile
+ *  file has not been built.
+ ***********************************************************/
+TextureHandle SceneManager::CreateVirtualTexture(const char* filename, const char* tag)
+{
+	TextureHandle handle = m_textureRegistry.FindBySource(filename);
 
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
+	if (handle == INVALID_TEXTURE_HANDLE)
+	{
+		int virtualTexture = m_pVirtualTextures->Open(filename);
+		if (virtualTexture < 0)
+		{
+			return(INVALID_TEXTURE_HANDLE);
+		}
+
+		handle = m_textureRegistry.Register(filename, 0);
+		m_textureRegistry.Get(handle).virtualTexture = virtualTexture;
+	}
+
+	// associate the texture with the special tag string
+	if (m_textureRegistry.AddTag(tag, handle) == false)
+	{
+		std::cout << "Texture tag is already in use: " << tag << std::endl;
+	}
+
+	return(handle);
+}
+
+/***********************************************************
+ *  CreateProceduralTexture()
+ *
+ *  This method is used for baking the procedural texture
+ *  of a defined material on the GPU, in place of loading
+ *  and decoding an image file.  The baked texture cannot
+ *  be reloaded from a file, so it is never downgraded to
+ *  meet the texture memory budget.  Returns the handle used
+ *  for rendering with the texture, or INVALID_TEXTURE_HANDLE
+ *  if the material has no procedural texture.
+ ***********************************************************/
+TextureHandle SceneManager::CreateProceduralTexture(const char* materialTag, const char* tag)
+{
+	// the source name keeps each material's texture from being baked twice
+	std::string source = std::string("procedural:") + materialTag;
+	TextureHandle handle = m_textureRegistry.FindBySource(source.c_str());
+
+	if (handle == INVALID_TEXTURE_HANDLE)
+	{
+		OBJECT_MATERIAL material;
+		if ((FindMaterial(materialTag, material) == false) ||
+			(material.procedural.pattern == PROCEDURAL_PATTERN_NONE))
+		{
+			return(INVALID_TEXTURE_HANDLE);
+		}
+
+		if (NULL == m_pProceduralTextures)
+		{
+			m_pProceduralTextures = new ProceduralTextureBaker();
+		}
+
+		double startTime = GetTimeMs();
+		std::vector<size_t> levelBytes;
+		GLuint textureID = m_pProceduralTextures->Bake(material.procedural, levelBytes);
+		if (textureID == 0)
+		{
+			return(INVALID_TEXTURE_HANDLE);
+		}
+		glFinish();
+
+		std::cout << "Baked procedural texture: " << source << " (" << material.procedural.size << "x"
+			<< material.procedural.size << ") in " << (GetTimeMs() - startTime) << " ms" << std::endl;
+
+		m_pTextureResidency->Register(textureID, GL_TEXTURE_2D, GL_RGBA8,
+			material.procedural.size, material.procedural.size, 1, levelBytes, false);
+
+		handle = m_textureRegistry.Register(source.c_str(), textureID);
+	}
+
+	// associate the texture with the special tag string
+	if (m_textureRegistry.AddTag(tag, handle) == false)
+	{
+		std::cout << "Texture tag is already in use: " << tag << std::endl;
+	}
+
+	return(handle);
+}
+
+/***********************************************************
+ *  AllocateTextureArray()
+ *
+ *  This method is used for deciding which of the image
+ *  files waiting in CreateGLTexture() go into the texture
+ *  array, and allocating the storage of the array for them
+ *  with a full mipmap chain.  The layers all have the size
+ *  that the most images share, so no image is stretched or
+ *  squashed to fit, and an image of any other size is
+ *  loaded into a texture of its own instead, the same way
+ *  as the images that no longer fit into the array.  The
+ *  array is only made when at least two images share a
+ *  size, unless SetTextureArraySize() asks for every image
+ *  to be resampled to one size.  The texture mapping
+ *  parameters come from the sampler objects.
+ ***********************************************************/
+void SceneManager::AllocateTextureArray()
+{
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &m_maxTextureArrayLayers);
+
+	int layerWidth = 0;
+	int layerHeight = 0;
+	int sharedCount = 1;
+	if (m_textureArraySize > 0)
+	{
+		// every image is resampled to the size asked for
+		for (size_t i = 0; i < m_arrayCandidates.size(); i++)
+		{
+			m_arrayCandidates[i].width = m_textureArraySize;
+			m_arrayCandidates[i].height = m_textureArraySize;
+		}
+	}
+	for (size_t i = 0; i < m_arrayCandidates.size(); i++)
+	{
+		int count = 0;
+		for (size_t j = 0; j < m_arrayCandidates.size(); j++)
+		{
+			if ((m_arrayCandidates[j].width == m_arrayCandidates[i].width) &&
+				(m_arrayCandidates[j].height == m_arrayCandidates[i].height))
+			{
+				count++;
+			}
+		}
+		if (count > sharedCount)
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
+			layerWidth = m_arrayCandidates[i].width;
+			layerHeight = m_arrayCandidates[i].height;
+			sharedCount = count;
 		}
+	}
+
+	for (size_t i = 0; i < m_arrayCandidates.size(); i++)
+	{
+		const ARRAY_CANDIDATE& candidate = m_arrayCandidates[i];
+		TextureRegistry::TEXTURE_INFO& texture = m_textureRegistry.Get(candidate.texture);
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		if ((candidate.width == layerWidth) && (candidate.height == layerHeight) &&
+			(m_textureArrayLayers < m_maxTextureArrayLayers))
+		{
+			if (m_textureArrayID == 0)
+			{
+				m_textureArrayID = GLResources::CreateTexture(GL_TEXTURE_2D_ARRAY);
+			}
+			texture.ID = m_textureArrayID;
+			texture.layer = m_textureArrayLayers;
+			m_textureArrayLayers++;
+
+			std::cout << "Queueing texture: " << texture.filename << " into texture array layer " << texture.layer << std::endl;
+
+			m_pTextureLoader->QueueTextureLayer(texture.filename.c_str(), m_textureArrayID, texture.layer,
+				layerWidth, layerHeight);
+		}
+		else
+		{
+			std::cout << "Queueing texture: " << texture.filename << " (" << candidate.width << "x"
+				<< candidate.height << ", not sharing the texture array)" << std::endl;
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+			texture.ID = GLResources::CreateTexture(GL_TEXTURE_2D);
+			m_pTextureLoader->QueueTexture(texture.filename.c_str(), texture.ID);
+		}
+	}
+	m_arrayCandidates.clear();
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+	// textures created later get a texture of their own
+	m_maxTextureArrayLayers = m_textureArrayLayers;
 
-		return true;
+	if (m_textureArrayLayers == 0)
+	{
+		return;
 	}
 
-	std::cerr << "Failed to load texture: " << filename << std::endl;
-	std::cerr << "STB Error: " << stbi_failure_reason() << std::endl;
+	int levels = 1;
+	while ((std::max(layerWidth, layerHeight) >> levels) > 0)
+	{
+		levels++;
+	}
+
+	// no level of any layer has been uploaded yet
+	m_textureArrayLevels = levels;
+	m_textureLayerLevels.assign(m_textureArrayLayers, levels);
+
+	// the layers are decoded straight into the format of the array
+	GLenum layerFormat = m_pTextureLoader->GetTextureLayerFormat();
 
-	return false;
+	GLResources::TextureStorage(m_textureArrayID, GL_TEXTURE_2D_ARRAY, levels, layerFormat,
+		layerWidth, layerHeight, m_textureArrayLayers);
+	GLResources::TextureParameter(m_textureArrayID, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+	// the array counts towards the texture memory budget, but it
+	// holds the layers of many textures so it is never downgraded
+	std::vector<size_t> levelBytes;
+	for (int level = 0; level < levels; level++)
+	{
+		levelBytes.push_back(BlockCompressor::GetLevelSize(layerFormat,
+			std::max(1, layerWidth >> level), std::max(1, layerHeight >> level), 4) * m_textureArrayLayers);
+	}
+	m_pTextureResidency->Register(m_textureArrayID, GL_TEXTURE_2D_ARRAY, layerFormat,
+		layerWidth, layerHeight, m_textureArrayLayers, levelBytes, false);
 }
+
 /***********************************************************
  *  BindGLTextures()
  *
  *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  OpenGL texture memory slots.  The texture array is bound
+ *  once to the last slot, and the virtual texture tile
+ *  cache to the slot before it.  The slot after those
+ *  holds the page table of the virtual texture being
+ *  drawn, the three after it the point light and light
+ *  cluster buffer textures, the five after those the
+ *  G-buffer of the deferred path, and the next one is kept
+ *  free for binding any textures that do not fit into the
+ *  other slots when they are used.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	GLint textureUnits = 16;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+	m_textureArraySlot = textureUnits - 1;
+	m_virtualTileCacheSlot = textureUnits - 2;
+	m_virtualPageTableSlot = textureUnits - 3;
+	m_pointLightDataSlot = textureUnits - 4;
+	m_clusterRangesSlot = textureUnits - 5;
+	m_clusterIndicesSlot = textureUnits - 6;
+	m_gBufferSlot = textureUnits - 6 - DeferredRenderer::GBUFFER_TEXTURE_COUNT;
+	m_overflowTextureSlot = m_gBufferSlot - 1;
+	ResolveSamplers();
+
+	// the samplers of the shader variants are pointed at the new
+	// slots when each variant is next used
+	m_variantUniforms.clear();
+	m_uniformProgramID = 0;
+	ApplyShaderVariant();
+
+	// the array sampler always gets its own slot, since samplers of
+	// different types cannot share a texture unit
+	if (m_textureArrayID != 0)
+	{
+		RenderState::BindTexture(m_textureArraySlot, GL_TEXTURE_2D_ARRAY, m_textureArrayID);
+		RenderState::BindSampler(m_textureArraySlot, m_defaultSamplerID);
+	}
+
+	// the tile cache is sampled at exact texels inside each tile's
+	// border, and the page table entries are read unfiltered
+	if (m_pVirtualTextures->GetTileCacheID() != 0)
 	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		SAMPLER_DESC tileCacheSampler = { GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, 1.0f };
+		SAMPLER_DESC pageTableSampler = { GL_NEAREST_MIPMAP_NEAREST, GL_NEAREST, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, 1.0f };
+		RenderState::BindTexture(m_virtualTileCacheSlot, GL_TEXTURE_2D, m_pVirtualTextures->GetTileCacheID());
+		RenderState::BindSampler(m_virtualTileCacheSlot, m_pSamplerCache->GetSampler(tileCacheSampler));
+		RenderState::BindSampler(m_virtualPageTableSlot, m_pSamplerCache->GetSampler(pageTableSampler));
+	}
+
+	// the lights are fetched from buffer textures, which are updated in
+	// place and never bound again
+	m_pLights->Initialize();
+	m_pLightClusters->Initialize();
+	RenderState::BindTexture(m_pointLightDataSlot, GL_TEXTURE_BUFFER, m_pLights->GetPointLightTexture());
+	RenderState::BindTexture(m_clusterRangesSlot, GL_TEXTURE_BUFFER, m_pLightClusters->GetClusterTexture());
+	RenderState::BindTexture(m_clusterIndicesSlot, GL_TEXTURE_BUFFER, m_pLightClusters->GetLightIndexTexture());
+
+	// the G-buffer textures are bound to their slots when they are
+	// created at the size of the viewport
+	m_pDeferredRenderer->Initialize(m_gBufferSlot);
+
+	int nextSlot = 0;
+	for (int i = 0; i < m_textureRegistry.GetCount(); i++)
+	{
+		TextureRegistry::TEXTURE_INFO& texture = m_textureRegistry.Get(i);
+		if (texture.virtualTexture >= 0)
+		{
+			texture.slot = m_virtualPageTableSlot;
+		}
+		else if (texture.layer >= 0)
+		{
+			texture.slot = m_textureArraySlot;
+		}
+		else if (nextSlot < m_overflowTextureSlot)
+		{
+			// bind textures on corresponding texture units
+			RenderState::BindTexture(nextSlot, GL_TEXTURE_2D, texture.ID);
+			RenderState::BindSampler(nextSlot, m_defaultSamplerID);
+			texture.slot = nextSlot;
+			nextSlot++;
+		}
+		else
+		{
+			texture.slot = -1;
+		}
 	}
 }
 
@@ -181,36 +891,137 @@ void SceneManager::BindGLTextures()
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	for (int i = 0; i < m_textureRegistry.GetCount(); i++)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		GLuint textureID = m_textureRegistry.Get(i).ID;
+
+		// textures with identical images share one OpenGL texture,
+		// which is only deleted once
+		bool bShared = false;
+		for (int j = 0; j < i; j++)
+		{
+			bShared = bShared || (m_textureRegistry.Get(j).ID == textureID);
+		}
+		if (bShared == false)
+		{
+			m_pTextureResidency->Unregister(textureID);
+			RenderState::DeleteTextures(1, &textureID);
+		}
+	}
+	m_textureRegistry.Clear();
+	m_pendingRestores.clear();
+
+	// textures still being reloaded at full resolution
+	std::vector<GLuint> restoredTextureIDs;
+	m_pTextureResidency->CancelRestores(restoredTextureIDs);
+	if (restoredTextureIDs.empty() == false)
+	{
+		RenderState::DeleteTextures((GLsizei)restoredTextureIDs.size(), restoredTextureIDs.data());
 	}
 }
 
 /***********************************************************
- *  FindTextureID()
+ *  ReplaceTexture()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for switching every texture handle
+ *  that uses one OpenGL texture over to another texture
+ *  holding the same image, and rebinding the texture units
+ *  that the old texture was bound to.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+void SceneManager::ReplaceTexture(GLuint oldTextureID, GLuint newTextureID)
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
+	m_textureRegistry.ReplaceTextureID(oldTextureID, newTextureID);
+	if (m_textureArrayID == oldTextureID)
+	{
+		m_textureArrayID = newTextureID;
+	}
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	for (int i = 0; i < m_textureRegistry.GetCount(); i++)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		const TextureRegistry::TEXTURE_INFO& texture = m_textureRegistry.Get(i);
+		if ((texture.ID == newTextureID) && (texture.slot >= 0))
 		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
+			RenderState::BindTexture(texture.slot, (texture.layer >= 0) ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, newTextureID);
 		}
-		else
-			index++;
+	}
+}
+
+/***********************************************************
+ *  OnTextureLoaded()
+ *
+ *  This method is called by the texture loader when every
+ *  mip level of a texture has been uploaded.  The memory of
+ *  each level is recorded for the texture memory budget,
+ *  and a texture that was reloaded at full resolution takes
+ *  the place of its downgraded copy.
+ ***********************************************************/
+void SceneManager::OnTextureLoaded(GLuint textureID, const TEXTURE_IMAGE& image)
+{
+	GLuint downgradedTextureID = 0;
+	if (m_pTextureResidency->FinishRestore(textureID, downgradedTextureID) == true)
+	{
+		ReplaceTexture(downgradedTextureID, textureID);
+		m_pTextureResidency->Unregister(downgradedTextureID);
+		RenderState::DeleteTextures(1, &downgradedTextureID);
 	}
 
-	return(textureID);
+	std::vector<size_t> levelBytes;
+	for (size_t level = 0; level < image.mips.size(); level++)
+	{
+		levelBytes.push_back(image.mips[level].size);
+	}
+	m_pTextureResidency->Register(textureID, GL_TEXTURE_2D, image.internalFormat,
+		image.width, image.height, 1, levelBytes, true);
+}
+
+/***********************************************************
+ *  StartTextureRestores()
+ *
+ *  This method is used for reloading the downgraded
+ *  textures drawn in this frame at full resolution, each
+ *  into a new texture that replaces the downgraded one when
+ *  it is loaded.  The reloads are handed to the running
+ *  decoder threads, so the render thread never waits on
+ *  them.
+ ***********************************************************/
+void SceneManager::StartTextureRestores()
+{
+	for (size_t i = 0; i < m_pendingRestores.size(); i++)
+	{
+		if (m_textureRegistry.IsValid(m_pendingRestores[i]) == false)
+		{
+			continue;
+		}
+
+		// handles sharing one texture only reload it once
+		const TextureRegistry::TEXTURE_INFO& textureInfo = m_textureRegistry.Get(m_pendingRestores[i]);
+		if (m_pTextureResidency->Touch(textureInfo.ID) == false)
+		{
+			continue;
+		}
+
+		GLuint restoredTextureID = GLResources::CreateTexture(GL_TEXTURE_2D);
+		m_pTextureResidency->BeginRestore(textureInfo.ID, restoredTextureID);
+		m_pTextureLoader->ReloadTexture(textureInfo.filename.c_str(), restoredTextureID);
+	}
+	m_pendingRestores.clear();
+}
+
+/***********************************************************
+ *  FindTextureID()
+ *
+ *  This method is used for getting an ID for the previously
+ *  loaded texture bitmap associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureID(const char* tag) const
+{
+	TextureHandle handle = m_textureRegistry.FindByTag(tag);
+	if (handle == INVALID_TEXTURE_HANDLE)
+	{
+		return(-1);
+	}
+
+	return((int)m_textureRegistry.Get(handle).ID);
 }
 
 /***********************************************************
@@ -219,24 +1030,15 @@ int SceneManager::FindTextureID(std::string tag)
  *  This method is used for getting a slot index for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(const char* tag) const
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
+	TextureHandle handle = m_textureRegistry.FindByTag(tag);
+	if (handle == INVALID_TEXTURE_HANDLE)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
+		return(-1);
 	}
 
-	return(textureSlot);
+	return(m_textureRegistry.Get(handle).slot);
 }
 
 /***********************************************************
@@ -262,6 +1064,7 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 			material.diffuseColor = m_objectMaterials[index].diffuseColor;
 			material.specularColor = m_objectMaterials[index].specularColor;
 			material.shininess = m_objectMaterials[index].shininess;
+			material.samplerID = m_objectMaterials[index].samplerID;
 		}
 		else
 		{
@@ -269,44 +1072,86 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 		}
 	}
 
-	return(true);
+	return(bFound);
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  FindMaterialIndex()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for getting the index of the
+ *  defined material associated with the passed in tag.
  ***********************************************************/
-void SceneManager::SetTransformations(
-	glm::vec3 scaleXYZ,
-	float XrotationDegrees,
-	float YrotationDegrees,
-	float ZrotationDegrees,
-	glm::vec3 positionXYZ)
+int SceneManager::FindMaterialIndex(const std::string& tag) const
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+	for (int index = 0; index < (int)m_objectMaterials.size(); index++)
+	{
+		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		{
+			return(index);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  ResolveSamplers()
+ *
+ *  This method is used for getting the shared sampler
+ *  object of every material, and of the textures drawn
+ *  without a material, at the current quality tier.
+ *  Materials with the same sampling state share a sampler.
+ ***********************************************************/
+void SceneManager::ResolveSamplers()
+{
+	m_defaultSamplerID = m_pSamplerCache->GetSampler(m_textureQuality, GL_REPEAT);
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		m_objectMaterials[i].samplerID = m_pSamplerCache->GetSampler(m_textureQuality, m_objectMaterials[i].wrapMode);
+	}
+
+	// the samplers of the old tier stay bound until the next draw
+	// sets them, except for the ones bound once for good
+	if (m_textureArrayID != 0)
+	{
+		RenderState::BindSampler(m_textureArraySlot, m_defaultSamplerID);
+	}
+}
 
+/***********************************************************
+ *  SetModelMatrix()
+ *
+ *  This method is used for setting the world matrix of the
+ *  next draw.  Its product with the view and projection of
+ *  the frame is worked out here once per object, so the
+ *  vertex shader transforms each vertex with one matrix,
+ *  and so is the inverse transpose that turns the normals,
+ *  which keeps them at right angles to the surface when an
+ *  object is scaled more along one axis than another.
+ ***********************************************************/
+void SceneManager::SetModelMatrix(const glm::mat4& model)
+{
+	SetModelMatrix(model, glm::transpose(glm::inverse(glm::mat3(model))));
+}
+
+/***********************************************************
+ *  SetModelMatrix()
+ *
+ *  This method is used for setting the world matrix of the
+ *  next draw along with the normal matrix already worked
+ *  out for it, as the scene graph keeps for every node, so
+ *  only the product with the camera is left to do.
+ ***********************************************************/
+void SceneManager::SetModelMatrix(const glm::mat4& model, const glm::mat3& normalMatrix)
+{
+	m_drawState.model = model;
+	m_drawState.modelViewProjection = m_viewProjectionMatrix * model;
+	m_drawState.normalMatrix = normalMatrix;
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		m_pShaderManager->setValue(m_uniforms.model, m_drawState.model);
+		m_pShaderManager->setValue(m_uniforms.modelViewProjection, m_drawState.modelViewProjection);
+		m_pShaderManager->setValue(m_uniforms.normalMatrix, m_drawState.normalMatrix);
 	}
 }
 
@@ -330,10 +1175,15 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
+	// the next draw samples no texture, so no material sampler
+	m_activeTextureSlot = -1;
+
+	m_drawState.objectColor = currentColor;
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		m_shaderVariant.textureSource = SHADER_TEXTURE_SOURCE_NONE;
+		ApplyShaderVariant();
+		m_pShaderManager->setValue(m_uniforms.objectColor, currentColor);
 	}
 }
 
@@ -341,18 +1191,81 @@ void SceneManager::SetShaderColor(
  *  SetShaderTexture()
  *
  *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  associated with the passed in handle into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	TextureHandle texture)
 {
-	if (NULL != m_pShaderManager)
+	if ((NULL != m_pShaderManager) && (m_textureRegistry.IsValid(texture) == true))
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		const TextureRegistry::TEXTURE_INFO& textureInfo = m_textureRegistry.Get(texture);
+
+		// a downgraded texture that is used again is reloaded at full
+		// resolution once the frame is drawn, and drawn downgraded
+		// until the reload is done
+		if ((m_pTextureResidency->Touch(textureInfo.ID) == true) &&
+			(std::find(m_pendingRestores.begin(), m_pendingRestores.end(), texture) == m_pendingRestores.end()))
+		{
+			m_pendingRestores.push_back(texture);
+		}
+
+		if (textureInfo.virtualTexture >= 0)
+		{
+			// the tile cache stays bound with its own sampler, only
+			// the page table changes
+			m_activeTextureSlot = -1;
+			RenderState::BindTexture(m_virtualPageTableSlot, GL_TEXTURE_2D, m_pVirtualTextures->GetPageTableID(textureInfo.virtualTexture));
+			m_drawState.virtualTextureID = textureInfo.virtualTexture;
+			m_drawState.virtualTextureInfo = glm::vec4(
+				(float)VirtualTextureSystem::GetTileSize(),
+				(float)VirtualTextureSystem::GetTileBorder(),
+				(float)m_pVirtualTextures->GetTileCacheSize(),
+				(float)m_pVirtualTextures->GetLevelCount(textureInfo.virtualTexture));
+			m_shaderVariant.textureSource = SHADER_TEXTURE_SOURCE_VIRTUAL;
+			ApplyShaderVariant();
+			m_pShaderManager->setValue(m_uniforms.virtualTextureID, m_drawState.virtualTextureID);
+			m_pShaderManager->setValue(m_uniforms.virtualTextureInfo, m_drawState.virtualTextureInfo);
+			return;
+		}
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+		if (textureInfo.layer >= 0)
+		{
+			// the levels of a layer finer than the ones uploaded so far
+			// are undefined, so the shader keeps to the uploaded ones, and
+			// a layer with none yet is drawn in a flat color
+			int uploadedLevel = (textureInfo.layer < (int)m_textureLayerLevels.size()) ?
+				m_textureLayerLevels[textureInfo.layer] : m_textureArrayLevels;
+			if (uploadedLevel >= m_textureArrayLevels)
+			{
+				SetShaderColor(0.5f, 0.5f, 0.5f, 1.0f);
+				return;
+			}
+
+			// the texture array stays bound, only the layer changes
+			m_activeTextureSlot = m_textureArraySlot;
+			RenderState::BindSampler(m_activeTextureSlot, m_defaultSamplerID);
+			m_drawState.textureLayer = textureInfo.layer;
+			m_drawState.textureLayerMinLevel = (float)uploadedLevel;
+			m_shaderVariant.textureSource = SHADER_TEXTURE_SOURCE_ARRAY;
+			ApplyShaderVariant();
+			m_pShaderManager->setValue(m_uniforms.textureLayer, textureInfo.layer);
+			m_pShaderManager->setValue(m_uniforms.textureLayerMinLevel, m_drawState.textureLayerMinLevel);
+			return;
+		}
+
+		int textureSlot = textureInfo.slot;
+		if (textureSlot < 0)
+		{
+			// bind the texture into the slot kept free for this
+			textureSlot = m_overflowTextureSlot;
+			RenderState::BindTexture(textureSlot, GL_TEXTURE_2D, textureInfo.ID);
+		}
+		m_activeTextureSlot = textureSlot;
+		RenderState::BindSampler(m_activeTextureSlot, m_defaultSamplerID);
+		m_drawState.objectTexture = textureSlot;
+		m_shaderVariant.textureSource = SHADER_TEXTURE_SOURCE_2D;
+		ApplyShaderVariant();
+		m_pShaderManager->setValue(m_uniforms.objectTexture, textureSlot);
 	}
 }
 
@@ -364,9 +1277,10 @@ void SceneManager::SetShaderTexture(
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
+	m_drawState.UVscale = glm::vec2(u, v);
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		m_pShaderManager->setValue(m_uniforms.UVscale, m_drawState.UVscale);
 	}
 }
 
@@ -374,23 +1288,87 @@ void SceneManager::SetTextureUVScale(float u, float v)
  *  SetShaderMaterial()
  *
  *  This method is used for passing the material values
- *  into the shader.
+ *  into the shader, and sampling the texture set for the
+ *  same draw with the sampler of the material.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
 	std::string materialTag)
 {
-	if (m_objectMaterials.size() > 0)
+	ApplyMaterial(FindMaterialIndex(materialTag));
+}
+
+/***********************************************************
+ *  ApplyMaterial()
+ *
+ *  This method is used for passing the values of the
+ *  material with the passed in index into the shader, the
+ *  way SetShaderMaterial() does for a tag.  An index of -1
+ *  leaves the material of the last draw in place.
+ ***********************************************************/
+void SceneManager::ApplyMaterial(int materialIndex)
+{
+	if ((materialIndex < 0) || (materialIndex >= (int)m_objectMaterials.size()))
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+		return;
+	}
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
+	const OBJECT_MATERIAL& material = m_objectMaterials[materialIndex];
+	m_drawState.materialDiffuseColor = material.diffuseColor;
+	m_drawState.materialSpecularColor = material.specularColor;
+	m_drawState.materialShininess = material.shininess;
+	m_pShaderManager->setValue(m_uniforms.materialDiffuseColor, material.diffuseColor);
+	m_pShaderManager->setValue(m_uniforms.materialSpecularColor, material.specularColor);
+	m_pShaderManager->setValue(m_uniforms.materialShininess, material.shininess);
+	RenderState::BindSampler(m_activeTextureSlot, material.samplerID);
+}
+
+/***********************************************************
+ *  AddSceneDraw()
+ *
+ *  This method is used for adding a draw of a mesh at a
+ *  scene graph node to the end of the draws of the scene.
+ *  The draw is textured when the texture is valid, and in
+ *  the passed in color otherwise, and its material is
+ *  looked up here once rather than by tag every frame.
+ ***********************************************************/
+void SceneManager::AddSceneDraw(int node, SCENE_MESH mesh, TextureHandle texture, const glm::vec4& color,
+	const char* materialTag)
+{
+	SCENE_DRAW draw;
+	draw.node = node;
+	draw.mesh = mesh;
+	draw.texture = texture;
+	draw.color = color;
+	draw.UVscale = glm::vec2(1.0f, 1.0f);
+	draw.material = (materialTag != NULL) ? FindMaterialIndex(materialTag) : -1;
+	m_sceneDraws.push_back(draw);
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing one of the basic meshes
+ *  with the transform and surface already set.
+ ***********************************************************/
+void SceneManager::DrawMesh(SCENE_MESH mesh)
+{
+	switch (mesh)
+	{
+	case SCENE_MESH_BOX:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case SCENE_MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case SCENE_MESH_SPHERE:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	case SCENE_MESH_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case SCENE_MESH_TORUS:
+		m_basicMeshes->DrawTorusMesh();
+		break;
 	}
 }
 
@@ -403,25 +1381,59 @@ void SceneManager::SetShaderMaterial(
 void SceneManager::LoadSceneTexture()
 {
 	std::cout << "Loading textures..." << std::endl;
-	bool bReturn = false;
 
-	bReturn = CreateGLTexture(
-		"textures/rusticwood.jpg",
-		"table");
+	// in the procedural texture mode the wood and drywall textures
+	// are baked from their materials instead of loaded
+	if (m_bProceduralTextures == true)
+	{
+		m_tableTexture = CreateProceduralTexture("wood", "table");
+		m_wallTexture = CreateProceduralTexture("drywall", "wall");
+	}
+
+	// the large surfaces use virtual textures once their tile files
+	// have been built with --build-virtual-texture
+	if (m_tableTexture == INVALID_TEXTURE_HANDLE)
+	{
+		m_tableTexture = CreateVirtualTexture(
+			"textures/rusticwood.vtex",
+			"table");
+	}
+	if (m_tableTexture == INVALID_TEXTURE_HANDLE)
+	{
+		m_tableTexture = CreateGLTexture(
+			"textures/rusticwood.jpg",
+			"table");
+	}
 
-	bReturn = CreateGLTexture(
-		"textures/drywall.jpg",
-		"wall");
+	if (m_wallTexture == INVALID_TEXTURE_HANDLE)
+	{
+		m_wallTexture = CreateVirtualTexture(
+			"textures/drywall.vtex",
+			"wall");
+	}
+	if (m_wallTexture == INVALID_TEXTURE_HANDLE)
+	{
+		m_wallTexture = CreateGLTexture(
+			"textures/drywall.jpg",
+			"wall");
+	}
 
-	bReturn = CreateGLTexture(
+	m_ballTexture = CreateGLTexture(
 		"textures/ball.jpg",
 		"ball");
 
-	bReturn = CreateGLTexture(
+	m_windowTexture = CreateGLTexture(
 		"textures/window.jpg",
 		"window");
 
-	
+	// the images that share a size go into the texture array, which
+	// needs its storage before any layer is uploaded
+	AllocateTextureArray();
+
+	// decode all of the queued images in parallel - the pixels are
+	// streamed into the bound textures as each decode finishes
+	m_pTextureLoader->StartDecoding();
+
 	BindGLTextures();
 }
 
@@ -429,56 +1441,81 @@ void SceneManager::LoadSceneTexture()
  *  SetupSceneLights()
  *
  *  This method is called to add and configure the light
- *  sources for the 3D scene.  There are up to 4 light sources.
+ *  sources for the 3D scene.  The lights are kept in the
+ *  light buffer, which is uploaded before the next frame.
  ***********************************************************/
 void SceneManager::SetupSceneLights()
 {
 	// this line of code is NEEDED for telling the shaders to render 
 	// the 3D scene with custom lighting - to use the default rendered 
 	// lighting then comment out the following line
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	m_shaderVariant.bLighting = true;
 
 	// directional light to emulate sunlight coming into scene
-	m_pShaderManager->setVec3Value("directionalLight.direction", 0.0f, -1.0f, -0.1f);
-	m_pShaderManager->setVec3Value("directionalLight.ambient", 0.8f, 0.8f, 0.6f);
-	m_pShaderManager->setVec3Value("directionalLight.diffuse", 0.07f, 0.06f, 0.04f);
-	m_pShaderManager->setVec3Value("directionalLight.specular", 1.0f, 0.9f, 0.6f);
-	m_pShaderManager->setBoolValue("directionalLight.bActive", true);
+	m_pLights->SetDirectionalLight(
+		glm::vec3(0.0f, -1.0f, -0.1f),
+		glm::vec3(0.8f, 0.8f, 0.6f),
+		glm::vec3(0.07f, 0.06f, 0.04f),
+		glm::vec3(1.0f, 0.9f, 0.6f),
+		true);
 
+	// the five lights of the scene reach across all of it
+	const float sceneLightRange = 60.0f;
 
 	// point light 1 (index 0)
-	m_pShaderManager->setVec3Value("pointLights[0].position", -4.0f, 8.0f, 0.0f);
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.3f, 0.3f, 0.1f);
-	m_pShaderManager->setVec3Value("pointLights[0].specular", 0.2f, 0.2f, 0.0f);
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
-		// point light 2 (index 1)
-	m_pShaderManager->setVec3Value("pointLights[1].position", 4.0f, 8.0f, 0.0f);
-	m_pShaderManager->setVec3Value("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[1].diffuse", 0.3f, 0.3f, 0.1f);
-	m_pShaderManager->setVec3Value("pointLights[1].specular", 0.2f, 0.2f, 0.0f);
-	m_pShaderManager->setBoolValue("pointLights[1].bActive", true);
+	m_pLights->AddPointLight(
+		glm::vec3(-4.0f, 8.0f, 0.0f),
+		sceneLightRange,
+		glm::vec3(0.05f, 0.05f, 0.05f),
+		glm::vec3(0.3f, 0.3f, 0.1f),
+		glm::vec3(0.2f, 0.2f, 0.0f));
+	// point light 2 (index 1)
+	m_pLights->AddPointLight(
+		glm::vec3(4.0f, 8.0f, 0.0f),
+		sceneLightRange,
+		glm::vec3(0.05f, 0.05f, 0.05f),
+		glm::vec3(0.3f, 0.3f, 0.1f),
+		glm::vec3(0.2f, 0.2f, 0.0f));
 	// point light 3 (index 2)
-	m_pShaderManager->setVec3Value("pointLights[2].position", 3.8f, 5.5f, 4.0f);
-	m_pShaderManager->setVec3Value("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[2].diffuse", 0.2f, 0.2f, 0.0f);
-	m_pShaderManager->setVec3Value("pointLights[2].specular", 0.8f, 0.8f, 0.6f);
-	m_pShaderManager->setBoolValue("pointLights[2].bActive", true);
+	m_pLights->AddPointLight(
+		glm::vec3(3.8f, 5.5f, 4.0f),
+		sceneLightRange,
+		glm::vec3(0.05f, 0.05f, 0.05f),
+		glm::vec3(0.2f, 0.2f, 0.0f),
+		glm::vec3(0.8f, 0.8f, 0.6f));
 	// point light 4 (index 3)
-	m_pShaderManager->setVec3Value("pointLights[3].position", 3.8f, 3.5f, 4.0f);
-	m_pShaderManager->setVec3Value("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[3].diffuse", 0.2f, 0.2f, 0.0f);
-	m_pShaderManager->setVec3Value("pointLights[3].specular", 0.8f, 0.8f, 0.6f);
-	m_pShaderManager->setBoolValue("pointLights[3].bActive", true);
+	m_pLights->AddPointLight(
+		glm::vec3(3.8f, 3.5f, 4.0f),
+		sceneLightRange,
+		glm::vec3(0.05f, 0.05f, 0.05f),
+		glm::vec3(0.2f, 0.2f, 0.0f),
+		glm::vec3(0.8f, 0.8f, 0.6f));
 	// point light 5 (index 4)
-	m_pShaderManager->setVec3Value("pointLights[4].position", -3.2f, 6.0f, -4.0f);
-	m_pShaderManager->setVec3Value("pointLights[4].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[4].diffuse", 0.9f, 0.9f, 0.7f);
-	m_pShaderManager->setVec3Value("pointLights[4].specular", 0.2f, 0.2f, 0.0f);
-	m_pShaderManager->setBoolValue("pointLights[4].bActive", true);
-
-
-
+	m_pLights->AddPointLight(
+		glm::vec3(-3.2f, 6.0f, -4.0f),
+		sceneLightRange,
+		glm::vec3(0.05f, 0.05f, 0.05f),
+		glm::vec3(0.9f, 0.9f, 0.7f),
+		glm::vec3(0.2f, 0.2f, 0.0f));
+
+	// small colored lights scattered over the table and in front of
+	// the wall, always in the same places
+	std::mt19937 random(330);
+	std::uniform_real_distribution<float> positionX(-15.0f, 23.0f);
+	std::uniform_real_distribution<float> positionY(0.2f, 8.0f);
+	std::uniform_real_distribution<float> positionZ(-9.0f, 10.0f);
+	std::uniform_real_distribution<float> range(1.0f, 2.5f);
+	std::uniform_real_distribution<float> color(0.1f, 0.6f);
+	for (int i = 0; i < m_extraPointLights; i++)
+	{
+		glm::vec3 position(positionX(random), positionY(random), positionZ(random));
+		float lightRange = range(random);
+		glm::vec3 diffuse(color(random), color(random), color(random));
+		if (m_pLights->AddPointLight(position, lightRange, glm::vec3(0.0f), diffuse, diffuse * 0.5f) < 0)
+		{
+			break;
+		}
+	}
 }
 /***********************************************************
  *  DefineObjectMaterials()
@@ -493,6 +1530,8 @@ void SceneManager::DefineObjectMaterials()
 	basketballMaterial.specularColor = glm::vec3(0.7f, 0.7f, 0.6f);
 	basketballMaterial.shininess = 52.0;
 	basketballMaterial.tag = "ball";
+	basketballMaterial.wrapMode = GL_REPEAT;
+	basketballMaterial.procedural.pattern = PROCEDURAL_PATTERN_NONE;
 
 	m_objectMaterials.push_back(basketballMaterial);
 
@@ -501,6 +1540,16 @@ void SceneManager::DefineObjectMaterials()
 	woodMaterial.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
 	woodMaterial.shininess = 0.1;
 	woodMaterial.tag = "wood";
+	woodMaterial.wrapMode = GL_REPEAT;
+	// dark rings bent by the noise across a warm brown
+	woodMaterial.procedural.pattern = PROCEDURAL_PATTERN_WOOD;
+	woodMaterial.procedural.baseColor = glm::vec3(0.58f, 0.38f, 0.22f);
+	woodMaterial.procedural.detailColor = glm::vec3(0.34f, 0.19f, 0.09f);
+	woodMaterial.procedural.frequency = 12;
+	woodMaterial.procedural.noiseCells = 4;
+	woodMaterial.procedural.turbulence = 2.5f;
+	woodMaterial.procedural.seed = 1.0f;
+	woodMaterial.procedural.size = 1024;
 
 	m_objectMaterials.push_back(woodMaterial);
 
@@ -509,6 +1558,8 @@ void SceneManager::DefineObjectMaterials()
 	mugMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f); 
 	mugMaterial.shininess = 10.0; // Less shiny for a ceramic look
 	mugMaterial.tag = "mug";
+	mugMaterial.wrapMode = GL_REPEAT;
+	mugMaterial.procedural.pattern = PROCEDURAL_PATTERN_NONE;
 
 	m_objectMaterials.push_back(mugMaterial);
 
@@ -517,8 +1568,33 @@ void SceneManager::DefineObjectMaterials()
 	metalMaterial.specularColor = glm::vec3(1.0f, 1.0f, 1.0f); // High specular for a shiny effect
 	metalMaterial.shininess = 100.0; // Very shiny for a metallic finish
 	metalMaterial.tag = "metal";
+	metalMaterial.wrapMode = GL_REPEAT;
+	metalMaterial.procedural.pattern = PROCEDURAL_PATTERN_NONE;
 
 	m_objectMaterials.push_back(metalMaterial);
+
+	// the wall used to be drawn with the ball material left over from
+	// the draw before it, so it keeps the same lighting values
+	OBJECT_MATERIAL drywallMaterial;
+	drywallMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
+	drywallMaterial.specularColor = glm::vec3(0.7f, 0.7f, 0.6f);
+	drywallMaterial.shininess = 52.0;
+	drywallMaterial.tag = "drywall";
+	drywallMaterial.wrapMode = GL_REPEAT;
+	// faint blotches and speckle on an off-white, which needs little
+	// resolution
+	drywallMaterial.procedural.pattern = PROCEDURAL_PATTERN_DRYWALL;
+	drywallMaterial.procedural.baseColor = glm::vec3(0.86f, 0.85f, 0.81f);
+	drywallMaterial.procedural.detailColor = glm::vec3(0.72f, 0.71f, 0.68f);
+	drywallMaterial.procedural.frequency = 0;
+	drywallMaterial.procedural.noiseCells = 8;
+	drywallMaterial.procedural.turbulence = 0.35f;
+	drywallMaterial.procedural.seed = 2.0f;
+	drywallMaterial.procedural.size = 512;
+
+	m_objectMaterials.push_back(drywallMaterial);
+
+	ResolveSamplers();
 }
 /***********************************************************
  *  PrepareScene()
@@ -533,6 +1609,9 @@ void SceneManager::PrepareScene()
 	// only one instance of a particular mesh needs to be
 	// loaded in memory no matter how many times it is drawn
 	// in the rendered 3D scene
+	// the materials are defined first, since the procedural
+	// textures are baked from them
+	DefineObjectMaterials();
 	LoadSceneTexture();
 
 	m_basicMeshes->LoadPlaneMesh();
@@ -541,9 +1620,8 @@ void SceneManager::PrepareScene()
 	m_basicMeshes->LoadTorusMesh();
 	m_basicMeshes->LoadBoxMesh();
 
-	DefineObjectMaterials();
-
 	SetupSceneLights();
+	BuildScene();
 }
 
 /***********************************************************
@@ -554,169 +1632,276 @@ void SceneManager::PrepareScene()
  ***********************************************************/
 void SceneManager::RenderScene()
 {
-	RenderTable();
-	RenderBall();
-	RenderWall();
-	RenderWindow();
-	RenderLaptop();
-	RenderCoffeeMug();
-}
+	// only objects that moved since the last frame are placed again
+	m_sceneGraph.UpdateWorldTransforms();
 
-void SceneManager::RenderTable()
-{
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+	// find the lights of every cluster of this frame's view, which
+	// only the forward path reads
+	if ((m_bClusteredLighting == true) && (m_bDeferredShading == false))
+	{
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		m_pLightClusters->Update(m_pLights, m_viewMatrix, m_projectionMatrix, viewport[2], viewport[3]);
+	}
+	else
+	{
+		LIGHT_CLUSTER_GRID grid = LIGHT_CLUSTER_GRID();
+		m_pLights->SetClusterGrid(grid);
+	}
 
-	scaleXYZ = glm::vec3(40.0f, 6.0f, 20.0f);
-	positionXYZ = glm::vec3(4.0f, -3.0f, 0.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	//SetShaderColor(0.58, 0.224, 0.102, 1.0);
-	
-	SetShaderTexture("table");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("wood");
+	// copy any lights that changed into the light buffer
+	m_pLights->Upload();
 
-	m_basicMeshes->DrawBoxMesh();
+	// the shader variants of this frame only light with the lights the
+	// scene has, and read the point lights of each fragment's cluster
+	// when the lights were assigned to clusters
+	m_shaderVariant.bDirectionalLight = m_pLights->IsDirectionalLightActive();
+	if (m_pLights->GetPointLightCount() == 0)
+	{
+		m_shaderVariant.pointLights = SHADER_POINT_LIGHTS_NONE;
+	}
+	else if (m_pLights->GetClusterGrid().bEnabled != 0)
+	{
+		m_shaderVariant.pointLights = SHADER_POINT_LIGHTS_CLUSTERED;
+	}
+	else
+	{
+		m_shaderVariant.pointLights = SHADER_POINT_LIGHTS_ALL;
+	}
+	m_shaderVariant.renderPass = SHADER_RENDER_PASS_FORWARD;
+	ApplyShaderVariant();
+
+	// every object of the scene is opaque
+	RenderState::SetPipelineState(RenderState::GetOpaqueState());
+
+	// stream any decoded texture mip levels into OpenGL
+	if (m_pTextureLoader->IsFinished() == false)
+	{
+		m_pTextureLoader->ProcessUploads(g_TextureUploadBudget);
+	}
+
+	// stream the virtual texture tiles the last feedback asked for,
+	// and every few frames draw the scene again at a low resolution
+	// to find out which tiles it samples now
+	m_pVirtualTextures->Update();
+	if (m_pVirtualTextures->BeginFeedback() == true)
+	{
+		m_drawState.virtualMipBias = m_pVirtualTextures->GetFeedbackMipBias();
+		m_shaderVariant.renderPass = SHADER_RENDER_PASS_VIRTUAL_FEEDBACK;
+		ApplyShaderVariant();
+		m_pShaderManager->setValue(m_uniforms.virtualMipBias, m_drawState.virtualMipBias);
+		RenderObjects();
+		m_drawState.virtualMipBias = 0.0f;
+		m_shaderVariant.renderPass = SHADER_RENDER_PASS_FORWARD;
+		ApplyShaderVariant();
+		m_pShaderManager->setValue(m_uniforms.virtualMipBias, m_drawState.virtualMipBias);
+		m_pVirtualTextures->EndFeedback();
+	}
+
+	// the deferred path draws the surfaces into the G-buffer and then
+	// lights each pixel once, and falls back to the forward path if
+	// the G-buffer cannot be drawn into
+	if ((m_bDeferredShading == true) && (m_pDeferredRenderer->BeginGeometryPass() == true))
+	{
+		m_shaderVariant.renderPass = SHADER_RENDER_PASS_DEFERRED_GEOMETRY;
+		ApplyShaderVariant();
+		RenderObjects();
+		m_shaderVariant.renderPass = SHADER_RENDER_PASS_FORWARD;
+		ApplyShaderVariant();
+		m_pDeferredRenderer->RenderLighting(m_pLights->GetPointLightCount(), m_pointLightDataSlot);
+	}
+	else
+	{
+		RenderObjects();
+	}
+
+	// downgrade cold textures while the texture memory is over budget,
+	// and reload the downgraded textures that were drawn
+	m_pTextureResidency->EndFrame();
+	StartTextureRestores();
 }
 
-void SceneManager::RenderLaptop()
+/***********************************************************
+ *  RenderObjects()
+ *
+ *  This method is used for drawing every object of the 3D
+ *  scene into the bound framebuffer, by walking the draws
+ *  of the scene with the matrices the scene graph keeps
+ *  for their nodes.
+ ***********************************************************/
+void SceneManager::RenderObjects()
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+	for (size_t i = 0; i < m_sceneDraws.size(); i++)
+	{
+		const SCENE_DRAW& draw = m_sceneDraws[i];
+		SetModelMatrix(m_sceneGraph.GetModelMatrix(draw.node), m_sceneGraph.GetNormalMatrix(draw.node));
+		if (m_textureRegistry.IsValid(draw.texture) == true)
+		{
+			SetShaderTexture(draw.texture);
+		}
+		else
+		{
+			SetShaderColor(draw.color.r, draw.color.g, draw.color.b, draw.color.a);
+		}
+		SetTextureUVScale(draw.UVscale.x, draw.UVscale.y);
+		ApplyMaterial(draw.material);
+		DrawMesh(draw.mesh);
+	}
 
-	scaleXYZ = glm::vec3(10.0f, 2.0f, 5.0f);
-	positionXYZ = glm::vec3(5.0f, 0.0f, 5.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1);
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	// the meshes bind their own vertex arrays
+	RenderState::InvalidateVertexArray();
+}
 
+/***********************************************************
+ *  RenderShadingTest()
+ *
+ *  This method is used for drawing planes in front of the
+ *  camera that exactly cover the perspective view, lit by
+ *  the directional light and every point light without any
+ *  clusters, so each one shades every pixel with the same
+ *  number of lights.  The depth test is turned off while
+ *  they are drawn so no plane hides the ones after it.
+ ***********************************************************/
+void SceneManager::RenderShadingTest(bool bTextured, int layers)
+{
+	LIGHT_CLUSTER_GRID grid = LIGHT_CLUSTER_GRID();
+	m_pLights->SetClusterGrid(grid);
+	m_pLights->Upload();
+
+	m_shaderVariant.bDirectionalLight = m_pLights->IsDirectionalLightActive();
+	m_shaderVariant.pointLights = (m_pLights->GetPointLightCount() > 0) ?
+		SHADER_POINT_LIGHTS_ALL : SHADER_POINT_LIGHTS_NONE;
+	m_shaderVariant.renderPass = SHADER_RENDER_PASS_FORWARD;
+	ApplyShaderVariant();
+
+	// the plane mesh lies in XZ from -1 to 1, so turned to face the
+	// camera one unit in front of it, it covers the view when scaled
+	// by the extent of the view at that distance
+	const float distance = 1.0f;
+	glm::mat4 model = glm::inverse(m_viewMatrix) *
+		glm::translate(glm::vec3(0.0f, 0.0f, -distance)) *
+		glm::scale(glm::vec3(distance / m_projectionMatrix[0][0], distance / m_projectionMatrix[1][1], 1.0f)) *
+		glm::rotate(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+
+	PIPELINE_STATE state = RenderState::GetOpaqueState();
+	state.bDepthTest = false;
+	RenderState::SetPipelineState(state);
+	for (int layer = 0; layer < layers; layer++)
+	{
+		if (bTextured == true)
+		{
+			SetShaderTexture(m_ballTexture);
+		}
+		else
+		{
+			SetShaderColor(0.8f, 0.8f, 0.8f, 1.0f);
+		}
+		SetShaderMaterial("ball");
+		SetTextureUVScale(1.0f, 1.0f);
+		SetModelMatrix(model);
+		m_basicMeshes->DrawPlaneMesh();
+	}
+	RenderState::InvalidateVertexArray();
+}
 
-	scaleXYZ = glm::vec3(8.0f, 0.2f, 2.5f);
-	positionXYZ = glm::vec3(5.0f, 1.0f, 6.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
 
-	SetShaderColor(1.0f, 0.9f, 0.9f, 1);
-	SetShaderMaterial("wood");
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  BuildScene()
+ *
+ *  This method is used for adding the nodes that place the
+ *  objects of the scene and the draws of their meshes, once
+ *  the materials and textures they use are defined.  Parts
+ *  of an object are children of its main node, so moving
+ *  the node moves the whole object.  The world transforms
+ *  are worked out here, and after that only when a node
+ *  moves.
+ ***********************************************************/
+void SceneManager::BuildScene()
+{
+	m_sceneGraph.Clear();
+	m_sceneDraws.clear();
 
+	AddTable();
+	AddBall();
+	AddWall();
+	AddWindow();
+	AddLaptop();
+	AddCoffeeMug();
 
-	scaleXYZ = glm::vec3(10.0f, 1.0f, 10.0f);
-	positionXYZ = glm::vec3(5, 5.0f, 2.5f);
-	SetTransformations(scaleXYZ, 90.0f, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1.0);
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	m_sceneGraph.UpdateWorldTransforms();
+}
 
-	scaleXYZ = glm::vec3(8.0f, 0.10f, 6.0f);
-	positionXYZ = glm::vec3(5, 6.0f, 3.0f);
-	SetTransformations(scaleXYZ, 90.0f, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(0, 0, 0, 1.0);
-	m_basicMeshes->DrawBoxMesh();
+void SceneManager::AddTable()
+{
+	int table = m_sceneGraph.AddNode(-1, glm::vec3(4.0f, -3.0f, 0.0f), glm::vec3(0.0f), glm::vec3(40.0f, 6.0f, 20.0f));
+	AddSceneDraw(table, SCENE_MESH_BOX, m_tableTexture, glm::vec4(0.58f, 0.224f, 0.102f, 1.0f), "wood");
 }
-void SceneManager::RenderWall()
+
+void SceneManager::AddLaptop()
 {
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+	// the keyboard and the lid sit on the base, and the screen is set
+	// into the lid
+	int base = m_sceneGraph.AddNode(-1, glm::vec3(5.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(10.0f, 2.0f, 5.0f));
+	AddSceneDraw(base, SCENE_MESH_BOX, INVALID_TEXTURE_HANDLE, glm::vec4(0.2f, 0.2f, 0.2f, 1.0f), "metal");
+
+	int keyboard = m_sceneGraph.AddNode(base, glm::vec3(0.0f, 1.0f, 1.0f), glm::vec3(0.0f), glm::vec3(8.0f, 0.2f, 2.5f));
+	AddSceneDraw(keyboard, SCENE_MESH_BOX, INVALID_TEXTURE_HANDLE, glm::vec4(1.0f, 0.9f, 0.9f, 1.0f), "wood");
+
+	int lid = m_sceneGraph.AddNode(base, glm::vec3(0.0f, 5.0f, -2.5f), glm::vec3(90.0f, 0.0f, 0.0f), glm::vec3(10.0f, 1.0f, 10.0f));
+	AddSceneDraw(lid, SCENE_MESH_BOX, INVALID_TEXTURE_HANDLE, glm::vec4(0.2f, 0.2f, 0.2f, 1.0f), "metal");
 
-	scaleXYZ = glm::vec3(40.0f, 1.0f, 40.0f);
-	positionXYZ = glm::vec3(4.0f, 15.0f, -8.0f);
-	SetTransformations(scaleXYZ, 90.0f, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	//SetShaderColor(0.043, 0.369, 0.149, 1.0);
-	SetShaderTexture("wall");
-	m_basicMeshes->DrawBoxMesh();
+	// the lid is turned upright, so its local Y points out of the screen
+	// and its local -Z points up
+	int screen = m_sceneGraph.AddNode(lid, glm::vec3(0.0f, 0.5f, -1.0f), glm::vec3(0.0f), glm::vec3(8.0f, 0.1f, 6.0f));
+	AddSceneDraw(screen, SCENE_MESH_BOX, INVALID_TEXTURE_HANDLE, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), "metal");
 }
 
-void SceneManager::RenderWindow()
+void SceneManager::AddWall()
 {
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+	glm::vec3 positionXYZ = glm::vec3(4.0f, 15.0f, -8.0f);
+	glm::vec3 rotationXYZ = glm::vec3(90.0f, 0.0f, 0.0f);
+	glm::vec3 scaleXYZ = glm::vec3(40.0f, 1.0f, 40.0f);
 
-	scaleXYZ = glm::vec3(30.0f, 1.0f, 30.0f);
-	positionXYZ = glm::vec3(4.0f, 15.0f, -7.0f);
-	SetTransformations(scaleXYZ, 90.0f, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	//SetShaderColor(0.043, 0.369, 0.149, 1.0);
-	SetShaderTexture("window");
-	m_basicMeshes->DrawBoxMesh();
+	// copies of the wall behind it, drawn back to front so each one
+	// is shaded and then covered by the next
+	for (int layer = m_overdrawLayers; layer > 0; layer--)
+	{
+		int copy = m_sceneGraph.AddNode(-1, positionXYZ - glm::vec3(0.0f, 0.0f, 0.5f * layer), rotationXYZ, scaleXYZ);
+		AddSceneDraw(copy, SCENE_MESH_BOX, m_wallTexture, glm::vec4(0.043f, 0.369f, 0.149f, 1.0f), "drywall");
+	}
+
+	int wall = m_sceneGraph.AddNode(-1, positionXYZ, rotationXYZ, scaleXYZ);
+	AddSceneDraw(wall, SCENE_MESH_BOX, m_wallTexture, glm::vec4(0.043f, 0.369f, 0.149f, 1.0f), "drywall");
 }
 
-
-void SceneManager::RenderCoffeeMug()
+void SceneManager::AddWindow()
 {
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	scaleXYZ = glm::vec3(2.0f, 5.0f, 2.0f);
-	positionXYZ = glm::vec3(15.0f, 0.0f, 3.0f);
-	SetTransformations(scaleXYZ, 0.0f, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(0.43, 0.4, 0.49, 1.0);
-	
-	m_basicMeshes->DrawCylinderMesh();
+	int window = m_sceneGraph.AddNode(-1, glm::vec3(4.0f, 15.0f, -7.0f), glm::vec3(90.0f, 0.0f, 0.0f), glm::vec3(30.0f, 1.0f, 30.0f));
+	AddSceneDraw(window, SCENE_MESH_BOX, m_windowTexture, glm::vec4(0.043f, 0.369f, 0.149f, 1.0f), "drywall");
+}
 
-	scaleXYZ = glm::vec3(1.5f, 1.5f, 3.0f);
-	positionXYZ = glm::vec3(18.0f, 2.0f, 3.0f);
-	SetTransformations(scaleXYZ, 0.0f, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(0.43, 0.4, 0.49, 1.0);
+void SceneManager::AddCoffeeMug()
+{
+	int mug = m_sceneGraph.AddNode(-1, glm::vec3(15.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(2.0f, 5.0f, 2.0f));
+	AddSceneDraw(mug, SCENE_MESH_CYLINDER, INVALID_TEXTURE_HANDLE, glm::vec4(0.43f, 0.4f, 0.49f, 1.0f), "metal");
 
-	m_basicMeshes->DrawTorusMesh();
+	int handle = m_sceneGraph.AddNode(mug, glm::vec3(3.0f, 2.0f, 0.0f), glm::vec3(0.0f), glm::vec3(1.5f, 1.5f, 3.0f));
+	AddSceneDraw(handle, SCENE_MESH_TORUS, INVALID_TEXTURE_HANDLE, glm::vec4(0.43f, 0.4f, 0.49f, 1.0f), "metal");
 }
 
-void SceneManager::RenderBall()
+void SceneManager::AddBall()
 {
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
 	// Basketball
 	//Sphere mimicking a basketball 3D shape
-	scaleXYZ = glm::vec3(4, 4, 4);
-	positionXYZ = glm::vec3(-7.0f, 4, 5.0f);
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	//SetShaderColor(1.00, 0.34, 0.00, 1.0); // Orange color matching the basketball
-	SetShaderTexture("ball");
-	SetShaderMaterial("ball");
-	SetTextureUVScale(1.0, 1.0);
-	m_basicMeshes->DrawSphereMesh();
-	//Used a torus shape to represent the lines on a basketball. By rotating the torus at the x axis I've mimicked  baskball lines
-	scaleXYZ = glm::vec3(3.4f, 3.4f, 0.5f);
-	positionXYZ = glm::vec3(-7.0f, 4, 5.0f);
-	XrotationDegrees = 90.0f;
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(0.0f, 0.0f, 0.0f, 1.0f);  // Black color for the lines
-	m_basicMeshes->DrawTorusMesh();
-
-	scaleXYZ = glm::vec3(3.4, 3.4, 0.1);
-	positionXYZ = glm::vec3(-7.0f, 4.0f, 5.0f);
-	XrotationDegrees = 135.0f;
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(0.0f, 0.0f, 0.0f, 1.0f);  // Black color for the line
-	m_basicMeshes->DrawTorusMesh();
-
-	scaleXYZ = glm::vec3(3.4, 3.4, 0.1);
-	positionXYZ = glm::vec3(-7.0f, 4.0f, 5.0f);
-	XrotationDegrees = 45.0f;
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-	SetShaderColor(0.0f, 0.0f, 0.0f, 1.0f);  // Black color for the line
-	m_basicMeshes->DrawTorusMesh();
+	int ball = m_sceneGraph.AddNode(-1, glm::vec3(-7.0f, 4.0f, 5.0f), glm::vec3(0.0f), glm::vec3(4.0f, 4.0f, 4.0f));
+	AddSceneDraw(ball, SCENE_MESH_SPHERE, m_ballTexture, glm::vec4(1.00f, 0.34f, 0.00f, 1.0f), "ball");
 
+	//Used a torus shape to represent the lines on a basketball. By rotating the torus at the x axis I've mimicked  baskball lines
+	const float lineRotations[3] = { 90.0f, 135.0f, 45.0f };
+	const glm::vec3 lineScales[3] = { glm::vec3(3.4f, 3.4f, 0.5f), glm::vec3(3.4f, 3.4f, 0.1f), glm::vec3(3.4f, 3.4f, 0.1f) };
+	for (int i = 0; i < 3; i++)
+	{
+		int line = m_sceneGraph.AddNode(ball, glm::vec3(0.0f), glm::vec3(lineRotations[i], 0.0f, 0.0f), lineScales[i]);
+		AddSceneDraw(line, SCENE_MESH_TORUS, INVALID_TEXTURE_HANDLE, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), "ball");
+	}
 }
-
@@ -9,12 +9,92 @@
 
 #pragma once
 
+#include "ClusteredLightCulling.h"
+#include "DeferredRenderer.h"
+#include "LightUniformBuffer.h"
+#include "ProceduralTextureBaker.h"
+#include "SamplerCache.h"
+#include "SceneGraph.h"
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "TextureLoader.h"
+#include "TextureRegistry.h"
+#include "TextureResidency.h"
+#include "VirtualTextureSystem.h"
 
+#include <map>
 #include <string>
 #include <vector>
 
+/***********************************************************
+ *  SHADER_TEXTURE_SOURCE
+ *
+ *  Where the shader variant of a draw reads the surface
+ *  color from.
+ ***********************************************************/
+enum SHADER_TEXTURE_SOURCE
+{
+	SHADER_TEXTURE_SOURCE_NONE,
+	SHADER_TEXTURE_SOURCE_2D,
+	SHADER_TEXTURE_SOURCE_ARRAY,
+	SHADER_TEXTURE_SOURCE_VIRTUAL
+};
+
+/***********************************************************
+ *  SHADER_POINT_LIGHTS
+ *
+ *  Which point lights the shader variant of a draw loops
+ *  over.
+ ***********************************************************/
+enum SHADER_POINT_LIGHTS
+{
+	SHADER_POINT_LIGHTS_NONE,
+	SHADER_POINT_LIGHTS_ALL,
+	SHADER_POINT_LIGHTS_CLUSTERED
+};
+
+/***********************************************************
+ *  SHADER_RENDER_PASS
+ *
+ *  The pass the shader variant of a draw writes.
+ ***********************************************************/
+enum SHADER_RENDER_PASS
+{
+	SHADER_RENDER_PASS_FORWARD,
+	SHADER_RENDER_PASS_VIRTUAL_FEEDBACK,
+	SHADER_RENDER_PASS_DEFERRED_GEOMETRY
+};
+
+/***********************************************************
+ *  SHADER_LIGHTING_KERNEL
+ *
+ *  How the shader variant of a draw combines the terms of
+ *  each light.
+ ***********************************************************/
+enum SHADER_LIGHTING_KERNEL
+{
+	// the previous kernel, where each light scales the material
+	// colors by the surface itself
+	SHADER_LIGHTING_KERNEL_PER_LIGHT,
+	// the material colors are scaled by the surface once and shared
+	// by every light
+	SHADER_LIGHTING_KERNEL_SHARED_SURFACE
+};
+
+/***********************************************************
+ *  SCENE_MESH
+ *
+ *  The basic shape a scene object is drawn with.
+ ***********************************************************/
+enum SCENE_MESH
+{
+	SCENE_MESH_BOX,
+	SCENE_MESH_PLANE,
+	SCENE_MESH_SPHERE,
+	SCENE_MESH_CYLINDER,
+	SCENE_MESH_TORUS
+};
+
 /***********************************************************
  *  SceneManager
  *
@@ -26,6 +106,11 @@ class SceneManager
 private:
 	glm::mat4 m_projectionMatrix;  
 	bool m_isPerspective;
+	// view matrix of the frame being drawn
+	glm::mat4 m_viewMatrix;
+	// product of the projection and view matrices, which every object
+	// transform is combined with
+	glm::mat4 m_viewProjectionMatrix;
 public:
 	// constructor
 	SceneManager(ShaderManager *pShaderManager);
@@ -33,12 +118,50 @@ public:
 	~SceneManager();
 	void SetProjectionMode(bool isPerspective);
 	void UpdateProjectionMatrix(float aspectRatio);
-
-	struct TEXTURE_INFO
-	{
-		std::string tag;
-		uint32_t ID;
-	};
+	// read the scene textures from an asset pack when it holds them
+	void SetAssetPack(AssetPack* pAssetPack);
+	// load the scene textures block compressed when the driver supports it
+	void SetCompressTextures(bool bCompress);
+	// scale the scene textures down by 2, 4 or 8 while they are decoded
+	void SetTextureDecodeScale(int scale);
+	// choose the filtering quality tier of the scene textures
+	void SetTextureQuality(TEXTURE_QUALITY quality);
+	// pack every scene image into texture array layers of this size
+	void SetTextureArraySize(int size) { m_textureArraySize = size; }
+	// bake the materials' procedural textures instead of loading their image files
+	void SetProceduralTextures(bool bProcedural) { m_bProceduralTextures = bProcedural; }
+	// check whether every queued scene texture has finished loading
+	bool AreTexturesLoaded() const;
+	// get the live statistics of the texture memory
+	const TEXTURE_MEMORY_STATS& GetTextureMemoryStats() const;
+	// get the live statistics of the virtual texture tile streaming
+	const VIRTUAL_TEXTURE_STATS& GetVirtualTextureStats() const;
+	// light each fragment with the lights of its cluster, or with every light
+	void SetClusteredLighting(bool bClustered) { m_bClusteredLighting = bClustered; }
+	// scatter this many small point lights over the scene
+	void SetExtraPointLights(int count) { m_extraPointLights = count; }
+	// get the number of point lights in the scene
+	int GetPointLightCount() const { return(m_pLights->GetPointLightCount()); }
+	// get the statistics of the light cluster assignment of the last frame
+	const LIGHT_CLUSTER_STATS& GetLightClusterStats() const { return(m_pLightClusters->GetStats()); }
+	// set the view and projection of the frame about to be drawn
+	void SetCameraMatrices(const glm::mat4& view, const glm::mat4& projection);
+	// light the scene from a G-buffer in a separate pass, or while drawing it
+	void SetDeferredShading(bool bDeferred) { m_bDeferredShading = bDeferred; }
+	bool IsDeferredShading() const { return(m_bDeferredShading); }
+	// draw this many extra copies of the wall behind it, each covered
+	// by the next, to measure the cost of shading hidden surfaces
+	void SetOverdrawLayers(int layers);
+	// get the nodes that place the objects of the scene
+	const SceneGraph& GetSceneGraph() const { return(m_sceneGraph); }
+	// draw the passed in number of planes that each cover the whole
+	// view, textured or in a flat color and lit by every scene light,
+	// to measure the cost of lighting a fragment
+	void RenderShadingTest(bool bTextured, int layers);
+	// choose how the lit shader variants combine the terms of each light
+	void SetLightingKernel(SHADER_LIGHTING_KERNEL kernel) { m_shaderVariant.lightingKernel = kernel; }
+	// get the number of shader variants built so far
+	int GetShaderVariantCount() const { return(m_pShaderManager->GetVariantCount()); }
 
 	struct OBJECT_MATERIAL
 	{
@@ -46,6 +169,13 @@ public:
 		glm::vec3 specularColor;
 		float shininess;
 		std::string tag;
+		// wrap mode of the textures drawn with the material, and the
+		// shared sampler object for it at the current quality tier
+		GLenum wrapMode;
+		GLuint samplerID;
+		// parameters of the texture baked for the material in the
+		// procedural texture mode, with no pattern if it has none
+		PROCEDURAL_TEXTURE_PARAMS procedural;
 	};
 
 private:
@@ -53,35 +183,210 @@ private:
 	ShaderManager* m_pShaderManager;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	// pointer to the background texture loader object
+	TextureLoader* m_pTextureLoader;
+	// pointer to the texture memory budget object
+	TextureResidency* m_pTextureResidency;
+	// pointer to the shared sampler objects
+	SamplerCache* m_pSamplerCache;
+	// pointer to the virtual texture tile streaming object
+	VirtualTextureSystem* m_pVirtualTextures;
+	// pointer to the scene lights shared with the shaders
+	LightUniformBuffer* m_pLights;
+	// pointer to the assignment of the point lights to view clusters
+	ClusteredLightCulling* m_pLightClusters;
+	// light with the lights of each fragment's cluster
+	bool m_bClusteredLighting;
+	// number of small point lights scattered over the scene
+	int m_extraPointLights;
+	// texture units of the point light and light cluster buffer textures
+	int m_pointLightDataSlot;
+	int m_clusterRangesSlot;
+	int m_clusterIndicesSlot;
+	// pointer to the G-buffer and lighting passes of the deferred path
+	DeferredRenderer* m_pDeferredRenderer;
+	// light the scene in a separate pass over the G-buffer
+	bool m_bDeferredShading;
+	// first of the texture units the G-buffer is read through
+	int m_gBufferSlot;
+	// number of extra wall copies drawn behind the wall
+	int m_overdrawLayers;
+	// pointer to the procedural texture baker, created when first used
+	ProceduralTextureBaker* m_pProceduralTextures;
+	// bake procedural textures in place of the image files they replace
+	bool m_bProceduralTextures;
+	// texture units of the virtual texture tile cache and page table
+	int m_virtualTileCacheSlot;
+	int m_virtualPageTableSlot;
+	// filtering quality tier of the scene textures
+	TEXTURE_QUALITY m_textureQuality;
+	// sampler for textures drawn without a material of their own
+	GLuint m_defaultSamplerID;
+	// texture unit of the texture set for the next draw, -1 if none
+	int m_activeTextureSlot;
+	// loaded textures, looked up by handle, tag or source file
+	TextureRegistry m_textureRegistry;
+	// downgraded textures used this frame, reloaded once it is drawn
+	std::vector<TextureHandle> m_pendingRestores;
+	// texture unit used for textures that have no unit of their own
+	int m_overflowTextureSlot;
+	// pack the scene textures into the layers of one texture array
+	bool m_bUseTextureArray;
+	// an image file waiting for AllocateTextureArray() to decide
+	// whether it goes into the texture array, with its size
+	struct ARRAY_CANDIDATE
+	{
+		TextureHandle texture;
+		int width;
+		int height;
+	};
+	std::vector<ARRAY_CANDIDATE> m_arrayCandidates;
+	// texture array holding the packed textures
+	GLuint m_textureArrayID;
+	// number of layers used and available in the texture array
+	int m_textureArrayLayers;
+	int m_maxTextureArrayLayers;
+	// size every image is resampled to for the texture array, or 0 to
+	// only pack the images that share a size
+	int m_textureArraySize;
+	// mip levels of the texture array, and the finest level of each
+	// layer uploaded so far, equal to the level count until its first
+	int m_textureArrayLevels;
+	std::vector<int> m_textureLayerLevels;
+	// texture unit the texture array is bound to
+	int m_textureArraySlot;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
 
-	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
+	// nodes that place the objects of the scene
+	SceneGraph m_sceneGraph;
+	// a mesh drawn at a scene graph node, with a texture or else a
+	// color, and the index of its material or -1 for none
+	struct SCENE_DRAW
+	{
+		int node;
+		SCENE_MESH mesh;
+		TextureHandle texture;
+		glm::vec4 color;
+		glm::vec2 UVscale;
+		int material;
+	};
+	// every draw of the scene, in the order they are drawn
+	std::vector<SCENE_DRAW> m_sceneDraws;
+
+	// handles of the shader uniforms set while drawing
+	struct SCENE_UNIFORMS
+	{
+		ShaderUniform<glm::mat4> model;
+		ShaderUniform<glm::mat4> modelViewProjection;
+		ShaderUniform<glm::mat3> normalMatrix;
+		ShaderUniform<glm::vec4> objectColor;
+		ShaderUniform<int> objectTexture;
+		ShaderUniform<int> objectTextureArray;
+		ShaderUniform<int> textureLayer;
+		ShaderUniform<float> textureLayerMinLevel;
+		ShaderUniform<glm::vec2> UVscale;
+		ShaderUniform<glm::vec3> materialDiffuseColor;
+		ShaderUniform<glm::vec3> materialSpecularColor;
+		ShaderUniform<float> materialShininess;
+		ShaderUniform<int> virtualPageTable;
+		ShaderUniform<int> virtualTileCache;
+		ShaderUniform<glm::vec4> virtualTextureInfo;
+		ShaderUniform<int> virtualTextureID;
+		ShaderUniform<float> virtualMipBias;
+		ShaderUniform<int> pointLightData;
+		ShaderUniform<int> clusterLightRanges;
+		ShaderUniform<int> clusterLightIndices;
+	};
+	SCENE_UNIFORMS m_uniforms;
+	// shader program the uniform handles were resolved from
+	GLuint m_uniformProgramID;
+
+	// the features of the shader variant the next draw is made with
+	struct SHADER_VARIANT
+	{
+		SHADER_TEXTURE_SOURCE textureSource;
+		bool bLighting;
+		bool bDirectionalLight;
+		SHADER_POINT_LIGHTS pointLights;
+		bool bSpotLight;
+		SHADER_RENDER_PASS renderPass;
+		SHADER_LIGHTING_KERNEL lightingKernel;
+	};
+	SHADER_VARIANT m_shaderVariant;
+	// uniform handles of each shader variant used so far, by variant key,
+	// and the program they were resolved from
+	struct VARIANT_UNIFORMS
+	{
+		GLuint programID;
+		SCENE_UNIFORMS uniforms;
+	};
+	std::map<unsigned int, VARIANT_UNIFORMS> m_variantUniforms;
+	// generation of the shader programs the handles were resolved from,
+	// since a reloaded program can reuse the name of a deleted one
+	unsigned int m_shaderGeneration;
+	// uniform values of the next draw, set again into every variant
+	// switched to, since each program keeps its own values
+	struct DRAW_STATE
+	{
+		glm::mat4 model;
+		glm::mat4 modelViewProjection;
+		glm::mat3 normalMatrix;
+		glm::vec4 objectColor;
+		glm::vec2 UVscale;
+		glm::vec3 materialDiffuseColor;
+		glm::vec3 materialSpecularColor;
+		float materialShininess;
+		int objectTexture;
+		int textureLayer;
+		float textureLayerMinLevel;
+		glm::vec4 virtualTextureInfo;
+		int virtualTextureID;
+		float virtualMipBias;
+	};
+	DRAW_STATE m_drawState;
+
+	// resolve the handles of the shader uniforms for the active program
+	void ResolveUniforms();
+	// get the key of the shader variant of the next draw
+	unsigned int GetShaderVariantKey() const;
+	// make the shader variant of the next draw the active program
+	void ApplyShaderVariant();
+	// queue texture images to be converted to OpenGL texture data
+	TextureHandle CreateGLTexture(const char* filename, const char* tag);
+	// open a virtual texture tile file for a very large texture
+	TextureHandle CreateVirtualTexture(const char* filename, const char* tag);
+	// bake the procedural texture of a material on the GPU
+	TextureHandle CreateProceduralTexture(const char* materialTag, const char* tag);
+	// pack the images that share a size into the texture array, and
+	// queue the others into textures of their own
+	void AllocateTextureArray();
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
+	// switch every use of one OpenGL texture over to another one
+	void ReplaceTexture(GLuint oldTextureID, GLuint newTextureID);
+	// start tracking the memory of a texture once it is loaded
+	void OnTextureLoaded(GLuint textureID, const TEXTURE_IMAGE& image);
+	// start reloading the downgraded textures used this frame
+	void StartTextureRestores();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const char* tag) const;
+	int FindTextureSlot(const char* tag) const;
 	// find a defined material by tag
 	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	// get the index of a defined material by tag, -1 if there is none
+	int FindMaterialIndex(const std::string& tag) const;
+	// look up the samplers of the materials at the current quality tier
+	void ResolveSamplers();
 
 	
 
-	// set the transformation values 
-	// into the transform buffer
-	void SetTransformations(
-		glm::vec3 scaleXYZ,
-		float XrotationDegrees,
-		float YrotationDegrees,
-		float ZrotationDegrees,
-		glm::vec3 positionXYZ);
+	// set the world matrix of the next draw, along with its product
+	// with the camera and the matrix its normals are turned by
+	void SetModelMatrix(const glm::mat4& model);
+	void SetModelMatrix(const glm::mat4& model, const glm::mat3& normalMatrix);
 
 	// set the color values into the shader
 	void SetShaderColor(
@@ -92,7 +397,7 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		TextureHandle texture);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -101,6 +406,17 @@ private:
 	// set the object material into the shader
 	void SetShaderMaterial(
 		std::string materialTag);
+	// set the material with the passed in index into the shader
+	void ApplyMaterial(int materialIndex);
+
+	// add a draw of a mesh at a scene graph node, textured when the
+	// texture is valid and in the passed in color otherwise
+	void AddSceneDraw(int node, SCENE_MESH mesh, TextureHandle texture, const glm::vec4& color,
+		const char* materialTag);
+	// draw one of the basic meshes
+	void DrawMesh(SCENE_MESH mesh);
+	// draw every object of the 3D scene
+	void RenderObjects();
 
 public:
 
@@ -109,12 +425,20 @@ public:
 	void PrepareScene();
 	void RenderScene();
 	void SetupSceneLights();
-	void RenderWall();
-	void RenderBall();
-	void RenderTable();
-	void RenderWindow();
+	void BuildScene();
+	void AddWall();
+	void AddBall();
+	void AddTable();
+	void AddWindow();
 	void LoadSceneTexture();
 	void DefineObjectMaterials();
-	void RenderLaptop();
-	void RenderCoffeeMug();
+	void AddLaptop();
+	void AddCoffeeMug();
+
+private:
+	// handles of the textures used by the 3D scene
+	TextureHandle m_tableTexture;
+	TextureHandle m_wallTexture;
+	TextureHandle m_ballTexture;
+	TextureHandle m_windowTexture;
 };
\ No newline at end of file
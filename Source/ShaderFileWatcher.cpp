@@ -0,0 +1,181 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderfilewatcher.cpp
+// ============
+// notice when the shader files are saved so they can be reloaded
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderFileWatcher.h"
+
+#include <chrono>
+#include <cstring>
+
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// time between two checks of the modification times, in milliseconds
+	const double g_PollIntervalMs = 500.0;
+
+	// get a steady timestamp in milliseconds for the polling interval
+	double GetTimeMs()
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+/***********************************************************
+ *  ShaderFileWatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderFileWatcher::ShaderFileWatcher()
+{
+	m_lastPollTime = 0.0;
+#ifdef __linux__
+	m_inotifyFD = -1;
+#endif
+}
+
+/***********************************************************
+ *  ~ShaderFileWatcher()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderFileWatcher::~ShaderFileWatcher()
+{
+#ifdef __linux__
+	if (m_inotifyFD >= 0)
+	{
+		close(m_inotifyFD);
+		m_inotifyFD = -1;
+	}
+#endif
+}
+
+/***********************************************************
+ *  GetModifiedTime()
+ *
+ *  This method is used for getting the last modification
+ *  time of a file, or 0 if it does not exist.
+ ***********************************************************/
+long long ShaderFileWatcher::GetModifiedTime(const std::string& filename)
+{
+	struct stat fileStatus;
+	if (stat(filename.c_str(), &fileStatus) != 0)
+	{
+		return(0);
+	}
+
+	return((long long)fileStatus.st_mtime);
+}
+
+/***********************************************************
+ *  Watch()
+ *
+ *  This method is used for starting to watch the passed in
+ *  files.  The directory of each file is watched rather
+ *  than the file itself, since an editor that saves by
+ *  writing a new file and renaming it over the old one
+ *  would end a watch on the old file.
+ ***********************************************************/
+bool ShaderFileWatcher::Watch(const std::vector<std::string>& filenames)
+{
+	m_filenames = filenames;
+	m_baseNames.clear();
+	m_modifiedTimes.clear();
+	bool bWatching = false;
+
+#ifdef __linux__
+	if (m_inotifyFD < 0)
+	{
+		m_inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	}
+#endif
+
+	for (size_t i = 0; i < m_filenames.size(); i++)
+	{
+		const std::string& filename = m_filenames[i];
+		size_t separator = filename.find_last_of("/\\");
+		std::string directory = (separator != std::string::npos) ? filename.substr(0, separator) : ".";
+		m_baseNames.push_back((separator != std::string::npos) ? filename.substr(separator + 1) : filename);
+		m_modifiedTimes.push_back(GetModifiedTime(filename));
+		bWatching = bWatching || (m_modifiedTimes.back() != 0);
+
+#ifdef __linux__
+		// watching a directory twice only returns the existing watch
+		if (m_inotifyFD >= 0)
+		{
+			inotify_add_watch(m_inotifyFD, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		}
+#endif
+	}
+	m_lastPollTime = GetTimeMs();
+
+	return(bWatching);
+}
+
+/***********************************************************
+ *  HasChanged()
+ *
+ *  This method is used for checking whether any watched
+ *  file was written since the last call, without waiting.
+ *  Every change waiting is taken, so several writes of one
+ *  save are reported once.
+ ***********************************************************/
+bool ShaderFileWatcher::HasChanged()
+{
+	bool bChanged = false;
+
+#ifdef __linux__
+	if (m_inotifyFD >= 0)
+	{
+		// the buffer is aligned for the event structures read into it
+		alignas(struct inotify_event) char buffer[4096];
+		ssize_t length = 0;
+		while ((length = read(m_inotifyFD, buffer, sizeof(buffer))) > 0)
+		{
+			for (ssize_t offset = 0; offset < length; )
+			{
+				const struct inotify_event* pEvent = (const struct inotify_event*)(buffer + offset);
+				for (size_t i = 0; (pEvent->len > 0) && (i < m_baseNames.size()); i++)
+				{
+					if (strcmp(pEvent->name, m_baseNames[i].c_str()) == 0)
+					{
+						bChanged = true;
+					}
+				}
+				offset += sizeof(struct inotify_event) + pEvent->len;
+			}
+		}
+		return(bChanged);
+	}
+#endif
+
+	double currentTime = GetTimeMs();
+	if (currentTime - m_lastPollTime < g_PollIntervalMs)
+	{
+		return(false);
+	}
+	m_lastPollTime = currentTime;
+
+	for (size_t i = 0; i < m_filenames.size(); i++)
+	{
+		long long modifiedTime = GetModifiedTime(m_filenames[i]);
+		if (modifiedTime != m_modifiedTimes[i])
+		{
+			m_modifiedTimes[i] = modifiedTime;
+			bChanged = (modifiedTime != 0) || bChanged;
+		}
+	}
+
+	return(bChanged);
+}
@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderfilewatcher.h
+// ============
+// notice when the shader files are saved so they can be reloaded
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ShaderFileWatcher
+ *
+ *  This class watches a set of files for changes without
+ *  blocking.  On Linux the directories of the files are
+ *  watched with inotify, so a change is seen as soon as a
+ *  file is closed after writing or replaced by a rename,
+ *  the way most editors save.  Elsewhere the modification
+ *  times of the files are compared twice a second.
+ ***********************************************************/
+class ShaderFileWatcher
+{
+public:
+	// constructor
+	ShaderFileWatcher();
+	// destructor
+	~ShaderFileWatcher();
+
+	// start watching the passed in files, returns false if none of
+	// them can be watched
+	bool Watch(const std::vector<std::string>& filenames);
+	// check whether any watched file changed since the last call
+	bool HasChanged();
+
+private:
+	// watched files, the part of each name after its directory, and
+	// their last seen modification times
+	std::vector<std::string> m_filenames;
+	std::vector<std::string> m_baseNames;
+	std::vector<long long> m_modifiedTimes;
+	// time of the last modification time check, in milliseconds
+	double m_lastPollTime;
+#ifdef __linux__
+	// inotify instance watching the directories, -1 if none
+	int m_inotifyFD;
+#endif
+
+	// get the modification time of a file, 0 if it does not exist
+	static long long GetModifiedTime(const std::string& filename);
+
+	// watchers cannot be copied
+	ShaderFileWatcher(const ShaderFileWatcher&);
+	ShaderFileWatcher& operator=(const ShaderFileWatcher&);
+};
@@ -0,0 +1,1145 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadermanager.cpp
+// ============
+// manage the loading and setting of shader code
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderManager.h"
+#include "RenderState.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// uniform values sent and skipped by every shader manager
+	UNIFORM_UPLOAD_STATS g_UniformStats = UNIFORM_UPLOAD_STATS();
+}
+
+/***********************************************************
+ *  ShaderManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderManager::ShaderManager()
+{
+	m_programID = 0;
+	m_pActiveVariant = NULL;
+	m_activeKey = 0;
+	m_pProgramCache = NULL;
+	m_bParallelCompile = false;
+	m_bParallelCompileChecked = false;
+	m_programGeneration = 0;
+}
+
+/***********************************************************
+ *  ~ShaderManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderManager::~ShaderManager()
+{
+	ReportUnknownUniforms();
+	CancelReload();
+	DestroyVariants();
+}
+
+/***********************************************************
+ *  ReadTextFile()
+ *
+ *  This method is used for reading the whole contents of
+ *  the passed in text file into a string.
+ ***********************************************************/
+bool ShaderManager::ReadTextFile(const char* filename, std::string& contents)
+{
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	if (file.is_open() == false)
+	{
+		return(false);
+	}
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	contents = stream.str();
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for reading the vertex and fragment
+ *  shader code from the passed in GLSL files and building
+ *  the shader program from it.
+ ***********************************************************/
+GLuint ShaderManager::LoadShaders(const char* vertexShaderFile, const char* fragmentShaderFile)
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+
+	if (ReadTextFile(vertexShaderFile, vertexSource) == false)
+	{
+		std::cerr << "Failed to open shader file: " << vertexShaderFile << std::endl;
+		return(0);
+	}
+	if (ReadTextFile(fragmentShaderFile, fragmentSource) == false)
+	{
+		std::cerr << "Failed to open shader file: " << fragmentShaderFile << std::endl;
+		return(0);
+	}
+
+	return(LoadShaderSources(
+		vertexSource.c_str(), vertexSource.size(),
+		fragmentSource.c_str(), fragmentSource.size()));
+}
+
+/***********************************************************
+ *  SetDefine()
+ *
+ *  This method is used for defining a preprocessor constant
+ *  in the shaders compiled after it is called, replacing
+ *  any earlier value of the same name.
+ ***********************************************************/
+void ShaderManager::SetDefine(const std::string& name, int value)
+{
+	m_defines[name] = value;
+}
+
+/***********************************************************
+ *  AddVariantDefine()
+ *
+ *  This method is used for defining a preprocessor constant
+ *  whose value in each variant is read from the passed in
+ *  bits of the variant key, replacing any earlier bits of
+ *  the same name.  The loaded program is the variant of
+ *  key 0, so the shader code has to default every such
+ *  define to 0.
+ ***********************************************************/
+void ShaderManager::AddVariantDefine(const std::string& name, int firstBit, int bitCount)
+{
+	VARIANT_DEFINE define;
+	define.name = name;
+	define.firstBit = firstBit;
+	define.bitCount = bitCount;
+
+	for (size_t i = 0; i < m_variantDefines.size(); i++)
+	{
+		if (m_variantDefines[i].name == name)
+		{
+			m_variantDefines[i] = define;
+			return;
+		}
+	}
+	m_variantDefines.push_back(define);
+}
+
+/***********************************************************
+ *  GetDefines()
+ *
+ *  This method is used for getting the define lines the
+ *  variant of the passed in key is compiled with, the
+ *  constant defines followed by those read from the key.
+ ***********************************************************/
+std::string ShaderManager::GetDefines(unsigned int key) const
+{
+	std::ostringstream stream;
+	for (std::map<std::string, int>::const_iterator it = m_defines.begin(); it != m_defines.end(); ++it)
+	{
+		stream << "#define " << it->first << " " << it->second << "\n";
+	}
+	for (size_t i = 0; i < m_variantDefines.size(); i++)
+	{
+		const VARIANT_DEFINE& define = m_variantDefines[i];
+		unsigned int value = (key >> define.firstBit) & ((1u << define.bitCount) - 1u);
+		stream << "#define " << define.name << " " << value << "\n";
+	}
+
+	return(stream.str());
+}
+
+/***********************************************************
+ *  StartShader()
+ *
+ *  This method is used for handing a single shader stage
+ *  with the passed in define lines to the driver to
+ *  compile, without waiting for the result.  The defines
+ *  are passed as a string of their own after the version
+ *  line, which has to stay first, and a line directive
+ *  keeps the line numbers of compile errors matching the
+ *  source file.
+ ***********************************************************/
+GLuint ShaderManager::StartShader(GLenum type, const std::string& source, const std::string& defines) const
+{
+	// split the source after the version line
+	size_t versionLength = 0;
+	if (source.compare(0, 8, "#version") == 0)
+	{
+		size_t lineEnd = source.find('\n');
+		versionLength = (lineEnd != std::string::npos) ? lineEnd + 1 : source.size();
+	}
+
+	std::string header;
+	if (defines.empty() == false)
+	{
+		header = defines + "#line " + std::to_string((versionLength > 0) ? 2 : 1) + "\n";
+	}
+
+	const char* sources[3] = { source.c_str(), header.c_str(), source.c_str() + versionLength };
+	GLint sourceLengths[3] = { (GLint)versionLength, (GLint)header.size(), (GLint)(source.size() - versionLength) };
+
+	GLuint shaderID = glCreateShader(type);
+	glShaderSource(shaderID, 3, sources, sourceLengths);
+	glCompileShader(shaderID);
+
+	return(shaderID);
+}
+
+/***********************************************************
+ *  CheckShader()
+ *
+ *  This method is used for checking whether a shader stage
+ *  compiled, and printing its log if it did not.
+ ***********************************************************/
+bool ShaderManager::CheckShader(GLuint shaderID, unsigned int key, const char* stageName) const
+{
+	GLint success = GL_FALSE;
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+	if (success == GL_FALSE)
+	{
+		GLint logLength = 0;
+		glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> infoLog(logLength > 0 ? logLength : 1, '\0');
+		glGetShaderInfoLog(shaderID, (GLsizei)infoLog.size(), NULL, &infoLog[0]);
+		std::cerr << "Failed to compile " << stageName << " shader of variant " << key << ":\n"
+			<< &infoLog[0] << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  StartProgram()
+ *
+ *  This method is used for handing two compiled shader
+ *  stages to the driver to link into a program, without
+ *  waiting for the result.  The program can be read back
+ *  as a binary when a program cache is set.
+ ***********************************************************/
+GLuint ShaderManager::StartProgram(GLuint vertexShaderID, GLuint fragmentShaderID) const
+{
+	GLuint programID = glCreateProgram();
+	if ((NULL != m_pProgramCache) && (m_pProgramCache->IsEnabled() == true))
+	{
+		glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glAttachShader(programID, vertexShaderID);
+	glAttachShader(programID, fragmentShaderID);
+	glLinkProgram(programID);
+
+	return(programID);
+}
+
+/***********************************************************
+ *  CheckProgram()
+ *
+ *  This method is used for freeing the shader stages of a
+ *  program once it is linked, and checking whether it
+ *  linked.  A program that did not is deleted after its
+ *  log is printed.
+ ***********************************************************/
+bool ShaderManager::CheckProgram(GLuint programID, GLuint vertexShaderID, GLuint fragmentShaderID,
+	unsigned int key) const
+{
+	// the shader objects are no longer needed once the program is linked
+	glDetachShader(programID, vertexShaderID);
+	glDetachShader(programID, fragmentShaderID);
+	glDeleteShader(vertexShaderID);
+	glDeleteShader(fragmentShaderID);
+
+	GLint success = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (success == GL_FALSE)
+	{
+		GLint logLength = 0;
+		glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> infoLog(logLength > 0 ? logLength : 1, '\0');
+		glGetProgramInfoLog(programID, (GLsizei)infoLog.size(), NULL, &infoLog[0]);
+		std::cerr << "Failed to link shader program of variant " << key << ":\n" << &infoLog[0] << std::endl;
+
+		glDeleteProgram(programID);
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  BuildProgram()
+ *
+ *  This method is used for compiling the loaded vertex and
+ *  fragment shader sources with the defines of the passed
+ *  in variant key and linking them into a program.  With a
+ *  program cache the linked binary is loaded from it when
+ *  it holds one for the same sources, defines and driver,
+ *  and a program that had to be compiled is stored in it.
+ ***********************************************************/
+GLuint ShaderManager::BuildProgram(unsigned int key) const
+{
+	std::string defines = GetDefines(key);
+	uint64_t programKey = 0;
+	GLuint programID = 0;
+	bool bCache = (NULL != m_pProgramCache) && (m_pProgramCache->IsEnabled() == true);
+	if (bCache == true)
+	{
+		programKey = m_pProgramCache->GetProgramKey(m_vertexSource, m_fragmentSource, defines);
+		programID = m_pProgramCache->Load(programKey);
+	}
+
+	if (programID == 0)
+	{
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		GLuint vertexShaderID = StartShader(GL_VERTEX_SHADER, m_vertexSource, defines);
+		GLuint fragmentShaderID = StartShader(GL_FRAGMENT_SHADER, m_fragmentSource, defines);
+		bool bCompiled = CheckShader(vertexShaderID, key, "vertex");
+		bCompiled = CheckShader(fragmentShaderID, key, "fragment") && bCompiled;
+		if (bCompiled == false)
+		{
+			glDeleteShader(vertexShaderID);
+			glDeleteShader(fragmentShaderID);
+			return(0);
+		}
+
+		programID = StartProgram(vertexShaderID, fragmentShaderID);
+		if (CheckProgram(programID, vertexShaderID, fragmentShaderID, key) == false)
+		{
+			return(0);
+		}
+		double compileTimeMs = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - startTime).count();
+		if (NULL != m_pProgramCache)
+		{
+			m_pProgramCache->Store(programKey, programID, compileTimeMs);
+		}
+	}
+
+	ApplyBlockBindings(programID);
+
+	return(programID);
+}
+
+/***********************************************************
+ *  ApplyBlockBindings()
+ *
+ *  This method is used for pointing the uniform blocks of a
+ *  newly built program at the binding points set for them,
+ *  so every variant reads the same buffers.
+ ***********************************************************/
+void ShaderManager::ApplyBlockBindings(GLuint programID) const
+{
+	for (std::map<std::string, GLuint>::const_iterator it = m_blockBindings.begin(); it != m_blockBindings.end(); ++it)
+	{
+		GLuint blockIndex = glGetUniformBlockIndex(programID, it->first.c_str());
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(programID, blockIndex, it->second);
+		}
+	}
+}
+
+/***********************************************************
+ *  DestroyVariants()
+ *
+ *  This method is used for deleting the programs of every
+ *  variant built so far.
+ ***********************************************************/
+void ShaderManager::DestroyVariants()
+{
+	for (std::map<unsigned int, PROGRAM_VARIANT>::iterator it = m_variants.begin(); it != m_variants.end(); ++it)
+	{
+		if (it->second.programID != 0)
+		{
+			glDeleteProgram(it->second.programID);
+		}
+	}
+	m_variants.clear();
+	m_pActiveVariant = NULL;
+	m_programID = 0;
+}
+
+/***********************************************************
+ *  LoadShaderSources()
+ *
+ *  This method is used for keeping the passed in vertex
+ *  and fragment shader source text, which the variants are
+ *  built from, and building the variant of key 0 as the
+ *  active program.  Any program loaded before is replaced
+ *  only if the new one builds.
+ ***********************************************************/
+GLuint ShaderManager::LoadShaderSources(
+	const char* vertexSource, size_t vertexLength,
+	const char* fragmentSource, size_t fragmentLength)
+{
+	std::string previousVertexSource = m_vertexSource;
+	std::string previousFragmentSource = m_fragmentSource;
+	m_vertexSource.assign(vertexSource, vertexLength);
+	m_fragmentSource.assign(fragmentSource, fragmentLength);
+
+	GLuint programID = BuildProgram(0);
+	if (programID == 0)
+	{
+		m_vertexSource = previousVertexSource;
+		m_fragmentSource = previousFragmentSource;
+		return(0);
+	}
+
+	// replace any previously loaded program and its variants
+	CancelReload();
+	DestroyVariants();
+	PROGRAM_VARIANT& variant = m_variants[0];
+	variant.programID = programID;
+	// look up every uniform once, so setting them needs no driver lookups
+	ReflectUniforms(variant);
+	m_pActiveVariant = &variant;
+	m_activeKey = 0;
+	m_programID = programID;
+	m_programGeneration++;
+
+	return(m_programID);
+}
+
+/***********************************************************
+ *  UseVariant()
+ *
+ *  This method is used for making the variant of the
+ *  passed in key the active program, so the uniform
+ *  handles resolved next belong to it.  The variant is
+ *  built the first time its key is used.  A variant that
+ *  fails to build is reported once and leaves the active
+ *  program unchanged.  Returns the program of the variant,
+ *  or 0 if it could not be built.
+ ***********************************************************/
+GLuint ShaderManager::UseVariant(unsigned int key)
+{
+	if ((NULL != m_pActiveVariant) && (key == m_activeKey))
+	{
+		return(m_programID);
+	}
+
+	std::map<unsigned int, PROGRAM_VARIANT>::iterator found = m_variants.find(key);
+	if (found == m_variants.end())
+	{
+		PROGRAM_VARIANT& variant = m_variants[key];
+		variant.programID = BuildProgram(key);
+		if (variant.programID != 0)
+		{
+			ReflectUniforms(variant);
+		}
+		found = m_variants.find(key);
+	}
+	if (found->second.programID == 0)
+	{
+		return(0);
+	}
+
+	m_pActiveVariant = &found->second;
+	m_activeKey = key;
+	m_programID = found->second.programID;
+	RenderState::UseProgram(m_programID);
+
+	return(m_programID);
+}
+
+/***********************************************************
+ *  BeginReloadShaders()
+ *
+ *  This method is used for reading the vertex and fragment
+ *  shader code from the passed in GLSL files again and
+ *  starting to rebuild the programs from it in the
+ *  background.  Returns false if a file cannot be read.
+ ***********************************************************/
+bool ShaderManager::BeginReloadShaders(const char* vertexShaderFile, const char* fragmentShaderFile)
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+
+	if (ReadTextFile(vertexShaderFile, vertexSource) == false)
+	{
+		std::cerr << "Failed to open shader file: " << vertexShaderFile << std::endl;
+		return(false);
+	}
+	if (ReadTextFile(fragmentShaderFile, fragmentSource) == false)
+	{
+		std::cerr << "Failed to open shader file: " << fragmentShaderFile << std::endl;
+		return(false);
+	}
+
+	BeginReload(vertexSource, fragmentSource);
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginReload()
+ *
+ *  This method is used for starting to rebuild every
+ *  variant built so far from the passed in sources, the
+ *  active one first, while the current programs keep
+ *  drawing.  When the driver compiles in parallel the
+ *  stages of every variant are handed to it right away,
+ *  and any reload still running is dropped.
+ ***********************************************************/
+void ShaderManager::BeginReload(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	CancelReload();
+
+	// let the driver compile on threads of its own, so asking whether a
+	// shader is done never waits for it
+	if (m_bParallelCompileChecked == false)
+	{
+		m_bParallelCompileChecked = true;
+		if (GLEW_KHR_parallel_shader_compile)
+		{
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+			m_bParallelCompile = true;
+		}
+		else if (GLEW_ARB_parallel_shader_compile)
+		{
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+			m_bParallelCompile = true;
+		}
+	}
+
+	m_reloadVertexSource = vertexSource;
+	m_reloadFragmentSource = fragmentSource;
+
+	RELOAD_PROGRAM program;
+	program.vertexShaderID = 0;
+	program.fragmentShaderID = 0;
+	program.programID = 0;
+	program.step = RELOAD_STEP_START;
+	program.compileTimeMs = 0.0;
+	program.key = m_activeKey;
+	m_reloadPrograms.push_back(program);
+	for (std::map<unsigned int, PROGRAM_VARIANT>::const_iterator it = m_variants.begin(); it != m_variants.end(); ++it)
+	{
+		if ((it->first != m_activeKey) && (it->second.programID != 0))
+		{
+			program.key = it->first;
+			m_reloadPrograms.push_back(program);
+		}
+	}
+
+	if (m_bParallelCompile == true)
+	{
+		for (size_t i = 0; i < m_reloadPrograms.size(); i++)
+		{
+			AdvanceReload(m_reloadPrograms[i]);
+		}
+	}
+}
+
+/***********************************************************
+ *  AdvanceReload()
+ *
+ *  This method is used for moving a variant being rebuilt
+ *  on to its next step - compiling its stages, linking
+ *  them, and checking the link.  A cached binary of the
+ *  new sources skips straight to the end.  With parallel
+ *  compiling a step only starts once the driver reports
+ *  the one before as complete.  The compile time stored
+ *  with the binary is the time the steps blocked on the
+ *  driver, or with parallel compiling the time from handing
+ *  the stages to it until the link is seen complete, so
+ *  the frames spent waiting for another variant or the
+ *  next poll are left out.  Returns 1 if the variant moved
+ *  on, 0 if it is still waiting on the driver, and -1 if
+ *  it failed to build.
+ ***********************************************************/
+int ShaderManager::AdvanceReload(RELOAD_PROGRAM& program)
+{
+	std::chrono::steady_clock::time_point stepStartTime = std::chrono::steady_clock::now();
+
+	if (program.step == RELOAD_STEP_START)
+	{
+		std::string defines = GetDefines(program.key);
+		if ((NULL != m_pProgramCache) && (m_pProgramCache->IsEnabled() == true))
+		{
+			program.programID = m_pProgramCache->Load(
+				m_pProgramCache->GetProgramKey(m_reloadVertexSource, m_reloadFragmentSource, defines));
+			if (program.programID != 0)
+			{
+				program.step = RELOAD_STEP_DONE;
+				return(1);
+			}
+		}
+
+		program.vertexShaderID = StartShader(GL_VERTEX_SHADER, m_reloadVertexSource, defines);
+		program.fragmentShaderID = StartShader(GL_FRAGMENT_SHADER, m_reloadFragmentSource, defines);
+		program.submitTime = stepStartTime;
+		program.compileTimeMs += std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - stepStartTime).count();
+		program.step = RELOAD_STEP_COMPILE;
+		return(1);
+	}
+
+	if (program.step == RELOAD_STEP_COMPILE)
+	{
+		if (m_bParallelCompile == true)
+		{
+			GLint vertexDone = GL_FALSE;
+			GLint fragmentDone = GL_FALSE;
+			glGetShaderiv(program.vertexShaderID, GL_COMPLETION_STATUS_KHR, &vertexDone);
+			glGetShaderiv(program.fragmentShaderID, GL_COMPLETION_STATUS_KHR, &fragmentDone);
+			if ((vertexDone == GL_FALSE) || (fragmentDone == GL_FALSE))
+			{
+				return(0);
+			}
+		}
+
+		bool bCompiled = CheckShader(program.vertexShaderID, program.key, "vertex");
+		bCompiled = CheckShader(program.fragmentShaderID, program.key, "fragment") && bCompiled;
+		if (bCompiled == false)
+		{
+			return(-1);
+		}
+
+		program.programID = StartProgram(program.vertexShaderID, program.fragmentShaderID);
+		program.compileTimeMs += std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - stepStartTime).count();
+		program.step = RELOAD_STEP_LINK;
+		return(1);
+	}
+
+	if (program.step == RELOAD_STEP_LINK)
+	{
+		if (m_bParallelCompile == true)
+		{
+			GLint linkDone = GL_FALSE;
+			glGetProgramiv(program.programID, GL_COMPLETION_STATUS_KHR, &linkDone);
+			if (linkDone == GL_FALSE)
+			{
+				return(0);
+			}
+		}
+
+		bool bLinked = CheckProgram(program.programID, program.vertexShaderID, program.fragmentShaderID, program.key);
+		program.vertexShaderID = 0;
+		program.fragmentShaderID = 0;
+		if (bLinked == false)
+		{
+			program.programID = 0;
+			return(-1);
+		}
+
+		// the compiled program is kept for the next launch
+		if ((NULL != m_pProgramCache) && (m_pProgramCache->IsEnabled() == true))
+		{
+			double compileTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+				((m_bParallelCompile == true) ? program.submitTime : stepStartTime)).count();
+			if (m_bParallelCompile == false)
+			{
+				compileTimeMs += program.compileTimeMs;
+			}
+			m_pProgramCache->Store(m_pProgramCache->GetProgramKey(m_reloadVertexSource, m_reloadFragmentSource,
+				GetDefines(program.key)), program.programID, compileTimeMs);
+		}
+		program.step = RELOAD_STEP_DONE;
+		return(1);
+	}
+
+	return(0);
+}
+
+/***********************************************************
+ *  UpdateReload()
+ *
+ *  This method is used for advancing the running reload
+ *  without waiting on the driver, called once per frame.
+ *  Without parallel compiling only one step of one variant
+ *  is taken per call, so the time the driver blocks for is
+ *  spread over the frames.  Once every variant has linked,
+ *  the new programs and sources replace the old ones in a
+ *  single swap.  A variant that fails to build drops the
+ *  whole reload and the old programs are kept.
+ ***********************************************************/
+SHADER_RELOAD_STATE ShaderManager::UpdateReload()
+{
+	if (m_reloadPrograms.empty() == true)
+	{
+		return(SHADER_RELOAD_NONE);
+	}
+
+	bool bDone = true;
+	bool bAdvanced = false;
+	for (size_t i = 0; i < m_reloadPrograms.size(); i++)
+	{
+		RELOAD_PROGRAM& program = m_reloadPrograms[i];
+		if (program.step == RELOAD_STEP_DONE)
+		{
+			continue;
+		}
+		if ((m_bParallelCompile == true) || (bAdvanced == false))
+		{
+			int result = AdvanceReload(program);
+			if (result < 0)
+			{
+				std::cerr << "Shader reload failed, keeping the previous shader programs" << std::endl;
+				CancelReload();
+				return(SHADER_RELOAD_FAILED);
+			}
+			bAdvanced = bAdvanced || (result > 0);
+		}
+		bDone = bDone && (program.step == RELOAD_STEP_DONE);
+	}
+	if (bDone == false)
+	{
+		return(SHADER_RELOAD_PENDING);
+	}
+
+	// variants built from the old sources while the reload ran are
+	// dropped with the old programs, and built again when next used
+	std::map<unsigned int, PROGRAM_VARIANT> variants;
+	for (size_t i = 0; i < m_reloadPrograms.size(); i++)
+	{
+		PROGRAM_VARIANT& variant = variants[m_reloadPrograms[i].key];
+		variant.programID = m_reloadPrograms[i].programID;
+		ApplyBlockBindings(variant.programID);
+		ReflectUniforms(variant);
+	}
+	m_reloadPrograms.clear();
+
+	DestroyVariants();
+	m_variants.swap(variants);
+	m_vertexSource.swap(m_reloadVertexSource);
+	m_fragmentSource.swap(m_reloadFragmentSource);
+	m_reloadVertexSource.clear();
+	m_reloadFragmentSource.clear();
+
+	std::map<unsigned int, PROGRAM_VARIANT>::iterator active = m_variants.find(m_activeKey);
+	if (active != m_variants.end())
+	{
+		m_pActiveVariant = &active->second;
+		m_programID = active->second.programID;
+		RenderState::UseProgram(m_programID);
+	}
+	m_programGeneration++;
+
+	return(SHADER_RELOAD_DONE);
+}
+
+/***********************************************************
+ *  CancelReload()
+ *
+ *  This method is used for dropping the running reload and
+ *  freeing everything it has built so far.
+ ***********************************************************/
+void ShaderManager::CancelReload()
+{
+	for (size_t i = 0; i < m_reloadPrograms.size(); i++)
+	{
+		RELOAD_PROGRAM& program = m_reloadPrograms[i];
+		if (program.programID != 0)
+		{
+			glDeleteProgram(program.programID);
+		}
+		if (program.vertexShaderID != 0)
+		{
+			glDeleteShader(program.vertexShaderID);
+		}
+		if (program.fragmentShaderID != 0)
+		{
+			glDeleteShader(program.fragmentShaderID);
+		}
+	}
+	m_reloadPrograms.clear();
+	m_reloadVertexSource.clear();
+	m_reloadFragmentSource.clear();
+}
+
+/***********************************************************
+ *  ReflectUniforms()
+ *
+ *  This method is used for reading every active uniform
+ *  variable of a linked program into its uniform table,
+ *  with the program interface query when the context has
+ *  it.  Members of uniform blocks have no location of their
+ *  own and are left out.  The names are also added to the
+ *  names of every variant built, which the unknown uniform
+ *  report checks against.
+ ***********************************************************/
+void ShaderManager::ReflectUniforms(PROGRAM_VARIANT& variant)
+{
+	variant.uniforms.clear();
+	variant.uniformIndex.clear();
+	variant.shadows.clear();
+	GLuint programID = variant.programID;
+
+	if (GLEW_VERSION_4_3 || GLEW_ARB_program_interface_query)
+	{
+		GLint uniformCount = 0;
+		GLint maxNameLength = 0;
+		glGetProgramInterfaceiv(programID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+		glGetProgramInterfaceiv(programID, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+		std::vector<char> name(maxNameLength > 0 ? maxNameLength : 1, '\0');
+
+		const GLenum properties[4] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+		for (GLint i = 0; i < uniformCount; i++)
+		{
+			GLint values[4] = { -1, 0, 1, -1 };
+			glGetProgramResourceiv(programID, GL_UNIFORM, i, 4, properties, 4, NULL, values);
+			if ((values[0] < 0) || (values[3] != -1))
+			{
+				continue;
+			}
+
+			glGetProgramResourceName(programID, GL_UNIFORM, i, (GLsizei)name.size(), NULL, &name[0]);
+			AddUniform(variant, &name[0], values[0], (GLenum)values[1], values[2]);
+		}
+	}
+	else
+	{
+		GLint uniformCount = 0;
+		GLint maxNameLength = 0;
+		glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+		glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+		std::vector<char> name(maxNameLength > 0 ? maxNameLength : 1, '\0');
+
+		for (GLint i = 0; i < uniformCount; i++)
+		{
+			GLint arraySize = 1;
+			GLenum type = 0;
+			glGetActiveUniform(programID, (GLuint)i, (GLsizei)name.size(), NULL, &arraySize, &type, &name[0]);
+			GLint location = glGetUniformLocation(programID, &name[0]);
+			if (location < 0)
+			{
+				continue;
+			}
+
+			AddUniform(variant, &name[0], location, type, arraySize);
+		}
+	}
+
+	for (size_t i = 0; i < variant.uniforms.size(); i++)
+	{
+		m_builtUniformNames.insert(variant.uniforms[i].name);
+		m_unknownUniformNames.erase(variant.uniforms[i].name);
+	}
+}
+
+/***********************************************************
+ *  ReportUnknownUniforms()
+ *
+ *  This method is used for reporting, in debug builds, the
+ *  uniform names that were looked up but are not an active
+ *  uniform of any variant built, such as a misspelled name.
+ *  A single variant cannot tell, since each one compiles
+ *  out the uniforms that only the others use.
+ ***********************************************************/
+void ShaderManager::ReportUnknownUniforms()
+{
+#ifdef _DEBUG
+	std::set<std::string>::const_iterator it;
+	for (it = m_unknownUniformNames.begin(); it != m_unknownUniformNames.end(); ++it)
+	{
+		std::cerr << "Unknown shader uniform: " << *it << ", not active in any of the "
+			<< m_variants.size() << " variants built" << std::endl;
+	}
+#endif
+	m_unknownUniformNames.clear();
+}
+
+/***********************************************************
+ *  BindUniformBlock()
+ *
+ *  This method is used for pointing a uniform block at an
+ *  indexed uniform buffer binding point, so every program
+ *  reading the block shares the same buffer.  The binding
+ *  is kept and applied to every variant, including the
+ *  ones built later.
+ ***********************************************************/
+bool ShaderManager::BindUniformBlock(const char* blockName, GLuint bindingPoint)
+{
+	std::map<std::string, GLuint>::iterator found = m_blockBindings.find(blockName);
+	if ((found == m_blockBindings.end()) || (found->second != bindingPoint))
+	{
+		m_blockBindings[blockName] = bindingPoint;
+		for (std::map<unsigned int, PROGRAM_VARIANT>::iterator it = m_variants.begin(); it != m_variants.end(); ++it)
+		{
+			GLuint blockIndex = (it->second.programID != 0) ?
+				glGetUniformBlockIndex(it->second.programID, blockName) : GL_INVALID_INDEX;
+			if (blockIndex != GL_INVALID_INDEX)
+			{
+				glUniformBlockBinding(it->second.programID, blockIndex, bindingPoint);
+			}
+		}
+	}
+
+	return((m_programID != 0) && (glGetUniformBlockIndex(m_programID, blockName) != GL_INVALID_INDEX));
+}
+
+/***********************************************************
+ *  AddUniform()
+ *
+ *  This method is used for adding a reflected uniform to
+ *  the uniform table of a variant.  An array of a basic
+ *  type is reported as its first element, so the array
+ *  name and each of its elements are added, since the
+ *  elements have consecutive locations.
+ ***********************************************************/
+void ShaderManager::AddUniform(PROGRAM_VARIANT& variant, const std::string& name, GLint location, GLenum type,
+	GLint arraySize)
+{
+	std::string baseName = name;
+	bool bArray = (baseName.size() > 3) && (baseName.compare(baseName.size() - 3, 3, "[0]") == 0);
+	if (bArray == true)
+	{
+		baseName.resize(baseName.size() - 3);
+	}
+
+	UNIFORM_INFO uniform;
+	uniform.name = baseName;
+	uniform.location = location;
+	uniform.type = type;
+	variant.uniformIndex[uniform.name] = (int)variant.uniforms.size();
+	variant.uniforms.push_back(uniform);
+
+	// every location the uniform covers gets a shadow with no value yet
+	GLint lastLocation = location + ((bArray == true) ? arraySize : 1);
+	if ((GLint)variant.shadows.size() < lastLocation)
+	{
+		UNIFORM_SHADOW shadow;
+		memset(&shadow, 0, sizeof(shadow));
+		variant.shadows.resize(lastLocation, shadow);
+	}
+
+	for (GLint element = 0; (bArray == true) && (element < arraySize); element++)
+	{
+		uniform.name = baseName + "[" + std::to_string(element) + "]";
+		uniform.location = location + element;
+		variant.uniformIndex[uniform.name] = (int)variant.uniforms.size();
+		variant.uniforms.push_back(uniform);
+	}
+}
+
+/***********************************************************
+ *  FindUniform()
+ *
+ *  This method is used for finding the location of a
+ *  uniform in the uniform table of the active program.
+ *  Debug builds keep any name that is not an active uniform
+ *  of any variant built so far for ReportUnknownUniforms(),
+ *  and report any handle whose type does not match the
+ *  uniform.  A type of 0 skips the type check.  Returns -1
+ *  if the uniform is not found.
+ ***********************************************************/
+GLint ShaderManager::FindUniform(const char* name, GLenum expectedType) const
+{
+	if (NULL == m_pActiveVariant)
+	{
+		return(-1);
+	}
+
+	std::unordered_map<std::string, int>::const_iterator found = m_pActiveVariant->uniformIndex.find(name);
+	if (found == m_pActiveVariant->uniformIndex.end())
+	{
+#ifdef _DEBUG
+		// a variant built later can still have the uniform active
+		if (m_builtUniformNames.count(name) == 0)
+		{
+			m_unknownUniformNames.insert(name);
+		}
+#endif
+		return(-1);
+	}
+
+	const UNIFORM_INFO& uniform = m_pActiveVariant->uniforms[found->second];
+#ifdef _DEBUG
+	// samplers are set with the int of their texture unit
+	bool bSampler = (uniform.type == GL_SAMPLER_2D) || (uniform.type == GL_SAMPLER_2D_ARRAY) ||
+		(uniform.type == GL_SAMPLER_3D) || (uniform.type == GL_SAMPLER_CUBE) ||
+		(uniform.type == GL_SAMPLER_2D_SHADOW) || (uniform.type == GL_SAMPLER_BUFFER) ||
+		(uniform.type == GL_INT_SAMPLER_BUFFER) || (uniform.type == GL_UNSIGNED_INT_SAMPLER_BUFFER);
+	if ((expectedType != 0) && (uniform.type != expectedType) &&
+		!((expectedType == GL_INT) && (bSampler == true)))
+	{
+		std::cerr << "Shader uniform " << name << " has type 0x" << std::hex << uniform.type
+			<< ", not 0x" << expectedType << std::dec << std::endl;
+	}
+#else
+	(void)expectedType;
+#endif
+
+	return(uniform.location);
+}
+
+/***********************************************************
+ *  UpdateShadow()
+ *
+ *  This method is used for comparing a value about to be
+ *  set into a uniform location of the active program with
+ *  the value set into it before.  A changed value is kept
+ *  and true is returned so it is sent.  A value the program
+ *  already holds, or a location of -1 for a uniform the
+ *  program does not use, returns false so no call is made.
+ ***********************************************************/
+bool ShaderManager::UpdateShadow(GLint location, const void* pValue, size_t size)
+{
+	if (location < 0)
+	{
+		g_UniformStats.skipped++;
+		return(false);
+	}
+	if ((NULL == m_pActiveVariant) || (location >= (GLint)m_pActiveVariant->shadows.size()))
+	{
+		g_UniformStats.uploads++;
+		return(true);
+	}
+
+	UNIFORM_SHADOW& shadow = m_pActiveVariant->shadows[location];
+	if ((shadow.bValid == true) && (memcmp(shadow.value, pValue, size) == 0))
+	{
+		g_UniformStats.skipped++;
+		return(false);
+	}
+	memcpy(shadow.value, pValue, size);
+	shadow.bValid = true;
+	g_UniformStats.uploads++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetUniformStats()
+ *
+ *  This method is used for getting the number of uniform
+ *  values sent to OpenGL and skipped by every shader
+ *  manager so far.
+ ***********************************************************/
+const UNIFORM_UPLOAD_STATS& ShaderManager::GetUniformStats()
+{
+	return(g_UniformStats);
+}
+
+/***********************************************************
+ *  use()
+ *
+ *  This method is used for making the shader program the
+ *  active program for the following draw calls.
+ ***********************************************************/
+void ShaderManager::use()
+{
+	RenderState::UseProgram(m_programID);
+}
+
+/***********************************************************
+ *  setBoolValue()
+ *
+ *  This method is used for setting a bool uniform variable.
+ ***********************************************************/
+void ShaderManager::setBoolValue(const std::string& name, bool value)
+{
+	SetIntUniform(FindUniform(name.c_str(), 0), (int)value);
+}
+
+/***********************************************************
+ *  setIntValue()
+ *
+ *  This method is used for setting an int uniform variable.
+ ***********************************************************/
+void ShaderManager::setIntValue(const std::string& name, int value)
+{
+	SetIntUniform(FindUniform(name.c_str(), 0), value);
+}
+
+/***********************************************************
+ *  setSampler2DValue()
+ *
+ *  This method is used for setting the texture unit of a
+ *  sampler uniform variable.
+ ***********************************************************/
+void ShaderManager::setSampler2DValue(const std::string& name, int value)
+{
+	SetIntUniform(FindUniform(name.c_str(), 0), value);
+}
+
+/***********************************************************
+ *  setFloatValue()
+ *
+ *  This method is used for setting a float uniform variable.
+ ***********************************************************/
+void ShaderManager::setFloatValue(const std::string& name, float value)
+{
+	ShaderUniform<float> uniform;
+	uniform.location = FindUniform(name.c_str(), 0);
+	setValue(uniform, value);
+}
+
+/***********************************************************
+ *  setVec2Value()
+ *
+ *  This method is used for setting a vec2 uniform variable.
+ ***********************************************************/
+void ShaderManager::setVec2Value(const std::string& name, const glm::vec2& value)
+{
+	ShaderUniform<glm::vec2> uniform;
+	uniform.location = FindUniform(name.c_str(), 0);
+	setValue(uniform, value);
+}
+
+/***********************************************************
+ *  setVec3Value()
+ *
+ *  This method is used for setting a vec3 uniform variable.
+ ***********************************************************/
+void ShaderManager::setVec3Value(const std::string& name, const glm::vec3& value)
+{
+	ShaderUniform<glm::vec3> uniform;
+	uniform.location = FindUniform(name.c_str(), 0);
+	setValue(uniform, value);
+}
+
+/***********************************************************
+ *  setVec3Value()
+ *
+ *  This method is used for setting a vec3 uniform variable
+ *  from its separate components.
+ ***********************************************************/
+void ShaderManager::setVec3Value(const std::string& name, float x, float y, float z)
+{
+	setVec3Value(name, glm::vec3(x, y, z));
+}
+
+/***********************************************************
+ *  setVec4Value()
+ *
+ *  This method is used for setting a vec4 uniform variable.
+ ***********************************************************/
+void ShaderManager::setVec4Value(const std::string& name, const glm::vec4& value)
+{
+	ShaderUniform<glm::vec4> uniform;
+	uniform.location = FindUniform(name.c_str(), 0);
+	setValue(uniform, value);
+}
+
+/***********************************************************
+ *  setMat4Value()
+ *
+ *  This method is used for setting a mat4 uniform variable.
+ ***********************************************************/
+void ShaderManager::setMat4Value(const std::string& name, const glm::mat4& value)
+{
+	ShaderUniform<glm::mat4> uniform;
+	uniform.location = FindUniform(name.c_str(), 0);
+	setValue(uniform, value);
+}
@@ -0,0 +1,351 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadermanager.h
+// ============
+// manage the loading and setting of shader code
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ProgramBinaryCache.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <string>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  SHADER_RELOAD_STATE
+ *
+ *  The progress of a reload of the shader sources.
+ ***********************************************************/
+enum SHADER_RELOAD_STATE
+{
+	// no reload is running
+	SHADER_RELOAD_NONE,
+	// the new programs are still being compiled and linked
+	SHADER_RELOAD_PENDING,
+	// the new programs replaced the old ones
+	SHADER_RELOAD_DONE,
+	// a new program failed to build and the old ones are kept
+	SHADER_RELOAD_FAILED
+};
+
+/***********************************************************
+ *  UNIFORM_UPLOAD_STATS
+ *
+ *  Counts of the uniform values set by every shader manager.
+ ***********************************************************/
+struct UNIFORM_UPLOAD_STATS
+{
+	// values sent to OpenGL
+	int uploads;
+	// values not sent, since the program already held them or
+	// does not use the uniform
+	int skipped;
+};
+
+/***********************************************************
+ *  ShaderUniform
+ *
+ *  The location of a uniform variable, resolved once from
+ *  the shader program and typed by the value it is set
+ *  with, so setting it needs no name lookup.  The location
+ *  is -1 for a uniform the program does not use, which
+ *  OpenGL ignores.
+ ***********************************************************/
+template <typename T>
+struct ShaderUniform
+{
+	GLint location;
+
+	ShaderUniform() : location(-1) {}
+};
+
+/***********************************************************
+ *  ShaderManager
+ *
+ *  This class compiles and links the vertex and fragment
+ *  shaders into a shader program, and sets the values of
+ *  the uniform variables used by the shader code.  The
+ *  same sources can be built into variants, specialized
+ *  programs whose defines are taken from the fields of a
+ *  variant key, each compiled the first time it is used.
+ *  The value last set into each uniform of each program is
+ *  kept, and setting the same value again sends nothing.
+ ***********************************************************/
+class ShaderManager
+{
+public:
+	// constructor
+	ShaderManager();
+	// destructor
+	~ShaderManager();
+
+	// load, compile and link the shader program from GLSL files
+	GLuint LoadShaders(const char* vertexShaderFile, const char* fragmentShaderFile);
+	// compile and link the shader program from GLSL source text in memory
+	GLuint LoadShaderSources(
+		const char* vertexSource, size_t vertexLength,
+		const char* fragmentSource, size_t fragmentLength);
+	// make the shader program the active program
+	void use();
+	// start compiling the shader files again in the background, into
+	// every variant built so far, while the current programs keep drawing
+	bool BeginReloadShaders(const char* vertexShaderFile, const char* fragmentShaderFile);
+	void BeginReload(const std::string& vertexSource, const std::string& fragmentSource);
+	// advance the running reload without waiting on the driver, and swap
+	// in the new programs once every one of them has linked
+	SHADER_RELOAD_STATE UpdateReload();
+	// check whether a reload is running
+	bool IsReloading() const { return(m_reloadPrograms.empty() == false); }
+	// get a number that changes whenever the programs are replaced, so
+	// anything resolved from them can be resolved again
+	unsigned int GetProgramGeneration() const { return(m_programGeneration); }
+	// define a preprocessor constant in every shader compiled from now on,
+	// such as a limit that depends on the context
+	void SetDefine(const std::string& name, int value);
+	// load the programs from the passed in binary cache when it holds
+	// them, and store the ones compiled into it
+	void SetProgramCache(ProgramBinaryCache* pProgramCache) { m_pProgramCache = pProgramCache; }
+	// define a preprocessor constant whose value is a field of the
+	// variant key, the bits from the first one passed in, and 0 in the
+	// loaded program, which is the variant of key 0
+	void AddVariantDefine(const std::string& name, int firstBit, int bitCount);
+	// make the variant of the passed in key the active program, compiling
+	// it the first time, returns its program or 0 if it failed to build
+	GLuint UseVariant(unsigned int key);
+	// get the number of variants built from the loaded sources
+	int GetVariantCount() const { return (int)m_variants.size(); }
+	// get the number of active uniform variables of the active program
+	int GetUniformCount() const { return (NULL != m_pActiveVariant) ? (int)m_pActiveVariant->uniforms.size() : 0; }
+	// read a uniform block from the buffer bound to the passed in binding
+	// point, in every variant, returns false if the active program has
+	// no such block
+	bool BindUniformBlock(const char* blockName, GLuint bindingPoint);
+
+	// get the typed handle of a uniform variable of the active program -
+	// resolve the handles again whenever the program is reloaded
+	template <typename T>
+	ShaderUniform<T> GetUniform(const char* name) const
+	{
+		ShaderUniform<T> uniform;
+		uniform.location = FindUniform(name, GetUniformType((const T*)NULL));
+		return(uniform);
+	}
+
+	// set the values of the uniform variables through their handles,
+	// unless the active program already holds them
+	void setValue(ShaderUniform<bool> uniform, bool value) { SetIntUniform(uniform.location, (int)value); }
+	void setValue(ShaderUniform<int> uniform, int value) { SetIntUniform(uniform.location, value); }
+	void setValue(ShaderUniform<float> uniform, float value)
+	{
+		if (UpdateShadow(uniform.location, &value, sizeof(value)) == true)
+		{
+			glUniform1f(uniform.location, value);
+		}
+	}
+	void setValue(ShaderUniform<glm::vec2> uniform, const glm::vec2& value)
+	{
+		if (UpdateShadow(uniform.location, &value, sizeof(value)) == true)
+		{
+			glUniform2f(uniform.location, value.x, value.y);
+		}
+	}
+	void setValue(ShaderUniform<glm::vec3> uniform, const glm::vec3& value)
+	{
+		if (UpdateShadow(uniform.location, &value, sizeof(value)) == true)
+		{
+			glUniform3f(uniform.location, value.x, value.y, value.z);
+		}
+	}
+	void setValue(ShaderUniform<glm::vec4> uniform, const glm::vec4& value)
+	{
+		if (UpdateShadow(uniform.location, &value, sizeof(value)) == true)
+		{
+			glUniform4f(uniform.location, value.x, value.y, value.z, value.w);
+		}
+	}
+	void setValue(ShaderUniform<glm::mat3> uniform, const glm::mat3& value)
+	{
+		if (UpdateShadow(uniform.location, &value, sizeof(value)) == true)
+		{
+			glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &value[0][0]);
+		}
+	}
+	void setValue(ShaderUniform<glm::mat4> uniform, const glm::mat4& value)
+	{
+		if (UpdateShadow(uniform.location, &value, sizeof(value)) == true)
+		{
+			glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &value[0][0]);
+		}
+	}
+
+	// set the values of the shader uniform variables by name, looked up
+	// in the uniform table on every call
+	void setBoolValue(const std::string& name, bool value);
+	void setIntValue(const std::string& name, int value);
+	void setSampler2DValue(const std::string& name, int value);
+	void setFloatValue(const std::string& name, float value);
+	void setVec2Value(const std::string& name, const glm::vec2& value);
+	void setVec3Value(const std::string& name, const glm::vec3& value);
+	void setVec3Value(const std::string& name, float x, float y, float z);
+	void setVec4Value(const std::string& name, const glm::vec4& value);
+	void setMat4Value(const std::string& name, const glm::mat4& value);
+
+	// get the number of uniform values sent and skipped by every shader
+	// manager so far
+	static const UNIFORM_UPLOAD_STATS& GetUniformStats();
+
+	// the active shader program
+	GLuint m_programID;
+
+private:
+	struct UNIFORM_INFO
+	{
+		std::string name;
+		GLint location;
+		GLenum type;
+	};
+
+	// the value last set into a uniform location, large enough for a
+	// mat4, and whether any value was set yet
+	struct UNIFORM_SHADOW
+	{
+		bool bValid;
+		GLfloat value[16];
+	};
+
+	// a program linked from the sources, its active uniforms with their
+	// index by name, and the values set into them by location
+	struct PROGRAM_VARIANT
+	{
+		GLuint programID;
+		std::vector<UNIFORM_INFO> uniforms;
+		std::unordered_map<std::string, int> uniformIndex;
+		std::vector<UNIFORM_SHADOW> shadows;
+	};
+
+	// a define whose value is taken from bits of the variant key
+	struct VARIANT_DEFINE
+	{
+		std::string name;
+		int firstBit;
+		int bitCount;
+	};
+
+	// a variant being rebuilt from reloaded sources, and the step it is at
+	enum RELOAD_STEP
+	{
+		RELOAD_STEP_START,
+		RELOAD_STEP_COMPILE,
+		RELOAD_STEP_LINK,
+		RELOAD_STEP_DONE
+	};
+	struct RELOAD_PROGRAM
+	{
+		unsigned int key;
+		GLuint vertexShaderID;
+		GLuint fragmentShaderID;
+		GLuint programID;
+		RELOAD_STEP step;
+		// when its stages were handed to the driver, and the time the
+		// steps so far blocked on it, to store with its binary
+		std::chrono::steady_clock::time_point submitTime;
+		double compileTimeMs;
+	};
+
+	// load the variant of the passed in key from the program cache, or
+	// compile and link it from the sources, returns 0 on failure
+	GLuint BuildProgram(unsigned int key) const;
+	// point the uniform blocks of a new program at their binding points
+	void ApplyBlockBindings(GLuint programID) const;
+	// move a variant being rebuilt on to its next step, returns 1 if it
+	// moved on, 0 if it waits on the driver and -1 on failure
+	int AdvanceReload(RELOAD_PROGRAM& program);
+	// drop the running reload and free what it built
+	void CancelReload();
+	// delete the programs of every variant
+	void DestroyVariants();
+	// read every active uniform variable of a linked program into its table
+	void ReflectUniforms(PROGRAM_VARIANT& variant);
+	// report the uniform names looked up that no built variant has active
+	void ReportUnknownUniforms();
+	// add a reflected uniform, and each element of a uniform array
+	static void AddUniform(PROGRAM_VARIANT& variant, const std::string& name, GLint location, GLenum type,
+		GLint arraySize);
+	// find the location of a uniform, checking its type in debug builds
+	GLint FindUniform(const char* name, GLenum expectedType) const;
+	// keep the passed in value as the one set into a location of the
+	// active program, returns false if it already held it
+	bool UpdateShadow(GLint location, const void* pValue, size_t size);
+	// set an int or sampler uniform unless it already holds the value
+	void SetIntUniform(GLint location, int value)
+	{
+		if (UpdateShadow(location, &value, sizeof(value)) == true)
+		{
+			glUniform1i(location, value);
+		}
+	}
+	// get the uniform type set through a typed handle
+	static GLenum GetUniformType(const bool*) { return(GL_BOOL); }
+	static GLenum GetUniformType(const int*) { return(GL_INT); }
+	static GLenum GetUniformType(const float*) { return(GL_FLOAT); }
+	static GLenum GetUniformType(const glm::vec2*) { return(GL_FLOAT_VEC2); }
+	static GLenum GetUniformType(const glm::vec3*) { return(GL_FLOAT_VEC3); }
+	static GLenum GetUniformType(const glm::vec4*) { return(GL_FLOAT_VEC4); }
+	static GLenum GetUniformType(const glm::mat3*) { return(GL_FLOAT_MAT3); }
+	static GLenum GetUniformType(const glm::mat4*) { return(GL_FLOAT_MAT4); }
+
+	// get the define lines of the variant of the passed in key
+	std::string GetDefines(unsigned int key) const;
+	// start compiling a single shader stage with the passed in define lines
+	GLuint StartShader(GLenum type, const std::string& source, const std::string& defines) const;
+	// check whether a shader stage compiled, printing its log if not
+	bool CheckShader(GLuint shaderID, unsigned int key, const char* stageName) const;
+	// start linking two compiled shader stages into a program
+	GLuint StartProgram(GLuint vertexShaderID, GLuint fragmentShaderID) const;
+	// free the shader stages of a program and check whether it linked,
+	// deleting it if not
+	bool CheckProgram(GLuint programID, GLuint vertexShaderID, GLuint fragmentShaderID, unsigned int key) const;
+	// read the whole contents of a text file
+	static bool ReadTextFile(const char* filename, std::string& contents);
+
+	// the loaded sources every variant is built from
+	std::string m_vertexSource;
+	std::string m_fragmentSource;
+	// the variants built so far by key, with a program of 0 for a
+	// variant that failed to build, and the active one
+	std::map<unsigned int, PROGRAM_VARIANT> m_variants;
+	PROGRAM_VARIANT* m_pActiveVariant;
+	unsigned int m_activeKey;
+	// preprocessor constants inserted after the version line of each shader
+	std::map<std::string, int> m_defines;
+	// preprocessor constants inserted after those, set from the variant key
+	std::vector<VARIANT_DEFINE> m_variantDefines;
+	// uniform block binding points applied to every variant
+	std::map<std::string, GLuint> m_blockBindings;
+	// cache of linked program binaries, NULL to always compile
+	ProgramBinaryCache* m_pProgramCache;
+	// variants being rebuilt by the running reload and the sources
+	// they are built from
+	std::vector<RELOAD_PROGRAM> m_reloadPrograms;
+	std::string m_reloadVertexSource;
+	std::string m_reloadFragmentSource;
+	// whether the driver compiles on threads of its own, checked once
+	bool m_bParallelCompile;
+	bool m_bParallelCompileChecked;
+	// changes whenever the programs are replaced
+	unsigned int m_programGeneration;
+	// names of the active uniforms of every variant built so far, and
+	// the names looked up that none of them had when they were looked up
+	std::set<std::string> m_builtUniformNames;
+	mutable std::set<std::string> m_unknownUniformNames;
+};
@@ -0,0 +1,305 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.cpp
+// ============
+// store decoded textures with their mip chains in a GPU-ready disk cache
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCache.h"
+#include "BlockCompressor.h"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// declaration of the cache file layout and helper functions
+namespace
+{
+	// identifies a texture cache file
+	const char g_CacheMagic[4] = { 'G', 'T', 'E', 'X' };
+	// bump whenever the layout or the mip generation changes
+	const uint32_t g_CacheVersion = 1;
+	// alignment of the texel data of each mip level in the file
+	const size_t g_LevelAlignment = 16;
+
+	struct CACHE_FILE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+		uint32_t width;
+		uint32_t height;
+		uint32_t colorChannels;
+		uint32_t internalFormat;
+		uint32_t levelCount;
+		uint32_t reserved;
+	};
+
+	struct CACHE_FILE_LEVEL
+	{
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// round a file offset up to the level alignment
+	size_t AlignOffset(size_t offset)
+	{
+		return((offset + g_LevelAlignment - 1) & ~(g_LevelAlignment - 1));
+	}
+
+	// create every directory in the passed in path that does not exist yet
+	void CreateDirectories(const std::string& path)
+	{
+		for (size_t i = 1; i <= path.size(); i++)
+		{
+			if ((i == path.size()) || (path[i] == '/') || (path[i] == '\\'))
+			{
+				std::string directory = path.substr(0, i);
+#ifdef _WIN32
+				_mkdir(directory.c_str());
+#else
+				mkdir(directory.c_str(), 0755);
+#endif
+			}
+		}
+	}
+
+	// move the completed file over the previous one in a single step,
+	// so a load finds either the old file or the new one, never none
+	bool MoveOverFile(const std::string& source, const std::string& destination)
+	{
+#ifdef _WIN32
+		return(MoveFileExA(source.c_str(), destination.c_str(), MOVEFILE_REPLACE_EXISTING) != 0);
+#else
+		return(rename(source.c_str(), destination.c_str()) == 0);
+#endif
+	}
+}
+
+/***********************************************************
+ *  TextureCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureCache::TextureCache(const char* directory)
+{
+	m_directory = directory;
+	m_pAssetPack = NULL;
+}
+
+/***********************************************************
+ *  HashData()
+ *
+ *  This method is used for calculating the 64-bit FNV-1a
+ *  hash of the passed in source file contents.
+ ***********************************************************/
+uint64_t TextureCache::HashData(const unsigned char* pData, size_t size)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= pData[i];
+		hash *= 1099511628211ULL;
+	}
+	return(hash);
+}
+
+/***********************************************************
+ *  HashCombine()
+ *
+ *  This method is used for mixing another value, such as a
+ *  processing setting, into an existing hash.
+ ***********************************************************/
+uint64_t TextureCache::HashCombine(uint64_t hash, uint64_t value)
+{
+	unsigned char bytes[16];
+	memcpy(bytes, &hash, sizeof(hash));
+	memcpy(bytes + sizeof(hash), &value, sizeof(value));
+	return(HashData(bytes, sizeof(bytes)));
+}
+
+/***********************************************************
+ *  GetCacheFilename()
+ *
+ *  This method is used for getting the name of the cache
+ *  file that belongs to the passed in source hash.
+ ***********************************************************/
+std::string TextureCache::GetCacheFilename(uint64_t sourceHash) const
+{
+	char hashText[17];
+	snprintf(hashText, sizeof(hashText), "%016llx", (unsigned long long)sourceHash);
+	return(m_directory + "/" + hashText + ".gtex");
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for mapping the cached image that
+ *  belongs to the passed in source hash, from the asset
+ *  pack when it holds the cache file.  The mip levels of
+ *  the returned image point straight into the mapped file.
+ *  Returns false if there is no valid cache file.
+ ***********************************************************/
+bool TextureCache::Load(uint64_t sourceHash, TEXTURE_IMAGE& image) const
+{
+	std::string filename = GetCacheFilename(sourceHash);
+	std::unique_ptr<MappedFile> pMappedFile;
+	const unsigned char* pData = NULL;
+	size_t fileSize = 0;
+
+	// a cache file in the asset pack is read in place, without opening
+	// a file of its own
+	if ((m_pAssetPack == NULL) || (m_pAssetPack->Find(filename.c_str(), pData, fileSize) == false))
+	{
+		pMappedFile.reset(new MappedFile());
+		if (pMappedFile->Open(filename.c_str()) == false)
+		{
+			return(false);
+		}
+		pData = pMappedFile->GetData();
+		fileSize = pMappedFile->GetSize();
+	}
+
+	// validate the header before trusting any of the sizes in it
+	CACHE_FILE_HEADER header;
+	if (fileSize < sizeof(header))
+	{
+		return(false);
+	}
+	memcpy(&header, pData, sizeof(header));
+
+	if ((memcmp(header.magic, g_CacheMagic, sizeof(g_CacheMagic)) != 0) ||
+		(header.version != g_CacheVersion) ||
+		(header.sourceHash != sourceHash) ||
+		((header.colorChannels != 3) && (header.colorChannels != 4)) ||
+		(header.levelCount == 0) || (header.levelCount > 32) ||
+		(fileSize < sizeof(header) + header.levelCount * sizeof(CACHE_FILE_LEVEL)))
+	{
+		std::cout << "Ignoring invalid texture cache file: " << filename << std::endl;
+		return(false);
+	}
+
+	image.width = (int)header.width;
+	image.height = (int)header.height;
+	image.colorChannels = (int)header.colorChannels;
+	image.internalFormat = header.internalFormat;
+	image.mips.clear();
+
+	for (uint32_t level = 0; level < header.levelCount; level++)
+	{
+		CACHE_FILE_LEVEL fileLevel;
+		memcpy(&fileLevel, pData + sizeof(header) + level * sizeof(fileLevel), sizeof(fileLevel));
+
+		if ((fileLevel.offset > fileSize) || (fileLevel.size > fileSize - fileLevel.offset) ||
+			(fileLevel.size != BlockCompressor::GetLevelSize(header.internalFormat,
+				(int)fileLevel.width, (int)fileLevel.height, (int)header.colorChannels)))
+		{
+			std::cout << "Ignoring truncated texture cache file: " << filename << std::endl;
+			return(false);
+		}
+
+		TEXTURE_MIP_LEVEL mip;
+		mip.width = (int)fileLevel.width;
+		mip.height = (int)fileLevel.height;
+		mip.offset = (size_t)fileLevel.offset;
+		mip.size = (size_t)fileLevel.size;
+		image.mips.push_back(mip);
+	}
+
+	image.pData = pData;
+	image.pixels.clear();
+	image.pMappedFile = std::move(pMappedFile);
+	image.bFromCache = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Store()
+ *
+ *  This method is used for writing the passed in image and
+ *  all of its mip levels into the cache file that belongs
+ *  to the source hash.  The file is written under a
+ *  temporary name first so a partly written file is never
+ *  picked up by a later load.
+ ***********************************************************/
+bool TextureCache::Store(uint64_t sourceHash, const TEXTURE_IMAGE& image) const
+{
+	CreateDirectories(m_directory);
+
+	std::string filename = GetCacheFilename(sourceHash);
+	std::string tempFilename = filename + "." +
+		std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+	FILE* pFile = fopen(tempFilename.c_str(), "wb");
+	if (pFile == NULL)
+	{
+		return(false);
+	}
+
+	CACHE_FILE_HEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, g_CacheMagic, sizeof(g_CacheMagic));
+	header.version = g_CacheVersion;
+	header.sourceHash = sourceHash;
+	header.width = (uint32_t)image.width;
+	header.height = (uint32_t)image.height;
+	header.colorChannels = (uint32_t)image.colorChannels;
+	header.internalFormat = (uint32_t)image.internalFormat;
+	header.levelCount = (uint32_t)image.mips.size();
+
+	bool bSuccess = (fwrite(&header, sizeof(header), 1, pFile) == 1);
+
+	// the level table is followed by the aligned texel data of each level
+	size_t offset = AlignOffset(sizeof(header) + image.mips.size() * sizeof(CACHE_FILE_LEVEL));
+	std::vector<size_t> levelOffsets;
+	for (size_t level = 0; level < image.mips.size(); level++)
+	{
+		CACHE_FILE_LEVEL fileLevel;
+		fileLevel.width = (uint32_t)image.mips[level].width;
+		fileLevel.height = (uint32_t)image.mips[level].height;
+		fileLevel.offset = offset;
+		fileLevel.size = image.mips[level].size;
+		bSuccess = bSuccess && (fwrite(&fileLevel, sizeof(fileLevel), 1, pFile) == 1);
+
+		levelOffsets.push_back(offset);
+		offset = AlignOffset(offset + image.mips[level].size);
+	}
+
+	const unsigned char padding[g_LevelAlignment] = { 0 };
+	size_t written = sizeof(header) + image.mips.size() * sizeof(CACHE_FILE_LEVEL);
+	for (size_t level = 0; (level < image.mips.size()) && bSuccess; level++)
+	{
+		size_t paddingSize = levelOffsets[level] - written;
+		bSuccess = (fwrite(padding, 1, paddingSize, pFile) == paddingSize);
+		bSuccess = bSuccess && (fwrite(image.pData + image.mips[level].offset, 1,
+			image.mips[level].size, pFile) == image.mips[level].size);
+		written = levelOffsets[level] + image.mips[level].size;
+	}
+
+	bSuccess = (fclose(pFile) == 0) && bSuccess;
+
+	// replace any previous cache file with the completed one
+	if ((bSuccess == false) || (MoveOverFile(tempFilename, filename) == false))
+	{
+		remove(tempFilename.c_str());
+		return(false);
+	}
+
+	return(true);
+}
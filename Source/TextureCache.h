@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.h
+// ============
+// store decoded textures with their mip chains in a GPU-ready disk cache
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "AssetPack.h"
+#include "MappedFile.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TEXTURE_MIP_LEVEL
+ *
+ *  The size and location of one mip level in the pixel
+ *  data of a texture image.
+ ***********************************************************/
+struct TEXTURE_MIP_LEVEL
+{
+	int width;
+	int height;
+	size_t offset;
+	size_t size;
+};
+
+/***********************************************************
+ *  TEXTURE_IMAGE
+ *
+ *  A texture image with its complete mip chain, either
+ *  decoded into memory or mapped from the texture cache.
+ ***********************************************************/
+struct TEXTURE_IMAGE
+{
+	int width;
+	int height;
+	int colorChannels;
+	// OpenGL internal format of the texels
+	GLenum internalFormat;
+	// every mip level, largest level first
+	std::vector<TEXTURE_MIP_LEVEL> mips;
+	// pixel data for all of the mip levels - points into either
+	// the decoded pixels or the mapped cache file
+	const unsigned char* pData;
+	// decoded pixel storage
+	std::vector<unsigned char> pixels;
+	// mapped cache file storage, NULL when the pixel data is
+	// decoded or lives in the asset pack
+	std::unique_ptr<MappedFile> pMappedFile;
+	// true when the image was read from the texture cache
+	bool bFromCache;
+};
+
+/***********************************************************
+ *  TextureCache
+ *
+ *  This class stores decoded texture images, including every
+ *  mip level, in a directory of cache files keyed by a hash
+ *  of the source image file contents.  A cached image is
+ *  read back with a single memory mapping, so there is no
+ *  image decoding or mipmap generation on a cache hit.
+ ***********************************************************/
+class TextureCache
+{
+public:
+	// constructor
+	TextureCache(const char* directory);
+
+	// hash the contents of a source image file
+	static uint64_t HashData(const unsigned char* pData, size_t size);
+	// combine a hash with another value into a new hash
+	static uint64_t HashCombine(uint64_t hash, uint64_t value);
+
+	// map the cached image for the passed in source hash
+	bool Load(uint64_t sourceHash, TEXTURE_IMAGE& image) const;
+	// write an image and its mip chain into the cache
+	bool Store(uint64_t sourceHash, const TEXTURE_IMAGE& image) const;
+	// set the asset pack searched for cache files before the directory
+	void SetAssetPack(AssetPack* pAssetPack) { m_pAssetPack = pAssetPack; }
+
+private:
+	// directory that holds the cache files
+	std::string m_directory;
+	// asset pack that may hold cache files, NULL if none
+	AssetPack* m_pAssetPack;
+
+	// get the cache filename for the passed in source hash
+	std::string GetCacheFilename(uint64_t sourceHash) const;
+};
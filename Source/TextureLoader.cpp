@@ -0,0 +1,1090 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.cpp
+// ============
+// decode texture images on worker threads and stream them to OpenGL
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureLoader.h"
+#include "BlockCompressor.h"
+#include "GLResources.h"
+#include "ImageDecoder.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables and helper functions
+namespace
+{
+	// mixed into the cache key of block compressed images
+	const uint64_t g_BlockCompressedCacheKey = 0x4243;
+	// mixed into the cache key of images scaled down while decoding,
+	// together with the scale
+	const uint64_t g_DecodeScaleCacheKey = 0x5300;
+
+	// get a steady timestamp in milliseconds for the load timings
+	double GetTimeMs()
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// resample the rows or columns of an image along one axis - the
+	// samples are averaged when shrinking and interpolated when growing
+	void ResampleAxis(
+		const unsigned char* source, int sourceLength,
+		unsigned char* destination, int length,
+		int lineCount, int sourceLineStride, int lineStride,
+		int sourceStep, int step, int colorChannels)
+	{
+		double scale = (double)sourceLength / length;
+		for (int line = 0; line < lineCount; line++)
+		{
+			const unsigned char* sourceLine = source + (size_t)line * sourceLineStride;
+			unsigned char* destinationLine = destination + (size_t)line * lineStride;
+			for (int i = 0; i < length; i++)
+			{
+				for (int c = 0; c < colorChannels; c++)
+				{
+					double value = 0.0;
+					if (scale > 1.0)
+					{
+						int first = (int)(i * scale);
+						int last = std::min(sourceLength, std::max(first + 1, (int)((i + 1) * scale)));
+						for (int j = first; j < last; j++)
+						{
+							value += sourceLine[(size_t)j * sourceStep + c];
+						}
+						value /= (last - first);
+					}
+					else
+					{
+						double position = std::max(0.0, (i + 0.5) * scale - 0.5);
+						int first = std::min((int)position, sourceLength - 1);
+						int second = std::min(first + 1, sourceLength - 1);
+						double weight = position - first;
+						value = sourceLine[(size_t)first * sourceStep + c] * (1.0 - weight) +
+							sourceLine[(size_t)second * sourceStep + c] * weight;
+					}
+					destinationLine[(size_t)i * step + c] = (unsigned char)(value + 0.5);
+				}
+			}
+		}
+	}
+
+	// downsample one mip level into the next smaller level with a 2x2 box filter
+	void DownsampleMipLevel(
+		const unsigned char* source, int sourceWidth, int sourceHeight,
+		unsigned char* destination, int width, int height,
+		int colorChannels)
+	{
+		for (int y = 0; y < height; y++)
+		{
+			int y0 = std::min(y * 2, sourceHeight - 1);
+			int y1 = std::min(y * 2 + 1, sourceHeight - 1);
+			for (int x = 0; x < width; x++)
+			{
+				int x0 = std::min(x * 2, sourceWidth - 1);
+				int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+				for (int c = 0; c < colorChannels; c++)
+				{
+					int sum =
+						source[(y0 * sourceWidth + x0) * colorChannels + c] +
+						source[(y0 * sourceWidth + x1) * colorChannels + c] +
+						source[(y1 * sourceWidth + x0) * colorChannels + c] +
+						source[(y1 * sourceWidth + x1) * colorChannels + c];
+					destination[(y * width + x) * colorChannels + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  TextureLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureLoader::TextureLoader()
+	: m_textureCache("cache/textures")
+{
+	m_pAssetPack = NULL;
+	m_cacheHits = 0;
+	m_totalDecodeMs = 0.0;
+	m_bCompressTextures = false;
+	m_decodeScale = 1;
+	m_bDecodeOnly = false;
+	m_totalTextureBytes = 0;
+	m_totalUncompressedBytes = 0;
+	m_bStopWorkers = false;
+	m_startedJobs = 0;
+	m_bCancel = false;
+	m_finishedJobs = 0;
+	m_pixelBuffers[0] = 0;
+	m_pixelBuffers[1] = 0;
+	m_nextPixelBuffer = 0;
+	m_startTime = 0.0;
+	m_bLoadReported = false;
+}
+
+/***********************************************************
+ *  ~TextureLoader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureLoader::~TextureLoader()
+{
+	// stop any decoding that is still in progress
+	m_bCancel = true;
+	JoinWorkers();
+
+	if (m_pixelBuffers[0] != 0)
+	{
+		glDeleteBuffers(2, m_pixelBuffers);
+		m_pixelBuffers[0] = 0;
+		m_pixelBuffers[1] = 0;
+	}
+}
+
+/***********************************************************
+ *  QueueTexture()
+ *
+ *  This method is used for queueing an image file to be
+ *  decoded and loaded into the passed in OpenGL texture.
+ ***********************************************************/
+void TextureLoader::QueueTexture(const char* filename, GLuint textureID)
+{
+	std::unique_ptr<LOAD_JOB> job(new LOAD_JOB());
+	job->filename = filename;
+	job->textureID = textureID;
+	job->target = GL_TEXTURE_2D;
+	job->layer = -1;
+	job->layerWidth = 0;
+	job->layerHeight = 0;
+	job->bCompress = m_bCompressTextures;
+	job->decodeScale = m_decodeScale;
+	job->bShareDuplicates = true;
+	job->image.width = 0;
+	job->image.height = 0;
+	job->image.colorChannels = 0;
+	job->image.internalFormat = GL_RGB8;
+	job->image.pData = NULL;
+	job->image.bFromCache = false;
+	job->duplicateOfJob = -1;
+	job->nextUploadLevel = -1;
+	job->bFailed = false;
+	job->decodeMs = 0.0;
+	job->uploadMs = 0.0;
+	job->textureBytes = 0;
+	job->uncompressedBytes = 0;
+
+	// the workers may be looking up their jobs in the list meanwhile
+	std::lock_guard<std::mutex> lock(m_decodeMutex);
+	m_jobs.push_back(std::move(job));
+}
+
+/***********************************************************
+ *  QueueTextureLayer()
+ *
+ *  This method is used for queueing an image file to be
+ *  decoded and loaded into one layer of an OpenGL texture
+ *  array with layers of the passed in size.  The layers are
+ *  meant to hold images of that size as GetImageSize()
+ *  reports it, which are only expanded to RGBA; any other
+ *  image is resampled to fit.  The texture array storage
+ *  must already be allocated, in the format returned by
+ *  GetTextureLayerFormat().
+ ***********************************************************/
+void TextureLoader::QueueTextureLayer(const char* filename, GLuint arrayTextureID, int layer,
+	int layerWidth, int layerHeight)
+{
+	QueueTexture(filename, arrayTextureID);
+
+	LOAD_JOB& job = *m_jobs.back();
+	job.target = GL_TEXTURE_2D_ARRAY;
+	job.layer = layer;
+	job.layerWidth = layerWidth;
+	job.layerHeight = layerHeight;
+	job.decodeScale = 1;
+}
+
+/***********************************************************
+ *  ReloadTexture()
+ *
+ *  This method is used for loading an image file that was
+ *  loaded before into another texture, normally straight
+ *  from the texture cache, and starting to decode it.  It
+ *  is handed to the running workers, so it never waits on
+ *  the images they are still decoding.
+ ***********************************************************/
+void TextureLoader::ReloadTexture(const char* filename, GLuint textureID)
+{
+	QueueTexture(filename, textureID);
+	m_jobs.back()->bShareDuplicates = false;
+	StartDecoding();
+}
+
+/***********************************************************
+ *  StartDecoding()
+ *
+ *  This method is used for handing all of the newly queued
+ *  image files to the worker threads, which decode them in
+ *  parallel.  The workers are started with the first batch,
+ *  one for each hardware thread, and then wait for more, so
+ *  a later batch such as a texture reload is appended to
+ *  the jobs they are working on without waiting for them.
+ *  The load time is measured from the first batch.
+ ***********************************************************/
+void TextureLoader::StartDecoding()
+{
+	int jobsToDecode = (int)m_jobs.size() - m_startedJobs;
+	if (jobsToDecode <= 0)
+	{
+		return;
+	}
+
+	if (m_startedJobs == 0)
+	{
+		m_startTime = GetTimeMs();
+	}
+
+	if (m_workers.empty())
+	{
+		// indicate to always flip images vertically when loaded - this
+		// is set before the workers start since the stb_image setting
+		// is shared by all of them
+		stbi_set_flip_vertically_on_load(true);
+
+		// the pool is not sized to the first batch, since the workers
+		// also decode every later batch
+		int threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+		for (int i = 0; i < threadCount; i++)
+		{
+			m_workers.push_back(std::thread(&TextureLoader::DecodeWorker, this));
+		}
+	}
+
+	std::cout << "Decoding " << jobsToDecode << " textures on " << m_workers.size() << " threads" << std::endl;
+
+	{
+		std::lock_guard<std::mutex> lock(m_decodeMutex);
+		for (; m_startedJobs < (int)m_jobs.size(); m_startedJobs++)
+		{
+			m_decodeJobs.push_back(m_startedJobs);
+		}
+	}
+	m_decodeCondition.notify_all();
+}
+
+/***********************************************************
+ *  DecodeWorker()
+ *
+ *  This method is run by each worker thread to decode the
+ *  jobs handed over to it.  When none are left the worker
+ *  sleeps until more arrive, and it exits once it is told
+ *  to stop and nothing is left, or right away on cancel.
+ ***********************************************************/
+void TextureLoader::DecodeWorker()
+{
+	while (true)
+	{
+		int index = -1;
+		LOAD_JOB* pJob = NULL;
+		{
+			std::unique_lock<std::mutex> lock(m_decodeMutex);
+			m_decodeCondition.wait(lock, [this]()
+				{
+					return((m_bCancel == true) || (m_bStopWorkers == true) || (m_decodeJobs.empty() == false));
+				});
+			if ((m_bCancel == true) || (m_decodeJobs.empty() == true))
+			{
+				return;
+			}
+			index = m_decodeJobs.front();
+			m_decodeJobs.pop_front();
+			pJob = m_jobs[index].get();
+		}
+
+		LOAD_JOB& job = *pJob;
+		DecodeJob(job, index);
+
+		if (m_bDecodeOnly == true)
+		{
+			// the image is already in the cache, so it is not kept
+			std::vector<unsigned char>().swap(job.image.pixels);
+			job.image.pMappedFile.reset();
+			job.image.pData = NULL;
+		}
+		else
+		{
+			// hand the decoded image over to the render thread
+			std::lock_guard<std::mutex> lock(m_readyMutex);
+			m_readyJobs.push_back(index);
+		}
+	}
+}
+
+/***********************************************************
+ *  DecodeJob()
+ *
+ *  This method is used for reading a single image file with
+ *  its complete mipmap chain, either from the texture cache
+ *  or by decoding the image file and storing the result in
+ *  the cache for the next launch.
+ ***********************************************************/
+void TextureLoader::DecodeJob(LOAD_JOB& job, int jobIndex)
+{
+	double startTime = GetTimeMs();
+
+	// the image file is read in place from the asset pack when it
+	// holds the file, otherwise the file is mapped on its own
+	MappedFile sourceFile;
+	const unsigned char* pSource = NULL;
+	size_t sourceSize = 0;
+	if ((m_pAssetPack == NULL) || (m_pAssetPack->Find(job.filename.c_str(), pSource, sourceSize) == false))
+	{
+		if (sourceFile.Open(job.filename.c_str()) == false)
+		{
+			std::cerr << "Failed to load texture: " << job.filename << std::endl;
+			job.bFailed = true;
+			return;
+		}
+		pSource = sourceFile.GetData();
+		sourceSize = sourceFile.GetSize();
+	}
+
+	// the cache is keyed by the contents of the source file, so an
+	// edited image is decoded again even though its name is the same
+	uint64_t sourceHash = TextureCache::HashData(pSource, sourceSize);
+
+	// resampled texture array layers are cached separately from the
+	// original image, one entry for each layer size
+	if (job.target == GL_TEXTURE_2D_ARRAY)
+	{
+		sourceHash = TextureCache::HashCombine(sourceHash, (uint64_t)job.layerWidth);
+		sourceHash = TextureCache::HashCombine(sourceHash, (uint64_t)job.layerHeight);
+	}
+
+	// block compressed images are cached separately as well
+	if (job.bCompress == true)
+	{
+		sourceHash = TextureCache::HashCombine(sourceHash, g_BlockCompressedCacheKey);
+	}
+
+	// and so are images scaled down while decoding
+	if (job.decodeScale > 1)
+	{
+		sourceHash = TextureCache::HashCombine(sourceHash, g_DecodeScaleCacheKey + (uint64_t)job.decodeScale);
+	}
+
+	// an image identical to another queued image is not loaded
+	// again, it shares the texture of the other image instead
+	if (job.bShareDuplicates == true)
+	{
+		std::lock_guard<std::mutex> lock(m_hashMutex);
+		std::unordered_map<uint64_t, int>::iterator found = m_jobsByHash.find(sourceHash);
+		if (found != m_jobsByHash.end())
+		{
+			job.duplicateOfJob = found->second;
+			return;
+		}
+		m_jobsByHash[sourceHash] = jobIndex;
+	}
+
+	if (m_textureCache.Load(sourceHash, job.image) == true)
+	{
+		m_cacheHits++;
+	}
+	else if (DecodeImage(pSource, sourceSize,
+		(job.target == GL_TEXTURE_2D_ARRAY) ? GetLayerDecodeScale(pSource, sourceSize, job.layerWidth, job.layerHeight) : job.decodeScale,
+		job.image) == true)
+	{
+		if (job.target == GL_TEXTURE_2D_ARRAY)
+		{
+			ResampleImage(job.image, job.layerWidth, job.layerHeight);
+		}
+
+		if (job.bCompress == true)
+		{
+			BlockCompressor::CompressImage(job.image);
+		}
+
+		if (m_textureCache.Store(sourceHash, job.image) == false)
+		{
+			std::cout << "Unable to write texture cache for: " << job.filename << std::endl;
+		}
+	}
+	else
+	{
+		std::cerr << "Failed to load texture: " << job.filename << std::endl;
+		job.bFailed = true;
+		return;
+	}
+
+	for (size_t level = 0; level < job.image.mips.size(); level++)
+	{
+		job.textureBytes += job.image.mips[level].size;
+		job.uncompressedBytes += (size_t)job.image.mips[level].width * job.image.mips[level].height * 4;
+	}
+
+	job.decodeMs = GetTimeMs() - startTime;
+}
+
+/***********************************************************
+ *  DecodeImage()
+ *
+ *  This method is used for decoding an image file that has
+ *  been mapped into memory, scaled down by the passed in
+ *  factor, and building the complete mipmap chain for it
+ *  on the CPU.
+ ***********************************************************/
+bool TextureLoader::DecodeImage(const unsigned char* pSource, size_t sourceSize, int scale, TEXTURE_IMAGE& image)
+{
+	// try to parse the image data from the mapped image file
+	if (ImageDecoder::DecodeImage(pSource, sourceSize, scale, image) == false)
+	{
+		return(false);
+	}
+
+	if ((image.colorChannels != 3) && (image.colorChannels != 4))
+	{
+		std::cout << "Not implemented to handle image with " << image.colorChannels << " channels" << std::endl;
+		image.pixels.clear();
+		return(false);
+	}
+
+	image.internalFormat = (image.colorChannels == 4) ? GL_RGBA8 : GL_RGB8;
+	image.bFromCache = false;
+
+	BuildMipChain(image);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetLayerDecodeScale()
+ *
+ *  This method is used for getting the largest factor an
+ *  image can be scaled down by while it is decoded, without
+ *  becoming smaller than the texture array layer it will be
+ *  loaded into.  The detail a texture array layer never
+ *  shows is then not decoded at all.
+ ***********************************************************/
+int TextureLoader::GetLayerDecodeScale(const unsigned char* pSource, size_t sourceSize,
+	int layerWidth, int layerHeight)
+{
+	int width = 0;
+	int height = 0;
+	if (ImageDecoder::GetImageInfo(pSource, sourceSize, width, height) == false)
+	{
+		return(1);
+	}
+
+	for (int scale = 8; scale > 1; scale /= 2)
+	{
+		if ((ImageDecoder::GetScaledSize(width, scale) >= layerWidth) &&
+			(ImageDecoder::GetScaledSize(height, scale) >= layerHeight))
+		{
+			return(scale);
+		}
+	}
+	return(1);
+}
+
+/***********************************************************
+ *  SetDecodeScale()
+ *
+ *  This method is used for scaling the images of the
+ *  textures queued from now on down by a factor of 2, 4 or
+ *  8 while they are decoded, or 1 for full resolution.
+ *  Texture array layers pick their own scale from the layer
+ *  size instead.
+ ***********************************************************/
+void TextureLoader::SetDecodeScale(int scale)
+{
+	if ((scale != 1) && (scale != 2) && (scale != 4) && (scale != 8))
+	{
+		std::cout << "Unsupported texture decode scale: " << scale << std::endl;
+		return;
+	}
+	m_decodeScale = scale;
+}
+
+/***********************************************************
+ *  ResampleImage()
+ *
+ *  This method is used for converting the first level of an
+ *  image to an RGBA image of the passed in size, so it can
+ *  be packed into a texture array with other images, and
+ *  then rebuilding the mipmap chain.  An image that already
+ *  has the size is copied as it is.
+ ***********************************************************/
+void TextureLoader::ResampleImage(TEXTURE_IMAGE& image, int width, int height)
+{
+	const int colorChannels = 4;
+	std::vector<unsigned char> expanded;
+	const unsigned char* pSource = image.pData;
+
+	// expand RGB images to RGBA so every layer has the same format
+	if (image.colorChannels == 3)
+	{
+		size_t pixelCount = (size_t)image.width * image.height;
+		expanded.resize(pixelCount * colorChannels);
+		for (size_t i = 0; i < pixelCount; i++)
+		{
+			expanded[i * 4 + 0] = pSource[i * 3 + 0];
+			expanded[i * 4 + 1] = pSource[i * 3 + 1];
+			expanded[i * 4 + 2] = pSource[i * 3 + 2];
+			expanded[i * 4 + 3] = 255;
+		}
+		pSource = expanded.data();
+	}
+
+	// resample the rows first and then the columns
+	std::vector<unsigned char> rows((size_t)width * image.height * colorChannels);
+	ResampleAxis(pSource, image.width, rows.data(), width,
+		image.height, image.width * colorChannels, width * colorChannels,
+		colorChannels, colorChannels, colorChannels);
+
+	std::vector<unsigned char> resampled((size_t)width * height * colorChannels);
+	ResampleAxis(rows.data(), image.height, resampled.data(), height,
+		width, colorChannels, colorChannels,
+		width * colorChannels, width * colorChannels, colorChannels);
+
+	image.width = width;
+	image.height = height;
+	image.colorChannels = colorChannels;
+	image.internalFormat = GL_RGBA8;
+	image.pixels.swap(resampled);
+	image.pMappedFile.reset();
+	image.bFromCache = false;
+
+	BuildMipChain(image);
+}
+
+/***********************************************************
+ *  BuildMipChain()
+ *
+ *  This method is used for generating every mip level below
+ *  the first level of an image, which must be at the start
+ *  of the image pixels.
+ ***********************************************************/
+void TextureLoader::BuildMipChain(TEXTURE_IMAGE& image)
+{
+	// lay out all of the mip levels in a single allocation
+	size_t totalSize = 0;
+	int width = image.width;
+	int height = image.height;
+	image.mips.clear();
+	while (true)
+	{
+		TEXTURE_MIP_LEVEL mip;
+		mip.width = width;
+		mip.height = height;
+		mip.offset = totalSize;
+		mip.size = (size_t)width * height * image.colorChannels;
+		image.mips.push_back(mip);
+		totalSize += mip.size;
+
+		if ((width == 1) && (height == 1))
+		{
+			break;
+		}
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+
+	image.pixels.resize(totalSize);
+
+	// generate the texture mipmaps for mapping textures to lower resolutions
+	for (size_t level = 1; level < image.mips.size(); level++)
+	{
+		const TEXTURE_MIP_LEVEL& source = image.mips[level - 1];
+		const TEXTURE_MIP_LEVEL& mip = image.mips[level];
+		DownsampleMipLevel(
+			image.pixels.data() + source.offset, source.width, source.height,
+			image.pixels.data() + mip.offset, mip.width, mip.height,
+			image.colorChannels);
+	}
+
+	image.pData = image.pixels.data();
+}
+
+/***********************************************************
+ *  AllocateTexture()
+ *
+ *  This method is used for allocating every mip level of a
+ *  decoded image in OpenGL texture memory.
+ ***********************************************************/
+void TextureLoader::AllocateTexture(LOAD_JOB& job)
+{
+	const TEXTURE_IMAGE& image = job.image;
+	int lastLevel = (int)image.mips.size() - 1;
+
+	// the filter and wrap modes come from the sampler objects the
+	// texture is drawn with, so only the storage is set up here
+	GLResources::TextureStorage(job.textureID, GL_TEXTURE_2D, lastLevel + 1, image.internalFormat,
+		image.width, image.height);
+
+	// only the levels that have been uploaded are sampled - the base
+	// level is lowered as each larger level arrives
+	GLResources::TextureParameter(job.textureID, GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+	GLResources::TextureParameter(job.textureID, GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, lastLevel);
+
+	job.nextUploadLevel = lastLevel;
+}
+
+/***********************************************************
+ *  UploadMipLevel()
+ *
+ *  This method is used for copying a single mip level into
+ *  a pixel buffer object and transferring it from there into
+ *  the texture.
+ ***********************************************************/
+size_t TextureLoader::UploadMipLevel(LOAD_JOB& job, int level)
+{
+	const TEXTURE_MIP_LEVEL& mip = job.image.mips[level];
+	GLenum pixelFormat = (job.image.colorChannels == 4) ? GL_RGBA : GL_RGB;
+	const void* pPixels = job.image.pData + mip.offset;
+
+	// the pixel buffer stays bound as the source of the transfer, so
+	// the fallback path needs no extra binds to fill it
+	GLuint pixelBuffer = m_pixelBuffers[m_nextPixelBuffer];
+	GLResources::BindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	// orphan the previous contents so the driver does not have
+	// to wait for an earlier transfer from this buffer
+	GLResources::BufferData(pixelBuffer, GL_PIXEL_UNPACK_BUFFER, mip.size, NULL, GL_STREAM_DRAW);
+
+	void* mapped = GLResources::MapBufferRange(pixelBuffer, GL_PIXEL_UNPACK_BUFFER, 0, mip.size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped != NULL)
+	{
+		memcpy(mapped, job.image.pData + mip.offset, mip.size);
+		GLResources::UnmapBuffer(pixelBuffer, GL_PIXEL_UNPACK_BUFFER);
+		pPixels = (const void*)0;
+	}
+	else
+	{
+		// upload straight from client memory if mapping failed
+		GLResources::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	// compressed blocks are copied to the texture as they are, and
+	// texture array layers go into their own slice of the level
+	if (BlockCompressor::IsCompressedFormat(job.image.internalFormat) == true)
+	{
+		GLResources::CompressedTextureSubImage(job.textureID, job.target, level, 0, 0, job.layer,
+			mip.width, mip.height, job.image.internalFormat, (GLsizei)mip.size, pPixels);
+	}
+	else
+	{
+		GLResources::TextureSubImage(job.textureID, job.target, level, 0, 0, job.layer,
+			mip.width, mip.height, pixelFormat, GL_UNSIGNED_BYTE, pPixels);
+	}
+
+	m_nextPixelBuffer = (m_nextPixelBuffer + 1) % 2;
+
+	// the new level can be sampled from now on - the levels of a
+	// texture array are shared by all of its layers so its base
+	// level is left alone, and the layer level callback tells the
+	// renderer which levels of the layer can be sampled instead
+	if (job.target == GL_TEXTURE_2D)
+	{
+		GLResources::TextureParameter(job.textureID, GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	}
+
+	return(mip.size);
+}
+
+/***********************************************************
+ *  ProcessUploads()
+ *
+ *  This method is called once per frame on the render thread
+ *  to stream the decoded mip levels into OpenGL, smallest
+ *  level first, until the passed in byte budget is used.
+ *  At least one mip level is uploaded per call.
+ ***********************************************************/
+void TextureLoader::ProcessUploads(size_t byteBudget)
+{
+	// collect the images that the workers have finished decoding
+	{
+		std::lock_guard<std::mutex> lock(m_readyMutex);
+		m_uploadJobs.insert(m_uploadJobs.end(), m_readyJobs.begin(), m_readyJobs.end());
+		m_readyJobs.clear();
+	}
+
+	if (m_uploadJobs.empty())
+	{
+		return;
+	}
+
+	if (m_pixelBuffers[0] == 0)
+	{
+		m_pixelBuffers[0] = GLResources::CreateBuffer();
+		m_pixelBuffers[1] = GLResources::CreateBuffer();
+	}
+
+	// decoded rows are tightly packed, including the odd-sized mips
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	size_t uploadedBytes = 0;
+	while ((m_uploadJobs.empty() == false) &&
+		((uploadedBytes == 0) || (uploadedBytes < byteBudget)))
+	{
+		LOAD_JOB& job = *m_jobs[m_uploadJobs.front()];
+
+		if (job.duplicateOfJob >= 0)
+		{
+			const LOAD_JOB& original = *m_jobs[job.duplicateOfJob];
+			std::cout << "Sharing texture: " << job.filename << " is identical to " << original.filename << std::endl;
+			if (m_duplicateCallback)
+			{
+				m_duplicateCallback(job.textureID, job.layer, original.textureID, original.layer);
+			}
+		}
+		else if (job.bFailed == false)
+		{
+			double startTime = GetTimeMs();
+
+			if (job.target == GL_TEXTURE_2D_ARRAY)
+			{
+				// the texture array storage is allocated up front
+				if (job.nextUploadLevel < 0)
+				{
+					job.nextUploadLevel = (int)job.image.mips.size() - 1;
+				}
+			}
+			else if (job.nextUploadLevel < 0)
+			{
+				AllocateTexture(job);
+			}
+
+			while ((job.nextUploadLevel >= 0) &&
+				((uploadedBytes == 0) || (uploadedBytes < byteBudget)))
+			{
+				uploadedBytes += UploadMipLevel(job, job.nextUploadLevel);
+				if ((job.target == GL_TEXTURE_2D_ARRAY) && m_layerLevelCallback)
+				{
+					m_layerLevelCallback(job.textureID, job.layer, job.nextUploadLevel);
+				}
+				job.nextUploadLevel--;
+			}
+
+			job.uploadMs += GetTimeMs() - startTime;
+
+			// wait for the next frame if the full resolution
+			// image has not been uploaded yet
+			if (job.nextUploadLevel >= 0)
+			{
+				break;
+			}
+
+			std::cout << "Successfully loaded image: " << job.filename
+				<< ", width: " << job.image.width << ", height: " << job.image.height
+				<< ", channels: " << job.image.colorChannels
+				<< ", mips: " << job.image.mips.size()
+				<< ", " << ((BlockCompressor::IsCompressedFormat(job.image.internalFormat) == true) ?
+					((job.image.internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ? "BC1" : "BC3") : "uncompressed")
+				<< " " << (job.textureBytes / 1024) << " KB"
+				<< ((job.image.bFromCache == true) ? ", cache read: " : ", decode: ") << job.decodeMs << " ms"
+				<< ", upload: " << job.uploadMs << " ms" << std::endl;
+			m_totalDecodeMs += job.decodeMs;
+			m_totalTextureBytes += job.textureBytes;
+			m_totalUncompressedBytes += job.uncompressedBytes;
+
+			if ((job.target == GL_TEXTURE_2D) && m_loadedCallback)
+			{
+				m_loadedCallback(job.textureID, job.image);
+			}
+		}
+
+		// free the image data from local memory
+		std::vector<unsigned char>().swap(job.image.pixels);
+		job.image.pMappedFile.reset();
+		job.image.pData = NULL;
+		m_uploadJobs.erase(m_uploadJobs.begin());
+		m_finishedJobs++;
+	}
+
+	GLResources::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// the textures reloaded later are not part of the load time
+	if ((m_bLoadReported == false) && IsFinished())
+	{
+		m_bLoadReported = true;
+		std::cout << "All " << m_jobs.size() << " textures loaded in "
+			<< (GetTimeMs() - m_startTime) << " ms, " << m_cacheHits << " from the texture cache, "
+			<< m_totalDecodeMs << " ms total decode time" << std::endl;
+		std::cout << "Texture memory: " << (m_totalTextureBytes / 1024) << " KB, "
+			<< (m_totalUncompressedBytes / 1024) << " KB as RGBA8, "
+			<< ((m_totalUncompressedBytes > m_totalTextureBytes) ? (m_totalUncompressedBytes - m_totalTextureBytes) / 1024 : 0)
+			<< " KB saved" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  SetDuplicateCallback()
+ *
+ *  This method is used for setting the function that gets
+ *  called with the duplicate texture and layer and the
+ *  original ones when a queued image file is identical to
+ *  another queued image file, so the duplicate texture can
+ *  be released.  The layers are -1 for plain textures.
+ ***********************************************************/
+void TextureLoader::SetDuplicateCallback(std::function<void(GLuint, int, GLuint, int)> callback)
+{
+	m_duplicateCallback = callback;
+}
+
+/***********************************************************
+ *  SetLoadedCallback()
+ *
+ *  This method is used for setting the function that gets
+ *  called with a texture and its image once every mip level
+ *  has been uploaded.  Texture array layers are not
+ *  reported, since they share the storage of the array.
+ ***********************************************************/
+void TextureLoader::SetLoadedCallback(std::function<void(GLuint, const TEXTURE_IMAGE&)> callback)
+{
+	m_loadedCallback = callback;
+}
+
+/***********************************************************
+ *  SetLayerLevelCallback()
+ *
+ *  This method is used for setting the function that gets
+ *  called with a texture array, a layer and a mip level
+ *  each time that level of the layer has been uploaded.
+ *  The levels of a texture array are shared by all of its
+ *  layers, so the array cannot hide the levels of a layer
+ *  that are still missing, and whoever draws the layer has
+ *  to keep to the ones reported.
+ ***********************************************************/
+void TextureLoader::SetLayerLevelCallback(std::function<void(GLuint, int, int)> callback)
+{
+	m_layerLevelCallback = callback;
+}
+
+/***********************************************************
+ *  SetAssetPack()
+ *
+ *  This method is used for setting the asset pack that is
+ *  searched for the queued image files and their texture
+ *  cache files before they are opened from the disk.
+ ***********************************************************/
+void TextureLoader::SetAssetPack(AssetPack* pAssetPack)
+{
+	m_pAssetPack = pAssetPack;
+	m_textureCache.SetAssetPack(pAssetPack);
+}
+
+/***********************************************************
+ *  GetTextureLayerFormat()
+ *
+ *  This method is used for getting the internal format the
+ *  texture array layers are loaded in.  The layers are
+ *  always RGBA, so they use BC3 when they are compressed.
+ ***********************************************************/
+GLenum TextureLoader::GetTextureLayerFormat() const
+{
+	return((m_bCompressTextures == true) ? BlockCompressor::GetCompressedFormat(4) : GL_RGBA8);
+}
+
+/***********************************************************
+ *  GetImageSize()
+ *
+ *  This method is used for reading the size an image file
+ *  is loaded at, scaled down by the current decode scale,
+ *  from its header alone.  Returns false if the file cannot
+ *  be read.
+ ***********************************************************/
+bool TextureLoader::GetImageSize(const char* filename, int& width, int& height) const
+{
+	MappedFile sourceFile;
+	const unsigned char* pSource = NULL;
+	size_t sourceSize = 0;
+	if ((m_pAssetPack == NULL) || (m_pAssetPack->Find(filename, pSource, sourceSize) == false))
+	{
+		if (sourceFile.Open(filename) == false)
+		{
+			return(false);
+		}
+		pSource = sourceFile.GetData();
+		sourceSize = sourceFile.GetSize();
+	}
+
+	if (ImageDecoder::GetImageInfo(pSource, sourceSize, width, height) == false)
+	{
+		return(false);
+	}
+
+	width = ImageDecoder::GetScaledSize(width, m_decodeScale);
+	height = ImageDecoder::GetScaledSize(height, m_decodeScale);
+	return(true);
+}
+
+/***********************************************************
+ *  BakeTextures()
+ *
+ *  This method is used for encoding the passed in image
+ *  files, with their mip chains, into the texture cache on
+ *  all of the worker threads, so the 3D scene only reads
+ *  them on its next launch.  Every file is baked as a plain
+ *  texture and, when asked for, as a texture array layer of
+ *  its own size, which is what it is loaded as when another
+ *  scene texture has the same size.
+ ***********************************************************/
+void TextureLoader::BakeTextures(const std::vector<std::string>& filenames, bool bTextureLayers)
+{
+	m_bDecodeOnly = true;
+
+	for (size_t i = 0; i < filenames.size(); i++)
+	{
+		QueueTexture(filenames[i].c_str(), 0);
+
+		int width = 0;
+		int height = 0;
+		if ((bTextureLayers == true) && (GetImageSize(filenames[i].c_str(), width, height) == true))
+		{
+			QueueTextureLayer(filenames[i].c_str(), 0, 0, width, height);
+		}
+	}
+
+	StartDecoding();
+	JoinWorkers();
+
+	size_t totalBytes = 0;
+	size_t totalUncompressedBytes = 0;
+	for (size_t i = 0; i < m_jobs.size(); i++)
+	{
+		const LOAD_JOB& job = *m_jobs[i];
+		if ((job.bFailed == true) || (job.duplicateOfJob >= 0))
+		{
+			continue;
+		}
+
+		std::cout << job.filename << ((job.target == GL_TEXTURE_2D_ARRAY) ? " (layer)" : "")
+			<< ": " << (job.textureBytes / 1024) << " KB, " << (job.uncompressedBytes / 1024) << " KB as RGBA8, "
+			<< job.decodeMs << " ms" << std::endl;
+		totalBytes += job.textureBytes;
+		totalUncompressedBytes += job.uncompressedBytes;
+	}
+
+	std::cout << "Baked " << m_jobs.size() << " textures in " << (GetTimeMs() - m_startTime) << " ms, "
+		<< m_cacheHits << " already in the texture cache, " << (totalBytes / 1024) << " KB, "
+		<< (totalUncompressedBytes / 1024) << " KB as RGBA8" << std::endl;
+}
+
+/***********************************************************
+ *  IsFinished()
+ *
+ *  This method is used for checking whether all of the
+ *  queued textures have been decoded and uploaded.
+ ***********************************************************/
+bool TextureLoader::IsFinished() const
+{
+	return(m_finishedJobs == (int)m_jobs.size());
+}
+
+/***********************************************************
+ *  JoinWorkers()
+ *
+ *  This method is used for waiting on all of the worker
+ *  threads to decode the jobs handed over to them and exit.
+ *  When m_bCancel is set they exit without finishing.
+ ***********************************************************/
+void TextureLoader::JoinWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_decodeMutex);
+		m_bStopWorkers = true;
+	}
+	m_decodeCondition.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		if (m_workers[i].joinable())
+		{
+			m_workers[i].join();
+		}
+	}
+	m_workers.clear();
+	m_bStopWorkers = false;
+}
+
+/***********************************************************
+ *  RunCacheBenchmark()
+ *
+ *  This method is used for measuring how long each of the
+ *  passed in image files takes to decode with its mipmap
+ *  chain, compared to reading the same image back from the
+ *  texture cache.  Every cached level is touched so the
+ *  comparison includes reading all of the texel data.
+ ***********************************************************/
+void TextureLoader::RunCacheBenchmark(const std::vector<std::string>& filenames)
+{
+	const int iterations = 5;
+	TextureCache textureCache("cache/textures");
+
+	stbi_set_flip_vertically_on_load(true);
+
+	for (size_t i = 0; i < filenames.size(); i++)
+	{
+		MappedFile sourceFile;
+		if (sourceFile.Open(filenames[i].c_str()) == false)
+		{
+			std::cerr << "Failed to open: " << filenames[i] << std::endl;
+			continue;
+		}
+
+		double decodeMs = 0.0;
+		double cacheMs = 0.0;
+		bool bSuccess = true;
+		unsigned int checksum = 0;
+
+		for (int iteration = 0; (iteration < iterations) && bSuccess; iteration++)
+		{
+			double startTime = GetTimeMs();
+			TEXTURE_IMAGE decoded;
+			uint64_t sourceHash = TextureCache::HashData(sourceFile.GetData(), sourceFile.GetSize());
+			bSuccess = DecodeImage(sourceFile.GetData(), sourceFile.GetSize(), 1, decoded);
+			decodeMs += GetTimeMs() - startTime;
+
+			if ((bSuccess == true) && (iteration == 0))
+			{
+				bSuccess = textureCache.Store(sourceHash, decoded);
+			}
+
+			startTime = GetTimeMs();
+			TEXTURE_IMAGE cached;
+			sourceHash = TextureCache::HashData(sourceFile.GetData(), sourceFile.GetSize());
+			bSuccess = bSuccess && textureCache.Load(sourceHash, cached);
+			for (size_t level = 0; (level < cached.mips.size()) && bSuccess; level++)
+			{
+				const unsigned char* pLevel = cached.pData + cached.mips[level].offset;
+				for (size_t offset = 0; offset < cached.mips[level].size; offset += 4096)
+				{
+					checksum += pLevel[offset];
+				}
+			}
+			cacheMs += GetTimeMs() - startTime;
+		}
+
+		if (bSuccess == false)
+		{
+			std::cerr << "Benchmark failed for: " << filenames[i] << std::endl;
+			continue;
+		}
+
+		std::cout << filenames[i] << ": decode " << (decodeMs / iterations) << " ms, cache "
+			<< (cacheMs / iterations) << " ms, speedup " << (decodeMs / cacheMs) << "x"
+			<< " (checksum " << checksum << ")" << std::endl;
+	}
+}
@@ -0,0 +1,195 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.h
+// ============
+// decode texture images on worker threads and stream them to OpenGL
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCache.h"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  TextureLoader
+ *
+ *  This class decodes all of the queued texture image files
+ *  in parallel on worker threads, builds their mipmap chains,
+ *  and then streams the pixels into the OpenGL textures
+ *  through pixel buffer objects, smallest mip level first,
+ *  so the scene can be drawn before the full resolution
+ *  image has arrived.
+ ***********************************************************/
+class TextureLoader
+{
+public:
+	// constructor
+	TextureLoader();
+	// destructor
+	~TextureLoader();
+
+	// queue an image file to be loaded into the passed in texture
+	void QueueTexture(const char* filename, GLuint textureID);
+	// queue an image file to be loaded into a layer of a texture array
+	void QueueTextureLayer(const char* filename, GLuint arrayTextureID, int layer,
+		int layerWidth, int layerHeight);
+	// load an image file again into another texture and start decoding
+	// it, without waiting on the decoding already in progress
+	void ReloadTexture(const char* filename, GLuint textureID);
+	// hand all of the newly queued image files to the worker threads
+	void StartDecoding();
+	// upload decoded mip levels until the byte budget is used
+	void ProcessUploads(size_t byteBudget);
+	// check whether every queued texture has been processed
+	bool IsFinished() const;
+	// set the function called when a queued image is identical to an
+	// earlier one, with the duplicate and the original texture and layer
+	void SetDuplicateCallback(std::function<void(GLuint, int, GLuint, int)> callback);
+	// set the function called with each texture, other than texture
+	// array layers, once all of its mip levels are uploaded
+	void SetLoadedCallback(std::function<void(GLuint, const TEXTURE_IMAGE&)> callback);
+	// set the function called with a texture array, a layer and the mip
+	// level each time a level of the layer has been uploaded
+	void SetLayerLevelCallback(std::function<void(GLuint, int, int)> callback);
+	// set the asset pack searched for image and cache files before the disk
+	void SetAssetPack(AssetPack* pAssetPack);
+	// block compress the textures queued from now on
+	void SetCompressTextures(bool bCompress) { m_bCompressTextures = bCompress; }
+	// decode the textures queued from now on scaled down by 1, 2, 4 or 8
+	void SetDecodeScale(int scale);
+	// get the internal format that texture array layers are loaded in
+	GLenum GetTextureLayerFormat() const;
+	// get the size an image file is loaded at with the current decode scale
+	bool GetImageSize(const char* filename, int& width, int& height) const;
+
+	// encode the passed in image files into the texture cache without
+	// uploading them, as plain textures and optionally as texture array layers
+	void BakeTextures(const std::vector<std::string>& filenames, bool bTextureLayers);
+
+	// compare decoding the passed in image files against reading them from the cache
+	static void RunCacheBenchmark(const std::vector<std::string>& filenames);
+
+private:
+	struct LOAD_JOB
+	{
+		std::string filename;
+		GLuint textureID;
+		// GL_TEXTURE_2D, or GL_TEXTURE_2D_ARRAY for a texture array layer
+		GLenum target;
+		// texture array layer and the size of the layers of the array
+		int layer;
+		int layerWidth;
+		int layerHeight;
+		// encode the image in a block compressed format
+		bool bCompress;
+		// factor the image is scaled down by while it is decoded
+		int decodeScale;
+		// share the texture of an earlier job with an identical image
+		bool bShareDuplicates;
+		// the image with its complete mip chain
+		TEXTURE_IMAGE image;
+		// job with an identical source image, -1 if none
+		int duplicateOfJob;
+		// next mip level to upload, counts down to level 0
+		int nextUploadLevel;
+		bool bFailed;
+		double decodeMs;
+		double uploadMs;
+		// texture memory used by the image and what it would use as RGBA8
+		size_t textureBytes;
+		size_t uncompressedBytes;
+	};
+
+	// decode jobs as they are handed over until told to stop - runs on
+	// worker threads
+	void DecodeWorker();
+	// read a single image file from the cache or decode it
+	void DecodeJob(LOAD_JOB& job, int jobIndex);
+	// decode an image file and build its mipmap chain
+	static bool DecodeImage(const unsigned char* pSource, size_t sourceSize, int scale, TEXTURE_IMAGE& image);
+	// get the largest decode scale that keeps an image at least the layer size
+	static int GetLayerDecodeScale(const unsigned char* pSource, size_t sourceSize,
+		int layerWidth, int layerHeight);
+	// convert an image to an RGBA image of the layer size and rebuild its mipmap chain
+	static void ResampleImage(TEXTURE_IMAGE& image, int width, int height);
+	// build the mipmap chain below the first level of an image
+	static void BuildMipChain(TEXTURE_IMAGE& image);
+	// allocate the texture storage for a decoded image
+	void AllocateTexture(LOAD_JOB& job);
+	// upload a single mip level through a pixel buffer object
+	size_t UploadMipLevel(LOAD_JOB& job, int level);
+	// wait for the worker threads to decode every handed over job and exit
+	void JoinWorkers();
+
+	// asset pack holding image files, NULL if none
+	AssetPack* m_pAssetPack;
+	// disk cache of decoded images with their mip chains
+	TextureCache m_textureCache;
+	// number of images that were read from the cache
+	std::atomic<int> m_cacheHits;
+	// total time spent decoding or reading images, in milliseconds
+	double m_totalDecodeMs;
+	// block compress newly queued textures
+	bool m_bCompressTextures;
+	// factor newly queued textures are scaled down by while decoding
+	int m_decodeScale;
+	// only decode the images into the cache, without uploading them
+	bool m_bDecodeOnly;
+	// texture memory of the uploaded images and what it would be as RGBA8
+	size_t m_totalTextureBytes;
+	size_t m_totalUncompressedBytes;
+	// first job for each source file hash, guarded by m_hashMutex
+	std::unordered_map<uint64_t, int> m_jobsByHash;
+	std::mutex m_hashMutex;
+	// called when a queued image turns out to be a duplicate
+	std::function<void(GLuint, int, GLuint, int)> m_duplicateCallback;
+	// called when a texture has been completely uploaded
+	std::function<void(GLuint, const TEXTURE_IMAGE&)> m_loadedCallback;
+	// called when a mip level of a texture array layer has been uploaded
+	std::function<void(GLuint, int, int)> m_layerLevelCallback;
+
+	// all of the queued load jobs, only added to while m_decodeMutex
+	// is held since the workers look their jobs up in it
+	std::vector<std::unique_ptr<LOAD_JOB>> m_jobs;
+	// worker threads decoding the images, kept running between batches
+	std::vector<std::thread> m_workers;
+	// jobs handed over for decoding, guarded by m_decodeMutex, and the
+	// workers wait on m_decodeCondition for more
+	std::deque<int> m_decodeJobs;
+	std::mutex m_decodeMutex;
+	std::condition_variable m_decodeCondition;
+	// set when the workers should exit once the handed over jobs are done
+	bool m_bStopWorkers;
+	// index of the first job not handed over to the workers yet
+	int m_startedJobs;
+	// set when the workers should stop decoding early
+	std::atomic<bool> m_bCancel;
+	// decoded jobs waiting for upload, guarded by m_readyMutex
+	std::vector<int> m_readyJobs;
+	std::mutex m_readyMutex;
+	// decoded jobs being uploaded - only used on the render thread
+	std::vector<int> m_uploadJobs;
+	// number of jobs that have been completely processed
+	int m_finishedJobs;
+	// pixel buffer objects used alternately for the uploads
+	GLuint m_pixelBuffers[2];
+	int m_nextPixelBuffer;
+	// time when the first batch was started, in milliseconds
+	double m_startTime;
+	// whether the load of the first textures has been reported
+	bool m_bLoadReported;
+};
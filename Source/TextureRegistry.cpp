@@ -0,0 +1,262 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureregistry.cpp
+// ============
+// keep track of the loaded textures by handle, tag and source file
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureRegistry.h"
+
+#include <cstring>
+
+/***********************************************************
+ *  StringIndex()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StringIndex::StringIndex()
+{
+	m_buckets.assign(16, -1);
+}
+
+/***********************************************************
+ *  HashString()
+ *
+ *  This method is used for calculating the 32-bit FNV-1a
+ *  hash of the passed in string.
+ ***********************************************************/
+uint32_t StringIndex::HashString(const char* key)
+{
+	uint32_t hash = 2166136261u;
+	while (*key != '\0')
+	{
+		hash ^= (unsigned char)*key;
+		hash *= 16777619u;
+		key++;
+	}
+	return(hash);
+}
+
+/***********************************************************
+ *  Insert()
+ *
+ *  This method is used for adding a string and its value to
+ *  the index.  Returns false if the string is already there.
+ ***********************************************************/
+bool StringIndex::Insert(const char* key, int value)
+{
+	if (Find(key) >= 0)
+	{
+		return(false);
+	}
+
+	// keep the table at most half full so the probes stay short
+	if ((m_entries.size() + 1) * 2 > m_buckets.size())
+	{
+		Rehash(m_buckets.size() * 2);
+	}
+
+	ENTRY entry;
+	entry.key = key;
+	entry.hash = HashString(key);
+	entry.value = value;
+	m_entries.push_back(entry);
+
+	size_t mask = m_buckets.size() - 1;
+	size_t bucket = entry.hash & mask;
+	while (m_buckets[bucket] >= 0)
+	{
+		bucket = (bucket + 1) & mask;
+	}
+	m_buckets[bucket] = (int)m_entries.size() - 1;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for getting the value associated with
+ *  the passed in string.  Returns -1 if it is not found.
+ ***********************************************************/
+int StringIndex::Find(const char* key) const
+{
+	uint32_t hash = HashString(key);
+	size_t mask = m_buckets.size() - 1;
+	size_t bucket = hash & mask;
+
+	while (m_buckets[bucket] >= 0)
+	{
+		const ENTRY& entry = m_entries[m_buckets[bucket]];
+		if ((entry.hash == hash) && (strcmp(entry.key.c_str(), key) == 0))
+		{
+			return(entry.value);
+		}
+		bucket = (bucket + 1) & mask;
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every string from the
+ *  index.
+ ***********************************************************/
+void StringIndex::Clear()
+{
+	m_entries.clear();
+	m_buckets.assign(16, -1);
+}
+
+/***********************************************************
+ *  Rehash()
+ *
+ *  This method is used for rebuilding the bucket table with
+ *  the passed in number of buckets, a power of two.
+ ***********************************************************/
+void StringIndex::Rehash(size_t bucketCount)
+{
+	m_buckets.assign(bucketCount, -1);
+
+	size_t mask = bucketCount - 1;
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		size_t bucket = m_entries[i].hash & mask;
+		while (m_buckets[bucket] >= 0)
+		{
+			bucket = (bucket + 1) & mask;
+		}
+		m_buckets[bucket] = (int)i;
+	}
+}
+
+/***********************************************************
+ *  Register()
+ *
+ *  This method is used for adding a loaded texture to the
+ *  registry and getting the stable handle for it.
+ ***********************************************************/
+TextureHandle TextureRegistry::Register(const char* filename, GLuint textureID, int layer)
+{
+	TEXTURE_INFO texture;
+	texture.filename = filename;
+	texture.ID = textureID;
+	texture.slot = -1;
+	texture.layer = layer;
+	texture.virtualTexture = -1;
+	m_textures.push_back(texture);
+
+	TextureHandle handle = (TextureHandle)m_textures.size() - 1;
+	m_sourceIndex.Insert(filename, handle);
+
+	return(handle);
+}
+
+/***********************************************************
+ *  AddTag()
+ *
+ *  This method is used for associating a tag string with a
+ *  registered texture.  Returns false if the tag is already
+ *  used by another texture.
+ ***********************************************************/
+bool TextureRegistry::AddTag(const char* tag, TextureHandle handle)
+{
+	if (IsValid(handle) == false)
+	{
+		return(false);
+	}
+
+	if (m_tagIndex.Insert(tag, handle) == false)
+	{
+		return(FindByTag(tag) == handle);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  FindByTag()
+ *
+ *  This method is used for getting the handle of the
+ *  texture associated with the passed in tag.
+ ***********************************************************/
+TextureHandle TextureRegistry::FindByTag(const char* tag) const
+{
+	return(m_tagIndex.Find(tag));
+}
+
+/***********************************************************
+ *  FindBySource()
+ *
+ *  This method is used for getting the handle of the
+ *  texture loaded from the passed in image file.
+ ***********************************************************/
+TextureHandle TextureRegistry::FindBySource(const char* filename) const
+{
+	return(m_sourceIndex.Find(filename));
+}
+
+/***********************************************************
+ *  ReplaceTexture()
+ *
+ *  This method is used for pointing every texture that uses
+ *  one OpenGL texture and texture array layer at another
+ *  one instead, when two source files turn out to hold the
+ *  same image.  The layers are -1 for plain textures.
+ ***********************************************************/
+void TextureRegistry::ReplaceTexture(GLuint oldTextureID, int oldLayer, GLuint newTextureID, int newLayer)
+{
+	int newSlot = -1;
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		if ((m_textures[i].ID == newTextureID) && (m_textures[i].layer == newLayer))
+		{
+			newSlot = m_textures[i].slot;
+		}
+	}
+
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		if ((m_textures[i].ID == oldTextureID) && (m_textures[i].layer == oldLayer))
+		{
+			m_textures[i].ID = newTextureID;
+			m_textures[i].layer = newLayer;
+			m_textures[i].slot = newSlot;
+		}
+	}
+}
+
+/***********************************************************
+ *  ReplaceTextureID()
+ *
+ *  This method is used for pointing every texture that uses
+ *  one OpenGL texture at another one that holds the same
+ *  images, such as a copy with a different resolution.
+ ***********************************************************/
+void TextureRegistry::ReplaceTextureID(GLuint oldTextureID, GLuint newTextureID)
+{
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		if (m_textures[i].ID == oldTextureID)
+		{
+			m_textures[i].ID = newTextureID;
+		}
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every texture from the
+ *  registry.  The OpenGL textures are not deleted.
+ ***********************************************************/
+void TextureRegistry::Clear()
+{
+	m_textures.clear();
+	m_tagIndex.Clear();
+	m_sourceIndex.Clear();
+}
@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureregistry.h
+// ============
+// keep track of the loaded textures by handle, tag and source file
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// stable handle of a registered texture, handed out at load time
+typedef int TextureHandle;
+const TextureHandle INVALID_TEXTURE_HANDLE = -1;
+
+/***********************************************************
+ *  StringIndex
+ *
+ *  This class maps strings to integer values with an open
+ *  addressing hash table.  Lookups take a plain C string
+ *  and never allocate memory.
+ ***********************************************************/
+class StringIndex
+{
+public:
+	// constructor
+	StringIndex();
+
+	// add a string, returns false if it is already in the index
+	bool Insert(const char* key, int value);
+	// find the value for a string, returns -1 if it is not found
+	int Find(const char* key) const;
+	// remove every string from the index
+	void Clear();
+
+private:
+	struct ENTRY
+	{
+		std::string key;
+		uint32_t hash;
+		int value;
+	};
+
+	// hash a C string with 32-bit FNV-1a
+	static uint32_t HashString(const char* key);
+	// rebuild the bucket table with the passed in size
+	void Rehash(size_t bucketCount);
+
+	// all of the inserted strings
+	std::vector<ENTRY> m_entries;
+	// entry index for each bucket, -1 when the bucket is empty
+	std::vector<int> m_buckets;
+};
+
+/***********************************************************
+ *  TextureRegistry
+ *
+ *  This class holds any number of loaded textures.  Each
+ *  texture gets a stable integer handle when it is
+ *  registered, and tags and source filenames resolve to
+ *  their handle in constant time.
+ ***********************************************************/
+class TextureRegistry
+{
+public:
+	struct TEXTURE_INFO
+	{
+		std::string filename;
+		GLuint ID;
+		// texture unit the texture is bound to, -1 if none
+		int slot;
+		// layer of the texture array holding the image, -1 if none
+		int layer;
+		// index of the virtual texture holding the image, -1 if none
+		int virtualTexture;
+	};
+
+	// add a texture and get its handle
+	TextureHandle Register(const char* filename, GLuint textureID, int layer = -1);
+	// associate a tag with a registered texture
+	bool AddTag(const char* tag, TextureHandle handle);
+	// find a texture by its tag
+	TextureHandle FindByTag(const char* tag) const;
+	// find a texture by the file it was loaded from
+	TextureHandle FindBySource(const char* filename) const;
+	// point every texture using one OpenGL texture and layer at another one
+	void ReplaceTexture(GLuint oldTextureID, int oldLayer, GLuint newTextureID, int newLayer);
+	// point every texture using one OpenGL texture at another one, keeping
+	// their layers and texture units
+	void ReplaceTextureID(GLuint oldTextureID, GLuint newTextureID);
+	// remove every texture from the registry
+	void Clear();
+
+	// check whether a handle refers to a registered texture
+	bool IsValid(TextureHandle handle) const
+	{
+		return((handle >= 0) && (handle < (int)m_textures.size()));
+	}
+	// get the registered texture for a handle
+	TEXTURE_INFO& Get(TextureHandle handle) { return m_textures[handle]; }
+	const TEXTURE_INFO& Get(TextureHandle handle) const { return m_textures[handle]; }
+	// get the number of registered textures
+	int GetCount() const { return (int)m_textures.size(); }
+
+private:
+	// registered textures, indexed by handle
+	std::vector<TEXTURE_INFO> m_textures;
+	// tag to handle lookup
+	StringIndex m_tagIndex;
+	// source filename to handle lookup
+	StringIndex m_sourceIndex;
+};
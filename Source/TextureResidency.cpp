@@ -0,0 +1,338 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.cpp
+// ============
+// keep the texture memory within a budget by downgrading unused textures
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureResidency.h"
+#include "GLResources.h"
+#include "RenderState.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// frames a texture must go unused before it can be downgraded
+	const unsigned int g_ColdFrameCount = 120;
+}
+
+/***********************************************************
+ *  TextureResidency()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureResidency::TextureResidency(size_t budgetBytes)
+{
+	m_frame = 0;
+	m_bOverBudgetReported = false;
+	m_stats.budgetBytes = budgetBytes;
+	m_stats.residentBytes = 0;
+	m_stats.peakBytes = 0;
+	m_stats.textureCount = 0;
+	m_stats.pinnedBytes = 0;
+	m_stats.downgradedCount = 0;
+	m_stats.downgrades = 0;
+	m_stats.restores = 0;
+	m_stats.overBudgetFrames = 0;
+}
+
+/***********************************************************
+ *  GetResidentBytes()
+ *
+ *  This method is used for adding up the bytes of the mip
+ *  levels of a texture that have not been dropped.
+ ***********************************************************/
+size_t TextureResidency::GetResidentBytes(const RESIDENT_TEXTURE& texture)
+{
+	size_t bytes = 0;
+	for (size_t level = texture.droppedLevels; level < texture.levelBytes.size(); level++)
+	{
+		bytes += texture.levelBytes[level];
+	}
+	return(bytes);
+}
+
+/***********************************************************
+ *  Register()
+ *
+ *  This method is used for starting to track the memory of
+ *  a texture, with the bytes of each of its full resolution
+ *  mip levels.  Textures that are not evictable count
+ *  towards the budget but are never downgraded.
+ ***********************************************************/
+void TextureResidency::Register(GLuint textureID, GLenum target, GLenum internalFormat,
+	int width, int height, int layers, const std::vector<size_t>& levelBytes, bool bEvictable)
+{
+	Unregister(textureID);
+
+	RESIDENT_TEXTURE texture;
+	texture.target = target;
+	texture.internalFormat = internalFormat;
+	texture.width = width;
+	texture.height = height;
+	texture.layers = layers;
+	texture.levelBytes = levelBytes;
+	texture.droppedLevels = 0;
+	texture.lastUsedFrame = m_frame;
+	texture.bEvictable = bEvictable;
+	texture.bRestoring = false;
+	m_textures[textureID] = texture;
+
+	m_stats.textureCount++;
+	m_stats.residentBytes += GetResidentBytes(texture);
+	if (bEvictable == false)
+	{
+		m_stats.pinnedBytes += GetResidentBytes(texture);
+	}
+	m_stats.peakBytes = std::max(m_stats.peakBytes, m_stats.residentBytes);
+}
+
+/***********************************************************
+ *  Unregister()
+ *
+ *  This method is used for no longer tracking a texture,
+ *  once it has been deleted.
+ ***********************************************************/
+void TextureResidency::Unregister(GLuint textureID)
+{
+	std::unordered_map<GLuint, RESIDENT_TEXTURE>::iterator found = m_textures.find(textureID);
+	if (found == m_textures.end())
+	{
+		return;
+	}
+
+	m_stats.textureCount--;
+	m_stats.residentBytes -= GetResidentBytes(found->second);
+	if (found->second.bEvictable == false)
+	{
+		m_stats.pinnedBytes -= GetResidentBytes(found->second);
+	}
+	if (found->second.droppedLevels > 0)
+	{
+		m_stats.downgradedCount--;
+	}
+	m_textures.erase(found);
+}
+
+/***********************************************************
+ *  Touch()
+ *
+ *  This method is used for recording that a texture is used
+ *  for drawing in the current frame.  Returns true when the
+ *  texture is downgraded and not already being reloaded, so
+ *  the caller can reload it at full resolution.
+ ***********************************************************/
+bool TextureResidency::Touch(GLuint textureID)
+{
+	std::unordered_map<GLuint, RESIDENT_TEXTURE>::iterator found = m_textures.find(textureID);
+	if (found == m_textures.end())
+	{
+		return(false);
+	}
+
+	found->second.lastUsedFrame = m_frame;
+	return((found->second.droppedLevels > 0) && (found->second.bRestoring == false));
+}
+
+/***********************************************************
+ *  BeginRestore()
+ *
+ *  This method is used for recording that a downgraded
+ *  texture is being reloaded at full resolution into
+ *  another texture.  It is not downgraded any further in
+ *  the meantime.
+ ***********************************************************/
+void TextureResidency::BeginRestore(GLuint textureID, GLuint restoredTextureID)
+{
+	std::unordered_map<GLuint, RESIDENT_TEXTURE>::iterator found = m_textures.find(textureID);
+	if (found != m_textures.end())
+	{
+		found->second.bRestoring = true;
+		m_pendingRestores[restoredTextureID] = textureID;
+	}
+}
+
+/***********************************************************
+ *  FinishRestore()
+ *
+ *  This method is used for getting the downgraded texture
+ *  that the passed in reloaded texture replaces.  Returns
+ *  false if the texture is not a reload.
+ ***********************************************************/
+bool TextureResidency::FinishRestore(GLuint restoredTextureID, GLuint& textureID)
+{
+	std::unordered_map<GLuint, GLuint>::iterator found = m_pendingRestores.find(restoredTextureID);
+	if (found == m_pendingRestores.end())
+	{
+		return(false);
+	}
+
+	textureID = found->second;
+	m_pendingRestores.erase(found);
+	m_stats.restores++;
+	return(true);
+}
+
+/***********************************************************
+ *  CancelRestores()
+ *
+ *  This method is used for forgetting every reload that is
+ *  still in progress, and getting the textures they were
+ *  loading into so they can be deleted.
+ ***********************************************************/
+void TextureResidency::CancelRestores(std::vector<GLuint>& restoredTextureIDs)
+{
+	std::unordered_map<GLuint, GLuint>::const_iterator it;
+	for (it = m_pendingRestores.begin(); it != m_pendingRestores.end(); ++it)
+	{
+		restoredTextureIDs.push_back(it->first);
+		std::unordered_map<GLuint, RESIDENT_TEXTURE>::iterator found = m_textures.find(it->second);
+		if (found != m_textures.end())
+		{
+			found->second.bRestoring = false;
+		}
+	}
+	m_pendingRestores.clear();
+}
+
+/***********************************************************
+ *  SetReplaceCallback()
+ *
+ *  This method is used for setting the function that gets
+ *  called with the old and the new texture when a texture
+ *  is replaced by a downgraded copy.  The old texture is
+ *  deleted right after the call.
+ ***********************************************************/
+void TextureResidency::SetReplaceCallback(std::function<void(GLuint, GLuint)> callback)
+{
+	m_replaceCallback = callback;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is called once at the end of every frame.
+ *  When the textures are over the memory budget, the least
+ *  recently used texture that has gone cold loses its
+ *  largest mip level.  Only one texture is downgraded per
+ *  frame, so the copies are spread over several frames.
+ *  When no texture is left that could be downgraded, even
+ *  once it goes cold, the frame is counted as over budget
+ *  and the first such frame is reported.
+ ***********************************************************/
+void TextureResidency::EndFrame()
+{
+	m_frame++;
+
+	if (m_stats.residentBytes <= m_stats.budgetBytes)
+	{
+		m_bOverBudgetReported = false;
+		return;
+	}
+
+	GLuint coldestID = 0;
+	unsigned int coldestFrame = m_frame;
+	bool bDowngradable = false;
+	std::unordered_map<GLuint, RESIDENT_TEXTURE>::const_iterator it;
+	for (it = m_textures.begin(); it != m_textures.end(); ++it)
+	{
+		const RESIDENT_TEXTURE& texture = it->second;
+		if ((texture.bEvictable == false) ||
+			(texture.droppedLevels + 1 >= (int)texture.levelBytes.size()))
+		{
+			continue;
+		}
+
+		// a texture being reloaded can be downgraded again later
+		bDowngradable = true;
+		if ((texture.bRestoring == false) &&
+			(m_frame - texture.lastUsedFrame > g_ColdFrameCount) &&
+			(texture.lastUsedFrame < coldestFrame))
+		{
+			coldestID = it->first;
+			coldestFrame = texture.lastUsedFrame;
+		}
+	}
+
+	if (bDowngradable == false)
+	{
+		m_stats.overBudgetFrames++;
+		if (m_bOverBudgetReported == false)
+		{
+			std::cout << "Texture memory " << (m_stats.residentBytes / 1024) << " KB is over the "
+				<< (m_stats.budgetBytes / 1024) << " KB budget with nothing evictable, "
+				<< (m_stats.pinnedBytes / 1024) << " KB is in textures that are never downgraded" << std::endl;
+			m_bOverBudgetReported = true;
+		}
+	}
+	else if (coldestID != 0)
+	{
+		DropLargestLevel(coldestID);
+	}
+}
+
+/***********************************************************
+ *  DropLargestLevel()
+ *
+ *  This method is used for freeing the largest mip level of
+ *  a texture.  Immutable texture storage cannot shrink, so
+ *  the smaller levels are copied on the GPU into a new
+ *  texture that replaces the old one.  Needs OpenGL 4.3 or
+ *  ARB_copy_image, otherwise the texture is left alone.
+ ***********************************************************/
+bool TextureResidency::DropLargestLevel(GLuint textureID)
+{
+	if (!(GLEW_VERSION_4_3 || GLEW_ARB_copy_image) ||
+		!(GLEW_VERSION_4_2 || GLEW_ARB_texture_storage))
+	{
+		return(false);
+	}
+
+	RESIDENT_TEXTURE texture = m_textures[textureID];
+	int levels = (int)texture.levelBytes.size() - texture.droppedLevels - 1;
+	int firstLevel = texture.droppedLevels + 1;
+	int width = std::max(1, texture.width >> firstLevel);
+	int height = std::max(1, texture.height >> firstLevel);
+
+	GLuint newTextureID = GLResources::CreateTexture(texture.target);
+	GLResources::TextureStorage(newTextureID, texture.target, levels, texture.internalFormat,
+		width, height, texture.layers);
+	GLResources::TextureParameter(newTextureID, texture.target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+	// level 1 of the old texture becomes level 0 of the new one
+	for (int level = 0; level < levels; level++)
+	{
+		glCopyImageSubData(
+			textureID, texture.target, level + 1, 0, 0, 0,
+			newTextureID, texture.target, level, 0, 0, 0,
+			std::max(1, width >> level), std::max(1, height >> level), texture.layers);
+	}
+
+	if (m_replaceCallback)
+	{
+		m_replaceCallback(textureID, newTextureID);
+	}
+	RenderState::DeleteTextures(1, &textureID);
+
+	m_stats.residentBytes -= texture.levelBytes[texture.droppedLevels];
+	if (texture.droppedLevels == 0)
+	{
+		m_stats.downgradedCount++;
+	}
+	m_stats.downgrades++;
+
+	texture.droppedLevels++;
+	m_textures.erase(textureID);
+	m_textures[newTextureID] = texture;
+
+	std::cout << "Downgraded texture " << textureID << " to " << width << "x" << height
+		<< ", texture memory " << (m_stats.residentBytes / 1024) << " KB of "
+		<< (m_stats.budgetBytes / 1024) << " KB budget" << std::endl;
+
+	return(true);
+}
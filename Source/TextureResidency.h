@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.h
+// ============
+// keep the texture memory within a budget by downgrading unused textures
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  TEXTURE_MEMORY_STATS
+ *
+ *  Live statistics of the texture memory tracked by the
+ *  texture residency manager.
+ ***********************************************************/
+struct TEXTURE_MEMORY_STATS
+{
+	size_t budgetBytes;
+	// bytes used by every mip level that is currently resident
+	size_t residentBytes;
+	size_t peakBytes;
+	int textureCount;
+	// bytes of the textures that are never downgraded, such as texture
+	// arrays and procedural textures
+	size_t pinnedBytes;
+	// textures that are currently below their full resolution
+	int downgradedCount;
+	// number of times a mip level was dropped or brought back
+	int downgrades;
+	int restores;
+	// frames ended over the budget with no texture left to downgrade
+	int overBudgetFrames;
+};
+
+/***********************************************************
+ *  TextureResidency
+ *
+ *  This class records the memory used by every mip level of
+ *  the loaded textures and the frame each texture was last
+ *  used in.  While the textures are over the memory budget,
+ *  the least recently used texture that has gone cold has
+ *  its largest mip level dropped, one level per frame, and a
+ *  downgraded texture is reported for a reload at full
+ *  resolution as soon as it is used again.  Textures that
+ *  cannot be reloaded are never downgraded, and the frames
+ *  that stay over budget because only they are left are
+ *  counted and reported.
+ ***********************************************************/
+class TextureResidency
+{
+public:
+	// constructor
+	TextureResidency(size_t budgetBytes);
+
+	// start tracking a texture with the bytes of each mip level, for all layers
+	void Register(GLuint textureID, GLenum target, GLenum internalFormat,
+		int width, int height, int layers, const std::vector<size_t>& levelBytes, bool bEvictable);
+	// stop tracking a texture
+	void Unregister(GLuint textureID);
+	// record that a texture is used this frame, returns true when it
+	// is downgraded and should be reloaded at full resolution
+	bool Touch(GLuint textureID);
+	// move to the next frame and downgrade a cold texture when over budget
+	void EndFrame();
+
+	// record that a downgraded texture is being reloaded into another texture
+	void BeginRestore(GLuint textureID, GLuint restoredTextureID);
+	// get the downgraded texture that a reloaded texture replaces
+	bool FinishRestore(GLuint restoredTextureID, GLuint& textureID);
+	// forget every reload in progress and get the textures they load into
+	void CancelRestores(std::vector<GLuint>& restoredTextureIDs);
+
+	// change the memory budget
+	void SetBudget(size_t budgetBytes) { m_stats.budgetBytes = budgetBytes; }
+	// get the live texture memory statistics
+	const TEXTURE_MEMORY_STATS& GetStats() const { return m_stats; }
+	// set the function called when a downgraded texture replaces a texture
+	void SetReplaceCallback(std::function<void(GLuint, GLuint)> callback);
+
+private:
+	struct RESIDENT_TEXTURE
+	{
+		GLenum target;
+		GLenum internalFormat;
+		// size of the full resolution level and number of layers
+		int width;
+		int height;
+		int layers;
+		// bytes of each full resolution mip level, for all layers
+		std::vector<size_t> levelBytes;
+		// number of the largest mip levels that were dropped
+		int droppedLevels;
+		unsigned int lastUsedFrame;
+		// textures holding many layers are never downgraded
+		bool bEvictable;
+		// set while the texture is reloaded at full resolution
+		bool bRestoring;
+	};
+
+	// copy all but the largest mip level into a new texture
+	bool DropLargestLevel(GLuint textureID);
+	// get the bytes of the mip levels that are resident
+	static size_t GetResidentBytes(const RESIDENT_TEXTURE& texture);
+
+	// the tracked textures by OpenGL texture ID
+	std::unordered_map<GLuint, RESIDENT_TEXTURE> m_textures;
+	// downgraded textures by the texture they are reloaded into
+	std::unordered_map<GLuint, GLuint> m_pendingRestores;
+	// current frame number
+	unsigned int m_frame;
+	// set while over budget with nothing left to downgrade, so it is
+	// only reported once each time it happens
+	bool m_bOverBudgetReported;
+	// called with the old and the new texture after a downgrade
+	std::function<void(GLuint, GLuint)> m_replaceCallback;
+	TEXTURE_MEMORY_STATS m_stats;
+};
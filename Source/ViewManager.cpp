@@ -14,14 +14,14 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <iostream>
+
 // declaration of the global variables and defines
 namespace
 {
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
@@ -52,6 +52,10 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_pCameraBuffer = new CameraUniformBuffer();
+	m_uniformProgramID = 0;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -71,6 +75,11 @@ ViewManager::~ViewManager()
 	// free up allocated memory
 	m_pShaderManager = NULL;
 	m_pWindow = NULL;
+	if (NULL != m_pCameraBuffer)
+	{
+		delete m_pCameraBuffer;
+		m_pCameraBuffer = NULL;
+	}
 	if (NULL != g_pCamera)
 	{
 		delete g_pCamera;
@@ -110,11 +119,6 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	// callback for mouse wheel events
 	glfwSetScrollCallback(window, &ViewManager::Mouse_Wheel_CallBack);
 
-
-	// enable blending for supporting tranparent rendering
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
 	m_pWindow = window;
 
 	return(window);
@@ -301,14 +305,21 @@ void ViewManager::PrepareSceneView()
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
-
-		m_pShaderManager->setMat4Value("projection", projection);
+		// the shaders are loaded after the view manager is created,
+		// so the Camera block is bound on first use
+		if (m_uniformProgramID != m_pShaderManager->m_programID)
+		{
+			m_pShaderManager->BindUniformBlock(CameraUniformBuffer::BLOCK_NAME, CameraUniformBuffer::BINDING_POINT);
+			m_uniformProgramID = m_pShaderManager->m_programID;
+		}
 	}
+
+	// write the view and projection matrices and the view position of the
+	// camera once for every program that reads the Camera block
+	m_pCameraBuffer->Update(view, projection, g_pCamera->Position);
+
+	// kept for the light clusters of the scene
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
 }
 	
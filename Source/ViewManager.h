@@ -10,6 +10,7 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "CameraUniformBuffer.h"
 #include "camera.h"
 
 // GLFW library
@@ -35,6 +36,14 @@ private:
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
 
+	// uniform buffer the camera is shared with the shaders through
+	CameraUniformBuffer* m_pCameraBuffer;
+	// program whose Camera block was last bound to the buffer
+	GLuint m_uniformProgramID;
+	// view and projection matrices of the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
 	bool isPerspective;
@@ -45,4 +54,8 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+	// get the view matrix of the current frame
+	const glm::mat4& GetViewMatrix() const { return(m_viewMatrix); }
+	// get the projection matrix of the current frame
+	const glm::mat4& GetProjectionMatrix() const { return(m_projectionMatrix); }
 };
\ No newline at end of file
@@ -0,0 +1,957 @@
+///////////////////////////////////////////////////////////////////////////////
+// virtualtexturesystem.cpp
+// ============
+// stream the visible tiles of very large textures into a shared tile cache
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VirtualTextureSystem.h"
+#include "GLResources.h"
+#include "ImageDecoder.h"
+#include "RenderState.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// declaration of the tile file layout and global variables
+namespace
+{
+	// identifies a virtual texture tile file
+	const char g_TileFileMagic[4] = { 'V', 'T', 'E', 'X' };
+	// bump whenever the tile file layout changes
+	const uint32_t g_TileFileVersion = 1;
+
+	struct TILE_FILE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		// size of mip level 0, a whole number of tiles
+		uint32_t width;
+		uint32_t height;
+		uint32_t tileSize;
+		uint32_t border;
+		uint32_t levelCount;
+		uint32_t reserved;
+	};
+
+	// texels of image data in each tile, and of the border around it
+	// that the neighboring tiles are repeated into for filtering
+	const int g_TileSize = 128;
+	const int g_TileBorder = 4;
+	const int g_TileSlotSize = g_TileSize + 2 * g_TileBorder;
+	const size_t g_TileBytes = (size_t)g_TileSlotSize * g_TileSlotSize * 4;
+	// the tile cache is a square of this many slots across and down
+	const int g_CacheSlotsPerRow = 16;
+	// the feedback pass is this many times smaller than the frame
+	const int g_FeedbackDivisor = 8;
+	// a feedback pass is drawn every this many frames
+	const int g_FeedbackInterval = 2;
+	// maximum number of tiles uploaded into the cache per frame
+	const int g_MaxTileUploadsPerFrame = 8;
+	// maximum number of tiles waiting for a worker
+	const size_t g_MaxQueuedTiles = 64;
+	// number of worker threads reading tiles
+	const int g_TileWorkerCount = 2;
+
+	// get the smallest power of two that is at least the passed in size
+	int NextPowerOfTwo(int size)
+	{
+		int power = 1;
+		while (power < size)
+		{
+			power *= 2;
+		}
+		return(power);
+	}
+
+	// resample an RGBA image with bilinear filtering, repeating at the edges
+	void ResampleImage(const std::vector<unsigned char>& source, int sourceWidth, int sourceHeight,
+		std::vector<unsigned char>& destination, int width, int height)
+	{
+		destination.resize((size_t)width * height * 4);
+		for (int y = 0; y < height; y++)
+		{
+			float sourceY = (y + 0.5f) * sourceHeight / height - 0.5f;
+			int y0 = (int)std::floor(sourceY);
+			float fy = sourceY - y0;
+			int row0 = (y0 + sourceHeight) % sourceHeight;
+			int row1 = (y0 + 1) % sourceHeight;
+			for (int x = 0; x < width; x++)
+			{
+				float sourceX = (x + 0.5f) * sourceWidth / width - 0.5f;
+				int x0 = (int)std::floor(sourceX);
+				float fx = sourceX - x0;
+				int column0 = (x0 + sourceWidth) % sourceWidth;
+				int column1 = (x0 + 1) % sourceWidth;
+				for (int c = 0; c < 4; c++)
+				{
+					float top = source[((size_t)row0 * sourceWidth + column0) * 4 + c] * (1.0f - fx) +
+						source[((size_t)row0 * sourceWidth + column1) * 4 + c] * fx;
+					float bottom = source[((size_t)row1 * sourceWidth + column0) * 4 + c] * (1.0f - fx) +
+						source[((size_t)row1 * sourceWidth + column1) * 4 + c] * fx;
+					destination[((size_t)y * width + x) * 4 + c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+				}
+			}
+		}
+	}
+
+	// halve an RGBA image along each axis that is larger than the new size
+	void ReduceImage(const std::vector<unsigned char>& source, int sourceWidth, int sourceHeight,
+		std::vector<unsigned char>& destination, int width, int height)
+	{
+		int stepX = sourceWidth / width;
+		int stepY = sourceHeight / height;
+		destination.resize((size_t)width * height * 4);
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					int sum = 0;
+					for (int j = 0; j < stepY; j++)
+					{
+						for (int i = 0; i < stepX; i++)
+						{
+							sum += source[((size_t)(y * stepY + j) * sourceWidth + x * stepX + i) * 4 + c];
+						}
+					}
+					int count = stepX * stepY;
+					destination[((size_t)y * width + x) * 4 + c] = (unsigned char)((sum + count / 2) / count);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  VirtualTextureSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+VirtualTextureSystem::VirtualTextureSystem()
+{
+	m_pAssetPack = NULL;
+	m_tileCacheID = 0;
+	m_bCancel = false;
+	m_feedbackFramebuffer = 0;
+	m_feedbackColorBuffer = 0;
+	m_feedbackDepthBuffer = 0;
+	m_feedbackWidth = 0;
+	m_feedbackHeight = 0;
+	m_feedbackPixelBuffer = 0;
+	m_bFeedbackPending = false;
+	m_feedbackFence = 0;
+	m_previousFramebuffer = 0;
+	m_frame = 0;
+	m_feedbackFrame = 0;
+	memset(m_previousViewport, 0, sizeof(m_previousViewport));
+	memset(m_previousClearColor, 0, sizeof(m_previousClearColor));
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  ~VirtualTextureSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+VirtualTextureSystem::~VirtualTextureSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_loadMutex);
+		m_bCancel = true;
+	}
+	m_loadCondition.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		RenderState::DeleteTextures(1, &m_textures[i].pageTableID);
+	}
+	if (m_tileCacheID != 0)
+	{
+		RenderState::DeleteTextures(1, &m_tileCacheID);
+	}
+	if (m_feedbackFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_feedbackFramebuffer);
+		glDeleteRenderbuffers(1, &m_feedbackColorBuffer);
+		glDeleteRenderbuffers(1, &m_feedbackDepthBuffer);
+		glDeleteBuffers(1, &m_feedbackPixelBuffer);
+	}
+	if (m_feedbackFence != 0)
+	{
+		glDeleteSync(m_feedbackFence);
+	}
+}
+
+/***********************************************************
+ *  GetTileSize()
+ *
+ *  This method is used for getting the width and height of
+ *  the image data in every tile, in texels.
+ ***********************************************************/
+int VirtualTextureSystem::GetTileSize()
+{
+	return(g_TileSize);
+}
+
+/***********************************************************
+ *  GetTileBorder()
+ *
+ *  This method is used for getting the width of the border
+ *  around every tile in the tile cache, in texels.
+ ***********************************************************/
+int VirtualTextureSystem::GetTileBorder()
+{
+	return(g_TileBorder);
+}
+
+/***********************************************************
+ *  GetTileCacheSize()
+ *
+ *  This method is used for getting the width and height of
+ *  the physical tile cache texture, in texels.
+ ***********************************************************/
+int VirtualTextureSystem::GetTileCacheSize() const
+{
+	return(g_CacheSlotsPerRow * g_TileSlotSize);
+}
+
+/***********************************************************
+ *  GetFeedbackMipBias()
+ *
+ *  This method is used for getting the bias added to the
+ *  mip level in the feedback pass, which is drawn at a lower
+ *  resolution than the frame and so has larger derivatives.
+ ***********************************************************/
+float VirtualTextureSystem::GetFeedbackMipBias() const
+{
+	return(-std::log2((float)g_FeedbackDivisor));
+}
+
+/***********************************************************
+ *  MakeTileKey()
+ *
+ *  This method is used for packing the virtual texture,
+ *  the mip level and the position of a tile into one key.
+ *  A key is never 0.
+ ***********************************************************/
+uint64_t VirtualTextureSystem::MakeTileKey(int texture, int level, int x, int y)
+{
+	return(((uint64_t)(texture + 1) << 48) | ((uint64_t)level << 40) | ((uint64_t)y << 20) | (uint64_t)x);
+}
+
+/***********************************************************
+ *  SplitTileKey()
+ *
+ *  This method is used for getting the virtual texture, the
+ *  mip level and the position of a tile back from its key.
+ ***********************************************************/
+void VirtualTextureSystem::SplitTileKey(uint64_t tileKey, int& texture, int& level, int& x, int& y)
+{
+	texture = (int)(tileKey >> 48) - 1;
+	level = (int)((tileKey >> 40) & 0xFF);
+	y = (int)((tileKey >> 20) & 0xFFFFF);
+	x = (int)(tileKey & 0xFFFFF);
+}
+
+/***********************************************************
+ *  GetLevelPages()
+ *
+ *  This method is used for getting the number of tiles
+ *  across and down a mip level of a virtual texture.  An
+ *  axis that is a single tile wide is not reduced further.
+ ***********************************************************/
+void VirtualTextureSystem::GetLevelPages(const VIRTUAL_TEXTURE& texture, int level, int& pagesX, int& pagesY) const
+{
+	pagesX = std::max(1, texture.pagesX >> level);
+	pagesY = std::max(1, texture.pagesY >> level);
+}
+
+/***********************************************************
+ *  GetTileTexels()
+ *
+ *  This method is used for getting the texels of a tile,
+ *  border included, in the mapped tile file.
+ ***********************************************************/
+const unsigned char* VirtualTextureSystem::GetTileTexels(const VIRTUAL_TEXTURE& texture, int level, int x, int y) const
+{
+	int pagesX, pagesY;
+	GetLevelPages(texture, level, pagesX, pagesY);
+	size_t tile = texture.levelFirstTile[level] + (size_t)y * pagesX + x;
+	return(texture.pData + sizeof(TILE_FILE_HEADER) + tile * g_TileBytes);
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for opening a virtual texture tile
+ *  file, from the asset pack when it holds the file, and
+ *  creating its page table.  The single tile of the
+ *  coarsest mip level is loaded right away, so every page
+ *  has a tile to fall back to.  Returns the index of the
+ *  virtual texture, or -1 if the file is missing or invalid.
+ ***********************************************************/
+int VirtualTextureSystem::Open(const char* filename)
+{
+	VIRTUAL_TEXTURE texture;
+	texture.filename = filename;
+	texture.pData = NULL;
+	texture.dataSize = 0;
+	if ((m_pAssetPack == NULL) || (m_pAssetPack->Find(filename, texture.pData, texture.dataSize) == false))
+	{
+		texture.pMappedFile.reset(new MappedFile());
+		if (texture.pMappedFile->Open(filename) == false)
+		{
+			return(-1);
+		}
+		texture.pData = texture.pMappedFile->GetData();
+		texture.dataSize = texture.pMappedFile->GetSize();
+	}
+
+	// validate the header before trusting any of the sizes in it
+	TILE_FILE_HEADER header;
+	if (texture.dataSize < sizeof(header))
+	{
+		std::cout << "Ignoring invalid virtual texture file: " << filename << std::endl;
+		return(-1);
+	}
+	memcpy(&header, texture.pData, sizeof(header));
+
+	if ((memcmp(header.magic, g_TileFileMagic, sizeof(g_TileFileMagic)) != 0) ||
+		(header.version != g_TileFileVersion) ||
+		(header.tileSize != (uint32_t)g_TileSize) || (header.border != (uint32_t)g_TileBorder) ||
+		(header.width == 0) || (header.height == 0) ||
+		(header.width % g_TileSize != 0) || (header.height % g_TileSize != 0) ||
+		(header.width / g_TileSize > 256) || (header.height / g_TileSize > 256) ||
+		(header.levelCount == 0) || (header.levelCount > 16))
+	{
+		std::cout << "Ignoring invalid virtual texture file: " << filename << std::endl;
+		return(-1);
+	}
+
+	texture.pagesX = (int)(header.width / g_TileSize);
+	texture.pagesY = (int)(header.height / g_TileSize);
+	texture.levelCount = (int)header.levelCount;
+
+	size_t tileCount = 0;
+	for (int level = 0; level < texture.levelCount; level++)
+	{
+		int pagesX, pagesY;
+		GetLevelPages(texture, level, pagesX, pagesY);
+		texture.levelFirstTile.push_back(tileCount);
+		texture.pageTable.push_back(std::vector<unsigned char>((size_t)pagesX * pagesY * 4, 0));
+		tileCount += (size_t)pagesX * pagesY;
+	}
+
+	int topPagesX, topPagesY;
+	GetLevelPages(texture, texture.levelCount - 1, topPagesX, topPagesY);
+	if ((topPagesX != 1) || (topPagesY != 1) ||
+		(texture.dataSize < sizeof(header) + tileCount * g_TileBytes))
+	{
+		std::cout << "Ignoring truncated virtual texture file: " << filename << std::endl;
+		return(-1);
+	}
+
+	if (m_tileCacheID == 0)
+	{
+		Initialize();
+	}
+
+	// the page table has a texel for every tile of every mip level
+	texture.pageTableID = GLResources::CreateTexture(GL_TEXTURE_2D);
+	GLResources::TextureStorage(texture.pageTableID, GL_TEXTURE_2D, texture.levelCount, GL_RGBA8,
+		texture.pagesX, texture.pagesY);
+	GLResources::TextureParameter(texture.pageTableID, GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levelCount - 1);
+
+	int index = (int)m_textures.size();
+	texture.bPageTableDirty = true;
+	{
+		// the workers read the texture list while loading tiles
+		std::lock_guard<std::mutex> lock(m_loadMutex);
+		m_textures.push_back(std::move(texture));
+	}
+
+	LOADED_TILE topTile;
+	topTile.tileKey = MakeTileKey(index, m_textures[index].levelCount - 1, 0, 0);
+	const unsigned char* pTopTile = GetTileTexels(m_textures[index], m_textures[index].levelCount - 1, 0, 0);
+	topTile.texels.assign(pTopTile, pTopTile + g_TileBytes);
+	UploadTile(topTile, true);
+	UpdatePageTable(index);
+
+	m_stats.textureCount++;
+	m_stats.virtualBytes += tileCount * g_TileSize * g_TileSize * 4;
+
+	std::cout << "Opened virtual texture: " << filename << " (" << header.width << "x" << header.height
+		<< ", " << m_textures[index].levelCount << " levels, " << tileCount << " tiles)" << std::endl;
+
+	return(index);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for allocating the physical tile
+ *  cache texture and starting the worker threads that read
+ *  the tiles.
+ ***********************************************************/
+void VirtualTextureSystem::Initialize()
+{
+	int cacheSize = GetTileCacheSize();
+
+	m_tileCacheID = GLResources::CreateTexture(GL_TEXTURE_2D);
+	GLResources::TextureStorage(m_tileCacheID, GL_TEXTURE_2D, 1, GL_RGBA8, cacheSize, cacheSize);
+	GLResources::TextureParameter(m_tileCacheID, GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	CACHE_SLOT freeSlot;
+	freeSlot.tileKey = 0;
+	freeSlot.lastUsedFrame = -1;
+	freeSlot.bPinned = false;
+	m_cacheSlots.assign(g_CacheSlotsPerRow * g_CacheSlotsPerRow, freeSlot);
+
+	m_stats.cacheSlots = (int)m_cacheSlots.size();
+	m_stats.cacheBytes = (size_t)cacheSize * cacheSize * 4;
+
+	for (int i = 0; i < g_TileWorkerCount; i++)
+	{
+		m_workers.push_back(std::thread(&VirtualTextureSystem::LoadWorker, this));
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for processing the feedback that was
+ *  read back in an earlier frame once the GPU has written
+ *  it, so mapping it never waits, uploading the tiles that
+ *  the workers have loaded since the last frame, and
+ *  updating the page tables of the virtual textures whose
+ *  tiles changed.
+ ***********************************************************/
+void VirtualTextureSystem::Update()
+{
+	m_frame++;
+	if (m_textures.empty() == true)
+	{
+		return;
+	}
+
+	// the read back is left for a later frame while the GPU is behind,
+	// and a fence that cannot be waited on is not waited on again
+	bool bFeedbackReady = false;
+	if (m_bFeedbackPending == true)
+	{
+		bFeedbackReady = true;
+		if (m_feedbackFence != 0)
+		{
+			GLenum result = glClientWaitSync(m_feedbackFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			bFeedbackReady = ((result == GL_ALREADY_SIGNALED) || (result == GL_CONDITION_SATISFIED) ||
+				(result == GL_WAIT_FAILED));
+			if (bFeedbackReady == true)
+			{
+				glDeleteSync(m_feedbackFence);
+				m_feedbackFence = 0;
+			}
+			else
+			{
+				m_stats.feedbackDelays++;
+			}
+		}
+	}
+	if (bFeedbackReady == true)
+	{
+		const unsigned char* pFeedback = (const unsigned char*)GLResources::MapBufferRange(
+			m_feedbackPixelBuffer, GL_PIXEL_PACK_BUFFER, 0,
+			(GLsizeiptr)m_feedbackWidth * m_feedbackHeight * 4, GL_MAP_READ_BIT);
+		if (pFeedback != NULL)
+		{
+			ProcessFeedback(pFeedback, m_feedbackWidth, m_feedbackHeight);
+			GLResources::UnmapBuffer(m_feedbackPixelBuffer, GL_PIXEL_PACK_BUFFER);
+		}
+		m_bFeedbackPending = false;
+	}
+
+	std::vector<LOADED_TILE> loadedTiles;
+	{
+		std::lock_guard<std::mutex> lock(m_loadMutex);
+		size_t count = std::min(m_loadedTiles.size(), (size_t)g_MaxTileUploadsPerFrame);
+		for (size_t i = 0; i < count; i++)
+		{
+			loadedTiles.push_back(std::move(m_loadedTiles[i]));
+		}
+		m_loadedTiles.erase(m_loadedTiles.begin(), m_loadedTiles.begin() + count);
+	}
+
+	for (size_t i = 0; i < loadedTiles.size(); i++)
+	{
+		// a tile with no free slot is requested again by a later feedback
+		m_pendingTiles.erase(loadedTiles[i].tileKey);
+		UploadTile(loadedTiles[i], false);
+	}
+
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		if (m_textures[i].bPageTableDirty == true)
+		{
+			UpdatePageTable((int)i);
+		}
+	}
+}
+
+/***********************************************************
+ *  ProcessFeedback()
+ *
+ *  This method is used for collecting the tiles sampled in
+ *  the feedback pass, with every coarser tile covering
+ *  them.  Resident tiles are marked as used, and the
+ *  missing ones are queued for the workers, coarsest first
+ *  so a blurry version of a surface shows up soonest.
+ ***********************************************************/
+void VirtualTextureSystem::ProcessFeedback(const unsigned char* pFeedback, int width, int height)
+{
+	std::unordered_set<uint64_t> requestedTiles;
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		const unsigned char* pPixel = pFeedback + i * 4;
+		int texture = (int)pPixel[3] - 1;
+		int level = pPixel[2];
+		int x = pPixel[0];
+		int y = pPixel[1];
+		if ((texture < 0) || (texture >= (int)m_textures.size()) || (level >= m_textures[texture].levelCount))
+		{
+			continue;
+		}
+
+		int pagesX, pagesY;
+		GetLevelPages(m_textures[texture], level, pagesX, pagesY);
+		if ((x >= pagesX) || (y >= pagesY))
+		{
+			continue;
+		}
+
+		// the coarser tiles are already in the set when this one is
+		for (; level < m_textures[texture].levelCount; level++)
+		{
+			if (requestedTiles.insert(MakeTileKey(texture, level, x, y)).second == false)
+			{
+				break;
+			}
+			x /= 2;
+			y /= 2;
+		}
+	}
+
+	m_feedbackFrame++;
+
+	std::vector<uint64_t> missingTiles;
+	for (std::unordered_set<uint64_t>::const_iterator it = requestedTiles.begin(); it != requestedTiles.end(); ++it)
+	{
+		std::unordered_map<uint64_t, int>::iterator found = m_residentTiles.find(*it);
+		if (found != m_residentTiles.end())
+		{
+			m_cacheSlots[found->second].lastUsedFrame = m_feedbackFrame;
+		}
+		else if (m_pendingTiles.count(*it) == 0)
+		{
+			missingTiles.push_back(*it);
+		}
+	}
+
+	// the mip level is in the bits above the tile position
+	std::sort(missingTiles.begin(), missingTiles.end(),
+		[](uint64_t a, uint64_t b)
+		{
+			return(((a >> 40) & 0xFF) > ((b >> 40) & 0xFF));
+		});
+
+	{
+		std::lock_guard<std::mutex> lock(m_loadMutex);
+		for (size_t i = 0; (i < missingTiles.size()) && (m_loadQueue.size() < g_MaxQueuedTiles); i++)
+		{
+			m_loadQueue.push_back(missingTiles[i]);
+			m_pendingTiles.insert(missingTiles[i]);
+		}
+	}
+	m_loadCondition.notify_all();
+}
+
+/***********************************************************
+ *  LoadWorker()
+ *
+ *  This method is run by each worker thread.  It copies the
+ *  queued tiles out of their mapped tile files, which reads
+ *  them from the disk, until the system is destroyed.
+ ***********************************************************/
+void VirtualTextureSystem::LoadWorker()
+{
+	while (true)
+	{
+		LOADED_TILE tile;
+		const unsigned char* pTexels = NULL;
+		{
+			std::unique_lock<std::mutex> lock(m_loadMutex);
+			m_loadCondition.wait(lock,
+				[this]()
+				{
+					return((m_bCancel == true) || (m_loadQueue.empty() == false));
+				});
+			if (m_bCancel == true)
+			{
+				return;
+			}
+
+			tile.tileKey = m_loadQueue.front();
+			m_loadQueue.erase(m_loadQueue.begin());
+
+			int texture, level, x, y;
+			SplitTileKey(tile.tileKey, texture, level, x, y);
+			pTexels = GetTileTexels(m_textures[texture], level, x, y);
+		}
+
+		tile.texels.assign(pTexels, pTexels + g_TileBytes);
+
+		std::lock_guard<std::mutex> lock(m_loadMutex);
+		m_loadedTiles.push_back(std::move(tile));
+	}
+}
+
+/***********************************************************
+ *  UploadTile()
+ *
+ *  This method is used for copying a loaded tile into a
+ *  free slot of the tile cache, or else into the slot of
+ *  the least recently used tile that the last feedback did
+ *  not ask for.  Returns false if every slot is in use.
+ ***********************************************************/
+bool VirtualTextureSystem::UploadTile(const LOADED_TILE& tile, bool bPinned)
+{
+	int slot = -1;
+	for (int i = 0; i < (int)m_cacheSlots.size(); i++)
+	{
+		const CACHE_SLOT& cacheSlot = m_cacheSlots[i];
+		if (cacheSlot.tileKey == 0)
+		{
+			slot = i;
+			break;
+		}
+		if ((cacheSlot.bPinned == false) && (cacheSlot.lastUsedFrame < m_feedbackFrame) &&
+			((slot < 0) || (cacheSlot.lastUsedFrame < m_cacheSlots[slot].lastUsedFrame)))
+		{
+			slot = i;
+		}
+	}
+
+	if (slot < 0)
+	{
+		return(false);
+	}
+
+	int texture, level, x, y;
+	if (m_cacheSlots[slot].tileKey != 0)
+	{
+		// the page table falls back to a coarser tile for the evicted one
+		SplitTileKey(m_cacheSlots[slot].tileKey, texture, level, x, y);
+		m_residentTiles.erase(m_cacheSlots[slot].tileKey);
+		m_textures[texture].bPageTableDirty = true;
+		m_stats.tilesEvicted++;
+		m_stats.residentTiles--;
+	}
+
+	// the texels come from client memory, not a pixel buffer object
+	GLint previousPixelBuffer = 0;
+	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &previousPixelBuffer);
+	if (previousPixelBuffer != 0)
+	{
+		GLResources::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	GLResources::TextureSubImage(m_tileCacheID, GL_TEXTURE_2D, 0,
+		(slot % g_CacheSlotsPerRow) * g_TileSlotSize, (slot / g_CacheSlotsPerRow) * g_TileSlotSize, 0,
+		g_TileSlotSize, g_TileSlotSize, GL_RGBA, GL_UNSIGNED_BYTE, tile.texels.data());
+	if (previousPixelBuffer != 0)
+	{
+		GLResources::BindBuffer(GL_PIXEL_UNPACK_BUFFER, previousPixelBuffer);
+	}
+
+	m_cacheSlots[slot].tileKey = tile.tileKey;
+	m_cacheSlots[slot].lastUsedFrame = m_feedbackFrame;
+	m_cacheSlots[slot].bPinned = bPinned;
+	m_residentTiles[tile.tileKey] = slot;
+
+	SplitTileKey(tile.tileKey, texture, level, x, y);
+	m_textures[texture].bPageTableDirty = true;
+	m_stats.tilesLoaded++;
+	m_stats.residentTiles++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  UpdatePageTable()
+ *
+ *  This method is used for rebuilding the page table of a
+ *  virtual texture from the coarsest mip level down.  Each
+ *  entry holds the cache slot of its tile and the mip level
+ *  of that tile, and a tile that is not resident takes the
+ *  entry of the tile covering it one level up.
+ ***********************************************************/
+void VirtualTextureSystem::UpdatePageTable(int index)
+{
+	VIRTUAL_TEXTURE& texture = m_textures[index];
+
+	// the entries come from client memory, not a pixel buffer object
+	GLint previousPixelBuffer = 0;
+	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &previousPixelBuffer);
+	if (previousPixelBuffer != 0)
+	{
+		GLResources::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	for (int level = texture.levelCount - 1; level >= 0; level--)
+	{
+		int pagesX, pagesY, parentPagesX, parentPagesY;
+		GetLevelPages(texture, level, pagesX, pagesY);
+		GetLevelPages(texture, level + 1, parentPagesX, parentPagesY);
+
+		std::vector<unsigned char>& entries = texture.pageTable[level];
+		for (int y = 0; y < pagesY; y++)
+		{
+			for (int x = 0; x < pagesX; x++)
+			{
+				unsigned char* pEntry = &entries[((size_t)y * pagesX + x) * 4];
+				std::unordered_map<uint64_t, int>::const_iterator found =
+					m_residentTiles.find(MakeTileKey(index, level, x, y));
+				if (found != m_residentTiles.end())
+				{
+					pEntry[0] = (unsigned char)(found->second % g_CacheSlotsPerRow);
+					pEntry[1] = (unsigned char)(found->second / g_CacheSlotsPerRow);
+					pEntry[2] = (unsigned char)level;
+					pEntry[3] = 255;
+				}
+				else if (level + 1 < texture.levelCount)
+				{
+					const std::vector<unsigned char>& parentEntries = texture.pageTable[level + 1];
+					memcpy(pEntry, &parentEntries[((size_t)(y / 2) * parentPagesX + (x / 2)) * 4], 4);
+				}
+			}
+		}
+
+		GLResources::TextureSubImage(texture.pageTableID, GL_TEXTURE_2D, level, 0, 0, 0,
+			pagesX, pagesY, GL_RGBA, GL_UNSIGNED_BYTE, entries.data());
+	}
+
+	if (previousPixelBuffer != 0)
+	{
+		GLResources::BindBuffer(GL_PIXEL_UNPACK_BUFFER, previousPixelBuffer);
+	}
+
+	texture.bPageTableDirty = false;
+}
+
+/***********************************************************
+ *  BeginFeedback()
+ *
+ *  This method is used for starting the feedback pass of
+ *  the frame, every few frames while the last read back
+ *  has been processed.  The scene is then drawn into a
+ *  small framebuffer, with each virtual textured pixel
+ *  writing the tile it samples.  Returns false when there
+ *  is no feedback pass in this frame.
+ ***********************************************************/
+bool VirtualTextureSystem::BeginFeedback()
+{
+	if ((m_textures.empty() == true) || (m_bFeedbackPending == true) || ((m_frame % g_FeedbackInterval) != 0))
+	{
+		return(false);
+	}
+
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, m_previousViewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, m_previousClearColor);
+
+	int width = std::max(1, m_previousViewport[2] / g_FeedbackDivisor);
+	int height = std::max(1, m_previousViewport[3] / g_FeedbackDivisor);
+
+	// the framebuffer follows the size of the window
+	if ((m_feedbackFramebuffer == 0) || (width != m_feedbackWidth) || (height != m_feedbackHeight))
+	{
+		if (m_feedbackFramebuffer == 0)
+		{
+			m_feedbackFramebuffer = GLResources::CreateFramebuffer();
+			m_feedbackColorBuffer = GLResources::CreateRenderbuffer();
+			m_feedbackDepthBuffer = GLResources::CreateRenderbuffer();
+			m_feedbackPixelBuffer = GLResources::CreateBuffer();
+		}
+
+		GLResources::RenderbufferStorage(m_feedbackColorBuffer, GL_RGBA8, width, height);
+		GLResources::RenderbufferStorage(m_feedbackDepthBuffer, GL_DEPTH_COMPONENT24, width, height);
+
+		GLResources::FramebufferRenderbuffer(m_feedbackFramebuffer, GL_COLOR_ATTACHMENT0, m_feedbackColorBuffer);
+		GLResources::FramebufferRenderbuffer(m_feedbackFramebuffer, GL_DEPTH_ATTACHMENT, m_feedbackDepthBuffer);
+		if (GLResources::CheckFramebufferStatus(m_feedbackFramebuffer) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cerr << "Virtual texture feedback framebuffer is incomplete" << std::endl;
+			return(false);
+		}
+
+		GLResources::BufferData(m_feedbackPixelBuffer, GL_PIXEL_PACK_BUFFER,
+			(GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+
+		m_feedbackWidth = width;
+		m_feedbackHeight = height;
+	}
+
+	GLResources::BindFramebuffer(m_feedbackFramebuffer);
+	glViewport(0, 0, width, height);
+	RenderState::SetPipelineState(RenderState::GetOpaqueState());
+
+	// an alpha of 0 marks the pixels that request no tile
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	return(true);
+}
+
+/***********************************************************
+ *  EndFeedback()
+ *
+ *  This method is used for starting the read back of the
+ *  feedback pass into a pixel buffer object, which is
+ *  processed in the next frame so the render thread does
+ *  not wait for it, and restoring the framebuffer.
+ ***********************************************************/
+void VirtualTextureSystem::EndFeedback()
+{
+	GLResources::BindBuffer(GL_PIXEL_PACK_BUFFER, m_feedbackPixelBuffer);
+	glReadPixels(0, 0, m_feedbackWidth, m_feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	GLResources::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_bFeedbackPending = true;
+	m_feedbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	GLResources::BindFramebuffer(m_previousFramebuffer);
+	glViewport(m_previousViewport[0], m_previousViewport[1], m_previousViewport[2], m_previousViewport[3]);
+	glClearColor(m_previousClearColor[0], m_previousClearColor[1], m_previousClearColor[2], m_previousClearColor[3]);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for splitting an image file into a
+ *  virtual texture tile file.  The image is resampled to a
+ *  whole power of two number of tiles, and each mip level
+ *  is written tile by tile, finest level first, with a
+ *  border copied from the neighboring tiles.  The image
+ *  repeats, so the border wraps around at the edges.
+ ***********************************************************/
+bool VirtualTextureSystem::Build(const char* imageFilename, const char* tileFilename)
+{
+	MappedFile sourceFile;
+	TEXTURE_IMAGE image;
+	stbi_set_flip_vertically_on_load(true);
+	if ((sourceFile.Open(imageFilename) == false) ||
+		(ImageDecoder::DecodeImage(sourceFile.GetData(), sourceFile.GetSize(), 1, image) == false) ||
+		((image.colorChannels != 3) && (image.colorChannels != 4)))
+	{
+		std::cerr << "Failed to load image: " << imageFilename << std::endl;
+		return(false);
+	}
+
+	std::vector<unsigned char> texels((size_t)image.width * image.height * 4);
+	for (size_t i = 0; i < (size_t)image.width * image.height; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			texels[i * 4 + c] = (c < image.colorChannels) ? image.pData[i * image.colorChannels + c] : 255;
+		}
+	}
+
+	int width = std::max(g_TileSize, NextPowerOfTwo(image.width));
+	int height = std::max(g_TileSize, NextPowerOfTwo(image.height));
+	if ((width / g_TileSize > 256) || (height / g_TileSize > 256))
+	{
+		std::cerr << "Image is too large for a virtual texture: " << imageFilename << std::endl;
+		return(false);
+	}
+	if ((width != image.width) || (height != image.height))
+	{
+		std::vector<unsigned char> resampled;
+		ResampleImage(texels, image.width, image.height, resampled, width, height);
+		texels.swap(resampled);
+	}
+
+	TILE_FILE_HEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, g_TileFileMagic, sizeof(g_TileFileMagic));
+	header.version = g_TileFileVersion;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.tileSize = (uint32_t)g_TileSize;
+	header.border = (uint32_t)g_TileBorder;
+	header.levelCount = 1;
+	while ((width >> (header.levelCount - 1) > g_TileSize) || (height >> (header.levelCount - 1) > g_TileSize))
+	{
+		header.levelCount++;
+	}
+
+	FILE* pFile = fopen(tileFilename, "wb");
+	if (pFile == NULL)
+	{
+		std::cerr << "Failed to create: " << tileFilename << std::endl;
+		return(false);
+	}
+	bool bSuccess = (fwrite(&header, sizeof(header), 1, pFile) == 1);
+
+	std::vector<unsigned char> tile(g_TileBytes);
+	int levelWidth = width;
+	int levelHeight = height;
+	for (uint32_t level = 0; (level < header.levelCount) && bSuccess; level++)
+	{
+		for (int tileY = 0; (tileY < levelHeight / g_TileSize) && bSuccess; tileY++)
+		{
+			for (int tileX = 0; (tileX < levelWidth / g_TileSize) && bSuccess; tileX++)
+			{
+				for (int y = 0; y < g_TileSlotSize; y++)
+				{
+					int sourceY = (tileY * g_TileSize - g_TileBorder + y + levelHeight) % levelHeight;
+					for (int x = 0; x < g_TileSlotSize; x++)
+					{
+						int sourceX = (tileX * g_TileSize - g_TileBorder + x + levelWidth) % levelWidth;
+						memcpy(&tile[((size_t)y * g_TileSlotSize + x) * 4],
+							&texels[((size_t)sourceY * levelWidth + sourceX) * 4], 4);
+					}
+				}
+				bSuccess = (fwrite(tile.data(), 1, tile.size(), pFile) == tile.size());
+			}
+		}
+
+		// an axis that is a single tile wide is not reduced further
+		int nextWidth = std::max(g_TileSize, levelWidth / 2);
+		int nextHeight = std::max(g_TileSize, levelHeight / 2);
+		std::vector<unsigned char> reduced;
+		ReduceImage(texels, levelWidth, levelHeight, reduced, nextWidth, nextHeight);
+		texels.swap(reduced);
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+
+	bSuccess = (fclose(pFile) == 0) && bSuccess;
+	if (bSuccess == false)
+	{
+		std::cerr << "Failed to write: " << tileFilename << std::endl;
+		remove(tileFilename);
+		return(false);
+	}
+
+	std::cout << tileFilename << ": " << width << "x" << height << ", " << header.levelCount << " levels" << std::endl;
+	return(true);
+}
@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////
+// virtualtexturesystem.h
+// ============
+// stream the visible tiles of very large textures into a shared tile cache
+//
+//  AUTHOR: Alan Chumsawang
+//	Created for CS-330-Computational Graphics and Visualization, Oct. 21st, 2024
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "AssetPack.h"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/***********************************************************
+ *  VIRTUAL_TEXTURE_STATS
+ *
+ *  Live statistics of the virtual texture tile streaming.
+ ***********************************************************/
+struct VIRTUAL_TEXTURE_STATS
+{
+	int textureCount;
+	// tiles in the physical tile cache and the number of slots for them
+	int residentTiles;
+	int cacheSlots;
+	// texture memory of the tile cache and of every virtual texture in full
+	size_t cacheBytes;
+	size_t virtualBytes;
+	// number of tiles streamed into the cache and evicted from it
+	int tilesLoaded;
+	int tilesEvicted;
+	// frames a feedback read back was left for, since the GPU had not
+	// finished writing it yet
+	int feedbackDelays;
+};
+
+/***********************************************************
+ *  VirtualTextureSystem
+ *
+ *  This class draws textures that are far larger than the
+ *  texture memory they are given.  Each virtual texture is
+ *  a tile file holding its mip chain split into fixed-size
+ *  tiles.  A low resolution feedback pass records which
+ *  tiles the frame samples, the feedback is read back a
+ *  frame later, and the missing tiles are read on worker
+ *  threads and uploaded into one shared physical tile cache.
+ *  A page table texture for every virtual texture points
+ *  each tile at its slot in the cache, or at the closest
+ *  coarser tile that is resident.
+ ***********************************************************/
+class VirtualTextureSystem
+{
+public:
+	// constructor
+	VirtualTextureSystem();
+	// destructor
+	~VirtualTextureSystem();
+
+	// open a virtual texture tile file, returns its index or -1
+	int Open(const char* filename);
+	// set the asset pack searched for tile files before the disk
+	void SetAssetPack(AssetPack* pAssetPack) { m_pAssetPack = pAssetPack; }
+	// get the number of open virtual textures
+	int GetCount() const { return (int)m_textures.size(); }
+
+	// process the last feedback, stream the tiles it needs and update
+	// the page tables - call once per frame before drawing
+	void Update();
+	// start the feedback pass of this frame, returns false if there is none
+	bool BeginFeedback();
+	// read back the feedback pass and restore the framebuffer
+	void EndFeedback();
+	// get the mip bias that makes the feedback pass pick the same mip
+	// levels as the full resolution frame
+	float GetFeedbackMipBias() const;
+
+	// get the page table texture of a virtual texture
+	GLuint GetPageTableID(int index) const { return m_textures[index].pageTableID; }
+	// get the number of mip levels of a virtual texture
+	int GetLevelCount(int index) const { return m_textures[index].levelCount; }
+	// get the physical tile cache texture shared by every virtual texture
+	GLuint GetTileCacheID() const { return m_tileCacheID; }
+	// get the size of the physical tile cache texture in texels
+	int GetTileCacheSize() const;
+	// get the size of a tile and of the border around it, in texels
+	static int GetTileSize();
+	static int GetTileBorder();
+	// get the live tile streaming statistics
+	const VIRTUAL_TEXTURE_STATS& GetStats() const { return m_stats; }
+
+	// split an image file into the tiles of a virtual texture file
+	static bool Build(const char* imageFilename, const char* tileFilename);
+
+private:
+	struct VIRTUAL_TEXTURE
+	{
+		std::string filename;
+		// tile file mapped on its own, or NULL when read from the pack
+		std::unique_ptr<MappedFile> pMappedFile;
+		const unsigned char* pData;
+		size_t dataSize;
+		// number of tiles across and down at level 0
+		int pagesX;
+		int pagesY;
+		int levelCount;
+		// index of the first tile of each mip level in the file
+		std::vector<size_t> levelFirstTile;
+		// page table texture and its RGBA entries for every mip level
+		GLuint pageTableID;
+		std::vector<std::vector<unsigned char>> pageTable;
+		bool bPageTableDirty;
+	};
+
+	struct CACHE_SLOT
+	{
+		// tile held by the slot, 0 when the slot is free
+		uint64_t tileKey;
+		// feedback frame the tile was last requested in
+		int lastUsedFrame;
+		// the coarsest tile of each texture is never evicted
+		bool bPinned;
+	};
+
+	struct LOADED_TILE
+	{
+		uint64_t tileKey;
+		std::vector<unsigned char> texels;
+	};
+
+	// pack a virtual texture, mip level and tile position into a key
+	static uint64_t MakeTileKey(int texture, int level, int x, int y);
+	static void SplitTileKey(uint64_t tileKey, int& texture, int& level, int& x, int& y);
+	// get the number of tiles across and down a mip level
+	void GetLevelPages(const VIRTUAL_TEXTURE& texture, int level, int& pagesX, int& pagesY) const;
+	// get the texels of a tile in its file
+	const unsigned char* GetTileTexels(const VIRTUAL_TEXTURE& texture, int level, int x, int y) const;
+
+	// create the tile cache texture and start the worker threads
+	void Initialize();
+	// queue every tile in the last read back feedback that is missing
+	void ProcessFeedback(const unsigned char* pFeedback, int width, int height);
+	// copy queued tiles out of their files - runs on worker threads
+	void LoadWorker();
+	// copy a loaded tile into a free or least recently used cache slot
+	bool UploadTile(const LOADED_TILE& tile, bool bPinned);
+	// rebuild the page table of a virtual texture and upload it
+	void UpdatePageTable(int index);
+
+	// asset pack holding tile files, NULL if none
+	AssetPack* m_pAssetPack;
+	// all of the open virtual textures
+	std::vector<VIRTUAL_TEXTURE> m_textures;
+	// physical tile cache texture and the state of each of its slots
+	GLuint m_tileCacheID;
+	std::vector<CACHE_SLOT> m_cacheSlots;
+	// cache slot of each resident tile
+	std::unordered_map<uint64_t, int> m_residentTiles;
+	// tiles queued or being loaded - only used on the render thread
+	std::unordered_set<uint64_t> m_pendingTiles;
+
+	// tiles waiting for a worker, coarsest first, guarded by m_loadMutex
+	std::vector<uint64_t> m_loadQueue;
+	// tiles loaded by the workers, guarded by m_loadMutex
+	std::vector<LOADED_TILE> m_loadedTiles;
+	std::mutex m_loadMutex;
+	std::condition_variable m_loadCondition;
+	std::vector<std::thread> m_workers;
+	std::atomic<bool> m_bCancel;
+
+	// low resolution framebuffer the feedback pass is drawn into
+	GLuint m_feedbackFramebuffer;
+	GLuint m_feedbackColorBuffer;
+	GLuint m_feedbackDepthBuffer;
+	int m_feedbackWidth;
+	int m_feedbackHeight;
+	// pixel buffer object the feedback is read back through
+	GLuint m_feedbackPixelBuffer;
+	// set while a read back is waiting to be processed, and the fence
+	// that signals once the GPU has written it
+	bool m_bFeedbackPending;
+	GLsync m_feedbackFence;
+	// framebuffer, viewport and clear color to restore after the feedback pass
+	GLint m_previousFramebuffer;
+	GLint m_previousViewport[4];
+	GLfloat m_previousClearColor[4];
+	// frames drawn and feedback passes read back so far
+	int m_frame;
+	int m_feedbackFrame;
+
+	// live tile streaming statistics
+	VIRTUAL_TEXTURE_STATS m_stats;
+};
@@ -1,5 +1,43 @@
 #version 330 core
-out vec4 fragmentColor;
+// the variant of the shader being compiled, each define is set by the
+// application for every variant and the values here only apply when
+// the shader is compiled on its own
+// 0 = object color, 1 = 2D texture, 2 = texture array layer, 3 = virtual texture
+#ifndef TEXTURE_SOURCE
+#define TEXTURE_SOURCE 0
+#endif
+// 1 = Phong lighting, 0 = the surface color as is
+#ifndef LIGHTING
+#define LIGHTING 0
+#endif
+// 1 = the directional light is active
+#ifndef DIRECTIONAL_LIGHT
+#define DIRECTIONAL_LIGHT 0
+#endif
+// 0 = no point lights, 1 = every point light, 2 = the lights of the
+// cluster of the fragment
+#ifndef POINT_LIGHTS
+#define POINT_LIGHTS 0
+#endif
+// 1 = the spot light is active
+#ifndef SPOT_LIGHT
+#define SPOT_LIGHT 0
+#endif
+// 0 = forward shading, 1 = virtual texture feedback, 2 = deferred geometry
+#ifndef RENDER_PASS
+#define RENDER_PASS 0
+#endif
+// 1 = every light shares the material colors scaled by the surface,
+// 0 = the previous kernel, where each light scales them itself
+#ifndef LIGHTING_KERNEL
+#define LIGHTING_KERNEL 1
+#endif
+
+layout (location = 0) out vec4 fragmentColor;
+// the rest of the G-buffer, written only by the deferred geometry pass
+layout (location = 1) out vec4 gBufferNormal;
+layout (location = 2) out vec4 gBufferDiffuse;
+layout (location = 3) out vec4 gBufferSpecular;
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
@@ -11,6 +49,8 @@ struct Material {
     float shininess;
 }; 
 
+// the directional light is laid out by the std140 rules to match the
+// light buffer, every vec3 starts 16 bytes apart
 struct DirectionalLight {
     vec3 direction;
 	
@@ -21,16 +61,6 @@ struct DirectionalLight {
     bool bActive;
 };
 
-struct PointLight {
-    vec3 position;
-    
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    bool bActive;
-};
-
 struct SpotLight {
     vec3 position;
     vec3 direction;
@@ -48,178 +78,374 @@ struct SpotLight {
     bool bActive;
 };
 
-#define TOTAL_POINT_LIGHTS 5
+// the fragment being lit, with the albedo and the material colors it
+// scales worked out once and shared by every light
+struct Surface {
+    vec3 position;
+    vec3 normal;
+    vec3 viewDir;
+    // sampled again by every light of the previous kernel
+    vec2 textureCoordinate;
+    vec3 albedo;
+    vec3 diffuseAlbedo;
+    vec3 specularAlbedo;
+};
+
+// lights of the scene, uploaded only when they change
+layout (std140) uniform Lights
+{
+    DirectionalLight directionalLight;
+    int pointLightCount;
+    // clusters across, down and in depth, w = 1 to light each fragment
+    // with the lights of its cluster only
+    ivec4 clusterGrid;
+    // x, y = depth slice of the log of the view distance, z, w = cluster
+    // size in pixels
+    vec4 clusterDepth;
+};
+
+// point lights, four texels each - position and range, ambient,
+// diffuse and specular
+uniform samplerBuffer pointLightData;
+// offset and count of the light indices of each cluster
+uniform usamplerBuffer clusterLightRanges;
+// indices of the lights of every cluster, one cluster after another
+uniform usamplerBuffer clusterLightIndices;
+
+// camera shared by every program, written once per frame
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    vec4 position;
+} camera;
 
-uniform bool bUseTexture=false;
-uniform bool bUseLighting=false;
 uniform vec4 objectColor = vec4(1.0f);
-uniform vec3 viewPosition;
-uniform DirectionalLight directionalLight;
-uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
 uniform SpotLight spotLight;
 uniform Material material;
 uniform sampler2D objectTexture;
+uniform sampler2DArray objectTextureArray;
+uniform int textureLayer = 0;
+// finest mip level of the layer uploaded so far, 0 once it is complete
+uniform float textureLayerMinLevel = 0.0f;
 uniform vec2 UVscale = vec2(1.0f, 1.0f);
+uniform sampler2D virtualPageTable;
+uniform sampler2D virtualTileCache;
+// x = tile size, y = tile border, z = tile cache size, all in texels, w = mip level count
+uniform vec4 virtualTextureInfo;
+uniform int virtualTextureID = 0;
+uniform float virtualMipBias = 0.0f;
 
 // function prototypes
-vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+#if LIGHTING_KERNEL == 1
+vec2 PhongFactors(Surface surface, vec3 lightDir);
+#endif
+vec3 CalcDirectionalLight(DirectionalLight light, Surface surface);
+vec3 CalcPointLight(int index, Surface surface);
+vec3 CalcSpotLight(SpotLight light, Surface surface);
+vec4 SurfaceColor(vec2 textureCoordinate);
+vec4 SampleObjectTexture(vec2 textureCoordinate);
+float VirtualMipLevel(vec2 textureCoordinate);
+vec4 VirtualTextureFeedback(vec2 textureCoordinate);
+vec4 SampleVirtualTexture(vec2 textureCoordinate);
 
 void main()
 {    
-    if(bUseLighting == true)
+    // every pass samples the surface at the scaled texture coordinate
+    vec2 textureCoordinate = fragmentTextureCoordinate * UVscale;
+#if RENDER_PASS == 1
+    // the feedback pass only records the virtual texture tiles sampled
+#if TEXTURE_SOURCE == 3
+    fragmentColor = VirtualTextureFeedback(textureCoordinate);
+#else
+    fragmentColor = vec4(0.0f);
+#endif
+#elif RENDER_PASS == 2
+    // the deferred geometry pass stores the surface unlit, with the
+    // albedo in the color output and an alpha of 0 for unlit surfaces,
+    // and the lighting pass shades each pixel once
+    fragmentColor = vec4(SurfaceColor(textureCoordinate).rgb, float(LIGHTING));
+    gBufferNormal = vec4(normalize(fragmentVertexNormal), material.shininess);
+    gBufferDiffuse = vec4(material.diffuseColor, 1.0f);
+    gBufferSpecular = vec4(material.specularColor, 1.0f);
+#elif LIGHTING
+    // the surface is sampled once and shared by every light of the
+    // shared kernel, the previous kernel samples it again in each light
+    vec4 surfaceColor = SurfaceColor(textureCoordinate);
+    Surface surface;
+    surface.position = fragmentPosition;
+    surface.normal = normalize(fragmentVertexNormal);
+    surface.viewDir = normalize(camera.position.xyz - fragmentPosition);
+    surface.textureCoordinate = textureCoordinate;
+    surface.albedo = surfaceColor.rgb;
+    surface.diffuseAlbedo = material.diffuseColor * surfaceColor.rgb;
+    surface.specularAlbedo = material.specularColor * surfaceColor.rgb;
+    vec3 phongResult = vec3(0.0f);
+
+    // == =====================================================
+    // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
+    // For each phase, a calculate function is defined that calculates the corresponding color
+    // per light source. In the main() function we take all the calculated colors and sum them 
+    // up for this fragment's final color.
+    // == =====================================================
+    // phase 1: directional lighting
+#if DIRECTIONAL_LIGHT
+    phongResult += CalcDirectionalLight(directionalLight, surface);
+#endif
+    // phase 2: point lights
+#if POINT_LIGHTS == 2
+    // only the lights whose range reaches the cluster of the fragment
+    float viewDistance = -(camera.view * vec4(fragmentPosition, 1.0f)).z;
+    ivec3 cluster = ivec3(
+        int(gl_FragCoord.x / clusterDepth.z),
+        int(gl_FragCoord.y / clusterDepth.w),
+        int(floor(log(max(viewDistance, 0.0001f)) * clusterDepth.x + clusterDepth.y)));
+    cluster = clamp(cluster, ivec3(0), clusterGrid.xyz - 1);
+    int clusterIndex = cluster.x + clusterGrid.x * (cluster.y + clusterGrid.y * cluster.z);
+    uvec2 lightRange = texelFetch(clusterLightRanges, clusterIndex).xy;
+    for(uint i = 0u; i < lightRange.y; i++)
     {
-        vec3 phongResult = vec3(0.0f);
-        // properties
-        vec3 norm = normalize(fragmentVertexNormal);
-        vec3 viewDir = normalize(viewPosition - fragmentPosition);
-    
-        // == =====================================================
-        // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
-        // For each phase, a calculate function is defined that calculates the corresponding color
-        // per light source. In the main() function we take all the calculated colors and sum them 
-        // up for this fragment's final color.
-        // == =====================================================
-        // phase 1: directional lighting
-        if(directionalLight.bActive == true)
-        {
-            phongResult += CalcDirectionalLight(directionalLight, norm, viewDir);
-        }
-        // phase 2: point lights
-        for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
-        {
-	    if(pointLights[i].bActive == true)
-            {
-                phongResult += CalcPointLight(pointLights[i], norm, fragmentPosition, viewDir);   
-            }
-        } 
-        // phase 3: spot light
-        if(spotLight.bActive == true)
-        {
-            phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);    
-        }
-    
-        if(bUseTexture == true)
-        {
-            fragmentColor = vec4(phongResult, (texture(objectTexture, fragmentTextureCoordinate)).a);
-        }
-        else
-        {
-            fragmentColor = vec4(phongResult, objectColor.a);
-        }
+        phongResult += CalcPointLight(int(texelFetch(clusterLightIndices, int(lightRange.x + i)).r), surface);
     }
-    else
+#elif POINT_LIGHTS == 1
+    // the loop count is the same for every fragment of the draw
+    for(int i = 0; i < pointLightCount; i++)
     {
-        if(bUseTexture == true)
-        {
-            fragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
-        }
-        else
-        {
-            fragmentColor = objectColor;
-        }
+        phongResult += CalcPointLight(i, surface);
     }
+#endif
+    // phase 3: spot light
+#if SPOT_LIGHT
+    phongResult += CalcSpotLight(spotLight, surface);
+#endif
+
+    fragmentColor = vec4(phongResult, surfaceColor.a);
+#else
+    fragmentColor = SurfaceColor(textureCoordinate);
+#endif
+}
+
+#if LIGHTING_KERNEL == 1
+// gets the diffuse and specular factors of a light arriving from lightDir
+vec2 PhongFactors(Surface surface, vec3 lightDir)
+{
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    return vec2(
+        max(dot(surface.normal, lightDir), 0.0f),
+        pow(max(dot(surface.viewDir, reflectDir), 0.0f), material.shininess));
 }
 
 // calculates the color when using a directional light.
-vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirectionalLight(DirectionalLight light, Surface surface)
+{
+    vec2 factors = PhongFactors(surface, normalize(-light.direction));
+    return light.ambient * surface.albedo
+        + light.diffuse * (factors.x * surface.diffuseAlbedo)
+        + light.specular * (factors.y * surface.specularAlbedo);
+}
+
+// calculates the color of the point light at the passed in index of the
+// light buffer, the specular highlight keeps the color of the light
+vec3 CalcPointLight(int index, Surface surface)
+{
+    vec4 positionRange = texelFetch(pointLightData, index * 4);
+    vec3 toLight = positionRange.xyz - surface.position;
+    float distance = length(toLight);
+    vec2 factors = PhongFactors(surface, toLight / distance);
+
+    vec3 color = texelFetch(pointLightData, index * 4 + 1).rgb * surface.albedo
+        + texelFetch(pointLightData, index * 4 + 2).rgb * (factors.x * surface.diffuseAlbedo)
+        + texelFetch(pointLightData, index * 4 + 3).rgb * (factors.y * material.specularColor);
+
+    // fade out smoothly to nothing at the range of the light
+    float ratio = distance / positionRange.w;
+    ratio *= ratio;
+    float falloff = clamp(1.0f - ratio * ratio, 0.0f, 1.0f);
+    return color * (falloff * falloff);
+}
+
+// calculates the color when using a spot light.
+vec3 CalcSpotLight(SpotLight light, Surface surface)
+{
+    vec3 toLight = light.position - surface.position;
+    float distance = length(toLight);
+    vec3 lightDir = toLight / distance;
+    vec2 factors = PhongFactors(surface, lightDir);
+    // attenuation
+    float attenuation = 1.0f / (light.constant + distance * (light.linear + light.quadratic * distance));
+    // spotlight intensity
+    float theta = dot(lightDir, normalize(-light.direction)); 
+    float intensity = clamp((theta - light.outerCutOff) / (light.cutOff - light.outerCutOff), 0.0f, 1.0f);
+    // combine results
+    vec3 color = light.ambient * surface.albedo
+        + light.diffuse * (factors.x * surface.diffuseAlbedo)
+        + light.specular * (factors.y * surface.specularAlbedo);
+    return color * (attenuation * intensity);
+}
+#else
+// the previous kernel, kept to measure the shared one against - every
+// light works out its own factors, samples the surface again for each
+// of its terms and scales the material colors by it, and a point
+// light is read into a struct first
+struct PointLight {
+    vec3 position;
+    // the light fades out to nothing at this distance
+    float range;
+    
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+PointLight FetchPointLight(int index)
 {
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular = vec3(0.0f);
+    PointLight light;
+    vec4 positionRange = texelFetch(pointLightData, index * 4);
+    light.position = positionRange.xyz;
+    light.range = positionRange.w;
+    light.ambient = texelFetch(pointLightData, index * 4 + 1).rgb;
+    light.diffuse = texelFetch(pointLightData, index * 4 + 2).rgb;
+    light.specular = texelFetch(pointLightData, index * 4 + 3).rgb;
+    return light;
+}
 
+// calculates the color when using a directional light.
+vec3 CalcDirectionalLight(DirectionalLight light, Surface surface)
+{
     vec3 lightDirection = normalize(-light.direction);
     // diffuse shading
-    float diff = max(dot(normal, lightDirection), 0.0);
+    float diff = max(dot(surface.normal, lightDirection), 0.0);
     // specular shading
-    vec3 reflectDir = reflect(-lightDirection, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    vec3 reflectDir = reflect(-lightDirection, surface.normal);
+    float spec = pow(max(dot(surface.viewDir, reflectDir), 0.0), material.shininess);
     // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
-    }
+    vec3 ambient = light.ambient * vec3(SurfaceColor(surface.textureCoordinate));
+    vec3 diffuse = light.diffuse * diff * material.diffuseColor * vec3(SurfaceColor(surface.textureCoordinate));
+    vec3 specular = light.specular * spec * material.specularColor * vec3(SurfaceColor(surface.textureCoordinate));
     
     return (ambient + diffuse + specular);
 }
 
 // calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcPointLight(int index, Surface surface)
 {
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular= vec3(0.0f);
-
-    vec3 lightDir = normalize(light.position - fragPos);
+    PointLight light = FetchPointLight(index);
+    vec3 lightDir = normalize(light.position - surface.position);
     // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
+    float diff = max(dot(surface.normal, lightDir), 0.0);
     // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
     // Calculate specular component
-    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    float specularComponent = pow(max(dot(surface.viewDir, reflectDir), 0.0), material.shininess);
    
     // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * specularComponent * material.specularColor;
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * specularComponent * material.specularColor;
-    }
+    vec3 ambient = light.ambient * vec3(SurfaceColor(surface.textureCoordinate));
+    vec3 diffuse = light.diffuse * diff * material.diffuseColor * vec3(SurfaceColor(surface.textureCoordinate));
+    vec3 specular = light.specular * specularComponent * material.specularColor;
     
-    return (ambient + diffuse + specular);
+    // fade out smoothly to nothing at the range of the light
+    float falloff = clamp(1.0f - pow(length(light.position - surface.position) / light.range, 4.0f), 0.0f, 1.0f);
+    
+    return ((ambient + diffuse + specular) * falloff * falloff);
 }
 
 // calculates the color when using a spot light.
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcSpotLight(SpotLight light, Surface surface)
 {
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular = vec3(0.0f);
-
-    vec3 lightDir = normalize(light.position - fragPos);
+    vec3 lightDir = normalize(light.position - surface.position);
     // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
+    float diff = max(dot(surface.normal, lightDir), 0.0);
     // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    vec3 reflectDir = reflect(-lightDir, surface.normal);
+    float spec = pow(max(dot(surface.viewDir, reflectDir), 0.0), material.shininess);
     // attenuation
-    float distance = length(light.position - fragPos);
+    float distance = length(light.position - surface.position);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
     // spotlight intensity
     float theta = dot(lightDir, normalize(-light.direction)); 
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
-    }
+    vec3 ambient = light.ambient * vec3(SurfaceColor(surface.textureCoordinate));
+    vec3 diffuse = light.diffuse * diff * material.diffuseColor * vec3(SurfaceColor(surface.textureCoordinate));
+    vec3 specular = light.specular * spec * material.specularColor * vec3(SurfaceColor(surface.textureCoordinate));
     
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
     return (ambient + diffuse + specular);
 }
+#endif
+
+// gets the color of the surface, from the texture the variant samples
+// or the object color
+vec4 SurfaceColor(vec2 textureCoordinate)
+{
+#if TEXTURE_SOURCE == 0
+    return objectColor;
+#else
+    return SampleObjectTexture(textureCoordinate);
+#endif
+}
+
+// samples the object texture from the source the variant was compiled for
+vec4 SampleObjectTexture(vec2 textureCoordinate)
+{
+#if TEXTURE_SOURCE == 3
+    return SampleVirtualTexture(textureCoordinate);
+#elif TEXTURE_SOURCE == 2
+    vec3 layerCoordinate = vec3(textureCoordinate, float(textureLayer));
+    // while the finer levels of the layer are still being uploaded, the
+    // level is worked out here and kept to the levels already there
+    if (textureLayerMinLevel > 0.0f)
+    {
+        vec2 texels = textureCoordinate * vec2(textureSize(objectTextureArray, 0).xy);
+        vec2 dx = dFdx(texels);
+        vec2 dy = dFdy(texels);
+        float level = 0.5f * log2(max(dot(dx, dx), dot(dy, dy)));
+        return textureLod(objectTextureArray, layerCoordinate, max(level, textureLayerMinLevel));
+    }
+    return texture(objectTextureArray, layerCoordinate);
+#else
+    return texture(objectTexture, textureCoordinate);
+#endif
+}
+
+// gets the mip level of the virtual texture from the screen space derivatives
+float VirtualMipLevel(vec2 textureCoordinate)
+{
+    vec2 texelCoordinate = textureCoordinate * vec2(textureSize(virtualPageTable, 0)) * virtualTextureInfo.x;
+    vec2 dx = dFdx(texelCoordinate);
+    vec2 dy = dFdy(texelCoordinate);
+    float level = 0.5f * log2(max(dot(dx, dx), dot(dy, dy))) + virtualMipBias;
+    return clamp(floor(level), 0.0f, virtualTextureInfo.w - 1.0f);
+}
+
+// encodes the virtual texture tile sampled by the fragment for the feedback pass
+vec4 VirtualTextureFeedback(vec2 textureCoordinate)
+{
+    float level = VirtualMipLevel(textureCoordinate);
+    vec2 pages = vec2(textureSize(virtualPageTable, int(level)));
+    vec2 page = min(floor(fract(textureCoordinate) * pages), pages - 1.0f);
+    return vec4(page, level, float(virtualTextureID + 1)) / 255.0f;
+}
+
+// samples the virtual texture from the tile cache through its page table
+vec4 SampleVirtualTexture(vec2 textureCoordinate)
+{
+    float level = VirtualMipLevel(textureCoordinate);
+    vec2 uv = fract(textureCoordinate);
+    vec2 pages = vec2(textureSize(virtualPageTable, int(level)));
+    ivec2 page = ivec2(min(floor(uv * pages), pages - 1.0f));
+
+    // the entry holds the cache slot and the mip level of the closest
+    // resident tile, which may be coarser than the level asked for
+    vec4 entry = floor(texelFetch(virtualPageTable, page, int(level)) * 255.0f + 0.5f);
+    vec2 texel = uv * vec2(textureSize(virtualPageTable, int(entry.z))) * virtualTextureInfo.x;
+    vec2 tileTexel = texel - floor(texel / virtualTextureInfo.x) * virtualTextureInfo.x;
+    vec2 cacheTexel = entry.xy * (virtualTextureInfo.x + 2.0f * virtualTextureInfo.y) + virtualTextureInfo.y + tileTexel;
+    return textureLod(virtualTileCache, cacheTexel / virtualTextureInfo.z, 0.0f);
+}
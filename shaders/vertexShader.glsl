@@ -7,14 +7,18 @@ out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
 
+// world matrix of the object, its product with the view and projection
+// of the camera, and the inverse transpose of its upper 3x3 that turns
+// the normals, all worked out once per object
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat4 modelViewProjection;
+uniform mat3 normalMatrix;
 
 void main()
 {
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
-   fragmentVertexNormal = inVertexNormal;
+   vec4 position = vec4(inVertexPosition, 1.0f);
+   fragmentPosition = vec3(model * position);
+   gl_Position = modelViewProjection * position;
+   fragmentVertexNormal = normalMatrix * inVertexNormal;
    fragmentTextureCoordinate = inTextureCoordinate;
-}
\ No newline at end of file
+}